@@ -0,0 +1,94 @@
+/**
+ * @file UDP_bench.c
+ * @brief Micro-benchmarks for the core library shared by the client and the server.
+ * @details Runs the requested benchmark suites (all of them by default) and prints
+ * the cost of each operation. The same binary is used as the training workload
+ * for profile-guided builds.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "libs/harness/harness.h"	/**< Include the benchmark harness */
+#include "libs/suites/suites.h"		/**< Include the benchmark suites */
+
+/**
+ * @brief Associates a suite name with the function running it.
+ */
+typedef struct {
+    const char *name;		/**< Name used on the command line */
+    void (*run)(void);		/**< Function running the suite */
+} Suite;
+
+static const Suite suites[] = {
+    { "generator", bench_generator },
+    { "codec", bench_codec },
+    { "engine", bench_engine },
+    { "aead", bench_aead },
+    { "sketch", bench_sketch },
+    { "gossip", bench_gossip },
+    { "identifier", bench_identifier },
+    { "template", bench_template },
+    { "packing", bench_packing },
+#if defined PASSGEN_AUDIT
+    { "audit", bench_audit },
+#endif
+};
+
+#define SUITE_COUNT (sizeof(suites) / sizeof(suites[0]))	/**< Number of registered suites */
+
+/**
+ * @brief Prints the command line usage.
+ * @param[in] program The name of the executable.
+ */
+void show_usage(const char *program) {
+    printf("Usage: %s [-t MILLISECONDS] [SUITE...]\n", program);
+    printf("  -t MILLISECONDS  minimum measurement time per benchmark (default 200)\n");
+    printf("Suites:");
+    for (size_t i = 0; i < SUITE_COUNT; i++) {
+        printf(" %s", suites[i].name);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Entry point for the benchmark program.
+ * @param[in] argc Number of command line arguments.
+ * @param[in] argv Command line arguments.
+ * @return EXIT_SUCCESS The selected suites ran.
+ * @return EXIT_FAILURE An unknown option or suite was given.
+ */
+int main(int argc, char *argv[]) {
+    bool selected[SUITE_COUNT] = { false };
+    bool any_selected = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            bench_set_min_duration((unsigned int)atoi(argv[++i]));
+            continue;
+        }
+
+        bool found = false;
+        for (size_t s = 0; s < SUITE_COUNT; s++) {
+            if (strcmp(argv[i], suites[s].name) == 0) {
+                selected[s] = any_selected = found = true;
+            }
+        }
+        if (!found) {
+            show_usage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (size_t s = 0; s < SUITE_COUNT; s++) {
+        if (!any_selected || selected[s]) {
+            suites[s].run();
+        }
+    }
+    return EXIT_SUCCESS;
+}
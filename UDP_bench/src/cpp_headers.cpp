@@ -0,0 +1,149 @@
+/**
+ * @file cpp_headers.cpp
+ * @brief Builds and runs the C++ headers of the core library (`engine.hpp`, `client.hpp`).
+ * @details Compiled as C++20 with the same warnings as the C code, so that the
+ * headers keep compiling as the C API under them changes, and run by the
+ * `cpp-check` target. Every example of the headers' documentation is exercised
+ * as written: the engine directly, the coroutine client against its local
+ * engine (no network), and the deadline and cancellation paths against a
+ * socket that never answers. With `-DPASSGEN_FUZZ=ON` it is built under
+ * AddressSanitizer and UndefinedBehaviorSanitizer.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <stop_token>
+#include <thread>
+
+#include "libs/client/client.hpp"
+#include "libs/engine/engine.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+int failures = 0;	/**< Checks that failed */
+
+void expect(bool condition, const char *what) {
+    if (!condition) {
+        std::printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - ENGINE - - - - - - - - - - - - - - - - - - - - */
+
+void check_engine() {
+    passgen::Context context;
+    thread_local passgen::Engine engine(context);
+
+    std::string password = engine.generate('s', 16);
+    expect(password.size() == 16, "engine.generate returns a password of the requested length");
+    expect(engine.generate_list('a', 12, 8).size() == 8, "engine.generate_list returns every password");
+    expect(engine.generate_template("Cvc-9999", 8).size() == 8, "engine.generate_template follows the template");
+    expect(passgen::entropy_bits('n', 10) > 33.0, "entropy_bits of 10 digits");
+
+    bool thrown = false;
+    try {
+        engine.generate('?', 16);
+    } catch (const passgen::Error &error) {
+        thrown = error.status() != PASSGEN_OK;
+    }
+    expect(thrown, "an unknown type throws passgen::Error");
+}
+
+/* - - - - - - - - - - - - - - - - - - - END ENGINE - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLIENT - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief The example of `client.hpp`, verbatim: braced options built in the `co_await` expression.
+ */
+passgen::Task<passgen::AsyncError> fetch(passgen::AsyncClient &client, std::stop_token stop) {
+    auto password = co_await client.generate('s', 16, { .deadline = passgen::after(50ms), .stop = stop });
+    if (password) {
+        expect(password.value.view().size() == 16, "the awaited password has the requested length");
+    }
+    co_return password.error;
+}
+
+passgen::Task<size_t> fetch_batch(passgen::AsyncClient &client) {
+    char output[10 * 12];
+    auto received = co_await client.generate_batch('a', 12, output, { .deadline = passgen::after(50ms) });
+    co_return received ? received.value : 0;
+}
+
+/**
+ * @brief Runs a top-level task on the client's reactor and returns its result.
+ */
+template <class T>
+T run(passgen::AsyncClient &client, passgen::Task<T> task) {
+    task.start();
+    client.run();
+    return task.result();
+}
+
+void check_client(const sockaddr_in &silent) {
+    {
+        passgen::AsyncClient client(silent);
+        client_set_local_policy(&client.raw(), CLIENT_LOCAL_ALWAYS, 0);
+        std::stop_source source;
+        expect(run(client, fetch(client, source.get_token())) == passgen::AsyncError::none,
+               "a password is generated through the local engine");
+        expect(run(client, fetch_batch(client)) == 10, "a batch fills the caller's buffer");
+    }
+    {
+        passgen::AsyncClient client(silent);
+        std::stop_source source;
+        expect(run(client, fetch(client, source.get_token())) == passgen::AsyncError::deadline_exceeded,
+               "a silent server makes the request miss its deadline");
+    }
+    {
+        passgen::AsyncClient client(silent);
+        std::stop_source source;
+        passgen::Task<passgen::AsyncError> task = fetch(client, source.get_token());
+        task.start();
+        std::thread stopper([&source] {
+            std::this_thread::sleep_for(10ms);
+            source.request_stop();		/**< From another thread, as documented */
+        });
+        client.run();
+        stopper.join();
+        expect(task.result() == passgen::AsyncError::cancelled, "a stop request cancels the request");
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLIENT - - - - - - - - - - - - - - - - - - - */
+
+} // namespace
+
+int main() {
+    /* A bound socket that is never read: requests sent to it are never answered */
+    int silent_socket = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in silent = {};
+    socklen_t size = sizeof(silent);
+    silent.sin_family = AF_INET;
+    silent.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (silent_socket < 0 || bind(silent_socket, reinterpret_cast<sockaddr *>(&silent), sizeof(silent)) != 0
+        || getsockname(silent_socket, reinterpret_cast<sockaddr *>(&silent), &size) != 0) {
+        std::printf("cannot bind the silent socket\n");
+        return 1;
+    }
+
+    std::printf("engine.hpp\n");
+    check_engine();
+    std::printf("client.hpp\n");
+    check_client(silent);
+    close(silent_socket);
+
+    std::printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,63 @@
+/**
+ * @file harness.c
+ * @brief Implementation of the micro-benchmark harness.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <time.h>
+#include "harness.h"
+
+static unsigned int min_duration_ms = 200;	/**< Minimum time spent measuring each benchmark */
+static volatile uint64_t sink;				/**< Keeps benchmark results observable */
+
+/* - - - - - - - - - - - - - - - - - - - - CLOCK - - - - - - - - - - - - - - - - - - - - */
+
+uint64_t bench_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + (uint64_t)now.tv_nsec;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLOCK - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RUNNER - - - - - - - - - - - - - - - - - - - - */
+
+void bench_set_min_duration(unsigned int duration_ms) {
+    min_duration_ms = duration_ms;
+}
+
+void bench_section(const char *title) {
+    printf("\n== %s ==\n", title);
+}
+
+double bench_run(const char *name, BenchBody body, void *context, size_t bytes_per_op) {
+    uint64_t iterations = 1;
+    uint64_t elapsed_ns = 0;
+    uint64_t min_ns = (uint64_t)min_duration_ms * 1000000ull;
+
+    sink += body(context, 1);	/**< Warm-up: caches, branch predictors, lazy initialisation */
+
+    for (;;) {
+        uint64_t start = bench_now_ns();
+        sink += body(context, iterations);
+        elapsed_ns = bench_now_ns() - start;
+        if (elapsed_ns >= min_ns || iterations >= (1ull << 40)) {
+            break;
+        }
+        iterations *= 2;
+    }
+
+    double ns_per_op = (double)elapsed_ns / (double)iterations;
+    printf("  %-40s %10.2f ns/op %10.2f Mops/s", name, ns_per_op, 1e3 / ns_per_op);
+    if (bytes_per_op > 0) {
+        printf(" %10.1f MB/s", (double)bytes_per_op * 1e3 / ns_per_op);
+    }
+    printf("\n");
+    fflush(stdout);
+    return ns_per_op;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END RUNNER - - - - - - - - - - - - - - - - - - - */
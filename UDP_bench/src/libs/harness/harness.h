@@ -0,0 +1,82 @@
+/**
+ * @file harness.h
+ * @brief Minimal micro-benchmark harness shared by every benchmark suite.
+ *
+ * The harness measures wall-clock time with a monotonic clock, repeats a
+ * measured body until a minimum duration is reached and prints one aligned
+ * line per benchmark (nanoseconds per operation and millions of operations
+ * per second), so that results from different suites can be compared.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef HARNESS_H_
+#define HARNESS_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* - - - - - - - - - - - - - - - - - - - - CLOCK - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Returns the current value of the monotonic clock in nanoseconds.
+ * @return Nanoseconds elapsed since an arbitrary, fixed point in the past.
+ */
+uint64_t bench_now_ns(void);
+
+/* - - - - - - - - - - - - - - - - - - - END CLOCK - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RUNNER - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Body of a benchmark.
+ *
+ * The body must perform exactly `iterations` operations on `context` and
+ * return a value derived from the work done, so that the compiler cannot
+ * discard it as dead code.
+ */
+typedef uint64_t (*BenchBody)(void *context, uint64_t iterations);
+
+/**
+ * @brief Prevents the compiler from optimising away the memory pointed to by `pointer`.
+ *
+ * Benchmark bodies call it after each operation whose result is otherwise
+ * unused, so that link-time optimisation cannot hoist or drop the work.
+ *
+ * @param[in] pointer Memory that must be considered read and written.
+ */
+static inline void bench_do_not_optimize(const void *pointer) {
+    __asm__ volatile("" : : "g"(pointer) : "memory");
+}
+
+/**
+ * @brief Runs a benchmark body and prints its throughput.
+ *
+ * The body is first run once as warm-up, then repeatedly with a doubling
+ * number of iterations until it runs for at least `min_duration_ms`.
+ *
+ * @param[in] name Label printed in the report line.
+ * @param[in] body The benchmark body to measure.
+ * @param[in] context Opaque pointer forwarded to `body`.
+ * @param[in] bytes_per_op Bytes produced per operation (0 to omit the bandwidth column).
+ * @return The measured cost of one operation, in nanoseconds.
+ */
+double bench_run(const char *name, BenchBody body, void *context, size_t bytes_per_op);
+
+/**
+ * @brief Sets the minimum duration of every measurement (default 200 ms).
+ * @param[in] min_duration_ms Minimum measurement time in milliseconds.
+ */
+void bench_set_min_duration(unsigned int min_duration_ms);
+
+/**
+ * @brief Prints a section title to separate the output of different suites.
+ * @param[in] title The title of the section.
+ */
+void bench_section(const char *title);
+
+/* - - - - - - - - - - - - - - - - - - - END RUNNER - - - - - - - - - - - - - - - - - - - */
+
+#endif /* HARNESS_H_ */
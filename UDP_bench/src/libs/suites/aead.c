@@ -0,0 +1,115 @@
+/**
+ * @file aead.c
+ * @brief Benchmark suite for the encrypted responses.
+ * @details Measures ChaCha20-Poly1305 over response-sized payloads, then the cost
+ * it adds to a server answer: the engine answering a batch of secure/16 passwords,
+ * with and without sealing the response in place.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libs/aead/aead.h"
+#include "libs/codec/codec.h"
+#include "libs/engine/engine.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+/**
+ * @brief Parameters of a single AEAD benchmark.
+ */
+typedef struct {
+    PassgenEngine *engine;							/**< Engine answering the requests */
+    unsigned char key[AEAD_KEY_SIZE];				/**< Key of the sealed responses */
+    uint64_t nonce_counter;							/**< Next nonce counter */
+    size_t size;									/**< Payload size of the raw benchmarks */
+    unsigned char request[MAX_DATAGRAM_SIZE];		/**< Encoded batch request */
+    size_t request_size;							/**< Size of `request` */
+    unsigned char response[MAX_DATAGRAM_SIZE];		/**< Response buffer */
+} AeadCase;
+
+static uint64_t run_seal(void *context, uint64_t iterations) {
+    AeadCase *test_case = context;
+    unsigned char nonce[AEAD_NONCE_SIZE] = { 0 };
+    unsigned char tag[AEAD_TAG_SIZE];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(nonce + 4, &i, sizeof(i));
+        aead_seal(test_case->key, nonce, test_case->response, RESPONSE_HEADER_SIZE,
+                  test_case->response + RESPONSE_HEADER_SIZE, test_case->size, tag);
+        bench_do_not_optimize(test_case->response);
+        checksum += tag[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_respond(void *context, uint64_t iterations) {
+    AeadCase *test_case = context;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += passgen_engine_respond(test_case->engine, test_case->request, test_case->request_size,
+                                        test_case->response, sizeof(test_case->response));
+        bench_do_not_optimize(test_case->response);
+    }
+    return total;
+}
+
+/**
+ * @brief The server path of an encrypted request: the same answer, then sealed in place.
+ */
+static uint64_t run_respond_sealed(void *context, uint64_t iterations) {
+    AeadCase *test_case = context;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        size_t size = passgen_engine_respond(test_case->engine, test_case->request, test_case->request_size,
+                                             test_case->response, sizeof(test_case->response));
+        total += codec_seal_response(test_case->response, size, sizeof(test_case->response), test_case->key,
+                                     test_case->nonce_counter++);
+        bench_do_not_optimize(test_case->response);
+    }
+    return total;
+}
+
+void bench_aead(void) {
+    static AeadCase test_case;
+    static const size_t sizes[] = { 16, 64, 256, (size_t)MAX_SEALED_BATCH_COUNT(16) * 16 };
+    PassgenContext *context;
+    char name[64];
+
+    for (size_t i = 0; i < sizeof(test_case.key); i++) {
+        test_case.key[i] = (unsigned char)i;
+    }
+
+    bench_section("ChaCha20-Poly1305 (header as additional data)");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        test_case.size = sizes[i];
+        snprintf(name, sizeof(name), "seal %zu bytes", sizes[i]);
+        bench_run(name, run_seal, &test_case, sizes[i]);
+    }
+
+    bench_section("encrypted responses (sealed -> plain)");
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    /* The same number of passwords both ways: the trailer takes the room of two of them */
+    RequestView spec = { .type = 's', .length = 16, .count = (uint16_t)MAX_SEALED_BATCH_COUNT(16),
+                         .operation = OP_GENERATE, .key_id = 1 };
+    test_case.request_size = codec_encode_request(test_case.request, sizeof(test_case.request), &spec);
+    size_t bytes = (size_t)spec.count * spec.length;
+    double sealed = bench_run("respond + seal secure/16 batch", run_respond_sealed, &test_case, bytes);
+    double plain = bench_run("respond secure/16 batch", run_respond, &test_case, bytes);
+    printf("  %-40s %9.2fx sealed vs plain\n", "  overhead", sealed / plain);
+
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
@@ -0,0 +1,152 @@
+/**
+ * @file audit.c
+ * @brief Benchmark suite for the audit log.
+ * @details Measures what recording the issued passwords costs the thread serving
+ * the requests at full load: the engine answering a batch of secure/16 passwords,
+ * with and without queueing the records, while the writer thread commits them to
+ * a log in a temporary directory. Also reports whether the writer kept up.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "libs/audit/audit.h"
+#include "libs/codec/codec.h"
+#include "libs/engine/engine.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+/**
+ * @brief Parameters of a single audit benchmark.
+ */
+typedef struct {
+    PassgenEngine *engine;							/**< Engine answering the requests */
+    AuditLog log;									/**< Log being written */
+    RequestView spec;								/**< The batch request, decoded */
+    struct sockaddr_in client;						/**< Client the passwords are issued to */
+    unsigned char request[MAX_DATAGRAM_SIZE];		/**< Encoded batch request */
+    size_t request_size;							/**< Size of `request` */
+    unsigned char response[MAX_DATAGRAM_SIZE];		/**< Response buffer */
+} AuditCase;
+
+static uint64_t run_respond(void *context, uint64_t iterations) {
+    AuditCase *test_case = context;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += passgen_engine_respond(test_case->engine, test_case->request, test_case->request_size,
+                                        test_case->response, sizeof(test_case->response));
+        bench_do_not_optimize(test_case->response);
+    }
+    return total;
+}
+
+/**
+ * @brief The server path with the audit log: the same answer, then its passwords queued for the writer.
+ */
+static uint64_t run_respond_audited(void *context, uint64_t iterations) {
+    AuditCase *test_case = context;
+    const RequestView *spec = &test_case->spec;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += passgen_engine_respond(test_case->engine, test_case->request, test_case->request_size,
+                                        test_case->response, sizeof(test_case->response));
+        total += audit_issue(&test_case->log, &test_case->client, 0, (uint32_t)i, spec->type, spec->length,
+                             codec_response_password(test_case->response, spec, 0), spec->length, spec->count);
+    }
+    return total;
+}
+
+/**
+ * @brief Queueing alone, one record per call as for single-password requests.
+ */
+static uint64_t run_issue(void *context, uint64_t iterations) {
+    AuditCase *test_case = context;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += audit_issue(&test_case->log, &test_case->client, 0, (uint32_t)i, 's', 16,
+                             (const char *)test_case->response + RESPONSE_HEADER_SIZE, 16, 1);
+    }
+    return total;
+}
+
+/**
+ * @brief Deletes the segments written in the temporary directory, then the directory.
+ */
+static void remove_log(const char *directory) {
+    DIR *listing = opendir(directory);
+    char path[AUDIT_PATH_SIZE];
+    if (listing != NULL) {
+        for (struct dirent *entry = readdir(listing); entry != NULL; entry = readdir(listing)) {
+            if (strncmp(entry->d_name, "audit-", 6) == 0) {
+                snprintf(path, sizeof(path), "%s/%s", directory, entry->d_name);
+                unlink(path);
+            }
+        }
+        closedir(listing);
+    }
+    rmdir(directory);
+}
+
+void bench_audit(void) {
+    static AuditCase test_case;
+    char directory[] = "/tmp/passgen-audit-XXXXXX";
+    PassgenContext *context;
+
+    bench_section("audit log (issued passwords -> ring -> writer thread)");
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    AuditOptions options = { .directory = mkdtemp(directory), .segment_size = AUDIT_DEFAULT_SEGMENT_SIZE,
+                             .sync_interval_ms = AUDIT_DEFAULT_SYNC_MS };
+    for (size_t i = 0; i < sizeof(options.key); i++) {
+        options.key[i] = (unsigned char)i;
+    }
+    if (options.directory == NULL || !audit_open(&test_case.log, &options)) {
+        printf("  cannot open the log in a temporary directory\n");
+        if (options.directory != NULL) {
+            remove_log(directory);
+        }
+        passgen_engine_destroy(test_case.engine);
+        passgen_context_destroy(context);
+        return;
+    }
+
+    test_case.spec = (RequestView){ .type = 's', .length = 16, .count = (uint16_t)MAX_BATCH_COUNT(16),
+                                    .operation = OP_GENERATE };
+    test_case.request_size = codec_encode_request(test_case.request, sizeof(test_case.request), &test_case.spec);
+    test_case.client = (struct sockaddr_in){ .sin_family = AF_INET, .sin_port = htons(40000),
+                                             .sin_addr.s_addr = htonl(0x7F000001) };
+    size_t bytes = (size_t)test_case.spec.count * test_case.spec.length;
+    double audited = bench_run("respond + audit secure/16 batch", run_respond_audited, &test_case, bytes);
+    double plain = bench_run("respond secure/16 batch", run_respond, &test_case, bytes);
+    printf("  %-40s %9.2fx audited vs plain\n", "  overhead", audited / plain);
+    bench_run("audit one password", run_issue, &test_case, 16);
+
+    uint64_t start_ns = bench_now_ns();
+    audit_close(&test_case.log);
+    uint64_t close_ns = bench_now_ns() - start_ns;
+    AuditStats stats;
+    audit_stats(&test_case.log, &stats);
+    printf("  %-40s %llu records, %llu written in %llu blocks, %llu segments, %llu syncs\n", "log",
+           (unsigned long long)stats.records, (unsigned long long)stats.written, (unsigned long long)stats.blocks,
+           (unsigned long long)stats.segments, (unsigned long long)stats.syncs);
+    printf("  %-40s %llu stalls, %.1f ms to drain and close%s\n", "writer", (unsigned long long)stats.stalls,
+           close_ns / 1e6, audit_failed(&test_case.log) ? ", FAILED" : "");
+
+    remove_log(directory);
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
@@ -0,0 +1,127 @@
+/**
+ * @file codec.c
+ * @brief Benchmark suite for the in-place message codec.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "libs/codec/codec.h"
+#include "libs/siphash/siphash.h"
+#include "libs/password/password.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+static const unsigned char tenant_key[SIPHASH_KEY_SIZE] = {	/**< Key of the signed requests */
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+};
+
+/**
+ * @brief Buffers shared by the codec benchmarks.
+ */
+typedef struct {
+    unsigned char request[MAX_DATAGRAM_SIZE];		/**< Encoded request */
+    size_t request_size;							/**< Size of the encoded request */
+    unsigned char response[MAX_DATAGRAM_SIZE];		/**< Encoded response */
+    size_t response_size;							/**< Size of the encoded response */
+    RequestView spec;								/**< Request being encoded */
+} CodecContext;
+
+static uint64_t run_encode_request(void *context, uint64_t iterations) {
+    CodecContext *codec = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        codec->spec.request_id = (uint32_t)i;
+        total += codec_encode_request(codec->request, sizeof(codec->request), &codec->spec);
+        bench_do_not_optimize(codec->request);
+    }
+    return total;
+}
+
+static uint64_t run_decode_request(void *context, uint64_t iterations) {
+    CodecContext *codec = context;
+    RequestView view;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        bench_do_not_optimize(codec->request);
+        total += codec_decode_request(codec->request, codec->request_size, &view) + view.length;
+    }
+    return total;
+}
+
+/**
+ * @brief What a server serving tenants does before admitting a request: decode it and check its MAC.
+ */
+static uint64_t run_decode_verify_request(void *context, uint64_t iterations) {
+    CodecContext *codec = context;
+    RequestView view;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        bench_do_not_optimize(codec->request);
+        total += codec_decode_request(codec->request, codec->request_size, &view) + codec_verify_request(&view, tenant_key);
+    }
+    return total;
+}
+
+static uint64_t run_encode_response(void *context, uint64_t iterations) {
+    CodecContext *codec = context;
+    uint64_t total = 0;
+    uint16_t count = codec_response_count(&codec->spec);
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += codec_encode_response(codec->response, sizeof(codec->response), &codec->spec, STATUS_OK, count);
+        bench_do_not_optimize(codec->response);
+    }
+    return total;
+}
+
+static uint64_t run_decode_response(void *context, uint64_t iterations) {
+    CodecContext *codec = context;
+    ResponseView view;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        bench_do_not_optimize(codec->response);
+        total += codec_decode_response(codec->response, codec->response_size, &view) + view.count;
+    }
+    return total;
+}
+
+void bench_codec(void) {
+    static CodecContext codec;
+    RequestView view;
+
+    bench_section("codec");
+
+    codec.spec = (RequestView){ .type = 's', .length = 16, .count = 1 };
+    codec.request_size = codec_encode_request(codec.request, sizeof(codec.request), &codec.spec);
+    bench_run("encode_request", run_encode_request, &codec, codec.request_size);
+    bench_run("decode_request/compact", run_decode_request, &codec, codec.request_size);
+
+    /* A client request of a tenant, with its deadline and cookie extensions */
+    RequestView signed_spec = { .type = 's', .length = 16, .count = 1, .deadline_us = 500000,
+                                .cookie = 0x0123456789ABCDEFull, .tenant_id = 7, .tenant_time = 1734220800 };
+    codec.request_size = codec_sign_request(codec.request, codec_encode_request(codec.request, sizeof(codec.request),
+                                            &signed_spec), sizeof(codec.request), tenant_key);
+    bench_run("decode_request/tenant + verify MAC", run_decode_verify_request, &codec, codec.request_size);
+
+    PasswordRequest legacy;
+    memset(&legacy, 0, sizeof(legacy));
+    legacy.type = 's';
+    strcpy(legacy.length, "16");
+    memcpy(codec.request, &legacy, sizeof(legacy));
+    codec.request_size = sizeof(legacy);
+    bench_run("decode_request/legacy", run_decode_request, &codec, 0);
+
+    for (int batch = 0; batch < 2; batch++) {
+        codec.spec.count = batch ? (uint16_t)MAX_BATCH_COUNT(16) : 1;
+        codec_decode_request(codec.request, codec_encode_request(codec.request, sizeof(codec.request), &codec.spec), &view);
+        codec.response_size = codec_encode_response(codec.response, sizeof(codec.response), &view, STATUS_OK,
+                                                    codec_response_count(&view));
+        bench_run(batch ? "encode_response_header/batch" : "encode_response_header/single",
+                  run_encode_response, &codec, RESPONSE_HEADER_SIZE);
+        bench_run(batch ? "decode_response/batch" : "decode_response/single",
+                  run_decode_response, &codec, codec.response_size);
+    }
+}
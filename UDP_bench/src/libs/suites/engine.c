@@ -0,0 +1,144 @@
+/**
+ * @file engine.c
+ * @brief Benchmark suite for the embedding API.
+ * @details The same calls serve in-process callers and the network server, so
+ * these figures are the generation cost of both: single passwords and batches
+ * under each policy feature, and whole wire requests answered by the engine
+ * next to the direct `generate_response` path.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "libs/engine/engine.h"
+#include "libs/password/password.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+#define ENGINE_BATCH 64		/**< Passwords per batch call */
+
+/**
+ * @brief Parameters of a single engine benchmark.
+ */
+typedef struct {
+    PassgenEngine *engine;							/**< Engine under test */
+    char type;										/**< Password type */
+    unsigned int length;							/**< Password length */
+    unsigned char request[MAX_DATAGRAM_SIZE];		/**< Encoded batch request */
+    size_t request_size;							/**< Size of `request` */
+    unsigned char response[MAX_DATAGRAM_SIZE];		/**< Response buffer */
+} EngineCase;
+
+static uint64_t run_generate(void *context, uint64_t iterations) {
+    EngineCase *test_case = context;
+    char password[MAX_PASSWORD_LENGTH + 1];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        passgen_generate(test_case->engine, test_case->type, test_case->length, password);
+        bench_do_not_optimize(password);
+        checksum += (unsigned char)password[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_batch(void *context, uint64_t iterations) {
+    EngineCase *test_case = context;
+    char passwords[ENGINE_BATCH * MAX_PASSWORD_LENGTH];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        passgen_generate_batch(test_case->engine, test_case->type, test_case->length, ENGINE_BATCH, passwords);
+        bench_do_not_optimize(passwords);
+        checksum += (unsigned char)passwords[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_respond(void *context, uint64_t iterations) {
+    EngineCase *test_case = context;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += passgen_engine_respond(test_case->engine, test_case->request, test_case->request_size,
+                                        test_case->response, sizeof(test_case->response));
+        bench_do_not_optimize(test_case->response);
+    }
+    return total;
+}
+
+static uint64_t run_direct(void *context, uint64_t iterations) {
+    EngineCase *test_case = context;
+    RequestView view;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        codec_decode_request(test_case->request, test_case->request_size, &view);
+        total += generate_response(&view, test_case->response, sizeof(test_case->response));
+        bench_do_not_optimize(test_case->response);
+    }
+    return total;
+}
+
+/**
+ * @brief Runs the single and batch benchmarks of one policy.
+ */
+static void bench_policy(const char *label, const PassgenPolicy *policy) {
+    static EngineCase test_case;
+    PassgenContext *context;
+    char name[64];
+
+    if (passgen_context_create(policy, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  %s: cannot create the engine\n", label);
+        passgen_context_destroy(context);
+        return;
+    }
+    test_case.type = 's';
+    test_case.length = 16;
+
+    snprintf(name, sizeof(name), "%s generate secure/16", label);
+    bench_run(name, run_generate, &test_case, test_case.length);
+    snprintf(name, sizeof(name), "%s batch of %d secure/16", label, ENGINE_BATCH);
+    bench_run(name, run_batch, &test_case, (size_t)ENGINE_BATCH * test_case.length);
+
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
+
+void bench_engine(void) {
+    static EngineCase test_case;
+    PassgenPolicy policy;
+    PassgenContext *context;
+
+    bench_section("embedding API (policy features)");
+    passgen_policy_default(&policy);
+    bench_policy("plain", &policy);
+    policy.require_every_class = true;
+    bench_policy("classes", &policy);
+    policy.require_every_class = false;
+    policy.unique = true;
+    bench_policy("unique", &policy);
+    policy.require_every_class = true;
+    bench_policy("classes+unique", &policy);
+
+    bench_section("wire requests (engine -> direct)");
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    RequestView spec = { .type = 's', .length = 16, .count = (uint16_t)MAX_BATCH_COUNT(16), .operation = OP_GENERATE };
+    test_case.request_size = codec_encode_request(test_case.request, sizeof(test_case.request), &spec);
+    size_t bytes = (size_t)spec.count * spec.length;
+    double engine = bench_run("engine respond secure/16 full batch", run_respond, &test_case, bytes);
+    double direct = bench_run("direct response secure/16 full batch", run_direct, &test_case, bytes);
+    printf("  %-40s %9.2fx engine vs direct\n", "  overhead", engine / direct);
+
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
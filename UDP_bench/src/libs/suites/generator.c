@@ -0,0 +1,147 @@
+/**
+ * @file generator.c
+ * @brief Benchmark suite for the password generation engine.
+ * @details Every password type is measured three ways: the original `rand()` based
+ * implementation with its two `switch` statements (kept here as a reference),
+ * the table-driven generic function and the function specialised for the length.
+ * @version 1.1.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <ctype.h>
+
+#include "libs/generator/generator.h"
+#include "libs/random/random.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+/* - - - - - - - - - - - - - - - - - - REFERENCE IMPLEMENTATION - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief The generation path of the original server: `tolower`, a `switch` on the
+ *        type, a `switch` in `generate_password` and a `rand()` per character.
+ */
+static void reference_generate(char *password, char wire_type, int length) {
+    static const char secure[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%^&*()";
+    static const char unambiguous[] = "abcdefghjkmnpqrtuvwxyACDEFGHJKLMNPQRTUVWXY34679!@#$%^&*()";
+    PasswordType type;
+
+    switch (tolower(wire_type)) {
+        case 'a': type = ALPHA; break;
+        case 'm': type = MIXED; break;
+        case 's': type = SECURE; break;
+        case 'u': type = UNAMBIGUOUS; break;
+        default: type = NUMERIC; break;
+    }
+    switch (type) {
+        case NUMERIC:
+            for (int i = 0; i < length; i++) password[i] = '0' + rand() % 10;
+            break;
+        case ALPHA:
+            for (int i = 0; i < length; i++) password[i] = 'a' + rand() % 26;
+            break;
+        case MIXED:
+            for (int i = 0; i < length; i++) password[i] = (rand() % 2) ? 'a' + rand() % 26 : '0' + rand() % 10;
+            break;
+        case SECURE:
+            for (int i = 0; i < length; i++) password[i] = secure[rand() % (sizeof(secure) - 1)];
+            break;
+        case UNAMBIGUOUS:
+            for (int i = 0; i < length; i++) password[i] = unambiguous[rand() % (sizeof(unambiguous) - 1)];
+            break;
+    }
+    password[length] = '\0';
+}
+
+/* - - - - - - - - - - - - - - - - - END REFERENCE IMPLEMENTATION - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Parameters of a single generator benchmark.
+ */
+typedef struct {
+    char wire_type;			/**< Type byte as received on the wire */
+    int length;				/**< Password length to generate */
+    RandomStream stream;	/**< Deterministically seeded random stream */
+} GeneratorCase;
+
+static uint64_t run_reference(void *context, uint64_t iterations) {
+    GeneratorCase *test_case = context;
+    char password[MAX_PASSWORD_LENGTH + 1];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        reference_generate(password, test_case->wire_type, test_case->length);
+        checksum += (unsigned char)password[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_generic(void *context, uint64_t iterations) {
+    GeneratorCase *test_case = context;
+    char password[MAX_PASSWORD_LENGTH];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Generator *generator = generator_lookup(test_case->wire_type);
+        generator_fill_any(generator, password, (size_t)test_case->length, &test_case->stream);
+        bench_do_not_optimize(password);
+        checksum += (unsigned char)password[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_dispatch(void *context, uint64_t iterations) {
+    GeneratorCase *test_case = context;
+    char password[MAX_PASSWORD_LENGTH];
+    uint64_t checksum = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        const Generator *generator = generator_lookup(test_case->wire_type);
+        generator_fill(generator, password, test_case->length, &test_case->stream);
+        bench_do_not_optimize(password);
+        checksum += (unsigned char)password[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_refill(void *context, uint64_t iterations) {
+    GeneratorCase *test_case = context;
+    for (uint64_t i = 0; i < iterations; i++) {
+        random_stream_refill(&test_case->stream);
+    }
+    return test_case->stream.buffer[0];
+}
+
+void bench_generator(void) {
+    static const char *type_names[] = { "numeric", "alpha", "mixed", "secure", "unambiguous" };
+    static const char wire_types[] = { 'n', 'a', 'm', 's', 'u' };
+    static const int lengths[] = { 8, 12, 16, 32, 20 };
+    static const unsigned char key[RANDOM_KEY_SIZE] = { 1 };
+    static GeneratorCase test_case;
+    char name[64];
+
+    bench_section("random stream");
+    random_stream_init_with_key(&test_case.stream, key);
+    bench_run("chacha20 refill", run_refill, &test_case, RANDOM_MAX_TAKE);
+
+    bench_section("generate_password (reference -> generic -> specialised)");
+    for (int type = NUMERIC; type <= UNAMBIGUOUS; type++) {
+        for (size_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+            test_case.wire_type = wire_types[type];
+            test_case.length = lengths[i];
+
+            snprintf(name, sizeof(name), "%s/%d reference", type_names[type], lengths[i]);
+            double reference = bench_run(name, run_reference, &test_case, (size_t)lengths[i]);
+            snprintf(name, sizeof(name), "%s/%d generic", type_names[type], lengths[i]);
+            double generic = bench_run(name, run_generic, &test_case, (size_t)lengths[i]);
+            snprintf(name, sizeof(name), "%s/%d dispatch", type_names[type], lengths[i]);
+            double dispatch = bench_run(name, run_dispatch, &test_case, (size_t)lengths[i]);
+            printf("  %-40s %9.2fx vs reference, %5.2fx vs generic\n", "  speedup",
+                   reference / dispatch, generic / dispatch);
+        }
+    }
+}
@@ -0,0 +1,146 @@
+/**
+ * @file gossip.c
+ * @brief Benchmark suite for the gossip between the nodes of a cluster.
+ * @details Measures the encoding and the decoding of a delta for a few sizes, then
+ * the bandwidth a node sends each peer at several issuance rates, one delta round
+ * every 10 ms, against sending the 32-bit fingerprints or the 64-bit hashes as such.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libs/harness/harness.h"
+#include "libs/gossip/gossip.h"
+#include "suites.h"
+
+#define GOSSIP_ROUNDS_PER_SECOND 100	/**< One delta round every 10 ms, as the server */
+
+/**
+ * @brief Parameters of a single gossip benchmark.
+ */
+typedef struct {
+    unsigned char mac_key[SIPHASH_KEY_SIZE];		/**< Key of the MACs */
+    uint32_t source[GOSSIP_MAX_DELTA_COUNT];		/**< Fingerprints in issuance order */
+    uint32_t fingerprints[GOSSIP_MAX_DELTA_COUNT];	/**< Copy the encoder sorts */
+    size_t count;									/**< Fingerprints of the delta */
+    unsigned char datagram[GOSSIP_DATAGRAM_SIZE];	/**< The encoded delta */
+    size_t size;									/**< Its size */
+} GossipCase;
+
+/**
+ * @brief Fills `count` entries with random fingerprints.
+ */
+static void fill_fingerprints(uint32_t *fingerprints, size_t count, uint64_t seed) {
+    uint64_t state = seed | 1;
+    for (size_t i = 0; i < count; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        fingerprints[i] = (uint32_t)(state >> 32);
+    }
+}
+
+/**
+ * @brief Encodes as much of `test_case->source` as fits in one delta.
+ * @return The number of fingerprints taken.
+ */
+static size_t encode_case(GossipCase *test_case, uint64_t first) {
+    size_t taken;
+    memcpy(test_case->fingerprints, test_case->source, test_case->count * sizeof(uint32_t));
+    test_case->size = gossip_encode_delta(test_case->datagram, sizeof(test_case->datagram), test_case->mac_key, 1, 1,
+                                          1, first, test_case->fingerprints, test_case->count, &taken);
+    return taken;
+}
+
+static uint64_t run_encode(void *context, uint64_t iterations) {
+    GossipCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += encode_case(test_case, i);
+        bench_do_not_optimize(test_case->datagram);
+    }
+    return total;
+}
+
+static uint64_t run_decode(void *context, uint64_t iterations) {
+    GossipCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        GossipMessage message;
+        if (gossip_decode(test_case->datagram, test_case->size, test_case->mac_key, &message)
+            && gossip_delta_fingerprints(&message, test_case->fingerprints, GOSSIP_MAX_DELTA_COUNT)) {
+            total += message.count;
+        }
+        bench_do_not_optimize(test_case->fingerprints);
+    }
+    return total;
+}
+
+/**
+ * @brief Measures a delta of `count` fingerprints and prints its size.
+ */
+static void bench_delta(GossipCase *test_case, size_t count) {
+    char name[64];
+    test_case->count = count;
+    fill_fingerprints(test_case->source, count, count);
+    size_t taken = encode_case(test_case, 0);
+
+    snprintf(name, sizeof(name), "encode, %zu fingerprints", count);
+    bench_run(name, run_encode, test_case, test_case->size);
+    snprintf(name, sizeof(name), "decode, %zu fingerprints", count);
+    bench_run(name, run_decode, test_case, test_case->size);
+    printf("  %-40s %9zu bytes for %zu fingerprints, %.1f bits each\n", "  delta", test_case->size, taken,
+           (double)(test_case->size - GOSSIP_HEADER_SIZE - GOSSIP_MAC_SIZE) * 8 / (double)taken);
+}
+
+/**
+ * @brief Prints the bytes per second a node sends each peer when it issues `rate` passwords per second.
+ */
+static void print_bandwidth(GossipCase *test_case, uint64_t rate) {
+    size_t per_round = (size_t)(rate / GOSSIP_ROUNDS_PER_SECOND);
+    uint64_t round_bytes = 0;
+    uint64_t datagrams = 0;
+
+    fill_fingerprints(test_case->source, GOSSIP_MAX_DELTA_COUNT, rate);
+    for (size_t left = per_round; left > 0; datagrams++) {
+        test_case->count = left < GOSSIP_MAX_DELTA_COUNT ? left : GOSSIP_MAX_DELTA_COUNT;
+        left -= encode_case(test_case, 0);
+        round_bytes += test_case->size;
+    }
+
+    /* The same datagrams, with the fingerprints or the hashes as such instead of their coded set */
+    size_t overhead = GOSSIP_HEADER_SIZE + GOSSIP_MAC_SIZE;
+    size_t raw32_per_datagram = (GOSSIP_DATAGRAM_SIZE - overhead) / sizeof(uint32_t);
+    size_t raw64_per_datagram = (GOSSIP_DATAGRAM_SIZE - overhead) / sizeof(uint64_t);
+    uint64_t raw32 = per_round * sizeof(uint32_t) + (per_round + raw32_per_datagram - 1) / raw32_per_datagram * overhead;
+    uint64_t raw64 = per_round * sizeof(uint64_t) + (per_round + raw64_per_datagram - 1) / raw64_per_datagram * overhead;
+
+    char name[64];
+    snprintf(name, sizeof(name), "%llu passwords/s", (unsigned long long)rate);
+    printf("  %-40s %9.1f KB/s in %llu datagrams/s (32-bit: %.1f KB/s, 64-bit: %.1f KB/s)\n", name,
+           (double)(round_bytes * GOSSIP_ROUNDS_PER_SECOND) / 1000.0,
+           (unsigned long long)(datagrams * GOSSIP_ROUNDS_PER_SECOND),
+           (double)(raw32 * GOSSIP_ROUNDS_PER_SECOND) / 1000.0, (double)(raw64 * GOSSIP_ROUNDS_PER_SECOND) / 1000.0);
+}
+
+void bench_gossip(void) {
+    static GossipCase test_case;
+    static const size_t counts[] = { 10, 100, 1000, GOSSIP_MAX_DELTA_COUNT };
+    static const uint64_t rates[] = { 1000, 10000, 100000, 1000000 };
+    memset(test_case.mac_key, 0x5A, sizeof(test_case.mac_key));
+
+    bench_section("gossip deltas (per datagram)");
+    for (size_t i = 0; i < sizeof(counts) / sizeof(counts[0]); i++) {
+        bench_delta(&test_case, counts[i]);
+    }
+
+    bench_section("gossip bandwidth to each peer (one round every 10 ms)");
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        print_bandwidth(&test_case, rates[i]);
+    }
+}
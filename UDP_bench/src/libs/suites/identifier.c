@@ -0,0 +1,93 @@
+/**
+ * @file identifier.c
+ * @brief Benchmark suite for the identifier generation.
+ * @details Measures the hex and base32 kernels on their own, then a batch of every
+ * identifier type through the embedding API, as the server generates them, and
+ * prints the identifiers per second one engine hands out.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "libs/engine/engine.h"
+#include "libs/identifier/identifier.h"
+#include "libs/protocol/protocol.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+#define IDENTIFIER_BATCH 1024	/**< Identifiers per batch call */
+
+/**
+ * @brief Parameters of a single identifier benchmark.
+ */
+typedef struct {
+    PassgenEngine *engine;								/**< Engine under test */
+    const IdentifierFormat *format;						/**< Identifier type */
+    char output[IDENTIFIER_BATCH * MAX_PASSWORD_LENGTH];	/**< Identifiers of one batch */
+} IdentifierCase;
+
+static uint64_t run_hex64(void *context, uint64_t iterations) {
+    IdentifierCase *test_case = context;
+    uint64_t value = 0x0123456789ABCDEFull;
+    for (uint64_t i = 0; i < iterations; i++) {
+        identifier_hex64(value + i, test_case->output);
+        bench_do_not_optimize(test_case->output);
+    }
+    return (unsigned char)test_case->output[15];
+}
+
+static uint64_t run_base32(void *context, uint64_t iterations) {
+    IdentifierCase *test_case = context;
+    uint64_t high = 0x0123456789ABCDEFull;
+    for (uint64_t i = 0; i < iterations; i++) {
+        identifier_base32(high, i, test_case->output);
+        bench_do_not_optimize(test_case->output);
+    }
+    return (unsigned char)test_case->output[25];
+}
+
+static uint64_t run_batch(void *context, uint64_t iterations) {
+    IdentifierCase *test_case = context;
+    uint64_t checksum = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        passgen_generate_batch(test_case->engine, test_case->format->wire_type, test_case->format->length,
+                               IDENTIFIER_BATCH, test_case->output);
+        bench_do_not_optimize(test_case->output);
+        checksum += (unsigned char)test_case->output[0];
+    }
+    return checksum;
+}
+
+void bench_identifier(void) {
+    static IdentifierCase test_case;
+    static const struct {
+        char type;			/**< Wire type */
+        const char *name;	/**< Label */
+    } kinds[] = { { 'r', "UUIDv4" }, { 't', "UUIDv7" }, { 'l', "ULID" }, { 'f', "Snowflake" } };
+    PassgenContext *context;
+    char name[64];
+
+    bench_section("identifier encoding (per identifier)");
+    bench_run("hex, 64 bits", run_hex64, &test_case, 16);
+    bench_run("Crockford base32, 128 bits", run_base32, &test_case, 26);
+
+    bench_section("identifier batches (embedding API)");
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        test_case.format = identifier_lookup(kinds[i].type);
+        snprintf(name, sizeof(name), "batch of %d %s", IDENTIFIER_BATCH, kinds[i].name);
+        double batch_ns = bench_run(name, run_batch, &test_case, (size_t)IDENTIFIER_BATCH * test_case.format->length);
+        printf("  %-40s %9.1f M identifiers/s\n", "  one engine", IDENTIFIER_BATCH * 1000.0 / batch_ns);
+    }
+
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
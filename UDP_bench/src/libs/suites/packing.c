@@ -0,0 +1,119 @@
+/**
+ * @file packing.c
+ * @brief Benchmark suite for the bit-packed answers.
+ * @details Measures the packing of a full datagram of passwords of every password
+ * type, as the server does it, and its expansion by the vector decoder of the
+ * client next to a plain scalar one, then prints how many more passwords a
+ * packed datagram carries.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libs/engine/engine.h"
+#include "libs/generator/generator.h"
+#include "libs/packing/packing.h"
+#include "libs/protocol/protocol.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+#define PACKING_LENGTH 16		/**< Length of the passwords of the benchmark */
+
+/**
+ * @brief Parameters of a single packing benchmark.
+ */
+typedef struct {
+    const Generator *generator;								/**< Password type */
+    size_t symbols;											/**< Characters of a full packed datagram */
+    char characters[MAX_UNPACKED_RESPONSE_SIZE];			/**< The passwords */
+    unsigned char packed[MAX_UNPACKED_RESPONSE_SIZE];		/**< Their packed form */
+    char output[MAX_UNPACKED_RESPONSE_SIZE];				/**< Characters expanded again */
+} PackingCase;
+
+static uint64_t run_encode(void *context, uint64_t iterations) {
+    PackingCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += packing_encode(test_case->generator->alphabet, test_case->generator->alphabet_size,
+                                test_case->characters, test_case->symbols, test_case->packed);
+        bench_do_not_optimize(test_case->packed);
+    }
+    return total;
+}
+
+static uint64_t run_decode(void *context, uint64_t iterations) {
+    PackingCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += packing_decode(test_case->generator->alphabet, test_case->generator->alphabet_size,
+                                test_case->packed, test_case->symbols, test_case->output);
+        bench_do_not_optimize(test_case->output);
+    }
+    return total;
+}
+
+/**
+ * @brief Reference decoder: one symbol at a time from a 64-bit accumulator.
+ */
+static uint64_t run_decode_scalar(void *context, uint64_t iterations) {
+    PackingCase *test_case = context;
+    unsigned int bits = packing_bits(test_case->generator->alphabet_size);
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        const unsigned char *input = test_case->packed;
+        uint64_t accumulator = 0;
+        unsigned int available = 0;
+        for (size_t j = 0; j < test_case->symbols; j++) {
+            while (available < bits) {
+                accumulator |= (uint64_t)*input++ << available;
+                available += 8;
+            }
+            uint32_t symbol = (uint32_t)accumulator & ((1u << bits) - 1);
+            total += symbol >= test_case->generator->alphabet_size;
+            test_case->output[j] = test_case->generator->alphabet[symbol % test_case->generator->alphabet_size];
+            accumulator >>= bits;
+            available -= bits;
+        }
+        bench_do_not_optimize(test_case->output);
+    }
+    return total;
+}
+
+void bench_packing(void) {
+    static PackingCase test_case;
+    static const char types[] = { 'n', 'a', 'm', 'u', 's' };
+    PassgenContext *context;
+    PassgenEngine *engine;
+    char name[64];
+
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK || passgen_engine_create(context, &engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        test_case.generator = generator_lookup(types[i]);
+        unsigned int bits = packing_bits(test_case.generator->alphabet_size);
+        unsigned int plain_count = MAX_BATCH_COUNT(PACKING_LENGTH);
+        unsigned int packed_count = MAX_PACKED_BATCH_COUNT(PACKING_LENGTH, bits);
+        test_case.symbols = (size_t)packed_count * PACKING_LENGTH;
+        passgen_generate_batch(engine, types[i], PACKING_LENGTH, packed_count, test_case.characters);
+        packing_encode(test_case.generator->alphabet, test_case.generator->alphabet_size, test_case.characters,
+                       test_case.symbols, test_case.packed);
+
+        snprintf(name, sizeof(name), "packed datagram of '%c' %d (%u bits)", types[i], PACKING_LENGTH, bits);
+        bench_section(name);
+        bench_run("encode (server)", run_encode, &test_case, test_case.symbols);
+        bench_run("decode, vector (client)", run_decode, &test_case, test_case.symbols);
+        bench_run("decode, scalar reference", run_decode_scalar, &test_case, test_case.symbols);
+        printf("  %-40s %9u -> %u passwords, %.2fx fewer datagrams\n", "  per datagram", plain_count, packed_count,
+               (double)packed_count / plain_count);
+    }
+
+    passgen_engine_destroy(engine);
+    passgen_context_destroy(context);
+}
@@ -0,0 +1,125 @@
+/**
+ * @file sketch.c
+ * @brief Benchmark suite for the client sketches.
+ * @details Measures what the server pays per received datagram, with a single
+ * client, a skewed population where a few clients send most datagrams, and a
+ * uniform one where nearly every datagram replaces a heavy hitter; then what a
+ * stats request costs: the merge of two sets and the figures of the answer.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libs/harness/harness.h"
+#include "libs/sketch/sketch.h"
+#include "suites.h"
+
+#define SKETCH_TRACE_SIZE (1u << 16)	/**< Addresses replayed by the benchmarks, a power of two */
+#define SKETCH_SKEWED_CLIENTS 100000	/**< Clients of the skewed population */
+
+/**
+ * @brief Parameters of a single sketch benchmark.
+ */
+typedef struct {
+    SketchSet set;								/**< Set receiving the datagrams */
+    SketchSet other;							/**< Second set of the merges */
+    SketchSet merged;							/**< Destination of the merges */
+    uint32_t trace[SKETCH_TRACE_SIZE];			/**< Source addresses, in arrival order */
+} SketchCase;
+
+/**
+ * @brief Fills the trace with addresses of `clients` clients; with `skewed` the client
+ * of rank r sends in proportion to 1/r (Zipf), otherwise all send alike.
+ */
+static void fill_trace(SketchCase *test_case, uint32_t clients, bool skewed) {
+    uint64_t state = 0x9E3779B97F4A7C15ull;
+    for (size_t i = 0; i < SKETCH_TRACE_SIZE; i++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        double uniform = (double)(state >> 11) / (double)(1ull << 53);
+        uint32_t rank = skewed ? (uint32_t)pow(clients, uniform) : (uint32_t)(uniform * clients);
+        test_case->trace[i] = 0x0A000000u + rank;	/**< 10.0.0.0/8 */
+    }
+}
+
+static uint64_t run_add(void *context, uint64_t iterations) {
+    SketchCase *test_case = context;
+    for (uint64_t i = 0; i < iterations; i++) {
+        sketch_add(&test_case->set, test_case->trace[i & (SKETCH_TRACE_SIZE - 1)]);
+    }
+    bench_do_not_optimize(&test_case->set);
+    return test_case->set.packets;
+}
+
+static uint64_t run_merge(void *context, uint64_t iterations) {
+    SketchCase *test_case = context;
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(&test_case->merged, &test_case->set, sizeof(SketchSet));
+        sketch_merge(&test_case->merged, &test_case->other);
+        bench_do_not_optimize(&test_case->merged);
+    }
+    return test_case->merged.packets;
+}
+
+static uint64_t run_figures(void *context, uint64_t iterations) {
+    SketchCase *test_case = context;
+    SketchCounter counters[SKETCH_TOP_K];
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += sketch_unique(&test_case->set) + sketch_top(&test_case->set, counters, SKETCH_TOP_K);
+        bench_do_not_optimize(counters);
+    }
+    return total;
+}
+
+/**
+ * @brief Replays a trace into an empty set for `name`.
+ */
+static void bench_trace(SketchCase *test_case, const char *name, uint32_t clients, bool skewed) {
+    fill_trace(test_case, clients, skewed);
+    sketch_init(&test_case->set, 1);
+    bench_run(name, run_add, test_case, 0);
+}
+
+void bench_sketch(void) {
+    static SketchCase test_case;
+    static uint8_t seen[SKETCH_SKEWED_CLIENTS + 1];
+
+    bench_section("client sketches (per received datagram)");
+    bench_trace(&test_case, "add, 1 client", 1, false);
+    bench_trace(&test_case, "add, 100k clients, Zipf", SKETCH_SKEWED_CLIENTS, true);
+    bench_trace(&test_case, "add, 1M clients, uniform", 1000000, false);
+
+    bench_section("stats request (merge of two sets, figures)");
+    fill_trace(&test_case, SKETCH_SKEWED_CLIENTS, true);
+    sketch_init(&test_case.set, 1);
+    sketch_init(&test_case.other, 1);
+    for (size_t i = 0; i < SKETCH_TRACE_SIZE; i++) {
+        sketch_add(i % 2 == 0 ? &test_case.set : &test_case.other, test_case.trace[i]);
+    }
+    bench_run("merge", run_merge, &test_case, 0);
+    bench_run("unique + heavy hitters", run_figures, &test_case, 0);
+
+    /* Accuracy on the same trace, to check the figures the cost buys */
+    uint32_t distinct = 0;
+    uint32_t heaviest = 0;
+    for (size_t i = 0; i < SKETCH_TRACE_SIZE; i++) {
+        uint32_t rank = test_case.trace[i] - 0x0A000000u;
+        distinct += seen[rank] == 0;
+        seen[rank] = 1;
+        heaviest += rank == 1;
+    }
+    SketchCounter top;
+    sketch_top(&test_case.merged, &top, 1);
+    printf("  %-40s %9llu estimated, %u exact\n", "  distinct clients",
+           (unsigned long long)sketch_unique(&test_case.merged), distinct);
+    printf("  %-40s %9u estimated (+%u at most), %u exact\n", "  heaviest client",
+           top.count, top.error, heaviest);
+}
@@ -0,0 +1,68 @@
+/**
+ * @file suites.h
+ * @brief Declarations of the benchmark suites run by `UDP_bench`.
+ *
+ * Every suite measures one component of the core library in isolation and
+ * prints its results through the harness.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef SUITES_H_
+#define SUITES_H_
+
+/**
+ * @brief Measures `generate_password` for every password type and common lengths.
+ */
+void bench_generator(void);
+
+/**
+ * @brief Measures the encoding and decoding of every kind of message.
+ */
+void bench_codec(void);
+
+/**
+ * @brief Measures the embedding API under each policy feature and against the direct response path.
+ */
+void bench_engine(void);
+
+/**
+ * @brief Measures ChaCha20-Poly1305 and the cost it adds to an encrypted response.
+ */
+void bench_aead(void);
+
+/**
+ * @brief Measures the client sketches per received datagram and per stats request.
+ */
+void bench_sketch(void);
+
+/**
+ * @brief Measures the deltas the nodes of a cluster exchange and the bandwidth they take.
+ */
+void bench_gossip(void);
+
+/**
+ * @brief Measures the identifier encodings and the identifiers one engine hands out.
+ */
+void bench_identifier(void);
+
+/**
+ * @brief Measures the compilation of the templates and the passwords one engine draws from them.
+ */
+void bench_template(void);
+
+/**
+ * @brief Measures the packing of the answers by the server and their expansion by the client.
+ */
+void bench_packing(void);
+
+#if defined PASSGEN_AUDIT
+/**
+ * @brief Measures the cost of the audit log to the thread serving the requests.
+ */
+void bench_audit(void);
+#endif
+
+#endif /* SUITES_H_ */
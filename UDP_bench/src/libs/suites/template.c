@@ -0,0 +1,124 @@
+/**
+ * @file template.c
+ * @brief Benchmark suite for the passwords following a template.
+ * @details Measures the compilation of a template and a lookup in the cache of
+ * an engine, then batches of a few templates through the embedding API next to a
+ * batch of the built-in type of the same length, as the server generates them.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "libs/engine/engine.h"
+#include "libs/template/template.h"
+#include "libs/protocol/protocol.h"
+#include "libs/harness/harness.h"
+#include "suites.h"
+
+#define TEMPLATE_BATCH 1024		/**< Passwords per batch call */
+
+/**
+ * @brief Parameters of a single template benchmark.
+ */
+typedef struct {
+    PassgenEngine *engine;								/**< Engine under test */
+    const char *text;									/**< The template */
+    unsigned int length;								/**< Length of its passwords */
+    char type;											/**< Built-in type of the comparison */
+    TemplateCache cache;								/**< Cache of the lookup benchmark */
+    TemplateProgram program;							/**< Program of the compilation benchmark */
+    char output[TEMPLATE_BATCH * MAX_PASSWORD_LENGTH];	/**< Passwords of one batch */
+} TemplateCase;
+
+static uint64_t run_compile(void *context, uint64_t iterations) {
+    TemplateCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += template_compile(test_case->text, strlen(test_case->text), &test_case->program);
+        bench_do_not_optimize(&test_case->program);
+    }
+    return total;
+}
+
+static uint64_t run_lookup(void *context, uint64_t iterations) {
+    TemplateCase *test_case = context;
+    uint64_t total = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        total += template_cache_lookup(&test_case->cache, test_case->text, strlen(test_case->text))->length;
+    }
+    return total;
+}
+
+static uint64_t run_template(void *context, uint64_t iterations) {
+    TemplateCase *test_case = context;
+    uint64_t checksum = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        passgen_generate_template(test_case->engine, test_case->text, strlen(test_case->text), test_case->length,
+                                  TEMPLATE_BATCH, test_case->output);
+        bench_do_not_optimize(test_case->output);
+        checksum += (unsigned char)test_case->output[0];
+    }
+    return checksum;
+}
+
+static uint64_t run_builtin(void *context, uint64_t iterations) {
+    TemplateCase *test_case = context;
+    uint64_t checksum = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        passgen_generate_batch(test_case->engine, test_case->type, test_case->length, TEMPLATE_BATCH,
+                               test_case->output);
+        bench_do_not_optimize(test_case->output);
+        checksum += (unsigned char)test_case->output[0];
+    }
+    return checksum;
+}
+
+void bench_template(void) {
+    static TemplateCase test_case;
+    static const struct {
+        const char *text;	/**< The template */
+        char type;			/**< Built-in type of the same length */
+    } templates[] = { { "Cvc-9999-XX", 's' }, { "A{4}-9{4}", 'm' }, { "*{16}", 's' }, { "Cvcv-Cvcv-Cvcv-9{4}s", 'u' } };
+    static const unsigned char key[RANDOM_KEY_SIZE] = { 1 };
+    PassgenContext *context;
+    RandomStream stream;
+    char name[64];
+
+    bench_section("template compilation (per template)");
+    random_stream_init_with_key(&stream, key);
+    template_cache_init(&test_case.cache, &stream);
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        test_case.text = templates[i].text;
+        snprintf(name, sizeof(name), "compile %s", test_case.text);
+        bench_run(name, run_compile, &test_case, strlen(test_case.text));
+        snprintf(name, sizeof(name), "cached %s", test_case.text);
+        bench_run(name, run_lookup, &test_case, strlen(test_case.text));
+    }
+
+    bench_section("template batches (embedding API, template -> built-in type)");
+    if (passgen_context_create(NULL, &context) != PASSGEN_OK
+        || passgen_engine_create(context, &test_case.engine) != PASSGEN_OK) {
+        printf("  cannot create the engine\n");
+        passgen_context_destroy(context);
+        return;
+    }
+    for (size_t i = 0; i < sizeof(templates) / sizeof(templates[0]); i++) {
+        test_case.text = templates[i].text;
+        test_case.type = templates[i].type;
+        template_compile(test_case.text, strlen(test_case.text), &test_case.program);
+        test_case.length = test_case.program.length;
+
+        snprintf(name, sizeof(name), "batch of %d %s", TEMPLATE_BATCH, test_case.text);
+        double template_ns = bench_run(name, run_template, &test_case, (size_t)TEMPLATE_BATCH * test_case.length);
+        snprintf(name, sizeof(name), "batch of %d '%c' %u", TEMPLATE_BATCH, test_case.type, test_case.length);
+        double builtin_ns = bench_run(name, run_builtin, &test_case, (size_t)TEMPLATE_BATCH * test_case.length);
+        printf("  %-40s %9.2fx the time of the built-in type\n", "  template", template_ns / builtin_ns);
+    }
+
+    passgen_engine_destroy(test_case.engine);
+    passgen_context_destroy(context);
+}
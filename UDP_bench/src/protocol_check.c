@@ -0,0 +1,249 @@
+/**
+ * @file protocol_check.c
+ * @brief Checks of the protocol corner cases that the fuzzer cannot judge.
+ * @details The fuzz target only proves that malformed messages do not crash the
+ * codec; this program checks that they are refused with the right status, run
+ * by the `protocol-check` target. Each section builds the offending message by
+ * hand, as a broken or hostile peer would: the client library is run against a
+ * fake server on a loopback socket.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "libs/codec/codec.h"
+#include "libs/client/client.h"
+#include "libs/subscription/subscription.h"
+
+static int failures = 0;	/**< Checks that failed */
+
+/**
+ * @brief Records a check.
+ */
+static void expect(bool condition, const char *what) {
+    if (!condition) {
+        printf("  FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - CODEC - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Request flags: every defined flag decodes, any other bit is refused.
+ */
+static void check_request_flags(void) {
+    unsigned char request[MAX_DATAGRAM_SIZE];
+    RequestView spec = { .type = 's', .length = 16, .count = 4, .request_id = 7, .deadline_us = 1000 };
+    RequestView view;
+    size_t size = codec_encode_request(request, sizeof(request), &spec);
+
+    expect(codec_decode_request(request, size, &view) == CODEC_OK, "a request with a deadline decodes");
+    request[7] |= REQUEST_FLAG_PACKED | PRIORITY_BULK;
+    expect(codec_decode_request(request, size, &view) == CODEC_OK, "the packed and priority flags are accepted");
+    for (unsigned int bit = 0; bit < 8; bit++) {
+        if ((1u << bit) & REQUEST_FLAGS_KNOWN) {
+            continue;
+        }
+        request[7] = (unsigned char)(REQUEST_FLAG_DEADLINE | (1u << bit));
+        expect(codec_decode_request(request, size, &view) == CODEC_BAD_FLAGS, "an unknown flag bit is refused");
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CODEC - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLIENT - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief A server on a loopback socket whose answers are written by hand.
+ */
+typedef struct {
+    int socket;						/**< Bound UDP socket */
+    struct sockaddr_in address;		/**< Its address */
+    struct sockaddr_in client;		/**< Sender of the last request */
+    RequestView request;			/**< The last request */
+    unsigned char buffer[MAX_DATAGRAM_SIZE];	/**< Storage of `request` */
+} FakeServer;
+
+static bool fake_server_open(FakeServer *server) {
+    socklen_t size = sizeof(server->address);
+    server->socket = socket(AF_INET, SOCK_DGRAM, 0);
+    server->address = (struct sockaddr_in){ .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    return server->socket >= 0
+        && bind(server->socket, (struct sockaddr *)&server->address, sizeof(server->address)) == 0
+        && getsockname(server->socket, (struct sockaddr *)&server->address, &size) == 0;
+}
+
+/**
+ * @brief Waits for a request of the client and decodes it.
+ */
+static bool fake_server_receive(FakeServer *server) {
+    struct pollfd descriptor = { .fd = server->socket, .events = POLLIN };
+    socklen_t size = sizeof(server->client);
+    if (poll(&descriptor, 1, 1000) <= 0) {
+        return false;
+    }
+    ssize_t received = recvfrom(server->socket, server->buffer, sizeof(server->buffer), 0,
+                                (struct sockaddr *)&server->client, &size);
+    return received > 0 && codec_decode_request(server->buffer, (size_t)received, &server->request) == CODEC_OK;
+}
+
+/**
+ * @brief Answers the last request with `count` passwords of `length` characters, whatever it asked for.
+ */
+static void fake_server_answer(FakeServer *server, uint8_t length, uint16_t count) {
+    unsigned char response[MAX_DATAGRAM_SIZE];
+    RequestView request = server->request;
+    request.length = length;
+    size_t size = codec_encode_response(response, sizeof(response), &request, STATUS_OK, count);
+    memset(response + RESPONSE_HEADER_SIZE, '7', size - RESPONSE_HEADER_SIZE);
+    sendto(server->socket, response, size, 0, (struct sockaddr *)&server->client, sizeof(server->client));
+}
+
+/**
+ * @brief Answer collected by `collect`.
+ */
+typedef struct {
+    int answers;			/**< Answers delivered */
+    uint16_t count;			/**< Passwords of the last one */
+    uint8_t length;			/**< Their length */
+} Collected;
+
+static void collect(void *context, uint64_t tag, const ResponseView *response) {
+    Collected *collected = context;
+    (void)tag;
+    collected->answers++;
+    collected->count = response != NULL ? response->count : 0;
+    collected->length = response != NULL ? response->length : 0;
+}
+
+/**
+ * @brief Answers that do not fit their request never reach the callback.
+ */
+static void check_mismatched_answers(void) {
+    FakeServer server;
+    PassgenClient client;
+    Collected collected = { 0 };
+
+    if (!fake_server_open(&server) || !client_open(&client, &server.address)) {
+        expect(false, "the fake server and the client open");
+        return;
+    }
+    client_submit(&client, 'n', 32, 1, 0);
+    expect(fake_server_receive(&server), "the fake server receives the request");
+    fake_server_answer(&server, 32, 40);	/**< More passwords than asked for */
+    fake_server_answer(&server, 16, 1);		/**< Another length */
+    fake_server_answer(&server, 32, 1);		/**< The real answer */
+    for (int i = 0; i < 10 && collected.answers == 0; i++) {
+        client_poll(&client, 100, collect, &collected);
+    }
+    expect(collected.answers == 1 && collected.count == 1 && collected.length == 32,
+           "only the answer that fits the request is delivered");
+    expect(client.stats.rejected_answers == 2, "the mismatched answers are counted as rejected");
+    client_close(&client);
+    close(server.socket);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLIENT - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - SUBSCRIPTION - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Pushes the datagram `sequence` of the stream opened by the last request, with passwords of `length` characters.
+ */
+static void fake_server_push(FakeServer *server, const RequestView *subscription, uint32_t sequence, uint8_t length) {
+    unsigned char datagram[MAX_DATAGRAM_SIZE];
+    RequestView stream = *subscription;
+    stream.length = length;
+    size_t size = codec_encode_stream(datagram, sizeof(datagram), &stream, STATUS_STREAM_DATA, stream.count, sequence);
+    memset(datagram + STREAM_HEADER_SIZE, '7', size - STREAM_HEADER_SIZE);
+    sendto(server->socket, datagram, size, 0, (struct sockaddr *)&server->client, sizeof(server->client));
+}
+
+static void ignore_datagram(void *context, const ResponseView *datagram) {
+    (void)context;
+    (void)datagram;
+}
+
+/**
+ * @brief Polls until `datagrams` datagrams were received, or for a second.
+ */
+static void poll_until(PassgenSubscription *subscription, uint64_t datagrams) {
+    for (int i = 0; i < 10 && subscription->stats.datagrams < datagrams; i++) {
+        subscription_poll(subscription, 100, ignore_datagram, NULL);
+    }
+}
+
+/**
+ * @brief A stream through its whole life: cookie, gaps, late datagrams, credits and unsubscribe.
+ */
+static void check_subscription(void) {
+    FakeServer server;
+    PassgenSubscription subscription;
+    SubscribeOptions options;
+
+    if (!fake_server_open(&server) || !subscription_open(&subscription, &server.address, 'a', 16, 2, 0, 4)) {
+        expect(false, "the fake server and the subscription open");
+        return;
+    }
+    expect(fake_server_receive(&server) && server.request.operation == OP_SUBSCRIBE, "the stream is subscribed");
+    codec_subscribe_options(&server.request, &options);
+    expect(options.credits == 4, "the subscribe grants the window");
+
+    unsigned char response[MAX_DATAGRAM_SIZE];
+    size_t size = codec_encode_cookie_response(response, sizeof(response), &server.request, 0x1234);
+    sendto(server.socket, response, size, 0, (struct sockaddr *)&server.client, sizeof(server.client));
+    subscription_poll(&subscription, 100, ignore_datagram, NULL);
+    expect(fake_server_receive(&server) && server.request.operation == OP_SUBSCRIBE && server.request.cookie == 0x1234,
+           "the subscribe is sent again with the cookie of the server");
+    RequestView stream = server.request;
+
+    fake_server_push(&server, &stream, 0, 16);
+    fake_server_push(&server, &stream, 1, 16);
+    fake_server_push(&server, &stream, 3, 16);
+    poll_until(&subscription, 3);
+    expect(subscription.stats.datagrams == 3 && subscription.stats.lost == 1, "a skipped sequence number is lost");
+    expect(fake_server_receive(&server) && server.request.operation == OP_CREDIT
+           && server.request.request_id == stream.request_id && codec_credit_amount(&server.request) == 4,
+           "the window is granted again once it is used up");
+
+    fake_server_push(&server, &stream, 2, 16);
+    poll_until(&subscription, 4);
+    expect(subscription.stats.late == 1 && subscription.stats.lost == 0, "the lost datagram arrives late");
+
+    fake_server_push(&server, &stream, 4, 32);	/**< Not the subscribed length */
+    fake_server_push(&server, &stream, 5, 16);
+    poll_until(&subscription, 5);
+    expect(subscription.stats.datagrams == 5 && subscription.stats.passwords == 10 && subscription.stats.lost == 1,
+           "a datagram of another length is dropped");
+
+    subscription_close(&subscription);
+    expect(fake_server_receive(&server) && server.request.operation == OP_UNSUBSCRIBE
+           && server.request.request_id == stream.request_id, "closing the subscription unsubscribes");
+    close(server.socket);
+}
+
+/* - - - - - - - - - - - - - - - - - - END SUBSCRIPTION - - - - - - - - - - - - - - - - - - */
+
+int main(void) {
+    printf("codec\n");
+    check_request_flags();
+    printf("client\n");
+    check_mismatched_answers();
+    printf("subscription\n");
+    check_subscription();
+
+    printf("%s\n", failures == 0 ? "ok" : "FAILED");
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
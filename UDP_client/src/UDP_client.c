@@ -2,21 +2,24 @@
  * @file UDP_client.c
  * @brief UDP client for requesting password generation from a remote server.
  * @details The client connects to a password generation server via UDP, sends a request specifying the desired
- * password type and length, and receives the generated password in response.
- * @version 1.0.1
+ * password type and length, and receives the generated password in response. Without arguments it shows an
+ * interactive menu; with `-n` or `-f` it downloads passwords in bulk through a pipelined client, and with `-R`
+ * it receives them as a stream pushed by the server.
+ * @version 1.1.0
  * @date 2024-12-15
  * @author Cristian Biallo
  */
 
 #if defined WIN32
-#include <winsock.h>  		/**< Include Winsock header for Windows */
+#include <winsock2.h>  		/**< Include Winsock 2 header for Windows (the client library uses WSAPoll) */
+#define poll WSAPoll		/**< WSAPoll has the same interface as poll */
 #else
 #include <unistd.h> 	 	/**< Include UNIX standard header for close() */
+#include <poll.h>  			/**< Include for poll() used to wait for the stats answer */
 #include <sys/socket.h> 	/**< Include socket library for UNIX */
 #include <arpa/inet.h>   	/**< Include ARP and Internet address family libraries */
 #include <sys/types.h>   	/**< Include for socket types */
 #include <netinet/in.h> 	/**< Include for internet address family structures */
-#include <netdb.h>  		/**< Include for host and network databases */
 #define closesocket close   /**< Define closesocket to close for UNIX systems */
 #endif
 
@@ -25,11 +28,58 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "libs/password/password.h"  /**< Include password control functions */
 #include "libs/protocol/protocol.h"  /**< Include protocol header for message structures and communication formats */
+#include "libs/codec/codec.h"        /**< Include the codec for the compact wire format */
+#include "libs/identifier/identifier.h" /**< Include the identifier types and their lengths */
+#include "libs/template/template.h"  /**< Include the template compiler, for the length of a template */
+#include "libs/client/client.h"      /**< Include the pipelined client library */
+#include "libs/batch/batch.h"        /**< Include the non-interactive bulk mode */
+#include "libs/output/output.h"      /**< Include the bulk mode output */
+#include "libs/resolver/resolver.h"  /**< Include the asynchronous resolver */
+#include "libs/subscription/subscription.h" /**< Include the stream subscriptions */
+#include "libs/clock/clock.h"        /**< Include the monotonic clock */
+#if defined PASSGEN_TCP_BULK
+#include "libs/download/download.h"  /**< Include the download over the TCP bulk endpoint */
+#endif
 #include "libs/utils/utils.h"	     /**< Include the utils.h library for utility functions */
 
+#define DEFAULT_SERVER_NAME "passwdgen.uniba.it"	/**< Server contacted when `-s` is not given */
+#define RESOLVE_TIMEOUT_MS 5000						/**< Time allowed for the first resolution of the servers */
+#define KEY_VARIABLE "PASSGEN_KEY"					/**< Environment variable holding the key of -K */
+#define TENANT_KEY_VARIABLE "PASSGEN_TENANT_KEY"	/**< Environment variable holding the key of -A */
+#define STATS_TIMEOUT_MS 500						/**< Wait for a stats answer before asking again */
+#define STATS_ATTEMPTS 3							/**< Stats requests sent to a server before giving up */
+
+
+/**
+ * @struct ClientOptions
+ * @brief Command-line options.
+ */
+typedef struct {
+    const char *server_name;	/**< Servers as "host[:port]", comma separated (-s) */
+    unsigned short port;		/**< Port of the server (-p) */
+    const char *spec;			/**< Spec built from -t, -l and -n */
+    char spec_text[64];			/**< Storage of `spec` */
+    const char *spec_file;		/**< File of specs, "-" for standard input (-f) */
+    const char *output_path;	/**< Output file, standard output if `NULL` (-o) */
+    unsigned int window;		/**< Requests in flight (-w) */
+    ClientLocalPolicy local;	/**< When passwords are generated locally (-L never|fallback|always) */
+    uint32_t key_id;			/**< Key encrypting the answers (-K), 0 for none */
+    unsigned char key[AEAD_KEY_SIZE];	/**< The key, read from `KEY_VARIABLE` */
+    uint32_t tenant_id;			/**< Tenant signing the requests (-A), 0 for none */
+    unsigned char tenant_key[SIPHASH_KEY_SIZE];	/**< Its key, read from `TENANT_KEY_VARIABLE` */
+    bool stats;					/**< Ask the servers who their clients are (-S) */
+    uint32_t stats_address;		/**< Address whose datagrams are estimated (-S address), 0 for none (-S all) */
+    const char *template_text;	/**< Template of the 'p' requests (-P), `NULL` for none */
+    bool packed;				/**< Ask for bit-packed answers (-E packed) */
+    bool tcp;					/**< Download the spec over the TCP bulk endpoint (-T) */
+    bool stream;				/**< Receive the spec as a stream pushed by the server (-R) */
+    uint32_t stream_rate;		/**< Passwords per second of the stream, 0 for no limit (-R) */
+} ClientOptions;
+
 
 /**
  * @brief Cleans up the Winsock library (Windows only).
@@ -54,48 +104,41 @@ void error_handler(const char *error_message) {
 }
 
 /**
- * @brief Creates and initializes a UDP socket.
- * @details This function creates a socket for communication using UDP.
- * @return >=0 The socket descriptor if successful.
- * @return -1 An error occurred while creating the socket.
+ * @brief Registers every server of the `-s` list with the resolver.
+ * @param[in,out] resolver The resolver.
+ * @param[in] options The command-line options.
+ * @return `false` if an entry is invalid or there are too many servers.
  */
-int initialize_socket() {
-    int created_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (created_socket < 0) {
-        error_handler("Error creating socket.\n");
-    }
-    return created_socket;
-}
+bool add_servers(Resolver *resolver, const ClientOptions *options) {
+    char list[BUFFER_SIZE];
 
-/**
- * @brief Resolves the server's hostname to an IP address.
- * @details This function uses `gethostbyname` to resolve the server's hostname and populate the address structure.
- * @param[in] server_name The hostname of the server to resolve.
- * @param[out] server_address Pointer to a sockaddr_in structure to store the resolved address.
- * @return true The hostname was successfully resolved.
- * @return false An error occurred during resolution.
- */
-bool resolve_server_address(const char *server_name, struct sockaddr_in *server_address) {
-    struct hostent *host = gethostbyname(server_name);
-    if (host == NULL) {
-        error_handler("Error resolving host\n");
-        return false;
+    snprintf(list, sizeof(list), "%s", options->server_name);
+    for (char *entry = strtok(list, ","); entry != NULL; entry = strtok(NULL, ",")) {
+        unsigned short port = options->port;
+        char *separator = strchr(entry, ':');
+
+        if (separator != NULL) {
+            *separator = '\0';
+            port = (unsigned short)atoi(separator + 1);
+        }
+        if (port == 0 || !resolver_add(resolver, entry, port)) {
+            return false;
+        }
     }
-    memset(server_address, 0, sizeof(struct sockaddr_in));			/**< Clear the structure */
-    server_address->sin_family = AF_INET;							/**< Set address family to AF_INET (IPv4) */
-    server_address->sin_addr = *((struct in_addr *)host->h_addr);	/**< Set server IP address */
-    server_address->sin_port = htons(DEFAULT_PORT);					/**< Set server port, converting to network byte order */
     return true;
 }
 
 /**
  * @brief Reads user input for password generation parameters.
  * @details Displays a menu and prompts the user to enter the password type and length. Validates the input.
+ * A template ("p TEMPLATE") is compiled here: it becomes the template of the client and its length the length
+ * of the request.
  * @param[out] password_request Pointer to a PasswordRequest structure to store user input.
+ * @param[in,out] client The client, receiving the template.
  * @return true User input is valid.
  * @return false User input is invalid.
  */
-bool handle_user_input(PasswordRequest *password_request) {
+bool handle_user_input(PasswordRequest *password_request, PassgenClient *client) {
     char input[BUFFER_SIZE];
     int arguments;
 
@@ -113,140 +156,602 @@ bool handle_user_input(PasswordRequest *password_request) {
     } while (tolower(password_request->type) == 'h');
 
 
-    if (arguments == 1) {
+    if (codec_is_template(password_request->type)) {
+        TemplateProgram program;
+        size_t size = arguments == 2 ? strlen(password_request->length) : 0;
+        if (size == 0 || size > TEMPLATE_MAX_SIZE || !template_compile(password_request->length, size, &program)
+            || !client_set_template(client, password_request->length, size)) {
+            print_with_color("Bad request: the template is not valid.\n", RED);
+            return false;
+        }
+        snprintf(password_request->length, sizeof(password_request->length), "%u", (unsigned int)program.length);
+        return true;
+    }
+
+    const IdentifierFormat *format = identifier_lookup(password_request->type);
+    if (arguments == 1 && format != NULL) {
+        snprintf(password_request->length, sizeof(password_request->length), "%u", (unsigned int)format->length);
+    } else if (arguments == 1 && codec_is_random_bytes(password_request->type)) {
+        snprintf(password_request->length, sizeof(password_request->length), "%u", (unsigned int)MAX_PASSWORD_LENGTH);
+    } else if (arguments == 1) {
         strcpy(password_request->length, "8"); /**< Default password length */
     } else if (arguments != 2) {
         print_with_color("Invalid input. Please enter a valid type and length.\n", RED);
         return false;
     }
 
-    if (!control_type("namsuq", password_request->type)) {
+    if (!control_type("namsuqrtlfbp", password_request->type)) {
     	print_with_color("Bad request: the type inserted is not valid.\n", RED);
     	return false;
     }
 
-    if (!control_length(password_request->length, MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH)) {
+    int min_length = codec_is_random_bytes(password_request->type) ? MIN_RANDOM_BYTES_LENGTH : MIN_PASSWORD_LENGTH;
+    if (!control_length(password_request->length, min_length, MAX_PASSWORD_LENGTH)) {
     	print_with_color("Bad request: the length for the password is not valid.\n", RED);
     	return false;
     }
 
+    if (format != NULL && atoi(password_request->length) != format->length) {
+    	print_with_color("Bad request: an identifier has a fixed length.\n", RED);
+    	return false;
+    }
+
     return true;
 }
 
 /**
- * @brief Sends a password generation request to the server.
- * @details The function sends the PasswordRequest structure to the specified server address.
- * @param[in] client_socket The socket descriptor.
- * @param[in] password_request Pointer to the PasswordRequest structure.
- * @param[in] server_address Pointer to the sockaddr_in structure of the server.
- * @return true The request was sent successfully.
- * @return false An error occurred while sending the request.
+ * @brief Prints the command-line usage.
+ */
+void show_usage() {
+    fprintf(stderr,
+            "Usage: UDP_client [-s servers] [-p port]                      interactive menu\n"
+            "       UDP_client [-s servers] [-p port] -t type [-l length] -n count [-o file] [-w window]\n"
+            "type is a password type (n, a, m, s, u) or an identifier type: r (UUIDv4), t (UUIDv7),\n"
+            "l (ULID) or f (Snowflake ID), whose length is implied, or b for raw random bytes: length\n"
+            "bytes each (32 by default), written to the output as such, without newlines.\n"
+            "-P template asks for passwords following template (type p, length implied), e.g. Cvc-9999-XX:\n"
+            "9 digit, a/A letter, c/C consonant, v/V vowel, x/X hex digit, m letter or digit, s symbol,\n"
+            "* any of these, {n} repeats the previous character, \\ escapes, anything else is literal.\n"
+            "       UDP_client [-s servers] [-p port] -f specs|- [-o file] [-w window]\n"
+            "       UDP_client [-s servers] [-p port] -S address|all\n"
+            "servers is a comma-separated list of host[:port]; the requests are balanced over all of them.\n"
+            "-L never|fallback|always generates passwords locally never, when the servers miss their\n"
+            "deadline, or always (no network).\n"
+            "-K id asks for answers encrypted with key id; the key, 64 hex digits, is read from " KEY_VARIABLE ".\n"
+            "-A id signs the requests as tenant id; its key, 32 hex digits, is read from " TENANT_KEY_VARIABLE ".\n"
+            "-E plain|packed asks for the password characters as such, or bit-packed: fewer datagrams\n"
+            "for the types n, a, m, s and u (unencrypted answers only).\n"
+#if defined PASSGEN_TCP_BULK
+            "-T downloads the -t/-l/-n spec over the TCP bulk endpoint of the first server (started\n"
+            "with -T): one request, no window; not with -K, -A, -P or -E packed.\n"
+#endif
+            "-R rate receives the -t/-l/-n spec as a stream pushed by the first server, at most rate\n"
+            "passwords per second (0 for no limit), and reports the datagrams lost; not with -K, -A, -P,\n"
+            "-E packed or -w.\n"
+            "-S address|all prints the heaviest and the distinct clients of servers on this host, and how\n"
+            "many datagrams address sent.\n"
+            "A spec file holds one \"type length count\" per line; all specs are downloaded concurrently.\n");
+}
+
+/**
+ * @brief Parses the command line.
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ * @param[out] options The options.
+ * @return `true` if the command line is valid.
  */
-bool send_request(int client_socket, const PasswordRequest *password_request, const struct sockaddr_in *server_address) {
-    if (sendto(client_socket, password_request, sizeof(*password_request), 0,
-               (struct sockaddr *)server_address, sizeof(*server_address)) != sizeof(*password_request)) {
-        error_handler("Error sending request (Password settings).\n");
+bool parse_options(int argc, char *argv[], ClientOptions *options) {
+    char type = 's';
+    const char *length = NULL;
+    const char *count = NULL;
+    char identifier_length[4];
+
+    *options = (ClientOptions){ .server_name = DEFAULT_SERVER_NAME, .port = DEFAULT_PORT, .window = CLIENT_DEFAULT_WINDOW };
+    for (int i = 1; i < argc; i++) {
+#if defined PASSGEN_TCP_BULK
+        if (strcmp(argv[i], "-T") == 0) {	/**< The only option without a value */
+            options->tcp = true;
+            continue;
+        }
+#endif
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 == argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        switch (argv[i - 1][1]) {
+        case 's': options->server_name = value; break;
+        case 'p': options->port = (unsigned short)atoi(value); break;
+        case 't': type = value[0]; break;
+        case 'l': length = value; break;
+        case 'n': count = value; break;
+        case 'f': options->spec_file = value; break;
+        case 'o': options->output_path = value; break;
+        case 'w': options->window = (unsigned int)atoi(value); break;
+        case 'K': options->key_id = (uint32_t)strtoul(value, NULL, 10); break;
+        case 'A': options->tenant_id = (uint32_t)strtoul(value, NULL, 10); break;
+        case 'P': options->template_text = value; type = TEMPLATE_TYPE; break;
+        case 'R': options->stream = true; options->stream_rate = (uint32_t)strtoul(value, NULL, 10); break;
+        case 'S':
+            options->stats = true;
+            if (strcmp(value, "all") != 0) {
+                options->stats_address = inet_addr(value);
+                if (options->stats_address == INADDR_NONE || options->stats_address == 0) {
+                    return false;
+                }
+            }
+            break;
+        case 'L':
+            if (strcmp(value, "never") == 0) {
+                options->local = CLIENT_LOCAL_NEVER;
+            } else if (strcmp(value, "fallback") == 0) {
+                options->local = CLIENT_LOCAL_FALLBACK;
+            } else if (strcmp(value, "always") == 0) {
+                options->local = CLIENT_LOCAL_ALWAYS;
+            } else {
+                return false;
+            }
+            break;
+        case 'E':
+            if (strcmp(value, "plain") != 0 && strcmp(value, "packed") != 0) {
+                return false;
+            }
+            options->packed = strcmp(value, "packed") == 0;
+            break;
+        default: return false;
+        }
+    }
+    if (options->window == 0 || options->window > CLIENT_MAX_WINDOW || options->port == 0) {
         return false;
     }
+    if (options->key_id != 0) {
+        const char *key = getenv(KEY_VARIABLE);	/**< Not on the command line, where any user could read it */
+        if (key == NULL || !aead_parse_key(key, options->key)) {
+            return false;
+        }
+    }
+    if (options->tenant_id != 0) {
+        const char *key = getenv(TENANT_KEY_VARIABLE);
+        if (key == NULL || !siphash_parse_key(key, options->tenant_key)) {
+            return false;
+        }
+    }
+    if (options->template_text != NULL) {
+        TemplateProgram program;	/**< A template has the length of its passwords */
+        size_t size = strlen(options->template_text);
+        if (size == 0 || size > TEMPLATE_MAX_SIZE || !template_compile(options->template_text, size, &program)) {
+            return false;
+        }
+        snprintf(identifier_length, sizeof(identifier_length), "%u", (unsigned int)program.length);
+        length = identifier_length;
+    }
+    if (length == NULL) {
+        const IdentifierFormat *format = identifier_lookup(type);	/**< An identifier has its own length */
+        unsigned int implied = format != NULL ? format->length : codec_is_random_bytes(type) ? MAX_PASSWORD_LENGTH : 8u;
+        snprintf(identifier_length, sizeof(identifier_length), "%u", implied);
+        length = identifier_length;
+    }
+    if (count != NULL) {
+        snprintf(options->spec_text, sizeof(options->spec_text), "%c %s %s", type, length, count);
+        options->spec = options->spec_text;
+    }
+    if (options->tcp && (options->spec == NULL || options->spec_file != NULL || options->stats || options->key_id != 0
+                         || options->tenant_id != 0 || options->template_text != NULL || options->packed)) {
+        return false;	/**< The endpoint serves one plain spec, without keys or tenants */
+    }
+    if (options->stream && (options->spec == NULL || options->spec_file != NULL || options->stats || options->tcp
+                            || options->key_id != 0 || options->tenant_id != 0 || options->template_text != NULL
+                            || options->packed || options->window != CLIENT_DEFAULT_WINDOW)) {
+        return false;	/**< Streams carry one plain spec, without keys or tenants, and have their own window */
+    }
     return true;
 }
 
 /**
- * @brief Receives a password generation response from the server.
- * @param[in] client_socket The socket descriptor.
- * @param[out] response_msg Pointer to the PasswordResponse structure to store the server response.
- * @param[in] server_address Pointer to the sockaddr_in structure of the server.
- * @return true The response was received successfully.
- * @return false An error occurred while receiving the response.
+ * @brief Resolves the servers of the `-s` list and opens a client balancing over them.
+ * @details The names are resolved on the resolver's helper thread; the client follows
+ * the later changes of their addresses through its server source.
+ * @param[out] client The client.
+ * @param[in,out] resolver The resolver, initialised.
+ * @param[in] options The command-line options.
+ * @return `true` if at least one server was resolved and the socket was created.
  */
-bool receive_response(int client_socket, PasswordResponse *response_msg, struct sockaddr_in *server_address) {
-    unsigned int server_address_size = sizeof(*server_address);
-    int rcv_msg_size = recvfrom(client_socket, response_msg, sizeof(*response_msg), 0,
-                                (struct sockaddr *)server_address, &server_address_size);
-    if (rcv_msg_size < 0) {
-        error_handler("Error receiving response (Password generation response).\n");
+bool open_client(PassgenClient *client, Resolver *resolver, const ClientOptions *options) {
+    struct sockaddr_in server_addresses[CLIENT_MAX_SERVERS];	/**< Addresses of the servers */
+
+    if (!add_servers(resolver, options)) {
+        error_handler("Invalid server list.\n");
+        return false;
+    }
+    if (!resolver_start(resolver) || !resolver_wait(resolver, RESOLVE_TIMEOUT_MS)) {
+        error_handler("Error resolving host\n");
         return false;
     }
+
+    size_t count = resolver_addresses(resolver, server_addresses, CLIENT_MAX_SERVERS);
+    if (!client_open(client, &server_addresses[0])) {
+        error_handler("Error creating socket.\n");
+        return false;
+    }
+    client_set_servers(client, server_addresses, count);
+    client_set_server_source(client, resolver_update_client, resolver);
+    client_set_local_policy(client, options->local, CLIENT_DEFAULT_LOCAL_DEADLINE_MS);
+    client_set_key(client, options->key_id, options->key);
+    client_set_tenant(client, options->tenant_id, options->tenant_key);
+    client_set_packed(client, options->packed);
+    if (options->template_text != NULL) {
+        client_set_template(client, options->template_text, strlen(options->template_text));
+    }
     return true;
 }
 
+/**
+ * @brief Prints the counters of each server the requests were balanced over.
+ * @param[in] client The client.
+ */
+void print_server_stats(const PassgenClient *client) {
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        const ClientServer *server = &client->servers[i];
+        fprintf(stderr, "server %s:%u: %llu requests, %llu responses, %llu timeouts, %llu ejections, latency %.1f us%s\n",
+                inet_ntoa(server->address.sin_addr), ntohs(server->address.sin_port),
+                (unsigned long long)server->stats.requests, (unsigned long long)server->stats.responses,
+                (unsigned long long)server->stats.timeouts, (unsigned long long)server->stats.ejections,
+                server->latency_ns / 1e3, server->ejected_until_ns != 0 ? " (ejected)" : "");
+    }
+}
 
 /**
- * @brief Main function for the UDP client.
- * @details This function initializes the socket, resolves the server address, and handles the communication loop
- * with the password generation server. The loop terminates when the user decides to quit.
- * @return EXIT_SUCCESS Program completed successfully.
- * @return EXIT_FAILURE An error occurred during execution.
+ * @brief Asks one server for its stats, sending the request again when no answer comes.
+ * @param[in] client The client, whose socket is used.
+ * @param[in] server Address of the server.
+ * @param[in] address Address whose datagrams are estimated, 0 for none.
+ * @param[out] answer Buffer receiving the answer.
+ * @param[out] response The decoded answer.
+ * @return `true` if the server answered.
  */
-int main() {
+bool query_stats(const PassgenClient *client, const struct sockaddr_in *server, uint32_t address,
+                 unsigned char answer[MAX_DATAGRAM_SIZE], ResponseView *response) {
+    unsigned char request[REQUEST_HEADER_SIZE + STATS_BODY_SIZE];
+    uint32_t request_id = (uint32_t)rand();
+    size_t request_size = codec_encode_stats_request(request, sizeof(request), request_id, address);
+
+    for (int attempt = 0; attempt < STATS_ATTEMPTS; attempt++) {
+        sendto(client->socket, (const char *)request, request_size, 0, (const struct sockaddr *)server, sizeof(*server));
+        struct pollfd descriptor = { .fd = client->socket, .events = POLLIN };
+        while (poll(&descriptor, 1, STATS_TIMEOUT_MS) > 0) {
+            int size = recvfrom(client->socket, (char *)answer, MAX_DATAGRAM_SIZE, 0, NULL, NULL);
+            if (size > 0 && codec_decode_response(answer, (size_t)size, response) == CODEC_OK
+                && response->request_id == request_id) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
 
-#if defined WIN32
-	// Initialize Winsock
-	WSADATA wsa_data;  /**< Holds information about the Windows Sockets implementation */
-	WORD version_requested = MAKEWORD(2,2);  /**< Request version 2.2 of Winsock */
-	int result = WSAStartup(version_requested, &wsa_data);  /**< Initialize Winsock library */
-	if (result != NO_ERROR) {
-		error_handler("Error at WSAStartup()\nA usable WinSock DLL cannot be found.\n");
-		return EXIT_FAILURE;
-	}
+/**
+ * @brief Prints the clients of every server of the `-s` list, as counted by their sketches.
+ * @param[in] client The client.
+ * @param[in] options The command-line options.
+ * @return `true` if every server answered.
+ */
+bool run_stats_mode(const PassgenClient *client, const ClientOptions *options) {
+    unsigned char answer[MAX_DATAGRAM_SIZE];
+    bool answered = true;
+
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        const struct sockaddr_in *server = &client->servers[i].address;
+        ResponseView response;
+
+        printf("Server %s:%u\n", inet_ntoa(server->sin_addr), ntohs(server->sin_port));
+        if (!query_stats(client, server, options->stats_address, answer, &response)) {
+            error_handler("No answer from the server.\n");
+            answered = false;
+            continue;
+        }
+        if (response.status != STATUS_STATS) {
+            error_handler("The server refused the request: stats are only given on its own host.\n");
+            answered = false;
+            continue;
+        }
+
+        StatsSummary summary;
+        codec_stats_summary(answer, &summary);
+        double seconds = summary.window_ms > 0 ? summary.window_ms / 1e3 : 1;
+        printf("  last %.1f s: %llu datagrams (%.1f/s) from about %u clients\n", seconds,
+               (unsigned long long)summary.packets, summary.packets / seconds, summary.unique);
+        if (options->stats_address != 0) {
+            struct in_addr queried = { .s_addr = options->stats_address };
+            printf("  %s: at most %u datagrams (%.1f/s)\n", inet_ntoa(queried), summary.estimate,
+                   summary.estimate / seconds);
+        }
+        for (uint16_t rank = 0; rank < response.count; rank++) {
+            StatsEntry entry;
+            codec_stats_entry(&response, rank, &entry);
+            struct in_addr hitter = { .s_addr = entry.address };
+            printf("  %3u. %-15s %10u datagrams (%.1f/s), overestimated by at most %u\n", rank + 1,
+                   inet_ntoa(hitter), entry.count, entry.count / seconds, entry.error);
+        }
+    }
+    return answered;
+}
+
+/**
+ * @brief Downloads the passwords described on the command line or in a spec file.
+ * @param[in,out] client The client.
+ * @param[in] options The command-line options.
+ * @return `true` if every password was written.
+ */
+bool run_bulk_mode(PassgenClient *client, const ClientOptions *options) {
+    BatchSpec *specs = NULL;
+    size_t spec_count = 0;
+    bool specs_valid;
+
+    if (options->spec != NULL) {
+        specs = malloc(sizeof(BatchSpec));
+        spec_count = 1;
+        specs_valid = specs != NULL && batch_parse_spec(options->spec, specs);
+    } else {
+        FILE *input = strcmp(options->spec_file, "-") == 0 ? stdin : fopen(options->spec_file, "r");
+        specs_valid = input != NULL && batch_read_specs(input, &specs, &spec_count);
+        if (input != NULL && input != stdin) {
+            fclose(input);
+        }
+    }
+    if (!specs_valid || spec_count == 0) {
+        error_handler("Invalid password spec: expected \"type length count\".\n");
+        free(specs);
+        return false;
+    }
+
+    OutputSink sink;
+    if (!output_open(&sink, options->output_path, batch_layout(specs, spec_count))) {
+        error_handler("Cannot open the output file.\n");
+        free(specs);
+        return false;
+    }
+
+    BatchReport report;
+    client->window = options->window;
+    client_set_priority(client, PRIORITY_BULK);	/**< Never delay the interactive users of the servers */
+    bool completed = batch_run(client, specs, spec_count, &sink, &report);
+    bool written = output_close(&sink);
+    free(specs);
+
+    batch_print_report(&report, stderr);
+    if (client->server_count > 1) {
+        print_server_stats(client);
+    }
+    if (!completed || !written) {
+        error_handler("Error while downloading the passwords.\n");
+        return false;
+    }
+    return report.failed_requests == 0;
+}
+
+#if defined PASSGEN_TCP_BULK
+/**
+ * @brief Downloads the spec of the command line over the TCP bulk endpoint of the first server.
+ * @param[in] client The client, whose first server is asked.
+ * @param[in] options The command-line options.
+ * @return `true` if every password was written.
+ */
+bool run_tcp_mode(const PassgenClient *client, const ClientOptions *options) {
+    BatchSpec spec;
+
+    if (!batch_parse_spec(options->spec, &spec)) {
+        error_handler("Invalid password spec: expected \"type length count\".\n");
+        return false;
+    }
+    OutputSink sink;
+    if (!output_open(&sink, options->output_path, batch_layout(&spec, 1))) {
+        error_handler("Cannot open the output file.\n");
+        return false;
+    }
+
+    uint64_t received;
+    uint64_t start_ns = clock_now_ns();
+    ResponseStatus status = download_spec(&client->servers[0].address, &spec, &sink, &received);
+    double seconds = (clock_now_ns() - start_ns) / 1e9;
+    bool written = output_close(&sink);
+
+    fprintf(stderr, "%llu of %llu passwords in %.3f s (%.0f/s) over TCP from %s:%u\n", (unsigned long long)received,
+            (unsigned long long)spec.total, seconds, seconds > 0 ? received / seconds : 0.0,
+            inet_ntoa(client->servers[0].address.sin_addr), ntohs(client->servers[0].address.sin_port));
+    if (status != STATUS_OK || !written) {
+        error_handler(status == STATUS_BAD_REQUEST ? "The server refused the request: is it started with -T?\n"
+                                                   : "Error while downloading the passwords.\n");
+        return false;
+    }
+    return true;
+}
 #endif
 
-    struct sockaddr_in server_address; 		/**< Structure to hold the server address */
+/**
+ * @brief Output of a stream: where the next passwords go.
+ */
+typedef struct {
+    OutputSink *sink;		/**< The output */
+    const BatchSpec *spec;	/**< The spec, laid out */
+    uint64_t received;		/**< Passwords written */
+} StreamOutput;
 
-	// Resolve the server address
-    if (!resolve_server_address("passwdgen.uniba.it", &server_address)) {
-        clear_winsock();
-        return EXIT_FAILURE;
+/**
+ * @brief Writes the passwords of a stream datagram, past the spec's total ones excepted.
+ */
+static void write_stream_datagram(void *context, const ResponseView *datagram) {
+    StreamOutput *output = context;
+    uint64_t left = output->spec->total - output->received;
+    uint16_t count = datagram->count < left ? datagram->count : (uint16_t)left;
+
+    output_passwords(output->sink, output->spec->offset + output->received * output_record_size(output->spec->type,
+                     output->spec->length), datagram->passwords, count, output->spec->length, output->spec->type);
+    output->received += count;
+}
+
+/**
+ * @brief Receives the spec of the command line as a stream pushed by the first server.
+ * @param[in] client The client, whose first server is asked.
+ * @param[in] options The command-line options.
+ * @return `true` if every password was written.
+ */
+bool run_stream_mode(const PassgenClient *client, const ClientOptions *options) {
+    BatchSpec spec;
+    PassgenSubscription subscription;
+
+    if (!batch_parse_spec(options->spec, &spec)) {
+        error_handler("Invalid password spec: expected \"type length count\".\n");
+        return false;
+    }
+    OutputSink sink;
+    if (!output_open(&sink, options->output_path, batch_layout(&spec, 1))) {
+        error_handler("Cannot open the output file.\n");
+        return false;
+    }
+    if (!subscription_open(&subscription, &client->servers[0].address, spec.type, spec.length, UINT16_MAX,
+                           options->stream_rate, 0)) {
+        output_close(&sink);
+        error_handler("Cannot open the stream.\n");
+        return false;
     }
 
-    // Initialize the UDP socket
-    int client_socket = initialize_socket();
-    if (client_socket < 0) {
-        clear_winsock();
-        return EXIT_FAILURE;
+    StreamOutput output = { .sink = &sink, .spec = &spec };
+    uint64_t start_ns = clock_now_ns();
+    bool polled = true;
+    while (polled && output.received < spec.total && subscription_active(&subscription)) {
+        polled = subscription_poll(&subscription, -1, write_stream_datagram, &output) >= 0;
     }
+    double seconds = (clock_now_ns() - start_ns) / 1e9;
+    ResponseStatus status = subscription.status;
+    subscription_close(&subscription);
+    bool written = output_close(&sink);
+
+    fprintf(stderr, "%llu of %llu passwords in %.3f s (%.0f/s) streamed from %s:%u\n"
+            "%llu datagrams, %llu lost, %llu late, %llu credits\n", (unsigned long long)output.received,
+            (unsigned long long)spec.total, seconds, seconds > 0 ? output.received / seconds : 0.0,
+            inet_ntoa(client->servers[0].address.sin_addr), ntohs(client->servers[0].address.sin_port),
+            (unsigned long long)subscription.stats.datagrams, (unsigned long long)subscription.stats.lost,
+            (unsigned long long)subscription.stats.late, (unsigned long long)subscription.stats.credits);
+    if (output.received < spec.total || !written) {
+        error_handler(status == STATUS_UNAVAILABLE ? "The server did not open the stream.\n"
+                      : status != STATUS_OK && status != STATUS_STREAM_END ? "The server refused the stream.\n"
+                      : "Error while receiving the passwords.\n");
+        return false;
+    }
+    return true;
+}
 
-    PasswordRequest password_request;	/**< Structure to hold password request (type and length) */
-    PasswordResponse response_msg;		/**< Structure to hold server's response */
+/**
+ * @brief Runs the interactive menu until the user quits.
+ * @param[in,out] client The client.
+ * @return `true` if the user quit, `false` on a communication error.
+ */
+bool run_interactive_mode(PassgenClient *client) {
+    PasswordRequest password_request;			/**< Structure to hold password request (type and length) */
+    char password[MAX_PASSWORD_LENGTH + 1];		/**< Password received from the server */
+
+    client_set_priority(client, PRIORITY_INTERACTIVE);
 
     // Start password generation loop
     while(true) {
     	// Handle user input for password type and length
-        if (!handle_user_input(&password_request)) {
+        if (!handle_user_input(&password_request, client)) {
             continue;	/**< If input is invalid, re-prompt the user */
         }
 
         // Check if the user wants to quit
         if(!keep_generating(password_request.type, 'q')) {
-        	break;
+        	return true;
         }
 
-        // Send the password request to the server
-        if (!send_request(client_socket, &password_request, &server_address)) {
-            closesocket(client_socket);
-            clear_winsock();
-            return EXIT_FAILURE;
+        // Send the request and wait for the password
+        uint8_t length = (uint8_t)atoi(password_request.length);
+        ResponseStatus status = client_generate(client, password_request.type, length, 1, password);
+        if (status == STATUS_UNAVAILABLE) {
+            error_handler("Error receiving response (Password generation response).\n");
+            return false;
         }
-
-        // Receive the password response from the server
-        if (!receive_response(client_socket, &response_msg, &server_address)) {
-            closesocket(client_socket);
-            clear_winsock();
-            return EXIT_FAILURE;
+        if (status != STATUS_OK) {
+            error_handler("The server rejected the request.\n");
+            return false;
+        }
+        password[length] = '\0';
+
+        // Display the generated password, random bytes in hex
+        if (codec_is_random_bytes(password_request.type)) {
+            print_with_color("Random bytes generated: ", GREEN);
+            for (uint8_t i = 0; i < length; i++) {
+                printf("%02x", (unsigned char)password[i]);
+            }
+            printf("\n\n");
+            continue;
         }
-
-        // Display the generated password
 		print_with_color("Password generated: ", GREEN);
-		print_with_color(response_msg.password, GREEN);
+		print_with_color(password, GREEN);
 		printf("\n\n");
+    }
+}
+
+
+/**
+ * @brief Main function for the UDP client.
+ * @details This function parses the command line, resolves the server address, and either runs the interactive
+ * loop with the password generation server or downloads passwords in bulk.
+ * @return EXIT_SUCCESS Program completed successfully.
+ * @return EXIT_FAILURE An error occurred during execution.
+ */
+int main(int argc, char *argv[]) {
+    ClientOptions options;
 
+    if (!parse_options(argc, argv, &options)) {
+        show_usage();
+        return EXIT_FAILURE;
+    }
+
+#if defined WIN32
+	// Initialize Winsock
+	WSADATA wsa_data;  /**< Holds information about the Windows Sockets implementation */
+	WORD version_requested = MAKEWORD(2,2);  /**< Request version 2.2 of Winsock */
+	int result = WSAStartup(version_requested, &wsa_data);  /**< Initialize Winsock library */
+	if (result != NO_ERROR) {
+		error_handler("Error at WSAStartup()\nA usable WinSock DLL cannot be found.\n");
+		return EXIT_FAILURE;
+	}
+#endif
+
+    // Resolve the servers and initialize the pipelined client and its UDP socket
+    PassgenClient client;
+    Resolver resolver;
+    if (!resolver_init(&resolver, 0)) {
+        clear_winsock();
+        return EXIT_FAILURE;
+    }
+    if (!open_client(&client, &resolver, &options)) {
+        resolver_stop(&resolver);
+        clear_winsock();
+        return EXIT_FAILURE;
+    }
+
+    bool success;
+    if (options.stats) {
+        success = run_stats_mode(&client, &options);
+#if defined PASSGEN_TCP_BULK
+    } else if (options.tcp) {
+        success = run_tcp_mode(&client, &options);
+#endif
+    } else if (options.stream) {
+        success = run_stream_mode(&client, &options);
+    } else if (options.spec != NULL || options.spec_file != NULL) {
+        success = run_bulk_mode(&client, &options);
+    } else {
+        success = run_interactive_mode(&client);
     }
 
     // Close the connection and clean up
-    closesocket(client_socket); /**< Close the socket */
-    clear_winsock();            /**< Clean up Winsock */
+    client_close(&client);		/**< Close the socket */
+    resolver_stop(&resolver);	/**< Stop the resolver thread */
+    clear_winsock();			/**< Clean up Winsock */
 #if defined WIN32
     Sleep(3000); /**< Pause for 3 seconds before exiting */
 #endif
-    return EXIT_SUCCESS;
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,142 @@
+/**
+ * @file batch.c
+ * @brief Implementation of the non-interactive bulk download.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "batch.h"
+#include "libs/clock/clock.h"
+#include "libs/codec/codec.h"
+
+/**
+ * @struct BatchContext
+ * @brief State shared with the callback receiving the answers.
+ */
+typedef struct {
+    OutputSink *sink;		/**< Destination of the passwords */
+    BatchReport *report;	/**< Counters of the job */
+} BatchContext;
+
+/**
+ * @brief Writes an answer at the output position carried by its tag.
+ */
+static void store_answer(void *context, uint64_t tag, const ResponseView *response) {
+    BatchContext *batch = context;
+
+    if (response == NULL || response->status != STATUS_OK) {
+        batch->report->failed_requests++;
+        return;
+    }
+    output_passwords(batch->sink, tag, response->passwords, response->count, response->length, response->type);
+    batch->report->passwords += response->count;
+    batch->report->bytes += response->count * output_record_size(response->type, response->length);
+}
+
+bool batch_parse_spec(const char *text, BatchSpec *spec) {
+    char type;
+    unsigned int length = 8;
+    unsigned long long total = 1;
+
+    if (sscanf(text, " %c %u %llu", &type, &length, &total) < 1
+        || codec_check_type(type, length) != CODEC_OK || total == 0) {
+        return false;
+    }
+    *spec = (BatchSpec){ .type = type, .length = (uint8_t)length, .total = total };
+    return true;
+}
+
+bool batch_read_specs(FILE *input, BatchSpec **specs, size_t *count) {
+    char line[BUFFER_SIZE];
+    size_t capacity = 0;
+
+    *specs = NULL;
+    *count = 0;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        const char *text = line + strspn(line, " \t");
+        if (*text == '\n' || *text == '\0' || *text == '#') {
+            continue;
+        }
+        if (*count == capacity) {
+            capacity = capacity == 0 ? 16 : capacity * 2;
+            BatchSpec *grown = realloc(*specs, capacity * sizeof(BatchSpec));
+            if (grown == NULL) {
+                return false;
+            }
+            *specs = grown;
+        }
+        if (!batch_parse_spec(text, &(*specs)[*count])) {
+            return false;
+        }
+        (*count)++;
+    }
+    return true;
+}
+
+uint64_t batch_layout(BatchSpec *specs, size_t count) {
+    uint64_t offset = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        specs[i].offset = offset;
+        specs[i].submitted = 0;
+        offset += specs[i].total * output_record_size(specs[i].type, specs[i].length);
+    }
+    return offset;
+}
+
+bool batch_run(PassgenClient *client, BatchSpec *specs, size_t count, OutputSink *sink, BatchReport *report) {
+    BatchContext context = { .sink = sink, .report = report };
+    size_t cursor = 0;		/**< Next spec to serve, round robin */
+    size_t unfinished = count;
+    uint64_t start_ns = clock_now_ns();
+
+    memset(report, 0, sizeof(*report));
+    while (unfinished > 0 || client->outstanding > 0) {
+        while (unfinished > 0 && client_can_submit(client)) {
+            while (specs[cursor].submitted == specs[cursor].total) {
+                cursor = (cursor + 1) % count;
+            }
+            BatchSpec *spec = &specs[cursor];
+            uint64_t left = spec->total - spec->submitted;
+            uint16_t max_count = client_max_count(client, spec->type, spec->length);
+            uint16_t batch = left < max_count ? (uint16_t)left : max_count;
+            uint64_t offset = spec->offset + spec->submitted * output_record_size(spec->type, spec->length);
+
+            client_submit(client, spec->type, spec->length, batch, offset);
+            spec->submitted += batch;
+            if (spec->submitted == spec->total) {
+                unfinished--;
+            }
+            cursor = (cursor + 1) % count;
+        }
+        if (client_poll(client, -1, store_answer, &context) < 0) {
+            return false;
+        }
+    }
+    report->elapsed_ns = clock_now_ns() - start_ns;
+    report->client = client->stats;
+    return true;
+}
+
+void batch_print_report(const BatchReport *report, FILE *stream) {
+    double seconds = (double)report->elapsed_ns / NANOSECONDS_PER_SECOND;
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+    fprintf(stream, "%" PRIu64 " passwords (%.1f MB) in %.3f s: %.0f passwords/s, %.1f MB/s\n",
+            report->passwords, report->bytes / 1e6, seconds, report->passwords / seconds, report->bytes / 1e6 / seconds);
+    fprintf(stream, "%" PRIu64 " requests, %" PRIu64 " retransmissions, %" PRIu64 " failed\n",
+            report->client.requests_sent, report->client.retransmissions, report->failed_requests);
+    if (report->client.local_requests > 0) {
+        fprintf(stream, "%" PRIu64 " requests (%" PRIu64 " passwords) generated locally, %" PRIu64 " after a missed deadline\n",
+                report->client.local_requests, report->client.local_passwords, report->client.local_fallbacks);
+    }
+    if (report->client.rejected_answers > 0) {
+        fprintf(stream, "%" PRIu64 " answers dropped: not encrypted with the key\n", report->client.rejected_answers);
+    }
+}
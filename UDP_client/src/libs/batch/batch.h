@@ -0,0 +1,93 @@
+/**
+ * @file batch.h
+ * @brief Non-interactive bulk download of passwords.
+ *
+ * A job is a list of specs ("type length count"). Their requests are
+ * interleaved on one pipelined client, so every spec progresses at the same
+ * time instead of one after the other, and each answer is written to the
+ * output position reserved for it when the request was sent.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libs/client/client.h"
+#include "libs/output/output.h"
+
+/**
+ * @struct BatchSpec
+ * @brief One line of a job: `total` passwords of a given type and length.
+ */
+typedef struct {
+    char type;				/**< Password type */
+    uint8_t length;			/**< Password length */
+    uint64_t total;			/**< Passwords wanted */
+    uint64_t submitted;		/**< Passwords already requested */
+    uint64_t offset;		/**< Output position of the first password of the spec */
+} BatchSpec;
+
+/**
+ * @struct BatchReport
+ * @brief Outcome of a job.
+ */
+typedef struct {
+    uint64_t passwords;			/**< Passwords written */
+    uint64_t bytes;				/**< Bytes written */
+    uint64_t failed_requests;	/**< Requests that were never answered or were rejected */
+    uint64_t elapsed_ns;		/**< Duration of the job */
+    ClientStats client;			/**< Counters of the client */
+} BatchReport;
+
+/**
+ * @brief Parses a spec written as "type [length [count]]" (defaults: length 8, count 1).
+ * @param[in] text The text to parse.
+ * @param[out] spec The spec.
+ * @return `true` if the spec is valid.
+ */
+bool batch_parse_spec(const char *text, BatchSpec *spec);
+
+/**
+ * @brief Reads one spec per line; empty lines and lines starting with '#' are skipped.
+ * @param[in] input The stream to read.
+ * @param[out] specs Receives a `malloc`'d array of specs, to be released with `free`.
+ * @param[out] count Receives the number of specs.
+ * @return `false` if a line is not a valid spec or memory runs out.
+ */
+bool batch_read_specs(FILE *input, BatchSpec **specs, size_t *count);
+
+/**
+ * @brief Reserves the output region of each spec.
+ * @param[in,out] specs The specs of the job.
+ * @param[in] count Number of specs.
+ * @return The size of the whole output.
+ */
+uint64_t batch_layout(BatchSpec *specs, size_t count);
+
+/**
+ * @brief Downloads every spec, keeping the client's window full.
+ * @param[in,out] client The client.
+ * @param[in,out] specs The specs, laid out by `batch_layout`.
+ * @param[in] count Number of specs.
+ * @param[in,out] sink The output.
+ * @param[out] report Outcome of the job.
+ * @return `false` on a socket error. Unanswered requests are only counted in the report.
+ */
+bool batch_run(PassgenClient *client, BatchSpec *specs, size_t count, OutputSink *sink, BatchReport *report);
+
+/**
+ * @brief Prints the throughput of a job.
+ * @param[in] report Outcome of the job.
+ * @param[in] stream Where to print (the passwords may be on standard output).
+ */
+void batch_print_report(const BatchReport *report, FILE *stream);
+
+#endif /* BATCH_H_ */
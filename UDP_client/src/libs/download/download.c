@@ -0,0 +1,129 @@
+/**
+ * @file download.c
+ * @brief Implementation of the download over the TCP bulk endpoint.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#include "download.h"
+
+/* - - - - - - - - - - - - - - - - - - - - DOWNLOAD - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Opens a blocking connection to the endpoint, with `DOWNLOAD_TIMEOUT_MS` on every send and receive.
+ * @return The connected socket, or -1.
+ */
+static int open_connection(const struct sockaddr_in *server) {
+    int connection = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (connection < 0) {
+        return -1;
+    }
+    struct timeval timeout = { .tv_sec = DOWNLOAD_TIMEOUT_MS / 1000, .tv_usec = (DOWNLOAD_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    if (connect(connection, (const struct sockaddr *)server, sizeof(*server)) != 0) {
+        close(connection);
+        return -1;
+    }
+    return connection;
+}
+
+/**
+ * @brief Sends the `OP_BULK` request of a spec.
+ */
+static bool send_request(int connection, const BatchSpec *spec) {
+    unsigned char request[REQUEST_HEADER_SIZE + BULK_BODY_SIZE];
+    RequestView header = { .type = spec->type, .length = spec->length, .request_id = 1 };
+    BulkOptions options = { .total = spec->total, .framing = FRAMING_LENGTH_PREFIX };
+    size_t size = codec_encode_bulk(request, sizeof(request), &header, &options);
+
+    for (size_t sent = 0; sent < size;) {
+        ssize_t written = send(connection, request + sent, size - sent, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        sent += (size_t)written;
+    }
+    return size > 0;
+}
+
+ResponseStatus download_spec(const struct sockaddr_in *server, const BatchSpec *spec, OutputSink *sink,
+                             uint64_t *received) {
+    static unsigned char buffer[DOWNLOAD_BUFFER_SIZE];
+    static char passwords[DOWNLOAD_BUFFER_SIZE];	/**< Passwords of the buffer without their prefixes */
+    const size_t frame_size = (size_t)spec->length + 1;
+    const uint64_t record_size = output_record_size(spec->type, spec->length);
+    ResponseStatus status = STATUS_UNAVAILABLE;
+    bool answered = false;		/**< The response header was read */
+    bool framed = true;			/**< Every frame so far had the length of the spec */
+    size_t filled = 0;
+
+    *received = 0;
+    int connection = open_connection(server);
+    if (connection < 0) {
+        return STATUS_UNAVAILABLE;
+    }
+    if (!send_request(connection, spec)) {
+        close(connection);
+        return STATUS_UNAVAILABLE;
+    }
+
+    while (framed && *received < spec->total) {
+        ssize_t got = recv(connection, buffer + filled, sizeof(buffer) - filled, 0);
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            break;
+        }
+        filled += (size_t)got;
+
+        size_t used = 0;
+        if (!answered) {
+            ResponseView view;
+            if (filled < RESPONSE_HEADER_SIZE) {
+                continue;
+            }
+            if (codec_decode_response(buffer, RESPONSE_HEADER_SIZE, &view) != CODEC_OK) {
+                break;
+            }
+            if (view.status != STATUS_OK) {
+                status = view.status;
+                break;
+            }
+            answered = true;
+            used = RESPONSE_HEADER_SIZE;
+        }
+
+        /* Whole frames only: a frame cut by the end of the buffer is completed by the next read */
+        uint16_t count = 0;
+        while (filled - used >= frame_size && *received + count < spec->total) {
+            if (buffer[used] != spec->length) {
+                framed = false;
+                break;
+            }
+            memcpy(passwords + (size_t)count * spec->length, buffer + used + 1, spec->length);
+            count++;
+            used += frame_size;
+        }
+        output_passwords(sink, spec->offset + *received * record_size, passwords, count, spec->length, spec->type);
+        *received += count;
+        memmove(buffer, buffer + used, filled - used);
+        filled -= used;
+    }
+
+    close(connection);
+    return *received == spec->total ? STATUS_OK : status;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END DOWNLOAD - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,45 @@
+/**
+ * @file download.h
+ * @brief Download of one spec over the TCP bulk endpoint of a server.
+ *
+ * A server started with `-T` also listens for TCP connections on its port. One
+ * `OP_BULK` request asks for the whole spec, and the passwords come back on
+ * the connection, each preceded by its length, until the total is reached:
+ * no request per datagram, no window and no retransmission. The passwords are
+ * written to the output as they arrive.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef DOWNLOAD_H_
+#define DOWNLOAD_H_
+
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/batch/batch.h"
+#include "libs/output/output.h"
+
+/* - - - - - - - - - - - - - - - - - - - - DOWNLOAD - - - - - - - - - - - - - - - - - - - - */
+
+#define DOWNLOAD_BUFFER_SIZE (64 * 1024)		/**< Bytes read from the connection at once */
+#define DOWNLOAD_TIMEOUT_MS 10000				/**< Longest silence of the server */
+
+/**
+ * @brief Downloads a spec from the TCP bulk endpoint of a server.
+ * @param[in] server Address of the server; the endpoint listens on its UDP port.
+ * @param[in] spec The spec, laid out in the output by `batch_layout`.
+ * @param[in,out] sink The output.
+ * @param[out] received Passwords received.
+ * @return `STATUS_OK` once the whole spec arrived, the status of a server that refused the
+ *         request, or `STATUS_UNAVAILABLE` if the connection failed or ended short.
+ */
+ResponseStatus download_spec(const struct sockaddr_in *server, const BatchSpec *spec, OutputSink *sink,
+                             uint64_t *received);
+
+/* - - - - - - - - - - - - - - - - - - - END DOWNLOAD - - - - - - - - - - - - - - - - - - - */
+
+#endif /* DOWNLOAD_H_ */
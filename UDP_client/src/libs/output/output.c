@@ -0,0 +1,115 @@
+/**
+ * @file output.c
+ * @brief Implementation of the bulk mode output.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if !defined WIN32
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "output.h"
+
+static char stdout_buffer[OUTPUT_BUFFER_SIZE];	/**< Standard output stays in use after the sink is closed */
+
+/**
+ * @brief Opens a buffered sequential output.
+ */
+static bool open_sequential(OutputSink *sink, const char *path) {
+    sink->file = path == NULL ? stdout : fopen(path, "wb");
+    if (sink->file == NULL) {
+        return false;
+    }
+    sink->buffer = sink->file == stdout ? NULL : malloc(OUTPUT_BUFFER_SIZE);
+    setvbuf(sink->file, sink->buffer != NULL ? sink->buffer : stdout_buffer, _IOFBF, OUTPUT_BUFFER_SIZE);
+    return true;
+}
+
+bool output_open(OutputSink *sink, const char *path, uint64_t total_bytes) {
+    memset(sink, 0, sizeof(*sink));
+    sink->descriptor = -1;
+    if (path == NULL || total_bytes == 0) {
+        return open_sequential(sink, path);
+    }
+
+#if defined WIN32
+    return open_sequential(sink, path);
+#else
+    sink->descriptor = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (sink->descriptor < 0) {
+        return false;
+    }
+    if (ftruncate(sink->descriptor, (off_t)total_bytes) < 0) {
+        close(sink->descriptor);
+        return false;
+    }
+    sink->map = mmap(NULL, total_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, sink->descriptor, 0);
+    if (sink->map == MAP_FAILED) {
+        /* Not mappable (e.g. a pipe given as path): fall back to the buffered output */
+        sink->map = NULL;
+        close(sink->descriptor);
+        sink->descriptor = -1;
+        return open_sequential(sink, path);
+    }
+    sink->map_size = total_bytes;
+    return true;
+#endif
+}
+
+void output_passwords(OutputSink *sink, uint64_t offset, const char *passwords, uint16_t count, uint8_t length,
+                      char type) {
+    uint64_t size = (uint64_t)count * output_record_size(type, length);
+    bool raw = codec_is_random_bytes(type);		/**< No newlines: the answer is stored in one piece */
+
+    if (sink->map != NULL) {
+        if (offset > sink->map_size || size > sink->map_size - offset) {
+            return;
+        }
+        unsigned char *out = sink->map + offset;
+        if (raw) {
+            memcpy(out, passwords, size);
+        } else {
+            for (uint16_t i = 0; i < count; i++) {
+                memcpy(out, passwords + (size_t)i * length, length);
+                out[length] = '\n';
+                out += length + 1;
+            }
+        }
+    } else if (raw) {
+        fwrite(passwords, 1, size, sink->file);
+    } else {
+        for (uint16_t i = 0; i < count; i++) {
+            fwrite(passwords + (size_t)i * length, 1, length, sink->file);
+            putc('\n', sink->file);
+        }
+    }
+    sink->bytes_written += size;
+}
+
+bool output_close(OutputSink *sink) {
+    bool ok = true;
+
+#if !defined WIN32
+    if (sink->map != NULL) {
+        ok = munmap(sink->map, sink->map_size) == 0;
+        ok = close(sink->descriptor) == 0 && ok;
+        sink->map = NULL;
+        return ok;
+    }
+#endif
+    ok = fflush(sink->file) == 0;
+    if (sink->file != stdout) {
+        ok = fclose(sink->file) == 0 && ok;
+    }
+    sink->file = NULL;
+    free(sink->buffer);
+    sink->buffer = NULL;
+    return ok;
+}
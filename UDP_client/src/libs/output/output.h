@@ -0,0 +1,80 @@
+/**
+ * @file output.h
+ * @brief Destination of the passwords downloaded in bulk mode.
+ *
+ * When the output is a regular file its final size is known in advance (every
+ * password is followed by a newline, random bytes are written as such), so the
+ * file is sized once and mapped in
+ * memory: each answer is copied straight to its own position, whatever the
+ * order in which the answers arrive, and no `write` call is made at all.
+ * Standard output, or a file on a system without `mmap`, goes through a large
+ * stdio buffer and receives the passwords in arrival order.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef OUTPUT_H_
+#define OUTPUT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "libs/codec/codec.h"
+
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)	/**< stdio buffer of the sequential output */
+
+/**
+ * @struct OutputSink
+ * @brief An open output.
+ */
+typedef struct {
+    FILE *file;				/**< Sequential output, `NULL` when the output is mapped */
+    char *buffer;			/**< stdio buffer of `file` */
+    unsigned char *map;		/**< Mapped output, `NULL` when the output is sequential */
+    uint64_t map_size;		/**< Size of the mapping */
+    int descriptor;			/**< File descriptor of the mapped output */
+    uint64_t bytes_written;	/**< Bytes stored so far */
+} OutputSink;
+
+/**
+ * @brief Computes the bytes one password of a type takes in the output.
+ * @param[in] type The wire type.
+ * @param[in] length Length of each password.
+ * @return `length`, plus the newline unless the type is random bytes.
+ */
+static inline uint64_t output_record_size(char type, uint8_t length) {
+    return codec_is_random_bytes(type) ? length : length + 1u;
+}
+
+/**
+ * @brief Opens the output.
+ * @param[out] sink The output to initialise.
+ * @param[in] path File to create, or `NULL` for standard output.
+ * @param[in] total_bytes Final size of the output.
+ * @return `true` on success, `false` if the file could not be created or sized.
+ */
+bool output_open(OutputSink *sink, const char *path, uint64_t total_bytes);
+
+/**
+ * @brief Stores passwords, each followed by a newline, or random bytes back to back.
+ * @param[in,out] sink The output.
+ * @param[in] offset Position of the first password: used when the output is mapped, ignored otherwise.
+ * @param[in] passwords `count` passwords of `length` characters, back to back.
+ * @param[in] count Number of passwords.
+ * @param[in] length Length of each password.
+ * @param[in] type The wire type of the passwords.
+ */
+void output_passwords(OutputSink *sink, uint64_t offset, const char *passwords, uint16_t count, uint8_t length,
+                      char type);
+
+/**
+ * @brief Flushes and closes the output.
+ * @param[in,out] sink The output.
+ * @return `true` if every byte reached the file.
+ */
+bool output_close(OutputSink *sink);
+
+#endif /* OUTPUT_H_ */
@@ -80,15 +80,24 @@ void show_help_menu() {
 		" m LENGTH : generate mixed password (lowercase letters and numbers)\n"
 		" s LENGTH : generate secure password (uppercase, lowercase, numbers, symbols)\n"
 		" u LENGTH : generate unambiguous secure password (no similar-looking characters)\n"
+		" r        : generate a random UUID (version 4, 32 hex digits)\n"
+		" t        : generate a time-ordered UUID (version 7, 32 hex digits)\n"
+		" l        : generate a ULID (26 Crockford base32 digits)\n"
+		" f        : generate a Snowflake ID (16 hex digits)\n"
+		" b LENGTH : generate LENGTH raw random bytes (1 to 32, shown in hex)\n"
+		" p TEMPLATE : generate a password following TEMPLATE, e.g. Cvc-9999-XX or A{4}-9{4}\n"
 		" q        : quit application\n\n"
-		" LENGTH must be between 6 and 32 characters\n\n"
+		" In a template, 9 is a digit, a/A a lowercase/uppercase letter, c/C a consonant,\n"
+		" v/V a vowel, x/X a hex digit, m a letter or digit, s a symbol, * any character of 's';\n"
+		" {n} repeats the previous character n times, \\ makes the next one a literal\n\n"
+		" LENGTH must be between 6 and 32 characters; an identifier has a fixed length\n\n"
 		" Ambiguous characters excluded in 'u' option:\n"
 		" 0 O o (zero and letters O)\n"
 		" 1 l I i (one and letters l, I)\n"
 		" 2 Z z (two and letter Z)\n"
 		" 5 S s (five and letter S)\n"
 		" 8 B (eight and letter B)\n"
-		"\nIf the length is absent, a default value is used: 8\n\n";
+		"\nIf the length is absent, a default value is used: 8 (32 for random bytes)\n\n";
 	print_with_color(help_text,CYAN);
 }
 
@@ -106,6 +115,9 @@ void show_password_menu() {
 		"  m: mixed password (lowercase letters and digits)\n"
 		"  s: secure password (uppercase letters, lowercase letters, digits, and symbols)\n"
 		"  u: unambiguous secure password (no similar-looking characters)\n"
+		"  r, t, l, f: UUIDv4, UUIDv7, ULID or Snowflake identifier (no length)\n"
+		"  b: raw random bytes (length between 1 and 32, shown in hex)\n"
+		"  p: password following a template (p TEMPLATE, see the help menu)\n"
 		"  h: help menu\n"
 		"  q: quit application\n"
 		"? ";
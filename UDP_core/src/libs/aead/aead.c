@@ -0,0 +1,382 @@
+/**
+ * @file aead.c
+ * @brief Implementation of ChaCha20-Poly1305 (RFC 8439).
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+#include "aead.h"
+
+/* - - - - - - - - - - - - - - - - - - - - BYTE ORDER - - - - - - - - - - - - - - - - - - - - */
+
+static inline uint32_t load_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void store_le32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static inline uint64_t load_le64(const unsigned char *p) {
+    return (uint64_t)load_le32(p) | ((uint64_t)load_le32(p + 4) << 32);
+}
+
+static inline void store_le64(unsigned char *p, uint64_t value) {
+    store_le32(p, (uint32_t)value);
+    store_le32(p + 4, (uint32_t)(value >> 32));
+}
+
+/* - - - - - - - - - - - - - - - - - - - END BYTE ORDER - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CHACHA20 - - - - - - - - - - - - - - - - - - - - */
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+/**
+ * @brief Eight 32-bit lanes: each lane holds the same state word of a different block.
+ */
+typedef uint32_t lanes_t __attribute__((vector_size(32)));
+
+#define CHACHA_BLOCK_SIZE 64
+#define CHACHA_LANES 8	/**< Blocks computed by one call to `chacha20_blocks` */
+
+/**
+ * @brief Computes eight consecutive ChaCha20 blocks (RFC 8439: 32-bit counter, 96-bit nonce).
+ * @details The random number generator uses the original variant, with a 64-bit counter
+ * and no nonce, which is why the two modules each have their own block function.
+ * @param[in] key The key, as eight little-endian words.
+ * @param[in] nonce The nonce, as three little-endian words.
+ * @param[in] counter The counter of the first block.
+ * @param[out] out The 512 bytes of keystream.
+ */
+static void chacha20_blocks(const uint32_t key[8], const uint32_t nonce[3], uint32_t counter,
+                            unsigned char out[CHACHA_LANES * CHACHA_BLOCK_SIZE]) {
+    static const uint32_t constants[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    lanes_t input[16];
+    lanes_t x[16];
+
+    for (int i = 0; i < 4; i++) {
+        input[i] = (lanes_t){ 0 } + constants[i];
+        input[4 + i] = (lanes_t){ 0 } + key[i];
+        input[8 + i] = (lanes_t){ 0 } + key[4 + i];
+    }
+    input[12] = (lanes_t){ 0, 1, 2, 3, 4, 5, 6, 7 } + counter;
+    for (int i = 0; i < 3; i++) {
+        input[13 + i] = (lanes_t){ 0 } + nonce[i];
+    }
+    memcpy(x, input, sizeof(x));
+
+    for (int round = 0; round < 10; round++) {
+        QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        lanes_t word = x[i] + input[i];
+        for (int lane = 0; lane < CHACHA_LANES; lane++) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            uint32_t value = word[lane];	/**< One store per word rather than four byte stores */
+            memcpy(out + lane * CHACHA_BLOCK_SIZE + 4 * i, &value, sizeof(value));
+#else
+            store_le32(out + lane * CHACHA_BLOCK_SIZE + 4 * i, word[lane]);
+#endif
+        }
+    }
+}
+
+/**
+ * @struct ChaCha20
+ * @brief Keystream of one message, computed eight blocks at a time.
+ */
+typedef struct {
+    uint32_t key[8];									/**< Key words */
+    uint32_t nonce[3];									/**< Nonce words */
+    unsigned char first[CHACHA_LANES * CHACHA_BLOCK_SIZE];	/**< Blocks 0 to 7 */
+} ChaCha20;
+
+/**
+ * @brief Computes the first eight blocks of a message: block 0 starts with the one-time
+ * Poly1305 key, the message is encrypted from block 1.
+ */
+static void chacha20_start(ChaCha20 *stream, const unsigned char key[AEAD_KEY_SIZE],
+                           const unsigned char nonce[AEAD_NONCE_SIZE]) {
+    for (int i = 0; i < 8; i++) {
+        stream->key[i] = load_le32(key + 4 * i);
+    }
+    for (int i = 0; i < 3; i++) {
+        stream->nonce[i] = load_le32(nonce + 4 * i);
+    }
+    chacha20_blocks(stream->key, stream->nonce, 0, stream->first);
+}
+
+/**
+ * @brief XORs a message with the keystream starting at block 1.
+ */
+static void chacha20_xor(const ChaCha20 *stream, unsigned char *data, size_t size) {
+    unsigned char next[CHACHA_LANES * CHACHA_BLOCK_SIZE];
+    const unsigned char *keystream = stream->first + CHACHA_BLOCK_SIZE;
+    size_t available = sizeof(stream->first) - CHACHA_BLOCK_SIZE;
+
+    for (uint32_t counter = 0; size > 0; ) {
+        size_t chunk = size < available ? size : available;
+        for (size_t i = 0; i < chunk; i++) {
+            data[i] ^= keystream[i];
+        }
+        data += chunk;
+        size -= chunk;
+        if (size > 0) {
+            counter += CHACHA_LANES;
+            chacha20_blocks(stream->key, stream->nonce, counter, next);
+            keystream = next;
+            available = sizeof(next);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CHACHA20 - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - POLY1305 - - - - - - - - - - - - - - - - - - - - */
+
+#define LIMB44 0xFFFFFFFFFFFull		/**< Low 44 bits */
+#define LIMB42 0x3FFFFFFFFFFull		/**< Low 42 bits */
+
+/**
+ * @struct Poly1305
+ * @brief Accumulator and key of a Poly1305 computation, in limbs of 44, 44 and 42 bits.
+ */
+typedef struct {
+    uint64_t r[3];		/**< Clamped multiplier */
+    uint64_t rr[3];		/**< r^2, to absorb two blocks per multiplication of the accumulator */
+    uint64_t h[3];		/**< Accumulator */
+    uint64_t pad[2];	/**< Value added at the end */
+} Poly1305;
+
+/**
+ * @brief Sums of the products of `a` and `b` modulo 2^130 - 5, before the carries: the
+ * products past 2^130 come back multiplied by 5 (`s1`, `s2` = b * 20).
+ */
+#define POLY_MULTIPLY(d0, d1, d2, a0, a1, a2, b0, b1, b2, s1, s2) \
+    d0 = (unsigned __int128)(a0) * (b0) + (unsigned __int128)(a1) * (s2) + (unsigned __int128)(a2) * (s1); \
+    d1 = (unsigned __int128)(a0) * (b1) + (unsigned __int128)(a1) * (b0) + (unsigned __int128)(a2) * (s2); \
+    d2 = (unsigned __int128)(a0) * (b2) + (unsigned __int128)(a1) * (b1) + (unsigned __int128)(a2) * (b0)
+
+/**
+ * @brief Carries the sums of products back into limbs.
+ */
+static inline void poly1305_carry(unsigned __int128 d0, unsigned __int128 d1, unsigned __int128 d2, uint64_t h[3]) {
+    uint64_t carry = (uint64_t)(d0 >> 44);
+    h[0] = (uint64_t)d0 & LIMB44;
+    d1 += carry;
+    carry = (uint64_t)(d1 >> 44);
+    h[1] = (uint64_t)d1 & LIMB44;
+    d2 += carry;
+    carry = (uint64_t)(d2 >> 42);
+    h[2] = (uint64_t)d2 & LIMB42;
+    h[0] += carry * 5;
+    carry = h[0] >> 44;
+    h[0] &= LIMB44;
+    h[1] += carry;
+}
+
+static void poly1305_init(Poly1305 *state, const unsigned char key[32]) {
+    uint64_t t0 = load_le64(key);
+    uint64_t t1 = load_le64(key + 8);
+    unsigned __int128 d0, d1, d2;
+
+    state->r[0] = t0 & 0xFFC0FFFFFFFull;
+    state->r[1] = ((t0 >> 44) | (t1 << 20)) & 0xFFFFFC0FFFFull;
+    state->r[2] = (t1 >> 24) & 0x00FFFFFFC0Full;
+    POLY_MULTIPLY(d0, d1, d2, state->r[0], state->r[1], state->r[2], state->r[0], state->r[1], state->r[2],
+                  state->r[1] * 20, state->r[2] * 20);
+    poly1305_carry(d0, d1, d2, state->rr);
+    state->h[0] = state->h[1] = state->h[2] = 0;
+    state->pad[0] = load_le64(key + 16);
+    state->pad[1] = load_le64(key + 24);
+}
+
+/**
+ * @brief Absorbs whole 16-byte blocks (the AEAD construction pads every part to 16 bytes).
+ * @details Two blocks at a time, as (h + m1) * r^2 + m2 * r: the second product does
+ * not wait for the accumulator, so the multiplications of a pair overlap instead of
+ * forming one chain as long as the message.
+ */
+static void poly1305_blocks(Poly1305 *state, const unsigned char *data, size_t blocks) {
+    const uint64_t r0 = state->r[0], r1 = state->r[1], r2 = state->r[2];
+    const uint64_t s1 = r1 * 20, s2 = r2 * 20;
+    const uint64_t rr0 = state->rr[0], rr1 = state->rr[1], rr2 = state->rr[2];
+    const uint64_t ss1 = rr1 * 20, ss2 = rr2 * 20;
+    uint64_t h0 = state->h[0], h1 = state->h[1], h2 = state->h[2];
+    unsigned __int128 d0, d1, d2, e0, e1, e2;
+
+    for (; blocks >= 2; blocks -= 2, data += 32) {
+        uint64_t t0 = load_le64(data);
+        uint64_t t1 = load_le64(data + 8);
+        uint64_t t2 = load_le64(data + 16);
+        uint64_t t3 = load_le64(data + 24);
+        h0 += t0 & LIMB44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & LIMB44;
+        h2 += ((t1 >> 24) & LIMB42) | (1ull << 40);	/**< The 2^128 bit of a full block */
+        uint64_t m0 = t2 & LIMB44;
+        uint64_t m1 = ((t2 >> 44) | (t3 << 20)) & LIMB44;
+        uint64_t m2 = ((t3 >> 24) & LIMB42) | (1ull << 40);
+
+        POLY_MULTIPLY(d0, d1, d2, h0, h1, h2, rr0, rr1, rr2, ss1, ss2);
+        POLY_MULTIPLY(e0, e1, e2, m0, m1, m2, r0, r1, r2, s1, s2);
+        poly1305_carry(d0 + e0, d1 + e1, d2 + e2, state->h);
+        h0 = state->h[0];
+        h1 = state->h[1];
+        h2 = state->h[2];
+    }
+    if (blocks > 0) {
+        uint64_t t0 = load_le64(data);
+        uint64_t t1 = load_le64(data + 8);
+        h0 += t0 & LIMB44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & LIMB44;
+        h2 += ((t1 >> 24) & LIMB42) | (1ull << 40);
+
+        POLY_MULTIPLY(d0, d1, d2, h0, h1, h2, r0, r1, r2, s1, s2);
+        poly1305_carry(d0, d1, d2, state->h);
+    } else {
+        state->h[0] = h0;
+        state->h[1] = h1;
+        state->h[2] = h2;
+    }
+}
+
+/**
+ * @brief Absorbs a message followed by zeros up to a multiple of 16 bytes.
+ */
+static void poly1305_padded(Poly1305 *state, const unsigned char *data, size_t size) {
+    poly1305_blocks(state, data, size / 16);
+    if (size % 16 != 0) {
+        unsigned char last[16] = { 0 };
+        memcpy(last, data + size - size % 16, size % 16);
+        poly1305_blocks(state, last, 1);
+    }
+}
+
+static void poly1305_finish(Poly1305 *state, unsigned char tag[AEAD_TAG_SIZE]) {
+    uint64_t h0 = state->h[0], h1 = state->h[1], h2 = state->h[2];
+    uint64_t carry;
+
+    /* Full carry propagation */
+    carry = h1 >> 44; h1 &= LIMB44; h2 += carry;
+    carry = h2 >> 42; h2 &= LIMB42; h0 += carry * 5;
+    carry = h0 >> 44; h0 &= LIMB44; h1 += carry;
+    carry = h1 >> 44; h1 &= LIMB44; h2 += carry;
+    carry = h2 >> 42; h2 &= LIMB42; h0 += carry * 5;
+    carry = h0 >> 44; h0 &= LIMB44; h1 += carry;
+
+    /* h - p = h + 5 - 2^130: kept, without branching, when it does not go negative */
+    uint64_t g0 = h0 + 5;
+    carry = g0 >> 44; g0 &= LIMB44;
+    uint64_t g1 = h1 + carry;
+    carry = g1 >> 44; g1 &= LIMB44;
+    uint64_t g2 = h2 + carry - (1ull << 42);
+    uint64_t keep_g = (g2 >> 63) - 1;
+    h0 = (h0 & ~keep_g) | (g0 & keep_g);
+    h1 = (h1 & ~keep_g) | (g1 & keep_g);
+    h2 = (h2 & ~keep_g) | (g2 & keep_g);
+
+    /* Add the pad modulo 2^128 */
+    uint64_t t0 = state->pad[0], t1 = state->pad[1];
+    h0 += t0 & LIMB44;
+    carry = h0 >> 44; h0 &= LIMB44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & LIMB44) + carry;
+    carry = h1 >> 44; h1 &= LIMB44;
+    h2 += ((t1 >> 24) & LIMB42) + carry;
+
+    store_le64(tag, h0 | (h1 << 44));
+    store_le64(tag + 8, (h1 >> 20) | (h2 << 24));
+}
+
+/**
+ * @brief Computes the tag of the AEAD construction: aad, ciphertext, then both sizes.
+ */
+static void aead_tag(const unsigned char poly_key[32], const unsigned char *aad, size_t aad_size,
+                     const unsigned char *ciphertext, size_t size, unsigned char tag[AEAD_TAG_SIZE]) {
+    Poly1305 state;
+    unsigned char sizes[16];
+
+    poly1305_init(&state, poly_key);
+    poly1305_padded(&state, aad, aad_size);
+    poly1305_padded(&state, ciphertext, size);
+    store_le64(sizes, aad_size);
+    store_le64(sizes + 8, size);
+    poly1305_blocks(&state, sizes, 1);
+    poly1305_finish(&state, tag);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END POLY1305 - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - AEAD - - - - - - - - - - - - - - - - - - - - - */
+
+void aead_seal(const unsigned char key[AEAD_KEY_SIZE], const unsigned char nonce[AEAD_NONCE_SIZE],
+               const unsigned char *aad, size_t aad_size, unsigned char *data, size_t size,
+               unsigned char tag[AEAD_TAG_SIZE]) {
+    ChaCha20 stream;
+
+    chacha20_start(&stream, key, nonce);
+    chacha20_xor(&stream, data, size);
+    aead_tag(stream.first, aad, aad_size, data, size, tag);
+}
+
+bool aead_open(const unsigned char key[AEAD_KEY_SIZE], const unsigned char nonce[AEAD_NONCE_SIZE],
+               const unsigned char *aad, size_t aad_size, unsigned char *data, size_t size,
+               const unsigned char tag[AEAD_TAG_SIZE]) {
+    ChaCha20 stream;
+    unsigned char expected[AEAD_TAG_SIZE];
+    unsigned char difference = 0;
+
+    /* The Poly1305 key is in block 0: computing it does not touch the message */
+    chacha20_start(&stream, key, nonce);
+    aead_tag(stream.first, aad, aad_size, data, size, expected);
+    for (int i = 0; i < AEAD_TAG_SIZE; i++) {
+        difference |= expected[i] ^ tag[i];		/**< No early exit: the time does not depend on where they differ */
+    }
+    if (difference != 0) {
+        return false;
+    }
+    chacha20_xor(&stream, data, size);
+    return true;
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        return (c | 0x20) - 'a' + 10;
+    }
+    return -1;
+}
+
+bool aead_parse_key(const char *hex, unsigned char key[AEAD_KEY_SIZE]) {
+    for (int i = 0; i < AEAD_KEY_SIZE; i++) {
+        int high = hex_digit(hex[2 * i]);
+        int low = high < 0 ? -1 : hex_digit(hex[2 * i + 1]);
+        if (low < 0) {
+            return false;
+        }
+        key[i] = (unsigned char)(high << 4 | low);
+    }
+    return hex_digit(hex[2 * AEAD_KEY_SIZE]) < 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END AEAD - - - - - - - - - - - - - - - - - - - */
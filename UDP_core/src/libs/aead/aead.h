@@ -0,0 +1,76 @@
+/**
+ * @file aead.h
+ * @brief ChaCha20-Poly1305 authenticated encryption (RFC 8439).
+ *
+ * Used to encrypt the passwords of a response with a key shared by the server
+ * and one client (see `REQUEST_FLAG_ENCRYPTED`): nobody on the path can read
+ * them, and the client can tell that the answer was neither forged nor altered.
+ *
+ * A whole batch response is encrypted in one pass: the keystream is computed
+ * eight blocks at a time in vector registers, as in the random number
+ * generator, and Poly1305 uses 64-bit limbs with 128-bit products.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef AEAD_H_
+#define AEAD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define AEAD_KEY_SIZE 32		/**< Size of a ChaCha20-Poly1305 key */
+#define AEAD_NONCE_SIZE 12		/**< Size of a nonce; a nonce must never be used twice with the same key */
+#define AEAD_TAG_SIZE 16		/**< Size of the authentication tag */
+
+/**
+ * @brief Encrypts a message in place and authenticates it with additional data.
+ * @param[in] key The 256-bit key.
+ * @param[in] nonce The 96-bit nonce, unique for the key.
+ * @param[in] aad Data authenticated but not encrypted (may be `NULL` if `aad_size` is 0).
+ * @param[in] aad_size Size of `aad`.
+ * @param[in,out] data The plaintext, replaced with the ciphertext.
+ * @param[in] size Size of `data`.
+ * @param[out] tag The authentication tag.
+ */
+void aead_seal(const unsigned char key[AEAD_KEY_SIZE], const unsigned char nonce[AEAD_NONCE_SIZE],
+               const unsigned char *aad, size_t aad_size, unsigned char *data, size_t size,
+               unsigned char tag[AEAD_TAG_SIZE]);
+
+/**
+ * @brief Checks the tag of a message and decrypts it in place.
+ * @details The tag is verified, in constant time, before anything is decrypted:
+ * on failure `data` is left untouched.
+ * @param[in] key The 256-bit key.
+ * @param[in] nonce The nonce the message was sealed with.
+ * @param[in] aad The additional data the message was sealed with.
+ * @param[in] aad_size Size of `aad`.
+ * @param[in,out] data The ciphertext, replaced with the plaintext.
+ * @param[in] size Size of `data`.
+ * @param[in] tag The received tag.
+ * @return `true` if the message is authentic, `false` otherwise.
+ */
+bool aead_open(const unsigned char key[AEAD_KEY_SIZE], const unsigned char nonce[AEAD_NONCE_SIZE],
+               const unsigned char *aad, size_t aad_size, unsigned char *data, size_t size,
+               const unsigned char tag[AEAD_TAG_SIZE]);
+
+/**
+ * @brief Reads a key written as 64 hexadecimal digits.
+ * @param[in] hex The digits; parsing stops after the 64th.
+ * @param[out] key The key.
+ * @return `false` if `hex` does not start with 64 hexadecimal digits followed by a non-digit.
+ */
+bool aead_parse_key(const char *hex, unsigned char key[AEAD_KEY_SIZE]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* AEAD_H_ */
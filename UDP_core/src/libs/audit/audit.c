@@ -0,0 +1,363 @@
+/**
+ * @file audit.c
+ * @brief Implementation of the audit log.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "audit.h"
+#include "libs/codec/codec.h"
+
+#define AUDIT_SEGMENT_MAGIC "PGAUDIT1"		/**< First bytes of a segment */
+#define AUDIT_FORMAT_VERSION 1				/**< Version of the segment layout */
+#define AUDIT_BLOCK_MAGIC 0xA7B10C4Bu		/**< First bytes of a block */
+#define AUDIT_STALL_NS (100 * NANOSECONDS_PER_MICROSECOND)	/**< Wait of a producer finding the ring full */
+
+/* - - - - - - - - - - - - - - - - - - - - - CRC-32C - - - - - - - - - - - - - - - - - - - - */
+
+static uint32_t crc_tables[8][256];					/**< Slicing-by-8 tables */
+static pthread_once_t crc_tables_once = PTHREAD_ONCE_INIT;
+
+static void build_crc_tables(void) {
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0x82F63B78u & -(crc & 1));	/**< Castagnoli polynomial, reflected */
+        }
+        crc_tables[0][byte] = crc;
+    }
+    for (uint32_t byte = 0; byte < 256; byte++) {
+        for (int table = 1; table < 8; table++) {
+            uint32_t previous = crc_tables[table - 1][byte];
+            crc_tables[table][byte] = (previous >> 8) ^ crc_tables[0][previous & 0xFF];
+        }
+    }
+}
+
+uint32_t audit_crc32c(const void *data, size_t size) {
+    const unsigned char *bytes = data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    pthread_once(&crc_tables_once, build_crc_tables);
+    /* Eight bytes per step, one table lookup for each */
+    for (; size >= 8; size -= 8, bytes += 8) {
+        uint32_t low = crc ^ ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24);
+        crc = crc_tables[7][low & 0xFF] ^ crc_tables[6][(low >> 8) & 0xFF] ^ crc_tables[5][(low >> 16) & 0xFF]
+            ^ crc_tables[4][low >> 24] ^ crc_tables[3][bytes[4]] ^ crc_tables[2][bytes[5]] ^ crc_tables[1][bytes[6]]
+            ^ crc_tables[0][bytes[7]];
+    }
+    for (; size > 0; size--, bytes++) {
+        crc = (crc >> 8) ^ crc_tables[0][(crc ^ *bytes) & 0xFF];
+    }
+    return ~crc;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END CRC-32C - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+static inline void store_le16(unsigned char *p, uint16_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static inline void store_le32(unsigned char *p, uint32_t value) {
+    store_le16(p, (uint16_t)value);
+    store_le16(p + 2, (uint16_t)(value >> 16));
+}
+
+static inline void store_le64(unsigned char *p, uint64_t value) {
+    store_le32(p, (uint32_t)value);
+    store_le32(p + 4, (uint32_t)(value >> 32));
+}
+
+/**
+ * @brief Wall-clock time of the records, nanoseconds since the Unix epoch.
+ */
+static uint64_t wall_clock_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    return (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)now.tv_nsec;
+}
+
+static void sleep_ns(uint64_t duration_ns) {
+    struct timespec duration = { .tv_sec = (time_t)(duration_ns / NANOSECONDS_PER_SECOND),
+                                 .tv_nsec = (long)(duration_ns % NANOSECONDS_PER_SECOND) };
+    nanosleep(&duration, NULL);
+}
+
+/**
+ * @brief Writes a record in its on-disk layout. The addresses keep their network byte order.
+ */
+static void encode_record(unsigned char *out, const AuditRecord *record) {
+    store_le64(out, record->time_ns);
+    memcpy(out + 8, &record->address, 4);
+    memcpy(out + 12, &record->port, 2);
+    out[14] = (unsigned char)record->type;
+    out[15] = record->length;
+    store_le32(out + 16, record->tenant_id);
+    store_le32(out + 20, record->request_id);
+    store_le64(out + 24, record->password_hash);
+}
+
+/**
+ * @brief Number following the highest segment already in the directory, 1 for an empty one.
+ */
+static uint64_t next_segment_number(const char *directory) {
+    DIR *listing = opendir(directory);
+    uint64_t highest = 0;
+    if (listing == NULL) {
+        return 1;
+    }
+    for (struct dirent *entry = readdir(listing); entry != NULL; entry = readdir(listing)) {
+        unsigned long long number;
+        int consumed = 0;
+        if (sscanf(entry->d_name, "audit-%llu.log%n", &number, &consumed) == 1 && entry->d_name[consumed] == '\0'
+            && consumed > 0 && number > highest) {
+            highest = number;
+        }
+    }
+    closedir(listing);
+    return highest + 1;
+}
+
+/**
+ * @brief Makes the creation of a segment durable along with its content.
+ */
+static void sync_directory(const char *directory) {
+    int descriptor = open(directory, O_RDONLY | O_DIRECTORY);
+    if (descriptor >= 0) {
+        fsync(descriptor);
+        close(descriptor);
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - SEGMENTS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Creates segment `log->segment_number`, with all its blocks allocated, and maps it.
+ * @details The space is reserved up front: a full disk is reported here rather than by a
+ * `SIGBUS` when the mapping is written.
+ */
+static bool open_segment(AuditLog *log) {
+    char path[AUDIT_PATH_SIZE];
+    snprintf(path, sizeof(path), "%s/audit-%010llu.log", log->options.directory,
+             (unsigned long long)log->segment_number);
+
+    int file = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (file < 0) {
+        return false;
+    }
+    void *mapping = MAP_FAILED;
+    if (posix_fallocate(file, 0, (off_t)log->options.segment_size) == 0) {
+        mapping = mmap(NULL, log->options.segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    }
+    if (mapping == MAP_FAILED) {
+        close(file);
+        unlink(path);
+        return false;
+    }
+
+    log->segment = mapping;
+    log->segment_file = file;
+    memcpy(log->segment, AUDIT_SEGMENT_MAGIC, 8);
+    store_le32(log->segment + 8, AUDIT_FORMAT_VERSION);
+    store_le32(log->segment + 12, AUDIT_RECORD_SIZE);
+    store_le64(log->segment + 16, log->segment_number);
+    store_le64(log->segment + 24, wall_clock_ns());
+    log->used = AUDIT_SEGMENT_HEADER_SIZE;
+    log->synced = 0;
+    sync_directory(log->options.directory);
+    __atomic_add_fetch(&log->stats.segments, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * @brief Synchronises the bytes written since the last synchronisation.
+ */
+static bool sync_segment(AuditLog *log, uint64_t now_ns) {
+    uint64_t page_size = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t start = log->synced & ~(page_size - 1);	/**< `msync` wants an aligned address */
+    log->synced_ns = now_ns;
+    if (log->used == log->synced) {
+        return true;
+    }
+    if (msync(log->segment + start, log->used - start, MS_SYNC) != 0) {
+        return false;
+    }
+    log->synced = log->used;
+    __atomic_add_fetch(&log->stats.syncs, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * @brief Synchronises the open segment, cuts it to its used size and closes it.
+ */
+static bool close_segment(AuditLog *log) {
+    bool closed = sync_segment(log, clock_now_ns());
+    munmap(log->segment, log->options.segment_size);
+    log->segment = NULL;
+    closed = ftruncate(log->segment_file, (off_t)log->used) == 0 && closed;
+    closed = fsync(log->segment_file) == 0 && closed;
+    close(log->segment_file);
+    return closed;
+}
+
+/**
+ * @brief Writes the records queued up to `head` as one block, at most `AUDIT_BLOCK_RECORDS`
+ * of them and no more than the segment holds; starts the next segment when it is full.
+ */
+static bool write_block(AuditLog *log, uint64_t head) {
+    uint64_t size = log->options.segment_size;
+    if (log->used + AUDIT_BLOCK_HEADER_SIZE + AUDIT_RECORD_SIZE > size) {
+        log->segment_number++;
+        if (!close_segment(log) || !open_segment(log)) {
+            return false;
+        }
+    }
+
+    uint64_t count = head - log->tail;
+    count = count < AUDIT_BLOCK_RECORDS ? count : AUDIT_BLOCK_RECORDS;
+    if (log->used + AUDIT_BLOCK_HEADER_SIZE + count * AUDIT_RECORD_SIZE > size) {
+        count = (size - log->used - AUDIT_BLOCK_HEADER_SIZE) / AUDIT_RECORD_SIZE;
+    }
+
+    unsigned char *block = log->segment + log->used;
+    unsigned char *records = block + AUDIT_BLOCK_HEADER_SIZE;
+    for (uint64_t i = 0; i < count; i++) {
+        encode_record(records + i * AUDIT_RECORD_SIZE, &log->ring[(log->tail + i) & (AUDIT_RING_RECORDS - 1)]);
+    }
+    store_le32(block, AUDIT_BLOCK_MAGIC);
+    store_le32(block + 4, (uint32_t)count);
+    store_le64(block + 8, log->tail);
+    store_le32(block + 16, audit_crc32c(records, count * AUDIT_RECORD_SIZE));
+    store_le32(block + 20, audit_crc32c(block, 20));
+
+    log->used += AUDIT_BLOCK_HEADER_SIZE + count * AUDIT_RECORD_SIZE;
+    __atomic_store_n(&log->tail, log->tail + count, __ATOMIC_RELEASE);	/**< The slots can be reused */
+    __atomic_add_fetch(&log->stats.written, count, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&log->stats.blocks, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/**
+ * @brief The writer thread: a group commit every `AUDIT_COMMIT_NS`, an `msync` every
+ * `sync_interval_ms`, and everything written and synchronised once stopped.
+ */
+static void *writer_main(void *argument) {
+    AuditLog *log = argument;
+    uint64_t sync_interval_ns = (uint64_t)log->options.sync_interval_ms * NANOSECONDS_PER_MILLISECOND;
+    bool written = true;
+
+    while (true) {
+        bool running = __atomic_load_n(&log->running, __ATOMIC_ACQUIRE);
+        uint64_t head = __atomic_load_n(&log->head, __ATOMIC_ACQUIRE);
+        while (written && log->tail < head) {
+            written = write_block(log, head);
+        }
+        uint64_t now_ns = clock_now_ns();
+        if (written && now_ns - log->synced_ns >= sync_interval_ns) {
+            written = sync_segment(log, now_ns);
+        }
+        if (!written) {
+            __atomic_store_n(&log->failed, true, __ATOMIC_RELEASE);	/**< The producer stops waiting */
+            break;
+        }
+        if (!running) {
+            break;
+        }
+        sleep_ns(AUDIT_COMMIT_NS);
+    }
+    if (log->segment != NULL && !close_segment(log)) {
+        __atomic_store_n(&log->failed, true, __ATOMIC_RELEASE);
+    }
+    return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END SEGMENTS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - - AUDIT - - - - - - - - - - - - - - - - - - - - - */
+
+bool audit_open(AuditLog *log, const AuditOptions *options) {
+    memset(log, 0, sizeof(*log));
+    log->options = *options;
+    if (log->options.segment_size < AUDIT_MIN_SEGMENT_SIZE) {
+        return false;
+    }
+    log->ring = malloc(AUDIT_RING_RECORDS * sizeof(AuditRecord));
+    if (log->ring == NULL) {
+        return false;
+    }
+
+    log->segment_number = next_segment_number(options->directory);
+    log->synced_ns = clock_now_ns();
+    if (!open_segment(log)) {
+        free(log->ring);
+        return false;
+    }
+    log->running = true;
+    if (pthread_create(&log->writer, NULL, writer_main, log) != 0) {
+        close_segment(log);
+        free(log->ring);
+        return false;
+    }
+    return true;
+}
+
+void audit_close(AuditLog *log) {
+    __atomic_store_n(&log->running, false, __ATOMIC_RELEASE);
+    pthread_join(log->writer, NULL);
+    free(log->ring);
+    log->ring = NULL;
+}
+
+bool audit_issue(AuditLog *log, const struct sockaddr_in *client, uint32_t tenant_id, uint32_t request_id,
+                 char type, uint8_t length, const char *passwords, size_t stride, size_t count) {
+    if (codec_is_random_bytes(type)) {
+        return true;
+    }
+    uint64_t head = log->head;		/**< Only this thread writes it */
+    uint64_t time_ns = wall_clock_ns();
+
+    for (size_t i = 0; i < count; i++, passwords += stride) {
+        while (head - __atomic_load_n(&log->tail, __ATOMIC_ACQUIRE) >= AUDIT_RING_RECORDS) {
+            __atomic_store_n(&log->head, head, __ATOMIC_RELEASE);	/**< Hand over what is queued */
+            if (audit_failed(log)) {
+                return false;
+            }
+            __atomic_add_fetch(&log->stats.stalls, 1, __ATOMIC_RELAXED);
+            sleep_ns(AUDIT_STALL_NS);
+        }
+        log->ring[head & (AUDIT_RING_RECORDS - 1)] = (AuditRecord){
+            .time_ns = time_ns, .address = client->sin_addr.s_addr, .port = client->sin_port,
+            .type = type, .length = length, .tenant_id = tenant_id, .request_id = request_id,
+            .password_hash = siphash24(log->options.key, passwords, length) };
+        head++;
+    }
+    __atomic_store_n(&log->head, head, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&log->stats.records, count, __ATOMIC_RELAXED);
+    return !audit_failed(log);
+}
+
+void audit_stats(const AuditLog *log, AuditStats *stats) {
+    stats->records = __atomic_load_n(&log->stats.records, __ATOMIC_RELAXED);
+    stats->written = __atomic_load_n(&log->stats.written, __ATOMIC_RELAXED);
+    stats->blocks = __atomic_load_n(&log->stats.blocks, __ATOMIC_RELAXED);
+    stats->syncs = __atomic_load_n(&log->stats.syncs, __ATOMIC_RELAXED);
+    stats->segments = __atomic_load_n(&log->stats.segments, __ATOMIC_RELAXED);
+    stats->stalls = __atomic_load_n(&log->stats.stalls, __ATOMIC_RELAXED);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - END AUDIT - - - - - - - - - - - - - - - - - - - - - */
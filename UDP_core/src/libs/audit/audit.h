@@ -0,0 +1,193 @@
+/**
+ * @file audit.h
+ * @brief Append-only audit log of the issued passwords.
+ *
+ * Every password handed out is recorded: when, to which client, of which type
+ * and length, and a SipHash of the password under the audit key, never the
+ * password itself. Whoever holds the key can tell whether a given password was
+ * issued, and to whom; nobody can read the passwords back from the log.
+ * Identifiers are recorded like passwords; raw random bytes are not, a hash
+ * of a few bytes of seed material proving nothing and revealing them.
+ *
+ * The thread serving the requests never touches the disk. It writes its records
+ * into a single-producer, single-consumer ring, lock-free, and a writer thread
+ * drains the ring every `AUDIT_COMMIT_NS`: all the records that arrived in the
+ * meantime go to the log as one block (group commit). The log is a directory of
+ * segments, `audit-<number>.log`, each of `segment_size` bytes mapped in memory
+ * and synchronised with `msync` every `sync_interval_ms`; a full segment is cut
+ * to its used size and the next one is started (rotation).
+ *
+ * On-disk layout (integers little-endian):
+ *
+ * | Part           | Size | Content                                                            |
+ * |----------------|------|--------------------------------------------------------------------|
+ * | segment header | 32   | "PGAUDIT1", version, record size, segment number, creation time ns |
+ * | block header   | 24   | magic, records, first record sequence, CRC32C of the records, CRC32C of the header |
+ * | record         | 32   | time ns, address, port, type, length, tenant, request id, SipHash  |
+ *
+ * Blocks follow each other up to the end of the segment; a reader stops at the
+ * first block whose magic or checksums do not match, which is where the writer
+ * was when the system stopped. Records are durable once synchronised: a power
+ * failure loses at most the last `sync_interval_ms` of them, and a record sits
+ * in the ring for about `AUDIT_COMMIT_NS` before it is written. When the ring is
+ * full the producer waits for the writer rather than lose a record.
+ *
+ * POSIX only (threads, `mmap`): `PASSGEN_AUDIT` is defined where it is built.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef AUDIT_H_
+#define AUDIT_H_
+
+#include <pthread.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/clock/clock.h"
+#include "libs/siphash/siphash.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - AUDIT - - - - - - - - - - - - - - - - - - - - - */
+
+#define AUDIT_RING_RECORDS (1u << 16)					/**< Records the ring holds, a power of two */
+#define AUDIT_BLOCK_RECORDS 8192						/**< Most records in one block */
+#define AUDIT_COMMIT_NS NANOSECONDS_PER_MILLISECOND		/**< Period of the group commits */
+#define AUDIT_DEFAULT_SEGMENT_SIZE (64ull << 20)		/**< Size of a segment unless configured otherwise */
+#define AUDIT_MIN_SEGMENT_SIZE (1ull << 20)				/**< Smallest segment accepted */
+#define AUDIT_DEFAULT_SYNC_MS 100						/**< Period of the `msync` unless configured otherwise */
+#define AUDIT_SEGMENT_HEADER_SIZE 32					/**< Header of a segment */
+#define AUDIT_BLOCK_HEADER_SIZE 24						/**< Header of a block */
+#define AUDIT_RECORD_SIZE 32							/**< One record on disk */
+#define AUDIT_PATH_SIZE 512								/**< Longest path of a segment */
+
+/**
+ * @struct AuditOptions
+ * @brief Where and how the log is written.
+ */
+typedef struct {
+    const char *directory;					/**< Directory of the segments, created beforehand */
+    unsigned char key[SIPHASH_KEY_SIZE];	/**< Key of the password hashes */
+    uint64_t segment_size;					/**< Size of a segment, at least `AUDIT_MIN_SEGMENT_SIZE` */
+    unsigned int sync_interval_ms;			/**< Time between two `msync`, 0 at every group commit */
+} AuditOptions;
+
+/**
+ * @struct AuditRecord
+ * @brief One issued password, as queued in the ring.
+ */
+typedef struct {
+    uint64_t time_ns;			/**< Issuance time, nanoseconds since the Unix epoch */
+    uint32_t address;			/**< IPv4 address of the client, in network byte order */
+    uint16_t port;				/**< Port of the client, in network byte order */
+    char type;					/**< Password type */
+    uint8_t length;				/**< Password length */
+    uint32_t tenant_id;			/**< Tenant of the request, 0 for none */
+    uint32_t request_id;		/**< Request (or stream) id */
+    uint64_t password_hash;		/**< SipHash-2-4 of the password under the audit key */
+} AuditRecord;
+
+/**
+ * @struct AuditStats
+ * @brief Counters of the log since it was opened.
+ */
+typedef struct {
+    uint64_t records;			/**< Records queued */
+    uint64_t written;			/**< Records written to a segment */
+    uint64_t blocks;			/**< Group commits */
+    uint64_t syncs;				/**< `msync` calls */
+    uint64_t segments;			/**< Segments started */
+    uint64_t stalls;			/**< Times the producer waited for room in the ring */
+} AuditStats;
+
+/**
+ * @struct AuditLog
+ * @brief The ring, the writer thread and the open segment.
+ */
+typedef struct {
+    AuditOptions options;				/**< Configuration, the key included */
+    AuditRecord *ring;					/**< `AUDIT_RING_RECORDS` records */
+    uint64_t head;						/**< Records queued so far (written by the producer, atomic) */
+    uint64_t tail;						/**< Records taken by the writer so far (written by the writer, atomic) */
+    bool running;						/**< Cleared to stop the writer (atomic) */
+    bool failed;						/**< The writer could not write a segment (atomic) */
+    pthread_t writer;					/**< The writer thread */
+    unsigned char *segment;				/**< Mapping of the open segment, `NULL` if none */
+    int segment_file;					/**< Descriptor of the open segment */
+    uint64_t segment_number;			/**< Number of the open segment */
+    uint64_t used;						/**< Bytes of the open segment written */
+    uint64_t synced;					/**< Bytes of the open segment synchronised */
+    uint64_t synced_ns;					/**< Last synchronisation */
+    AuditStats stats;					/**< Counters (atomic) */
+} AuditLog;
+
+/**
+ * @brief Opens the log in its directory, after the segments already there, and starts the writer.
+ * @param[out] log The log.
+ * @param[in] options Directory, key, segment size and sync interval.
+ * @return `false` if the ring cannot be allocated, the first segment cannot be created
+ *         or the writer cannot be started.
+ */
+bool audit_open(AuditLog *log, const AuditOptions *options);
+
+/**
+ * @brief Writes the queued records, synchronises and cuts the segment, and stops the writer.
+ * @param[in,out] log The log.
+ */
+void audit_close(AuditLog *log);
+
+/**
+ * @brief Records the passwords handed out to a client.
+ * @details Called by a single thread. Waits for room in the ring when it is full.
+ * Random bytes (`RANDOM_BYTES_TYPE`) are not recorded.
+ * @param[in,out] log The log.
+ * @param[in] client Address of the client.
+ * @param[in] tenant_id Tenant of the request, 0 for none.
+ * @param[in] request_id Request (or stream) id.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[in] passwords The first password.
+ * @param[in] stride Distance between the starts of two passwords.
+ * @param[in] count Number of passwords.
+ * @return `false` if the writer failed: the records were not queued.
+ */
+bool audit_issue(AuditLog *log, const struct sockaddr_in *client, uint32_t tenant_id, uint32_t request_id,
+                 char type, uint8_t length, const char *passwords, size_t stride, size_t count);
+
+/**
+ * @brief Tells whether the writer stopped after an error; nothing is recorded any more.
+ * @param[in] log The log.
+ */
+static inline bool audit_failed(const AuditLog *log) {
+    return __atomic_load_n(&log->failed, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * @brief Reads the counters of the log.
+ * @param[in] log The log.
+ * @param[out] stats The counters.
+ */
+void audit_stats(const AuditLog *log, AuditStats *stats);
+
+/**
+ * @brief CRC-32C (Castagnoli) of a buffer, the checksum of the blocks.
+ * @param[in] data The buffer.
+ * @param[in] size Its size.
+ * @return The checksum.
+ */
+uint32_t audit_crc32c(const void *data, size_t size);
+
+/* - - - - - - - - - - - - - - - - - - - - END AUDIT - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* AUDIT_H_ */
@@ -0,0 +1,676 @@
+/**
+ * @file client.c
+ * @brief Implementation of the pipelined client library.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#include <winsock2.h>
+#define poll WSAPoll
+typedef int socklen_t;
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/socket.h>
+#define closesocket close
+#endif
+
+#include <string.h>
+#include <time.h>
+
+#include "client.h"
+#include "libs/clock/clock.h"
+#include "libs/password/password.h"
+
+#define CLIENT_RECEIVE_BUFFER (4 * 1024 * 1024)	/**< Socket buffer able to hold a full window of answers */
+#define CLIENT_RECEIVE_BATCH 256				/**< Datagrams read per call before checking timeouts */
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Switches a socket to non-blocking mode.
+ */
+static bool set_nonblocking(int socket_descriptor) {
+#if defined WIN32
+    u_long enabled = 1;
+    return ioctlsocket(socket_descriptor, FIONBIO, &enabled) == 0;
+#else
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/**
+ * @brief Tells whether the last socket call failed only because it would have blocked.
+ */
+static bool would_block(void) {
+#if defined WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/**
+ * @brief Converts a deadline into a `poll` timeout, rounded up.
+ */
+static int milliseconds_until(uint64_t deadline_ns, uint64_t now_ns) {
+    if (deadline_ns <= now_ns) {
+        return 0;
+    }
+    return (int)((deadline_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+}
+
+/**
+ * @brief Returns the index of the server with the given address, or -1 if it is not one of ours.
+ */
+static int find_server(const PassgenClient *client, const struct sockaddr_in *address) {
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        const struct sockaddr_in *server = &client->servers[i].address;
+        if (server->sin_addr.s_addr == address->sin_addr.s_addr && server->sin_port == address->sin_port) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Draws a pseudo-random number for the server selection (xorshift32, not security relevant).
+ */
+static uint32_t next_selection(PassgenClient *client) {
+    uint32_t x = client->selection_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    client->selection_state = x;
+    return x;
+}
+
+/**
+ * @brief Cost of sending one more request to a server: latency times load.
+ */
+static uint64_t server_cost(const ClientServer *server) {
+    return (server->latency_ns + 1) * (server->outstanding + 1);
+}
+
+/**
+ * @brief Chooses the server of a request with the power of two choices.
+ * @param[in] avoid Server to skip if another healthy one exists (the one that just timed out), -1 for none.
+ * @return The index of the chosen server.
+ */
+static unsigned int select_server(PassgenClient *client, int avoid) {
+    unsigned int healthy[CLIENT_MAX_SERVERS];
+    unsigned int healthy_count = 0;
+    unsigned int soonest = 0;
+    uint64_t soonest_ns = UINT64_MAX;
+
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        const ClientServer *server = &client->servers[i];
+        if (server->retired) {
+            continue;
+        }
+        if (server->ejected_until_ns == 0 && (int)i != avoid) {
+            healthy[healthy_count++] = i;
+        }
+        if (server->ejected_until_ns < soonest_ns) {
+            soonest = i;
+            soonest_ns = server->ejected_until_ns;
+        }
+    }
+    if (healthy_count == 0) {
+        /* Nothing better: retry the server we wanted to avoid, or the one closest to coming back */
+        return avoid >= 0 && client->servers[avoid].ejected_until_ns == 0 && !client->servers[avoid].retired
+            ? (unsigned int)avoid : soonest;
+    }
+    if (healthy_count == 1) {
+        return healthy[0];
+    }
+
+    /* Two distinct candidates, uniformly */
+    uint32_t draw = next_selection(client);
+    unsigned int first = draw % healthy_count;
+    unsigned int second = (draw / healthy_count) % (healthy_count - 1);
+    if (second >= first) {
+        second++;
+    }
+    first = healthy[first];
+    second = healthy[second];
+    return server_cost(&client->servers[second]) < server_cost(&client->servers[first]) ? second : first;
+}
+
+/**
+ * @brief Time after which the client stops waiting for the transmission of a slot sent now.
+ * @details The transmission is superseded at its timeout, by a retransmission or a
+ * failure, or earlier by the local deadline; the server is told so that it does not
+ * generate an answer nobody will read.
+ * @return The budget in microseconds, at least 1.
+ */
+static uint32_t transmission_budget_us(const PassgenClient *client, const ClientSlot *slot, uint64_t now_ns) {
+    uint64_t budget_ns = client->timeout_ns;
+    if (client->local_policy == CLIENT_LOCAL_FALLBACK && !slot->probe) {
+        uint64_t deadline_ns = slot->submitted_ns + client->local_deadline_ns;
+        uint64_t remaining_ns = deadline_ns > now_ns ? deadline_ns - now_ns : 0;
+        budget_ns = remaining_ns < budget_ns ? remaining_ns : budget_ns;
+    }
+    uint64_t budget_us = budget_ns / NANOSECONDS_PER_MICROSECOND;
+    return budget_us == 0 ? 1 : budget_us > UINT32_MAX ? UINT32_MAX : (uint32_t)budget_us;
+}
+
+/**
+ * @brief Encodes and sends the request held by a slot to the slot's server.
+ * @return `false` on a socket error other than a full send buffer.
+ */
+static bool send_slot(PassgenClient *client, ClientSlot *slot, uint64_t now_ns) {
+    unsigned char buffer[REQUEST_HEADER_SIZE + DEADLINE_EXTENSION_SIZE + COOKIE_EXTENSION_SIZE + KEY_EXTENSION_SIZE
+                         + TENANT_EXTENSION_SIZE + TEMPLATE_MAX_SIZE + TENANT_MAC_SIZE];
+    ClientServer *server = &client->servers[slot->server];
+    RequestView request = {
+        .type = slot->type,
+        .length = slot->length,
+        .count = slot->count,
+        .flags = (uint8_t)(client->priority | (client->packed ? REQUEST_FLAG_PACKED : 0)),
+        .request_id = slot->request_id,
+        .deadline_us = transmission_budget_us(client, slot, now_ns),
+        .cookie = server->cookie,
+        .key_id = client->key_id,
+        .tenant_id = client->tenant_id,
+        .tenant_time = (uint32_t)time(NULL)	/**< Signed again at every transmission */
+    };
+    size_t size = codec_is_template(slot->type)
+        ? codec_encode_template(buffer, sizeof(buffer), &request, client->template_text, client->template_size)
+        : codec_encode_request(buffer, sizeof(buffer), &request);
+    if (client->tenant_id != 0) {
+        size = codec_sign_request(buffer, size, sizeof(buffer), client->tenant_key);
+    }
+
+    slot->sent_ns = now_ns;
+    server->stats.requests++;
+    if (sendto(client->socket, (const char *)buffer, size, 0,
+               (const struct sockaddr *)&server->address, sizeof(server->address)) != (int)size) {
+        return would_block();	/**< A full buffer is handled like a lost datagram */
+    }
+    return true;
+}
+
+/**
+ * @brief Takes a free slot and gives it the next request id.
+ */
+static ClientSlot *acquire_slot(PassgenClient *client) {
+    ClientSlot *slot;
+
+    /* Skip the ids whose slot is still taken by a slow request */
+    do {
+        slot = &client->slots[client->next_id % CLIENT_SLOT_COUNT];
+        client->next_id++;
+    } while (slot->active);
+    *slot = (ClientSlot){ .active = true, .request_id = client->next_id - 1 };
+    return slot;
+}
+
+/**
+ * @brief Frees a slot once its request completed.
+ */
+static void release_slot(PassgenClient *client, ClientSlot *slot) {
+    slot->active = false;
+    if (slot->probe) {
+        client->servers[slot->server].probing = false;
+    } else if (slot->local) {
+        client->outstanding--;
+    } else {
+        client->servers[slot->server].outstanding--;
+        client->outstanding--;
+    }
+}
+
+/**
+ * @brief Ejects a server for a period doubling at each ejection in a row.
+ */
+static void eject_server(ClientServer *server, uint64_t now_ns) {
+    unsigned int shift = server->ejection_streak < 6 ? server->ejection_streak : 6;
+    uint64_t period_ms = (uint64_t)CLIENT_EJECT_BASE_MS << shift;
+
+    if (period_ms > CLIENT_EJECT_MAX_MS) {
+        period_ms = CLIENT_EJECT_MAX_MS;
+    }
+    server->ejected_until_ns = now_ns + period_ms * NANOSECONDS_PER_MILLISECOND;
+    server->ejection_streak++;
+    server->stats.ejections++;
+}
+
+/**
+ * @brief Records an answer: the server is healthy and, for a first transmission, its latency is sampled.
+ */
+static void record_answer(ClientServer *server, const ClientSlot *slot, bool answered_by_target, uint64_t now_ns) {
+    server->stats.responses++;
+    server->consecutive_failures = 0;
+    server->ejection_streak = 0;
+    server->ejected_until_ns = 0;
+
+    /* An answer to a retransmitted request may belong to any transmission: no sample (Karn's rule) */
+    if (answered_by_target && slot->retries == 0) {
+        uint64_t sample_ns = now_ns - slot->sent_ns;
+        if (server->latency_ns == 0) {
+            server->latency_ns = sample_ns;
+        } else {
+            server->latency_ns += ((int64_t)sample_ns - (int64_t)server->latency_ns) / (1 << CLIENT_EWMA_SHIFT);
+        }
+    }
+}
+
+/**
+ * @brief Records a timeout of a server, ejecting it after too many in a row.
+ */
+static void record_timeout(ClientServer *server, bool probe, uint64_t now_ns) {
+    server->stats.timeouts++;
+    server->consecutive_failures++;
+    if (probe || (server->ejected_until_ns == 0 && server->consecutive_failures >= CLIENT_EJECT_FAILURES)) {
+        eject_server(server, now_ns);
+    }
+}
+
+/**
+ * @brief Sends a health check to every ejected server whose ejection period is over.
+ */
+static bool probe_servers(PassgenClient *client, uint64_t now_ns) {
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        ClientServer *server = &client->servers[i];
+        if (server->retired || server->ejected_until_ns == 0 || server->probing || now_ns < server->ejected_until_ns) {
+            continue;
+        }
+        ClientSlot *slot = acquire_slot(client);
+        slot->probe = true;
+        slot->server = (uint8_t)i;
+        slot->type = 'n';
+        slot->length = MIN_PASSWORD_LENGTH;
+        slot->count = 1;
+        server->probing = true;
+        if (!send_slot(client, slot, now_ns)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Answers a request with the local engine and delivers the answer.
+ * @details The request goes through the same codec validation and generation code as on the server.
+ * It asks for packing as the servers are asked, so that it gets as many passwords; the answer stays
+ * unpacked, which needs up to `MAX_UNPACKED_RESPONSE_SIZE` bytes.
+ */
+static void complete_locally(PassgenClient *client, ClientSlot *slot, ClientCallback callback, void *context) {
+    unsigned char request_buffer[REQUEST_HEADER_SIZE + TEMPLATE_MAX_SIZE];
+    unsigned char response_buffer[MAX_UNPACKED_RESPONSE_SIZE];
+    RequestView request = {
+        .type = slot->type,
+        .length = slot->length,
+        .count = slot->count,
+        .flags = client->packed ? REQUEST_FLAG_PACKED : 0,
+        .request_id = slot->request_id
+    };
+    ResponseView response;
+    size_t request_size = codec_is_template(slot->type)
+        ? codec_encode_template(request_buffer, sizeof(request_buffer), &request, client->template_text,
+                                client->template_size)
+        : codec_encode_request(request_buffer, sizeof(request_buffer), &request);
+    size_t response_size;
+
+    if (codec_decode_request(request_buffer, request_size, &request) == CODEC_OK) {
+        response_size = generate_response(&request, response_buffer, sizeof(response_buffer));
+    } else {
+        response_size = codec_encode_response(response_buffer, sizeof(response_buffer), &request, STATUS_BAD_REQUEST, 0);
+    }
+    codec_decode_response(response_buffer, response_size, &response);
+
+    uint64_t tag = slot->tag;
+    release_slot(client, slot);
+    client->stats.local_requests++;
+    client->stats.local_passwords += response.count;
+    callback(context, tag, &response);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLIENT - - - - - - - - - - - - - - - - - - - - */
+
+bool client_open(PassgenClient *client, const struct sockaddr_in *server) {
+    int buffer_size = CLIENT_RECEIVE_BUFFER;
+
+    memset(client, 0, sizeof(*client));
+    client->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (client->socket < 0) {
+        return false;
+    }
+    if (!set_nonblocking(client->socket)) {
+        closesocket(client->socket);
+        return false;
+    }
+    setsockopt(client->socket, SOL_SOCKET, SO_RCVBUF, (const char *)&buffer_size, sizeof(buffer_size));
+
+    client_add_server(client, server);
+    client->selection_state = (uint32_t)clock_now_ns() | 1;
+    client->window = CLIENT_DEFAULT_WINDOW;
+    client->timeout_ns = CLIENT_DEFAULT_TIMEOUT_MS * NANOSECONDS_PER_MILLISECOND;
+    client->max_retries = CLIENT_DEFAULT_RETRIES;
+    client->local_policy = CLIENT_LOCAL_NEVER;
+    client->local_deadline_ns = CLIENT_DEFAULT_LOCAL_DEADLINE_MS * NANOSECONDS_PER_MILLISECOND;
+    client->priority = PRIORITY_AUTO;
+    client->next_id = 1;
+    return true;
+}
+
+bool client_add_server(PassgenClient *client, const struct sockaddr_in *server) {
+    if (client->server_count == CLIENT_MAX_SERVERS) {
+        return false;
+    }
+    client->servers[client->server_count++] = (ClientServer){ .address = *server };
+    return true;
+}
+
+void client_set_servers(PassgenClient *client, const struct sockaddr_in *servers, size_t count) {
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        client->servers[i].retired = true;
+    }
+    for (size_t n = 0; n < count; n++) {
+        int known = find_server(client, &servers[n]);
+        if (known >= 0) {
+            client->servers[known].retired = false;
+            continue;
+        }
+
+        /* Reuse a retired server with nothing in flight, or append */
+        unsigned int index = client->server_count;
+        for (unsigned int i = 0; i < client->server_count; i++) {
+            const ClientServer *server = &client->servers[i];
+            if (server->retired && server->outstanding == 0 && !server->probing) {
+                index = i;
+                break;
+            }
+        }
+        if (index == CLIENT_MAX_SERVERS) {
+            break;
+        }
+        client->servers[index] = (ClientServer){ .address = servers[n] };
+        if (index == client->server_count) {
+            client->server_count++;
+        }
+    }
+}
+
+void client_set_local_policy(PassgenClient *client, ClientLocalPolicy policy, unsigned int deadline_ms) {
+    client->local_policy = policy;
+    client->local_deadline_ns = (uint64_t)deadline_ms * NANOSECONDS_PER_MILLISECOND;
+}
+
+void client_set_priority(PassgenClient *client, RequestPriority priority) {
+    client->priority = priority;
+}
+
+void client_set_key(PassgenClient *client, uint32_t key_id, const unsigned char key[AEAD_KEY_SIZE]) {
+    client->key_id = key_id;
+    if (key_id != 0) {
+        memcpy(client->key, key, AEAD_KEY_SIZE);
+    } else {
+        memset(client->key, 0, AEAD_KEY_SIZE);
+    }
+}
+
+void client_set_tenant(PassgenClient *client, uint32_t tenant_id, const unsigned char key[SIPHASH_KEY_SIZE]) {
+    client->tenant_id = tenant_id;
+    if (tenant_id != 0) {
+        memcpy(client->tenant_key, key, SIPHASH_KEY_SIZE);
+    } else {
+        memset(client->tenant_key, 0, SIPHASH_KEY_SIZE);
+    }
+}
+
+bool client_set_template(PassgenClient *client, const char *text, size_t size) {
+    if (size == 0 || size > TEMPLATE_MAX_SIZE) {
+        return false;
+    }
+    memcpy(client->template_text, text, size);
+    client->template_size = (uint8_t)size;
+    return true;
+}
+
+void client_set_packed(PassgenClient *client, bool packed) {
+    client->packed = packed;
+}
+
+void client_set_server_source(PassgenClient *client, ClientServerSource source, void *context) {
+    client->server_source = source;
+    client->server_source_context = context;
+}
+
+void client_close(PassgenClient *client) {
+    closesocket(client->socket);
+    client->socket = -1;
+    client->outstanding = 0;
+}
+
+bool client_submit(PassgenClient *client, char type, uint8_t length, uint16_t count, uint64_t tag) {
+    if (!client_can_submit(client)) {
+        return false;
+    }
+
+    ClientSlot *slot = acquire_slot(client);
+    slot->type = type;
+    slot->length = length;
+    slot->count = count;
+    slot->tag = tag;
+    slot->submitted_ns = clock_now_ns();
+    client->outstanding++;
+    if (client->local_policy == CLIENT_LOCAL_ALWAYS) {
+        slot->local = true;		/**< Answered by the next client_poll, without waiting */
+        return true;
+    }
+    slot->server = (uint8_t)select_server(client, -1);
+    client->servers[slot->server].outstanding++;
+    client->stats.requests_sent++;
+    send_slot(client, slot, slot->submitted_ns);	/**< On failure the request is simply sent again at its timeout */
+    return true;
+}
+
+int client_poll(PassgenClient *client, int timeout_ms, ClientCallback callback, void *context) {
+    uint64_t now_ns = clock_now_ns();
+    int completed = 0;
+
+    if (client->server_source != NULL) {
+        client->server_source(client->server_source_context, client);
+    }
+
+    /* Requests served locally are answered at once; then never sleep past the next
+       retransmission, local deadline or end of an ejection */
+    for (unsigned int i = 0; i < CLIENT_SLOT_COUNT; i++) {
+        ClientSlot *slot = &client->slots[i];
+        if (slot->active && slot->local) {
+            complete_locally(client, slot, callback, context);
+            completed++;
+            timeout_ms = 0;
+        } else if (slot->active) {
+            int slot_timeout_ms = milliseconds_until(slot->sent_ns + client->timeout_ns, now_ns);
+            if (client->local_policy == CLIENT_LOCAL_FALLBACK && !slot->probe) {
+                int deadline_ms = milliseconds_until(slot->submitted_ns + client->local_deadline_ns, now_ns);
+                slot_timeout_ms = deadline_ms < slot_timeout_ms ? deadline_ms : slot_timeout_ms;
+            }
+            if (timeout_ms < 0 || slot_timeout_ms < timeout_ms) {
+                timeout_ms = slot_timeout_ms;
+            }
+        }
+    }
+    for (unsigned int i = 0; i < client->server_count; i++) {
+        const ClientServer *server = &client->servers[i];
+        if (!server->retired && server->ejected_until_ns != 0 && !server->probing) {
+            int probe_timeout_ms = milliseconds_until(server->ejected_until_ns, now_ns);
+            if (timeout_ms < 0 || probe_timeout_ms < timeout_ms) {
+                timeout_ms = probe_timeout_ms;
+            }
+        }
+    }
+
+    struct pollfd descriptor = { .fd = client->socket, .events = POLLIN };
+    if (poll(&descriptor, 1, timeout_ms) < 0 && !would_block()) {
+        return -1;
+    }
+
+    for (int i = 0; i < CLIENT_RECEIVE_BATCH && (descriptor.revents & POLLIN); i++) {
+        unsigned char buffer[MAX_DATAGRAM_SIZE];
+        char unpacked[MAX_UNPACKED_RESPONSE_SIZE];	/**< Passwords of a packed answer */
+        struct sockaddr_in sender;
+        socklen_t sender_size = sizeof(sender);
+        ResponseView response;
+
+        int received = recvfrom(client->socket, (char *)buffer, sizeof(buffer), 0,
+                                (struct sockaddr *)&sender, &sender_size);
+        if (received < 0) {
+            if (would_block()) {
+                break;
+            }
+            return -1;
+        }
+        int server = find_server(client, &sender);
+        if (server < 0 || codec_decode_response(buffer, (size_t)received, &response) != CODEC_OK) {
+            continue;	/**< Not an answer from one of our servers */
+        }
+
+        ClientSlot *slot = &client->slots[response.request_id % CLIENT_SLOT_COUNT];
+        if (!slot->active || slot->request_id != response.request_id) {
+            continue;	/**< Duplicate answer to a retransmitted request */
+        }
+        if (response.count > slot->count
+            || (response.status == STATUS_OK && (response.type != slot->type || response.length != slot->length))) {
+            client->stats.rejected_answers++;
+            continue;	/**< Not what the slot asked for (spoofed id, broken server): handled as a lost answer */
+        }
+        if (response.status == STATUS_DEADLINE_EXCEEDED) {
+            client->stats.expired_answers++;
+            continue;	/**< Handled as a lost answer: the timeout decides what comes next */
+        }
+        if (response.status == STATUS_COOKIE_REQUIRED && server == slot->server) {
+            /* The server wants proof of our address: keep its cookie and send the request again at once.
+               The resends count as retries so that a server challenging every request cannot loop forever. */
+            client->servers[server].cookie = response.cookie;
+            client->stats.cookie_challenges++;
+            if (slot->retries >= client->max_retries) {
+                continue;	/**< Left to the timeout, which fails the request */
+            }
+            slot->retries++;
+            if (!send_slot(client, slot, clock_now_ns())) {
+                return -1;
+            }
+            continue;
+        }
+        if (client->key_id != 0 && response.status == STATUS_OK
+            && !codec_open_response(buffer, (size_t)received, &response, client->key)) {
+            client->stats.rejected_answers++;
+            continue;	/**< Forged, altered or sent in the clear: handled as a lost answer */
+        }
+        if (response.encoding == ENCODING_PACKED && !codec_unpack_response(&response, unpacked, sizeof(unpacked))) {
+            client->stats.rejected_answers++;
+            continue;	/**< A symbol out of the alphabet: handled as a lost answer */
+        }
+        now_ns = clock_now_ns();
+        record_answer(&client->servers[server], slot, server == slot->server, now_ns);
+        release_slot(client, slot);
+        if (slot->probe) {
+            continue;
+        }
+        client->stats.responses_received++;
+        client->stats.passwords_received += response.count;
+        callback(context, slot->tag, &response);
+        completed++;
+    }
+
+    now_ns = clock_now_ns();
+    for (unsigned int i = 0; i < CLIENT_SLOT_COUNT; i++) {
+        ClientSlot *slot = &client->slots[i];
+        if (!slot->active) {
+            continue;
+        }
+        if (client->local_policy == CLIENT_LOCAL_FALLBACK && !slot->probe
+            && now_ns - slot->submitted_ns >= client->local_deadline_ns) {
+            record_timeout(&client->servers[slot->server], false, now_ns);	/**< A missed deadline counts against the server */
+            client->stats.local_fallbacks++;
+            complete_locally(client, slot, callback, context);
+            completed++;
+            continue;
+        }
+        if (now_ns - slot->sent_ns < client->timeout_ns) {
+            continue;
+        }
+        ClientServer *server = &client->servers[slot->server];
+        record_timeout(server, slot->probe, now_ns);
+        if (slot->probe) {
+            release_slot(client, slot);
+        } else if (slot->retries < client->max_retries) {
+            /* Fail over: the retransmission goes to another server when there is one */
+            server->outstanding--;
+            slot->server = (uint8_t)select_server(client, slot->server);
+            client->servers[slot->server].outstanding++;
+            slot->retries++;
+            client->stats.retransmissions++;
+            if (!send_slot(client, slot, now_ns)) {
+                return -1;
+            }
+        } else if (client->local_policy == CLIENT_LOCAL_FALLBACK) {
+            client->stats.local_fallbacks++;	/**< Deadline longer than every retry: it is missed now */
+            complete_locally(client, slot, callback, context);
+            completed++;
+        } else {
+            release_slot(client, slot);
+            client->stats.failures++;
+            callback(context, slot->tag, NULL);
+            completed++;
+        }
+    }
+    if (!probe_servers(client, now_ns)) {
+        return -1;
+    }
+    return completed;
+}
+/**
+ * @struct GenerateResult
+ * @brief Answer collected by `client_generate`.
+ */
+typedef struct {
+    bool done;				/**< The request completed */
+    ResponseStatus status;	/**< Status of the answer */
+    char *passwords;		/**< Destination of the passwords */
+} GenerateResult;
+
+/**
+ * @brief Callback of `client_generate`: copies the passwords out of the receive buffer.
+ */
+static void collect_passwords(void *context, uint64_t tag, const ResponseView *response) {
+    GenerateResult *result = context;
+    (void)tag;
+
+    result->done = true;
+    if (response == NULL) {
+        result->status = STATUS_UNAVAILABLE;
+        return;
+    }
+    result->status = response->status;
+    if (response->status == STATUS_OK) {
+        memcpy(result->passwords, response->passwords, (size_t)response->count * response->length);
+    }
+}
+
+ResponseStatus client_generate(PassgenClient *client, char type, uint8_t length, uint16_t count, char *passwords) {
+    GenerateResult result = { .done = false, .status = STATUS_UNAVAILABLE, .passwords = passwords };
+
+    if (!client_submit(client, type, length, count, 0)) {
+        return STATUS_UNAVAILABLE;
+    }
+    while (!result.done) {
+        if (client_poll(client, -1, collect_passwords, &result) < 0) {
+            return STATUS_UNAVAILABLE;
+        }
+    }
+    return result.status;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLIENT - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,369 @@
+/**
+ * @file client.h
+ * @brief Pipelined client library for the password generation service.
+ *
+ * A `PassgenClient` keeps up to `window` requests in flight on one UDP
+ * socket instead of waiting for each answer before sending the next request.
+ * Requests are matched to their responses by request id, so answers may come
+ * back in any order; an answer whose type, length or count does not fit its
+ * request is dropped, so that the callbacks can size their buffers by what
+ * they asked for. A request that is not answered within the timeout is
+ * sent again with the same id, a bounded number of times.
+ *
+ * A client can spread its requests over several servers. Each request goes to
+ * the better of two servers picked at random ("power of two choices"), where
+ * a server costs its smoothed latency times its requests in flight. A server
+ * that misses several answers in a row is ejected for an increasing period;
+ * when the period ends a single health-check request decides whether it comes
+ * back. Retransmissions go to another server whenever one is available, so a
+ * dead server costs one timeout rather than every retry.
+ *
+ * Every request tells the server how long the client will wait for it, so that
+ * an overloaded server skips the answers nobody will read, and carries the last
+ * cookie the server handed out. A request challenged for a cookie is sent
+ * again at once with the new one. With a pre-shared key (`client_set_key`) the
+ * answers come back encrypted; an answer that fails authentication, or comes
+ * back in the clear, is dropped like a lost one. A client of a server shared by
+ * several tenants signs its requests with the key of its tenant (`client_set_tenant`).
+ * Unencrypted answers can also come back bit-packed (`client_set_packed`): up to
+ * twice as many passwords per datagram, expanded by the vector decoder of
+ * `libs/packing`.
+ *
+ * The client links the same generation engine as the server, so it can also
+ * answer requests itself, with the same ChaCha20 CSPRNG: never, only when the
+ * servers miss a deadline, or always (no network at all), as the local policy
+ * says.
+ *
+ * The library never blocks except inside `client_poll` (for at most the given
+ * timeout) and `client_generate`, the blocking convenience used by the
+ * interactive client.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef CLIENT_H_
+#define CLIENT_H_
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/codec/codec.h"
+#include "libs/generator/generator.h"
+#include "libs/packing/packing.h"
+#include "libs/aead/aead.h"
+#include "libs/siphash/siphash.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define CLIENT_MAX_WINDOW 256			/**< Upper bound on the requests in flight */
+#define CLIENT_DEFAULT_WINDOW 64		/**< Requests in flight unless configured otherwise */
+#define CLIENT_DEFAULT_TIMEOUT_MS 200	/**< Time before a request is sent again */
+#define CLIENT_DEFAULT_RETRIES 5		/**< Retransmissions before a request fails */
+#define CLIENT_MAX_SERVERS 16			/**< Servers a client can spread its requests over */
+#define CLIENT_SLOT_COUNT (CLIENT_MAX_WINDOW + CLIENT_MAX_SERVERS)	/**< Window plus one health check per server */
+#define CLIENT_EJECT_FAILURES 3			/**< Consecutive timeouts that eject a server */
+#define CLIENT_EJECT_BASE_MS 500		/**< First ejection period, doubled at every new ejection */
+#define CLIENT_EJECT_MAX_MS 30000		/**< Longest ejection period */
+#define CLIENT_EWMA_SHIFT 3				/**< Weight of a new latency sample: 1/8 */
+#define CLIENT_DEFAULT_LOCAL_DEADLINE_MS 100	/**< Deadline of the servers under `CLIENT_LOCAL_FALLBACK` */
+
+/**
+ * @enum ClientLocalPolicy
+ * @brief When requests are answered by the client itself.
+ */
+typedef enum {
+    CLIENT_LOCAL_NEVER,		/**< Only the servers answer; unanswered requests fail */
+    CLIENT_LOCAL_FALLBACK,	/**< Answer locally when the servers miss the deadline */
+    CLIENT_LOCAL_ALWAYS		/**< Answer every request locally, without using the network */
+} ClientLocalPolicy;
+
+/**
+ * @struct ClientSlot
+ * @brief A request in flight.
+ */
+typedef struct {
+    bool active;			/**< The slot holds a request waiting for its answer */
+    bool probe;				/**< Health check, not reported to the caller */
+    bool local;				/**< To be answered locally, never sent */
+    uint8_t server;			/**< Server the request was last sent to */
+    uint32_t request_id;	/**< Id of the request */
+    char type;				/**< Requested password type */
+    uint8_t length;			/**< Requested password length */
+    uint16_t count;			/**< Requested number of passwords */
+    uint64_t submitted_ns;	/**< When the request was submitted */
+    uint64_t sent_ns;		/**< When the request was last sent */
+    unsigned int retries;	/**< Retransmissions so far */
+    uint64_t tag;			/**< Caller value handed back with the answer */
+} ClientSlot;
+
+/**
+ * @struct ClientStats
+ * @brief Counters of a client since it was opened.
+ */
+typedef struct {
+    uint64_t requests_sent;			/**< Requests sent, retransmissions excluded */
+    uint64_t retransmissions;		/**< Requests sent again after a timeout */
+    uint64_t responses_received;	/**< Answers matched to a request in flight */
+    uint64_t passwords_received;	/**< Passwords carried by those answers */
+    uint64_t failures;				/**< Requests abandoned after the last retransmission */
+    uint64_t expired_answers;		/**< Answers telling that a transmission arrived after its deadline */
+    uint64_t cookie_challenges;		/**< Requests sent again with a new cookie */
+    uint64_t rejected_answers;		/**< Answers dropped: not encrypted with the key, or not matching their request */
+    uint64_t local_requests;		/**< Requests answered locally */
+    uint64_t local_fallbacks;		/**< Of which because the servers missed the deadline */
+    uint64_t local_passwords;		/**< Passwords generated locally */
+} ClientStats;
+
+/**
+ * @struct ClientServerStats
+ * @brief Counters of one server.
+ */
+typedef struct {
+    uint64_t requests;		/**< Requests sent to the server, retransmissions included */
+    uint64_t responses;		/**< Answers received from the server */
+    uint64_t timeouts;		/**< Requests the server did not answer in time */
+    uint64_t ejections;		/**< Times the server was ejected */
+} ClientServerStats;
+
+/**
+ * @struct ClientServer
+ * @brief A server and the client's view of its health.
+ */
+typedef struct {
+    struct sockaddr_in address;			/**< Address of the server */
+    uint64_t latency_ns;				/**< Smoothed round-trip time, 0 until the first answer */
+    unsigned int outstanding;			/**< Requests in flight to the server */
+    unsigned int consecutive_failures;	/**< Timeouts since the last answer */
+    unsigned int ejection_streak;		/**< Ejections since the server was last healthy */
+    uint64_t ejected_until_ns;			/**< End of the ejection, 0 if the server is healthy */
+    bool probing;						/**< A health check is in flight */
+    bool retired;						/**< Removed from the list, kept until its requests complete */
+    uint64_t cookie;					/**< Last anti-spoofing cookie handed out by the server, 0 for none */
+    ClientServerStats stats;			/**< Counters */
+} ClientServer;
+
+struct PassgenClient;
+
+/**
+ * @brief Function keeping the server list of a client up to date (e.g. from a resolver).
+ * @param[in] context The pointer given to `client_set_server_source`.
+ * @param[in,out] client The client, whose list can be replaced with `client_set_servers`.
+ * @note Called at the start of every `client_poll`, so it must return quickly.
+ */
+typedef void (*ClientServerSource)(void *context, struct PassgenClient *client);
+
+/**
+ * @struct PassgenClient
+ * @brief A connectionless client spreading its requests over one or more servers.
+ */
+typedef struct PassgenClient {
+    int socket;								/**< Non-blocking UDP socket */
+    unsigned int server_count;				/**< Servers in `servers`, retired ones included */
+    ClientServer servers[CLIENT_MAX_SERVERS];	/**< The servers */
+    uint32_t selection_state;				/**< State of the generator choosing the servers */
+    unsigned int window;					/**< Maximum requests in flight */
+    unsigned int outstanding;				/**< Requests in flight, health checks excluded */
+    uint32_t next_id;						/**< Id of the next request */
+    uint64_t timeout_ns;					/**< Time before a request is sent again */
+    unsigned int max_retries;				/**< Retransmissions before a request fails */
+    ClientLocalPolicy local_policy;			/**< When requests are answered locally */
+    uint64_t local_deadline_ns;				/**< Deadline of the servers under `CLIENT_LOCAL_FALLBACK` */
+    RequestPriority priority;				/**< Priority class put in the flags of every request */
+    uint32_t key_id;						/**< Key the answers are encrypted with, 0 for none */
+    unsigned char key[AEAD_KEY_SIZE];		/**< The key shared with the servers */
+    uint32_t tenant_id;						/**< Tenant signing the requests, 0 for none */
+    unsigned char tenant_key[SIPHASH_KEY_SIZE];	/**< Key of the tenant's MACs */
+    char template_text[TEMPLATE_MAX_SIZE];	/**< Template of the `TEMPLATE_TYPE` requests */
+    uint8_t template_size;					/**< Size of `template_text`, 0 for none */
+    bool packed;							/**< Ask for bit-packed answers */
+    ClientStats stats;						/**< Counters */
+    ClientServerSource server_source;		/**< Optional provider of the server list */
+    void *server_source_context;			/**< Context of `server_source` */
+    ClientSlot slots[CLIENT_SLOT_COUNT];	/**< Requests in flight, indexed by id modulo the size */
+} PassgenClient;
+
+/**
+ * @brief Function receiving the answer of a request.
+ * @param[in] context The pointer given to `client_poll`.
+ * @param[in] tag The value given to `client_submit`.
+ * @param[in] response The decoded answer (check its `status`), or `NULL` if the request failed
+ *            after the last retransmission. The view is only valid during the call. Answers
+ *            generated locally look exactly like the answers of a server.
+ */
+typedef void (*ClientCallback)(void *context, uint64_t tag, const ResponseView *response);
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLIENT - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Creates the socket of a client and sets the default window and timeouts.
+ * @param[out] client The client to initialise.
+ * @param[in] server Address of the first server; more can be added with `client_add_server`.
+ * @return `true` on success, `false` if the socket could not be created.
+ */
+bool client_open(PassgenClient *client, const struct sockaddr_in *server);
+
+/**
+ * @brief Adds a server to spread the requests over.
+ * @param[in,out] client The client.
+ * @param[in] server Address of the server.
+ * @return `false` if the client already has `CLIENT_MAX_SERVERS` servers.
+ */
+bool client_add_server(PassgenClient *client, const struct sockaddr_in *server);
+
+/**
+ * @brief Replaces the server list, keeping the health and counters of the servers that remain.
+ * @details Servers that are no longer listed are retired: they receive no new request
+ * and their slot is reused once their requests in flight have completed.
+ * @param[in,out] client The client.
+ * @param[in] servers The new list.
+ * @param[in] count Number of servers in `servers` (extra servers are ignored when no slot is free).
+ */
+void client_set_servers(PassgenClient *client, const struct sockaddr_in *servers, size_t count);
+
+/**
+ * @brief Installs a function refreshing the server list before each poll.
+ * @param[in,out] client The client.
+ * @param[in] source The function, `NULL` to remove it.
+ * @param[in] context Pointer handed to `source`.
+ */
+void client_set_server_source(PassgenClient *client, ClientServerSource source, void *context);
+
+/**
+ * @brief Chooses when requests are answered locally.
+ * @param[in,out] client The client.
+ * @param[in] policy The local policy (`CLIENT_LOCAL_NEVER` by default).
+ * @param[in] deadline_ms Time the servers have to answer under `CLIENT_LOCAL_FALLBACK`.
+ */
+void client_set_local_policy(PassgenClient *client, ClientLocalPolicy policy, unsigned int deadline_ms);
+
+/**
+ * @brief Chooses the priority class the server is asked to give to the requests.
+ * @param[in,out] client The client.
+ * @param[in] priority The class (`PRIORITY_AUTO` by default).
+ */
+void client_set_priority(PassgenClient *client, RequestPriority priority);
+
+/**
+ * @brief Asks the servers to encrypt the answers with a pre-shared key.
+ * @details An encrypted answer has room for fewer passwords (`MAX_SEALED_BATCH_COUNT`):
+ * larger requests are answered with that many.
+ * @param[in,out] client The client.
+ * @param[in] key_id Id of the key on the servers, 0 to stop encrypting.
+ * @param[in] key The key (ignored when `key_id` is 0).
+ */
+void client_set_key(PassgenClient *client, uint32_t key_id, const unsigned char key[AEAD_KEY_SIZE]);
+
+/**
+ * @brief Signs the requests on behalf of a tenant of the servers.
+ * @param[in,out] client The client.
+ * @param[in] tenant_id Id of the tenant, 0 to stop signing.
+ * @param[in] key The key of the tenant (ignored when `tenant_id` is 0).
+ */
+void client_set_tenant(PassgenClient *client, uint32_t tenant_id, const unsigned char key[SIPHASH_KEY_SIZE]);
+
+/**
+ * @brief Sets the template sent with the requests of type `TEMPLATE_TYPE`.
+ * @details The template is not checked here: one that does not compile is answered
+ * `STATUS_BAD_REQUEST`, by the servers as by the local engine.
+ * @param[in,out] client The client.
+ * @param[in] text The template (see `libs/template`), not necessarily terminated.
+ * @param[in] size Size of `text`.
+ * @return `false` if the template is empty or longer than `TEMPLATE_MAX_SIZE`.
+ */
+bool client_set_template(PassgenClient *client, const char *text, size_t size);
+
+/**
+ * @brief Asks the servers to bit-pack the passwords of the answers.
+ * @details A packed answer has room for more passwords (`MAX_PACKED_BATCH_COUNT`): up to
+ * twice as many digits, 1.6 times as many letters. Encrypted answers and the answers to
+ * other types are never packed.
+ * @param[in,out] client The client.
+ * @param[in] packed `true` to ask for packed answers (`false` by default).
+ */
+void client_set_packed(PassgenClient *client, bool packed);
+
+/**
+ * @brief Closes the socket of a client. Requests in flight are forgotten.
+ * @param[in,out] client The client.
+ */
+void client_close(PassgenClient *client);
+
+/**
+ * @brief Tells whether another request can be put in flight.
+ * @param[in] client The client.
+ * @return `true` if fewer than `window` requests are in flight.
+ */
+static inline bool client_can_submit(const PassgenClient *client) {
+    return client->outstanding < client->window;
+}
+
+/**
+ * @brief Largest number of passwords of a type one answer can carry: fewer when the answers
+ * are encrypted, more when they are packed.
+ */
+static inline uint16_t client_max_count(const PassgenClient *client, char type, uint8_t length) {
+    const Generator *generator = generator_lookup(type);
+    if (client->key_id != 0) {
+        return (uint16_t)MAX_SEALED_BATCH_COUNT(length);
+    }
+    if (client->packed && generator != NULL) {
+        return (uint16_t)MAX_PACKED_BATCH_COUNT(length, packing_bits(generator->alphabet_size));
+    }
+    return (uint16_t)MAX_BATCH_COUNT(length);
+}
+
+/**
+ * @brief Sends a request for `count` passwords without waiting for the answer.
+ * @param[in,out] client The client.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[in] count Number of passwords, at most `client_max_count`.
+ * @param[in] tag Value handed back to the callback with the answer.
+ * @return `true` if the request is in flight, `false` if the window is full.
+ * @note A request the socket could not send right now is still in flight: it is sent again at its timeout.
+ */
+bool client_submit(PassgenClient *client, char type, uint8_t length, uint16_t count, uint64_t tag);
+
+/**
+ * @brief Waits for answers, delivers them and retransmits the requests that timed out.
+ * @param[in,out] client The client.
+ * @param[in] timeout_ms Maximum wait when nothing is pending on the socket (-1 waits for the next retransmission).
+ * @param[in] callback Function receiving each answer or failure.
+ * @param[in] context Pointer handed to `callback`.
+ * @return Number of requests completed (answered or failed), or -1 on a socket error.
+ */
+int client_poll(PassgenClient *client, int timeout_ms, ClientCallback callback, void *context);
+
+/**
+ * @brief Requests passwords and waits for them.
+ * @param[in,out] client The client, with no request in flight.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[in] count Number of passwords, at most `client_max_count`.
+ * @param[out] passwords Buffer of `count * length` characters receiving the passwords, back to back.
+ * @return The status of the answer, or `STATUS_UNAVAILABLE` if the server never answered.
+ */
+ResponseStatus client_generate(PassgenClient *client, char type, uint8_t length, uint16_t count, char *passwords);
+
+/* - - - - - - - - - - - - - - - - - - - END CLIENT - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CLIENT_H_ */
@@ -0,0 +1,646 @@
+/**
+ * @file client.hpp
+ * @brief Header-only C++20 coroutine façade over the non-blocking client library.
+ *
+ * `passgen::AsyncClient` owns a `PassgenClient` and lets coroutines wait for
+ * passwords without blocking their thread:
+ *
+ * @code
+ * passgen::Task<> fetch(passgen::AsyncClient &client, std::stop_token stop) {
+ *     auto password = co_await client.generate('s', 16, { .deadline = passgen::after(50ms), .stop = stop });
+ *     if (password) {
+ *         use(password.value.view());
+ *     }
+ * }
+ *
+ * auto task = fetch(client, source.get_token());
+ * task.start();
+ * client.run();		// or call run_once(0) whenever native_handle() is readable
+ * @endcode
+ *
+ * Requests are completed by the client's reactor (`run_once`), which submits
+ * the waiting requests as the window allows, drives `client_poll` and resumes
+ * the finished coroutines once `client_poll` has returned, so a resumed
+ * coroutine can issue new requests right away. Everything runs on the thread
+ * calling `run_once`; the only cross-thread entry point is a stop request,
+ * which is honoured at the next `run_once`.
+ *
+ * Cancellation and deadlines resume the waiting coroutine immediately; the
+ * request itself stays in the window until the library answers or abandons
+ * it, and its late answer is dropped.
+ *
+ * In steady state a request allocates nothing: the awaiters live in the
+ * coroutine frames, results are written into fixed-size `Password` values or
+ * caller buffers, the in-flight table is a fixed array and coroutine frames
+ * are recycled by a per-thread pool.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef CLIENT_HPP_
+#define CLIENT_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstring>
+#include <exception>
+#include <new>
+#include <optional>
+#include <span>
+#include <stop_token>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+#include "client.h"
+
+namespace passgen {
+
+/* - - - - - - - - - - - - - - - - - - - - RESULTS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @enum AsyncError
+ * @brief Outcome of an asynchronous request.
+ */
+enum class AsyncError {
+    none,				/**< The passwords were received */
+    failed,				/**< No answer after the last retransmission */
+    rejected,			/**< The server refused the request, or the arguments are invalid */
+    deadline_exceeded,	/**< The deadline passed before the answer */
+    cancelled			/**< A stop was requested before the answer */
+};
+
+inline const char *async_error_message(AsyncError error) noexcept {
+    switch (error) {
+        case AsyncError::none:				return "success";
+        case AsyncError::failed:			return "no answer from the servers";
+        case AsyncError::rejected:			return "request rejected";
+        case AsyncError::deadline_exceeded:	return "deadline exceeded";
+        case AsyncError::cancelled:			return "cancelled";
+    }
+    return "unknown error";
+}
+
+/**
+ * @struct Password
+ * @brief One password, stored inline.
+ */
+struct Password {
+    char data[MAX_PASSWORD_LENGTH + 1] = {};	/**< Null-terminated characters */
+    uint8_t length = 0;							/**< Number of characters */
+
+    std::string_view view() const noexcept { return { data, length }; }
+};
+
+/**
+ * @struct AsyncResult
+ * @brief Value of a request together with its outcome; `value` is meaningful only on success.
+ */
+template <class T>
+struct AsyncResult {
+    AsyncError error;	/**< Outcome */
+    T value;			/**< Result */
+
+    explicit operator bool() const noexcept { return error == AsyncError::none; }
+};
+
+/**
+ * @class StopRef
+ * @brief Stop token of a request, referred to rather than held.
+ * @details Keeps `RequestOptions` trivially destructible: GCC 12 destroys the class
+ * temporaries built inside a `co_await` expression twice, which a `std::stop_token`
+ * does not survive. The token is copied when the awaitable is created, so it only has
+ * to outlive that expression; temporary tokens are refused.
+ */
+class StopRef {
+public:
+    StopRef() noexcept = default;
+    StopRef(const std::stop_token &token) noexcept : token_(&token) {}
+    StopRef(const std::stop_token &&) = delete;
+
+    std::stop_token get() const noexcept { return token_ != nullptr ? *token_ : std::stop_token(); }
+
+private:
+    const std::stop_token *token_ = nullptr;
+};
+
+/**
+ * @struct RequestOptions
+ * @brief Deadline and cancellation of one request, passed by value.
+ */
+struct RequestOptions {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();	/**< Give up after this instant */
+    StopRef stop = {};		/**< Give up when a stop is requested on this token */
+};
+static_assert(std::is_trivially_destructible_v<RequestOptions>, "Options are built inside co_await expressions");
+
+/** Deadline `timeout` from now. */
+inline std::chrono::steady_clock::time_point after(std::chrono::steady_clock::duration timeout) {
+    return std::chrono::steady_clock::now() + timeout;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END RESULTS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - TASKS - - - - - - - - - - - - - - - - - - - - */
+
+namespace detail {
+
+/**
+ * @class FramePool
+ * @brief Per-thread free lists of coroutine frames, by multiples of `granularity` bytes.
+ * @details A frame released on another thread joins that thread's lists, which is harmless:
+ * every block comes from the global `operator new`.
+ */
+class FramePool {
+public:
+    static constexpr std::size_t granularity = 128;	/**< Size step of the lists */
+    static constexpr std::size_t classes = 32;		/**< Frames up to 4 KiB are pooled */
+
+    ~FramePool() {
+        for (FreeFrame *&head : free_) {
+            while (head != nullptr) {
+                ::operator delete(std::exchange(head, head->next));
+            }
+        }
+    }
+
+    void *allocate(std::size_t size) {
+        std::size_t index = (size + granularity - 1) / granularity;
+        if (index == 0 || index > classes) {
+            return ::operator new(size);
+        }
+        if (FreeFrame *frame = free_[index - 1]) {
+            free_[index - 1] = frame->next;
+            return frame;
+        }
+        return ::operator new(index * granularity);
+    }
+
+    void deallocate(void *frame, std::size_t size) noexcept {
+        std::size_t index = (size + granularity - 1) / granularity;
+        if (index == 0 || index > classes) {
+            ::operator delete(frame);
+            return;
+        }
+        free_[index - 1] = new (frame) FreeFrame{ free_[index - 1] };
+    }
+
+    static FramePool &local() {
+        thread_local FramePool pool;
+        return pool;
+    }
+
+private:
+    struct FreeFrame {
+        FreeFrame *next;
+    };
+
+    FreeFrame *free_[classes] = {};
+};
+
+struct PromiseBase {
+    std::coroutine_handle<> continuation;	/**< Coroutine awaiting this task, if any */
+    std::exception_ptr exception;			/**< Exception that escaped the body */
+
+    static void *operator new(std::size_t size) { return FramePool::local().allocate(size); }
+    static void operator delete(void *frame, std::size_t size) noexcept { FramePool::local().deallocate(frame, size); }
+
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false; }
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            std::coroutine_handle<> continuation = handle.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+    void unhandled_exception() noexcept { exception = std::current_exception(); }
+};
+
+template <class T>
+struct Promise;
+
+} // namespace detail
+
+/**
+ * @class Task
+ * @brief Lazily started coroutine whose frame comes from the per-thread pool.
+ * @details A task is either awaited by another coroutine (`co_await std::move(task)`) or, at the top
+ * level, started with `start()` and kept alive until `done()`.
+ */
+template <class T = void>
+class Task {
+public:
+    using promise_type = detail::Promise<T>;
+
+    explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle_(handle) {}
+    Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+    Task &operator=(Task &&other) noexcept {
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+    ~Task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    /** Runs a top-level task until its first suspension. */
+    void start() { handle_.resume(); }
+
+    bool done() const noexcept { return handle_.done(); }
+
+    /** Result of a finished task; rethrows the exception that escaped its body. */
+    T result() { return handle_.promise().take(); }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                handle.promise().continuation = awaiting;
+                return handle;
+            }
+            T await_resume() { return handle.promise().take(); }
+        };
+        return Awaiter{ handle_ };
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <class T>
+struct Promise : PromiseBase {
+    std::optional<T> value;		/**< Value returned by the body */
+
+    Task<T> get_return_object() noexcept { return Task<T>(std::coroutine_handle<Promise>::from_promise(*this)); }
+    void return_value(T result) { value.emplace(std::move(result)); }
+    T take() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <>
+struct Promise<void> : PromiseBase {
+    Task<void> get_return_object() noexcept { return Task<void>(std::coroutine_handle<Promise>::from_promise(*this)); }
+    void return_void() noexcept {}
+    void take() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+} // namespace detail
+
+/* - - - - - - - - - - - - - - - - - - - END TASKS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLIENT - - - - - - - - - - - - - - - - - - - - */
+
+class AsyncClient;
+
+/**
+ * @class Operation
+ * @brief State shared by the awaiters of `AsyncClient`; lives in the awaiting coroutine's frame.
+ */
+class Operation {
+public:
+    Operation(const Operation &) = delete;
+    Operation &operator=(const Operation &) = delete;
+
+protected:
+    Operation(AsyncClient &client, char type, unsigned int length, uint16_t count, const RequestOptions &options)
+        : client_(&client), type_(type), length_(static_cast<uint8_t>(length)), count_(count),
+          deadline_(options.deadline), stop_(options.stop.get()) {
+        if (codec_check_type(type, length) != CODEC_OK || count == 0) {
+            error_ = AsyncError::rejected;
+        }
+    }
+
+    bool await_ready() const noexcept { return error_ != AsyncError::none; }
+    inline bool await_suspend(std::coroutine_handle<> waiter);
+
+    /** Copies the passwords of a successful answer into the result. */
+    virtual void deliver(const ResponseView &response) = 0;
+
+private:
+    friend class AsyncClient;
+
+    struct StopRequest {
+        std::atomic<bool> *flag;
+        void operator()() const noexcept { flag->store(true, std::memory_order_relaxed); }
+    };
+
+    AsyncClient *client_;
+    char type_;
+    uint8_t length_;
+    uint16_t count_;
+    std::chrono::steady_clock::time_point deadline_;
+    std::stop_token stop_;
+    std::atomic<bool> stop_requested_{ false };				/**< Set by the stop callback, from any thread */
+    std::optional<std::stop_callback<StopRequest>> stop_callback_;
+    std::coroutine_handle<> waiter_;
+    int record_ = -1;										/**< In-flight record, -1 until submitted */
+    Operation *previous_ = nullptr;							/**< Links of the list the operation is in */
+    Operation *next_ = nullptr;
+
+protected:
+    AsyncError error_ = AsyncError::none;	/**< Outcome */
+};
+
+/**
+ * @class AsyncClient
+ * @brief Coroutine-friendly owner of a `PassgenClient`; must only be used by one thread.
+ */
+class AsyncClient {
+public:
+    explicit AsyncClient(const sockaddr_in &server) {
+        if (!client_open(&client_, &server)) {
+            throw std::system_error(std::make_error_code(std::errc::io_error), "cannot open the client");
+        }
+        for (int i = CLIENT_MAX_WINDOW - 1; i >= 0; i--) {
+            free_records_[free_count_++] = i;
+        }
+    }
+    ~AsyncClient() { client_close(&client_); }
+
+    AsyncClient(const AsyncClient &) = delete;
+    AsyncClient &operator=(const AsyncClient &) = delete;
+
+    /** The underlying C client, to configure servers, window and local policy. */
+    PassgenClient &raw() noexcept { return client_; }
+
+    /** Socket to watch for readability when `run_once` is driven by an external event loop. */
+    int native_handle() const noexcept { return client_.socket; }
+
+    /** `true` while some request has not been reported to its coroutine. */
+    bool busy() const noexcept { return waiting_.head || in_flight_.head || ready_.head; }
+
+    /**
+     * @brief Awaitable yielding one password as `AsyncResult<Password>`.
+     */
+    auto generate(char type, unsigned int length, RequestOptions options = {}) {
+        class Awaiter : public Operation {
+        public:
+            Awaiter(AsyncClient &client, char type, unsigned int length, const RequestOptions &options)
+                : Operation(client, type, length, 1, options) {}
+
+            using Operation::await_ready;
+            using Operation::await_suspend;
+            AsyncResult<Password> await_resume() noexcept { return { error_, password_ }; }
+
+        private:
+            void deliver(const ResponseView &response) override {
+                password_.length = response.length;
+                std::memcpy(password_.data, response.passwords, response.length);
+                password_.data[response.length] = '\0';
+            }
+
+            Password password_;
+        };
+        return Awaiter(*this, type, length, options);
+    }
+
+    /**
+     * @brief Awaitable filling `output` with passwords back to back, yielding their number as `AsyncResult<size_t>`.
+     * @details One request is sent, for as many passwords as fit in `output` and in one datagram.
+     */
+    auto generate_batch(char type, unsigned int length, std::span<char> output, RequestOptions options = {}) {
+        class Awaiter : public Operation {
+        public:
+            Awaiter(AsyncClient &client, char type, unsigned int length, std::span<char> output,
+                    const RequestOptions &options)
+                : Operation(client, type, length, batch_count(length, output.size()), options), output_(output) {}
+
+            using Operation::await_ready;
+            using Operation::await_suspend;
+            AsyncResult<size_t> await_resume() noexcept { return { error_, received_ }; }
+
+        private:
+            static uint16_t batch_count(unsigned int length, size_t capacity) {
+                if (length == 0 || length > MAX_PASSWORD_LENGTH) {
+                    return 0;	/**< Rejected by the constructor */
+                }
+                return static_cast<uint16_t>(std::min<size_t>(capacity / length, MAX_BATCH_COUNT(length)));
+            }
+
+            void deliver(const ResponseView &response) override {
+                received_ = std::min<size_t>(response.count, output_.size() / response.length);
+                std::memcpy(output_.data(), response.passwords, received_ * response.length);
+            }
+
+            std::span<char> output_;
+            size_t received_ = 0;
+        };
+        return Awaiter(*this, type, length, output, options);
+    }
+
+    /**
+     * @brief Submits the waiting requests, processes the answers and resumes the finished coroutines.
+     * @param[in] timeout_ms Longest wait for an answer, -1 to wait until something completes.
+     * @return The number of coroutines resumed, -1 on a socket error.
+     */
+    int run_once(int timeout_ms) {
+        submit_waiting();
+        int wait_ms = expire(timeout_ms);
+        if (client_.outstanding > 0) {
+            if (client_poll(&client_, ready_.head ? 0 : wait_ms, &AsyncClient::on_answer, this) < 0) {
+                return -1;
+            }
+            submit_waiting();
+        }
+        int resumed = 0;
+        while (Operation *operation = ready_.pop_front()) {
+            operation->stop_callback_.reset();
+            operation->waiter_.resume();
+            resumed++;
+        }
+        return resumed;
+    }
+
+    /** Runs the reactor until every request has been reported. */
+    bool run() {
+        while (busy()) {
+            if (run_once(-1) < 0) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    friend class Operation;
+
+    /**
+     * @brief Intrusive list of operations; an operation is in at most one list at a time.
+     */
+    struct OperationList {
+        Operation *head = nullptr;
+        Operation *tail = nullptr;
+
+        void push_back(Operation *operation) noexcept {
+            operation->previous_ = tail;
+            operation->next_ = nullptr;
+            (tail ? tail->next_ : head) = operation;
+            tail = operation;
+        }
+        void remove(Operation *operation) noexcept {
+            (operation->previous_ ? operation->previous_->next_ : head) = operation->next_;
+            (operation->next_ ? operation->next_->previous_ : tail) = operation->previous_;
+            operation->previous_ = operation->next_ = nullptr;
+        }
+        Operation *pop_front() noexcept {
+            Operation *operation = head;
+            if (operation != nullptr) {
+                remove(operation);
+            }
+            return operation;
+        }
+    };
+
+    /**
+     * @brief Link between a request in the C client's window and the operation waiting for it.
+     * @details The operation is cleared when it stops waiting; the record is freed when the
+     * library reports the request, and the generation rejects answers to a reused record.
+     */
+    struct Record {
+        uint32_t generation = 0;
+        Operation *operation = nullptr;
+    };
+
+    void enqueue(Operation *operation) {
+        if (waiting_.head == nullptr && client_can_submit(&client_)) {
+            submit(operation);
+        } else {
+            waiting_.push_back(operation);
+        }
+    }
+
+    void submit(Operation *operation) {
+        int index = free_records_[--free_count_];
+        Record &record = records_[index];
+        record.generation++;
+        record.operation = operation;
+        operation->record_ = index;
+        uint64_t tag = static_cast<uint64_t>(record.generation) << 32 | static_cast<uint32_t>(index);
+        if (client_submit(&client_, operation->type_, operation->length_, operation->count_, tag)) {
+            in_flight_.push_back(operation);
+        } else {
+            release(index);
+            operation->record_ = -1;
+            finish(operation, AsyncError::failed);
+        }
+    }
+
+    void submit_waiting() {
+        while (waiting_.head != nullptr && client_can_submit(&client_)) {
+            submit(waiting_.pop_front());
+        }
+    }
+
+    void release(int index) noexcept {
+        records_[index].operation = nullptr;
+        free_records_[free_count_++] = index;
+    }
+
+    void finish(Operation *operation, AsyncError error) noexcept {
+        operation->error_ = error;
+        ready_.push_back(operation);
+    }
+
+    /**
+     * @brief Reports the cancelled and late operations and computes how long to wait for the others.
+     */
+    int expire(int timeout_ms) {
+        auto now = std::chrono::steady_clock::now();
+        auto next_deadline = std::chrono::steady_clock::time_point::max();
+        for (OperationList *list : { &waiting_, &in_flight_ }) {
+            for (Operation *operation = list->head, *next; operation != nullptr; operation = next) {
+                next = operation->next_;
+                bool cancelled = operation->stop_requested_.load(std::memory_order_relaxed);
+                if (!cancelled && operation->deadline_ > now) {
+                    next_deadline = std::min(next_deadline, operation->deadline_);
+                    continue;
+                }
+                list->remove(operation);
+                if (operation->record_ >= 0) {
+                    records_[operation->record_].operation = nullptr;	/**< The late answer will be dropped */
+                }
+                finish(operation, cancelled ? AsyncError::cancelled : AsyncError::deadline_exceeded);
+            }
+        }
+        if (next_deadline != std::chrono::steady_clock::time_point::max()) {
+            auto until_ms = std::chrono::ceil<std::chrono::milliseconds>(next_deadline - now).count();
+            if (timeout_ms < 0 || until_ms < timeout_ms) {
+                timeout_ms = static_cast<int>(until_ms);
+            }
+        }
+        return timeout_ms;
+    }
+
+    static void on_answer(void *context, uint64_t tag, const ResponseView *response) {
+        AsyncClient *self = static_cast<AsyncClient *>(context);
+        int index = static_cast<int>(tag & 0xFFFFFFFFu);
+        Record &record = self->records_[index];
+        if (record.generation != static_cast<uint32_t>(tag >> 32)) {
+            return;
+        }
+        Operation *operation = record.operation;
+        self->release(index);
+        if (operation == nullptr) {
+            return;		/**< Nobody waits for this answer any more */
+        }
+        self->in_flight_.remove(operation);
+        operation->record_ = -1;
+        if (response == nullptr) {
+            self->finish(operation, AsyncError::failed);
+        } else if (response->status != STATUS_OK || response->length != operation->length_ || response->count == 0) {
+            self->finish(operation, AsyncError::rejected);
+        } else {
+            operation->deliver(*response);
+            self->finish(operation, AsyncError::none);
+        }
+    }
+
+    PassgenClient client_;
+    Record records_[CLIENT_MAX_WINDOW];
+    int free_records_[CLIENT_MAX_WINDOW];
+    int free_count_ = 0;
+    OperationList waiting_;		/**< Submitted by a coroutine, waiting for room in the window */
+    OperationList in_flight_;	/**< In the C client's window */
+    OperationList ready_;		/**< Finished, to be resumed */
+};
+
+inline bool Operation::await_suspend(std::coroutine_handle<> waiter) {
+    if (stop_.stop_requested()) {
+        error_ = AsyncError::cancelled;
+        return false;
+    }
+    waiter_ = waiter;
+    if (stop_.stop_possible()) {
+        stop_callback_.emplace(stop_, StopRequest{ &stop_requested_ });
+    }
+    client_->enqueue(this);
+    return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLIENT - - - - - - - - - - - - - - - - - - - */
+
+} // namespace passgen
+
+#endif /* CLIENT_HPP_ */
@@ -0,0 +1,34 @@
+/**
+ * @file clock.h
+ * @brief Monotonic time source shared by the client and the server.
+ *
+ * All timers (stream pacing, timeouts, latency measurements) are expressed
+ * in nanoseconds of the monotonic clock, which never jumps when the wall
+ * clock is adjusted.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef CLOCK_H_
+#define CLOCK_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#define NANOSECONDS_PER_SECOND 1000000000ull	/**< Nanoseconds in one second */
+#define NANOSECONDS_PER_MILLISECOND 1000000ull	/**< Nanoseconds in one millisecond */
+#define NANOSECONDS_PER_MICROSECOND 1000ull		/**< Nanoseconds in one microsecond */
+
+/**
+ * @brief Returns the current value of the monotonic clock.
+ * @return Nanoseconds elapsed since an arbitrary, fixed point in the past.
+ */
+static inline uint64_t clock_now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)now.tv_nsec;
+}
+
+#endif /* CLOCK_H_ */
@@ -0,0 +1,637 @@
+/**
+ * @file codec.c
+ * @brief Implementation of the in-place message codec.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+#include "codec.h"
+#include "libs/generator/generator.h"
+#include "libs/identifier/identifier.h"
+#include "libs/packing/packing.h"
+#include "libs/aead/aead.h"
+#include "libs/siphash/siphash.h"
+
+/* - - - - - - - - - - - - - - - - - - - BYTE ORDER - - - - - - - - - - - - - - - - - - - */
+
+/*
+ * Integers are read and written one byte at a time: this is independent of
+ * the host byte order and of the alignment of the buffer, and compiles to a
+ * single load/store plus byte swap on the usual targets.
+ */
+
+static inline uint16_t load_be16(const unsigned char *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t load_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t load_be64(const unsigned char *p) {
+    return ((uint64_t)load_be32(p) << 32) | load_be32(p + 4);
+}
+
+static inline void store_be16(unsigned char *p, uint16_t value) {
+    p[0] = (unsigned char)(value >> 8);
+    p[1] = (unsigned char)value;
+}
+
+static inline void store_be32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static inline void store_be64(unsigned char *p, uint64_t value) {
+    store_be32(p, (uint32_t)(value >> 32));
+    store_be32(p + 4, (uint32_t)value);
+}
+
+/* - - - - - - - - - - - - - - - - - - END BYTE ORDER - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - VALIDATION - - - - - - - - - - - - - - - - - - - */
+
+CodecStatus codec_check_type(char type, unsigned int length) {
+    const IdentifierFormat *identifier = identifier_lookup(type);
+    if (identifier != NULL) {
+        return length == identifier->length ? CODEC_OK : CODEC_BAD_LENGTH;
+    }
+    if (codec_is_random_bytes(type) || codec_is_template(type)) {
+        unsigned int min_length = codec_is_template(type) ? 1 : MIN_RANDOM_BYTES_LENGTH;
+        return length >= min_length && length <= MAX_PASSWORD_LENGTH ? CODEC_OK : CODEC_BAD_LENGTH;
+    }
+    if (generator_lookup(type) == NULL) {
+        return CODEC_BAD_TYPE;
+    }
+    if (length < MIN_PASSWORD_LENGTH || length > MAX_PASSWORD_LENGTH) {
+        return CODEC_BAD_LENGTH;
+    }
+    return CODEC_OK;
+}
+
+/**
+ * @brief Checks a control request (`OP_CREDIT`, `OP_UNSUBSCRIBE`, `OP_STATS`): a body, no type and no length.
+ */
+static CodecStatus check_control(const RequestView *view, size_t body_size) {
+    if (view->body_size < body_size) {
+        return CODEC_TRUNCATED;
+    }
+    if (view->type != 0) {
+        return CODEC_BAD_TYPE;
+    }
+    return view->length == 0 ? CODEC_OK : CODEC_BAD_LENGTH;
+}
+
+/**
+ * @brief Checks the fields of a request according to its operation.
+ */
+static CodecStatus validate_request(const RequestView *view) {
+    if ((view->flags & REQUEST_FLAG_ENCRYPTED) && view->operation != OP_GENERATE) {
+        return CODEC_BAD_OPERATION;		/**< Streams and bulk transfers are sent in the clear */
+    }
+    switch (view->operation) {
+        case OP_GENERATE:
+            if (codec_is_template(view->type) && (view->body_size == 0 || view->body_size > TEMPLATE_MAX_SIZE)) {
+                return view->body_size == 0 ? CODEC_TRUNCATED : CODEC_BAD_LENGTH;
+            }
+            break;
+        case OP_SUBSCRIBE:
+            if (view->body_size < SUBSCRIBE_BODY_SIZE) {
+                return CODEC_TRUNCATED;
+            }
+            break;
+        case OP_CREDIT:
+            return check_control(view, CREDIT_BODY_SIZE);
+        case OP_UNSUBSCRIBE:
+            return check_control(view, 0);
+        case OP_STATS:
+            return check_control(view, STATS_BODY_SIZE);
+        case OP_BULK:
+            if (view->body_size < BULK_BODY_SIZE) {
+                return CODEC_TRUNCATED;
+            }
+            if (view->body[8] != FRAMING_NEWLINE && view->body[8] != FRAMING_LENGTH_PREFIX) {
+                return CODEC_BAD_OPERATION;
+            }
+            if (view->body[8] == FRAMING_NEWLINE && codec_is_random_bytes(view->type)) {
+                return CODEC_BAD_OPERATION;		/**< Random bytes contain newlines */
+            }
+            break;
+        default:
+            return CODEC_BAD_OPERATION;
+    }
+
+    if (codec_is_template(view->type) && view->operation != OP_GENERATE) {
+        return CODEC_BAD_OPERATION;		/**< Templates are served one datagram at a time */
+    }
+    if (view->legacy && (codec_is_random_bytes(view->type) || codec_is_template(view->type))) {
+        return CODEC_BAD_TYPE;		/**< A legacy answer is a string without a 0, a legacy request has no body */
+    }
+    CodecStatus status = codec_check_type(view->type, view->length);
+    if (status != CODEC_OK) {
+        return status;
+    }
+    if (view->count == 0 && view->operation != OP_BULK) {
+        return CODEC_BAD_COUNT;
+    }
+    return CODEC_OK;
+}
+
+/* - - - - - - - - - - - - - - - - - - END VALIDATION - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - REQUESTS - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Decodes a legacy request: a type letter followed by a decimal length string.
+ */
+static CodecStatus decode_legacy_request(const unsigned char *buffer, size_t size, RequestView *view) {
+    unsigned int length = 0;
+    size_t digits = 0;
+
+    view->legacy = true;
+    view->count = 1;
+    if (size < 2) {
+        return CODEC_TRUNCATED;
+    }
+
+    view->type = (char)buffer[0];
+    for (size_t i = 1; i < size && buffer[i] != '\0'; i++) {
+        if (buffer[i] < '0' || buffer[i] > '9' || ++digits > 3) {
+            return CODEC_BAD_LENGTH;
+        }
+        length = length * 10 + (buffer[i] - '0');
+    }
+    if (digits == 0 || length > MAX_PASSWORD_LENGTH) {
+        return CODEC_BAD_LENGTH;
+    }
+    view->length = (uint8_t)length;
+    return validate_request(view);
+}
+
+CodecStatus codec_decode_request(const unsigned char *buffer, size_t size, RequestView *view) {
+    memset(view, 0, sizeof(*view));
+    view->raw = buffer;
+    view->raw_size = size;
+
+    if (size == 0) {
+        return CODEC_TRUNCATED;
+    }
+    if (buffer[0] != PROTOCOL_MAGIC) {
+        return decode_legacy_request(buffer, size, view);
+    }
+    if (size < REQUEST_HEADER_SIZE) {
+        return CODEC_TRUNCATED;
+    }
+    if (buffer[1] != PROTOCOL_VERSION) {
+        return CODEC_BAD_VERSION;
+    }
+
+    view->type = (char)buffer[2];
+    view->length = buffer[3];
+    view->count = load_be16(buffer + 4);
+    view->operation = buffer[6];
+    view->flags = buffer[7];
+    view->request_id = load_be32(buffer + 8);
+    if (view->flags & ~REQUEST_FLAGS_KNOWN) {
+        return CODEC_BAD_FLAGS;
+    }
+
+    size_t header_size = REQUEST_HEADER_SIZE;
+    if (view->flags & REQUEST_FLAG_DEADLINE) {
+        header_size += DEADLINE_EXTENSION_SIZE;
+        if (size < header_size) {
+            return CODEC_TRUNCATED;
+        }
+        view->deadline_us = load_be32(buffer + REQUEST_HEADER_SIZE);
+    }
+    if (view->flags & REQUEST_FLAG_COOKIE) {
+        if (size < header_size + COOKIE_EXTENSION_SIZE) {
+            return CODEC_TRUNCATED;
+        }
+        view->cookie = load_be64(buffer + header_size);
+        header_size += COOKIE_EXTENSION_SIZE;
+    }
+    if (view->flags & REQUEST_FLAG_ENCRYPTED) {
+        if (size < header_size + KEY_EXTENSION_SIZE) {
+            return CODEC_TRUNCATED;
+        }
+        view->key_id = load_be32(buffer + header_size);
+        header_size += KEY_EXTENSION_SIZE;
+    }
+    size_t trailer_size = 0;
+    if (view->flags & REQUEST_FLAG_TENANT) {
+        if (size < header_size + TENANT_EXTENSION_SIZE + TENANT_MAC_SIZE) {
+            return CODEC_TRUNCATED;
+        }
+        view->tenant_id = load_be32(buffer + header_size);
+        view->tenant_time = load_be32(buffer + header_size + 4);
+        header_size += TENANT_EXTENSION_SIZE;
+        trailer_size = TENANT_MAC_SIZE;
+    }
+    view->body = buffer + header_size;
+    view->body_size = size - header_size - trailer_size;
+    return validate_request(view);
+}
+
+/**
+ * @brief Size of the header of a request, extensions included.
+ */
+static size_t request_header_size(const RequestView *request) {
+    return REQUEST_HEADER_SIZE + (request->deadline_us != 0 ? DEADLINE_EXTENSION_SIZE : 0)
+        + (request->cookie != 0 ? COOKIE_EXTENSION_SIZE : 0) + (request->key_id != 0 ? KEY_EXTENSION_SIZE : 0)
+        + (request->tenant_id != 0 ? TENANT_EXTENSION_SIZE : 0);
+}
+
+size_t codec_encode_request(unsigned char *buffer, size_t capacity, const RequestView *request) {
+    size_t header_size = request_header_size(request);
+    if (capacity < header_size) {
+        return 0;
+    }
+    buffer[0] = PROTOCOL_MAGIC;
+    buffer[1] = PROTOCOL_VERSION;
+    buffer[2] = (unsigned char)request->type;
+    buffer[3] = request->length;
+    store_be16(buffer + 4, request->count);
+    buffer[6] = request->operation;
+    buffer[7] = (request->flags & ~(REQUEST_FLAG_DEADLINE | REQUEST_FLAG_COOKIE | REQUEST_FLAG_ENCRYPTED | REQUEST_FLAG_TENANT))
+        | (request->deadline_us != 0 ? REQUEST_FLAG_DEADLINE : 0) | (request->cookie != 0 ? REQUEST_FLAG_COOKIE : 0)
+        | (request->key_id != 0 ? REQUEST_FLAG_ENCRYPTED : 0) | (request->tenant_id != 0 ? REQUEST_FLAG_TENANT : 0);
+    store_be32(buffer + 8, request->request_id);
+
+    size_t offset = REQUEST_HEADER_SIZE;
+    if (request->deadline_us != 0) {
+        store_be32(buffer + offset, request->deadline_us);
+        offset += DEADLINE_EXTENSION_SIZE;
+    }
+    if (request->cookie != 0) {
+        store_be64(buffer + offset, request->cookie);
+        offset += COOKIE_EXTENSION_SIZE;
+    }
+    if (request->key_id != 0) {
+        store_be32(buffer + offset, request->key_id);
+        offset += KEY_EXTENSION_SIZE;
+    }
+    if (request->tenant_id != 0) {
+        store_be32(buffer + offset, request->tenant_id);
+        store_be32(buffer + offset + 4, request->tenant_time);
+    }
+    return header_size;
+}
+
+size_t codec_encode_subscribe(unsigned char *buffer, size_t capacity, const RequestView *request,
+                              const SubscribeOptions *options) {
+    RequestView header = *request;
+    header.operation = OP_SUBSCRIBE;
+    size_t header_size = request_header_size(&header);
+    if (capacity < header_size + SUBSCRIBE_BODY_SIZE) {
+        return 0;
+    }
+    codec_encode_request(buffer, capacity, &header);
+    store_be32(buffer + header_size, options->rate);
+    store_be32(buffer + header_size + 4, options->credits);
+    return header_size + SUBSCRIBE_BODY_SIZE;
+}
+
+size_t codec_encode_credit(unsigned char *buffer, size_t capacity, uint32_t stream_id, uint32_t credits) {
+    RequestView header = { .operation = OP_CREDIT, .request_id = stream_id };
+    if (capacity < REQUEST_HEADER_SIZE + CREDIT_BODY_SIZE) {
+        return 0;
+    }
+    codec_encode_request(buffer, capacity, &header);
+    store_be32(buffer + REQUEST_HEADER_SIZE, credits);
+    return REQUEST_HEADER_SIZE + CREDIT_BODY_SIZE;
+}
+
+size_t codec_encode_unsubscribe(unsigned char *buffer, size_t capacity, uint32_t stream_id) {
+    RequestView header = { .operation = OP_UNSUBSCRIBE, .request_id = stream_id };
+    return codec_encode_request(buffer, capacity, &header);
+}
+
+size_t codec_encode_bulk(unsigned char *buffer, size_t capacity, const RequestView *request, const BulkOptions *options) {
+    RequestView header = *request;
+    header.operation = OP_BULK;
+    size_t header_size = request_header_size(&header);
+    if (capacity < header_size + BULK_BODY_SIZE) {
+        return 0;
+    }
+    codec_encode_request(buffer, capacity, &header);
+    store_be64(buffer + header_size, options->total);
+    buffer[header_size + 8] = options->framing;
+    return header_size + BULK_BODY_SIZE;
+}
+
+size_t codec_encode_template(unsigned char *buffer, size_t capacity, const RequestView *request, const char *text,
+                             size_t size) {
+    RequestView header = *request;
+    header.operation = OP_GENERATE;
+    size_t header_size = request_header_size(&header);
+    if (capacity < header_size + size) {
+        return 0;
+    }
+    codec_encode_request(buffer, capacity, &header);
+    memcpy(buffer + header_size, text, size);
+    return header_size + size;
+}
+
+void codec_bulk_options(const RequestView *request, BulkOptions *options) {
+    options->total = load_be64(request->body);
+    options->framing = request->body[8];
+}
+
+void codec_subscribe_options(const RequestView *request, SubscribeOptions *options) {
+    options->rate = load_be32(request->body);
+    options->credits = load_be32(request->body + 4);
+}
+
+uint32_t codec_credit_amount(const RequestView *request) {
+    return load_be32(request->body);
+}
+
+size_t codec_encode_stats_request(unsigned char *buffer, size_t capacity, uint32_t request_id, uint32_t address) {
+    RequestView header = { .operation = OP_STATS, .request_id = request_id };
+    if (capacity < REQUEST_HEADER_SIZE + STATS_BODY_SIZE) {
+        return 0;
+    }
+    codec_encode_request(buffer, capacity, &header);
+    memcpy(buffer + REQUEST_HEADER_SIZE, &address, STATS_BODY_SIZE);	/**< Already in network byte order */
+    return REQUEST_HEADER_SIZE + STATS_BODY_SIZE;
+}
+
+uint32_t codec_stats_address(const RequestView *request) {
+    uint32_t address;
+    memcpy(&address, request->body, sizeof(address));
+    return address;
+}
+
+size_t codec_sign_request(unsigned char *buffer, size_t size, size_t capacity, const unsigned char *key) {
+    if (size + TENANT_MAC_SIZE > capacity) {
+        return 0;
+    }
+    store_be64(buffer + size, siphash24(key, buffer, size));
+    return size + TENANT_MAC_SIZE;
+}
+
+bool codec_verify_request(const RequestView *request, const unsigned char *key) {
+    size_t signed_size = request->raw_size - TENANT_MAC_SIZE;
+    return siphash24(key, request->raw, signed_size) == load_be64(request->raw + signed_size);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END REQUESTS - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RESPONSES - - - - - - - - - - - - - - - - - - - */
+
+unsigned int codec_packed_bits(const RequestView *request) {
+    const Generator *generator = generator_lookup(request->type);
+    if (request->legacy || !(request->flags & REQUEST_FLAG_PACKED) || (request->flags & REQUEST_FLAG_ENCRYPTED)
+        || request->operation != OP_GENERATE || generator == NULL) {
+        return 0;
+    }
+    return packing_bits(generator->alphabet_size);
+}
+
+uint16_t codec_response_count(const RequestView *request) {
+    if (request->legacy) {
+        return 1;
+    }
+    if (request->operation != OP_GENERATE) {
+        return 0;		/**< Streams count their datagrams, bulk transfers their total, control requests nothing */
+    }
+    unsigned int bits = codec_packed_bits(request);
+    uint16_t max_count = (uint16_t)((request->flags & REQUEST_FLAG_ENCRYPTED) ? MAX_SEALED_BATCH_COUNT(request->length)
+                                    : bits != 0 ? MAX_PACKED_BATCH_COUNT(request->length, bits)
+                                    : MAX_BATCH_COUNT(request->length));
+    return request->count < max_count ? request->count : max_count;
+}
+
+size_t codec_encode_response(unsigned char *buffer, size_t capacity, const RequestView *request,
+                             ResponseStatus status, uint16_t count) {
+    if (request->legacy) {
+        /* The legacy response is a null-terminated string padded to a fixed size;
+         * an empty string tells the client that the request was rejected. */
+        if (capacity < sizeof(PasswordResponse)) {
+            return 0;
+        }
+        size_t used = (status == STATUS_OK && count == 1) ? request->length : 0;
+        memset(buffer + used, 0, sizeof(PasswordResponse) - used);
+        return sizeof(PasswordResponse);
+    }
+
+    size_t length = (status == STATUS_OK) ? request->length : 0;
+    size_t total = RESPONSE_HEADER_SIZE + (size_t)count * length;
+    if (total > capacity) {
+        return 0;
+    }
+    buffer[0] = PROTOCOL_MAGIC;
+    buffer[1] = PROTOCOL_VERSION;
+    buffer[2] = (unsigned char)status;
+    buffer[3] = (unsigned char)request->type;
+    buffer[4] = (unsigned char)length;
+    buffer[5] = 0;
+    store_be16(buffer + 6, status == STATUS_OK ? count : 0);
+    store_be32(buffer + 8, request->request_id);
+    return status == STATUS_OK ? total : RESPONSE_HEADER_SIZE;
+}
+
+size_t codec_encode_cookie_response(unsigned char *buffer, size_t capacity, const RequestView *request, uint64_t cookie) {
+    if (request->legacy || capacity < RESPONSE_HEADER_SIZE + COOKIE_EXTENSION_SIZE) {
+        return 0;
+    }
+    codec_encode_response(buffer, capacity, request, STATUS_COOKIE_REQUIRED, 0);
+    store_be64(buffer + RESPONSE_HEADER_SIZE, cookie);
+    return RESPONSE_HEADER_SIZE + COOKIE_EXTENSION_SIZE;
+}
+
+size_t codec_encode_stats(unsigned char *buffer, size_t capacity, const RequestView *request,
+                          const StatsSummary *summary, const StatsEntry *entries, uint16_t count) {
+    size_t header_size = RESPONSE_HEADER_SIZE + STATS_SUMMARY_SIZE;
+    if (request->legacy || capacity < header_size) {
+        return 0;
+    }
+    if (count > (capacity - header_size) / STATS_ENTRY_SIZE) {
+        count = (uint16_t)((capacity - header_size) / STATS_ENTRY_SIZE);
+    }
+    codec_encode_response(buffer, capacity, request, STATUS_STATS, 0);
+    buffer[4] = STATS_ENTRY_SIZE;
+    store_be16(buffer + 6, count);
+    store_be32(buffer + 12, summary->window_ms);
+    store_be64(buffer + 16, summary->packets);
+    store_be32(buffer + 24, summary->unique);
+    store_be32(buffer + 28, summary->estimate);
+
+    unsigned char *entry = buffer + header_size;
+    for (uint16_t i = 0; i < count; i++, entry += STATS_ENTRY_SIZE) {
+        memcpy(entry, &entries[i].address, 4);
+        store_be32(entry + 4, entries[i].count);
+        store_be32(entry + 8, entries[i].error);
+    }
+    return header_size + (size_t)count * STATS_ENTRY_SIZE;
+}
+
+void codec_stats_summary(const unsigned char *buffer, StatsSummary *summary) {
+    summary->window_ms = load_be32(buffer + 12);
+    summary->packets = load_be64(buffer + 16);
+    summary->unique = load_be32(buffer + 24);
+    summary->estimate = load_be32(buffer + 28);
+}
+
+void codec_stats_entry(const ResponseView *response, uint16_t index, StatsEntry *entry) {
+    const unsigned char *source = (const unsigned char *)response->passwords + (size_t)index * STATS_ENTRY_SIZE;
+    memcpy(&entry->address, source, 4);
+    entry->count = load_be32(source + 4);
+    entry->error = load_be32(source + 8);
+}
+
+/**
+ * @brief Nonce of an encrypted response: the request id and the nonce counter, big-endian.
+ */
+static void response_nonce(const unsigned char *header, const unsigned char *counter, unsigned char nonce[AEAD_NONCE_SIZE]) {
+    memcpy(nonce, header + 8, 4);
+    memcpy(nonce + 4, counter, 8);
+}
+
+size_t codec_seal_response(unsigned char *buffer, size_t size, size_t capacity, const unsigned char *key,
+                           uint64_t nonce_counter) {
+    unsigned char nonce[AEAD_NONCE_SIZE];
+
+    if (size < RESPONSE_HEADER_SIZE || size + SEALED_TRAILER_SIZE > capacity) {
+        return 0;
+    }
+    buffer[5] = ENCODING_CHACHA20_POLY1305;
+    store_be64(buffer + size, nonce_counter);
+    response_nonce(buffer, buffer + size, nonce);
+    aead_seal(key, nonce, buffer, RESPONSE_HEADER_SIZE, buffer + RESPONSE_HEADER_SIZE, size - RESPONSE_HEADER_SIZE,
+              buffer + size + 8);
+    return size + SEALED_TRAILER_SIZE;
+}
+
+size_t codec_pack_response(unsigned char *buffer, size_t size, const RequestView *request) {
+    const Generator *generator = generator_lookup(request->type);
+    if (codec_packed_bits(request) == 0 || size <= RESPONSE_HEADER_SIZE || buffer[2] != STATUS_OK) {
+        return size;
+    }
+    buffer[5] = ENCODING_PACKED;
+    return RESPONSE_HEADER_SIZE + packing_encode(generator->alphabet, generator->alphabet_size,
+                                                 (const char *)buffer + RESPONSE_HEADER_SIZE,
+                                                 size - RESPONSE_HEADER_SIZE, buffer + RESPONSE_HEADER_SIZE);
+}
+
+bool codec_unpack_response(ResponseView *response, char *passwords, size_t capacity) {
+    const Generator *generator = generator_lookup(response->type);
+    size_t symbols = (size_t)response->count * response->length;
+    if (response->encoding != ENCODING_PACKED || generator == NULL || symbols > capacity
+        || !packing_decode(generator->alphabet, generator->alphabet_size, (const unsigned char *)response->passwords,
+                           symbols, passwords)) {
+        return false;
+    }
+    response->passwords = passwords;
+    response->encoding = ENCODING_PLAIN;
+    return true;
+}
+
+bool codec_open_response(unsigned char *buffer, size_t size, ResponseView *response, const unsigned char *key) {
+    unsigned char nonce[AEAD_NONCE_SIZE];
+    size_t payload = (size_t)response->count * response->length;
+
+    if (response->encoding != ENCODING_CHACHA20_POLY1305 || size != RESPONSE_HEADER_SIZE + payload + SEALED_TRAILER_SIZE) {
+        return false;
+    }
+    unsigned char *trailer = buffer + RESPONSE_HEADER_SIZE + payload;
+    response_nonce(buffer, trailer, nonce);
+    if (!aead_open(key, nonce, buffer, RESPONSE_HEADER_SIZE, buffer + RESPONSE_HEADER_SIZE, payload, trailer + 8)) {
+        return false;
+    }
+    response->encoding = ENCODING_PLAIN;
+    return true;
+}
+
+size_t codec_encode_stream(unsigned char *buffer, size_t capacity, const RequestView *subscription,
+                           ResponseStatus status, uint16_t count, uint32_t sequence) {
+    size_t total = STREAM_HEADER_SIZE + (size_t)count * subscription->length;
+    if (total > capacity) {
+        return 0;
+    }
+    buffer[0] = PROTOCOL_MAGIC;
+    buffer[1] = PROTOCOL_VERSION;
+    buffer[2] = (unsigned char)status;
+    buffer[3] = (unsigned char)subscription->type;
+    buffer[4] = subscription->length;
+    buffer[5] = 0;
+    store_be16(buffer + 6, count);
+    store_be32(buffer + 8, subscription->request_id);
+    store_be32(buffer + 12, sequence);
+    return total;
+}
+
+CodecStatus codec_decode_response(const unsigned char *buffer, size_t size, ResponseView *view) {
+    memset(view, 0, sizeof(*view));
+    if (size < RESPONSE_HEADER_SIZE || buffer[0] != PROTOCOL_MAGIC) {
+        return CODEC_TRUNCATED;
+    }
+    if (buffer[1] != PROTOCOL_VERSION) {
+        return CODEC_BAD_VERSION;
+    }
+
+    view->status = (ResponseStatus)buffer[2];
+    view->type = (char)buffer[3];
+    view->length = buffer[4];
+    view->encoding = buffer[5];
+    view->count = load_be16(buffer + 6);
+    view->request_id = load_be32(buffer + 8);
+
+    size_t header_size = RESPONSE_HEADER_SIZE;
+    if (view->status == STATUS_STREAM_DATA || view->status == STATUS_STREAM_END) {
+        header_size = STREAM_HEADER_SIZE;
+        if (size < header_size) {
+            return CODEC_TRUNCATED;
+        }
+        view->sequence = load_be32(buffer + 12);
+    } else if (view->status == STATUS_COOKIE_REQUIRED) {
+        if (size < RESPONSE_HEADER_SIZE + COOKIE_EXTENSION_SIZE) {
+            return CODEC_TRUNCATED;
+        }
+        view->cookie = load_be64(buffer + RESPONSE_HEADER_SIZE);
+    } else if (view->status == STATUS_STATS) {
+        header_size = RESPONSE_HEADER_SIZE + STATS_SUMMARY_SIZE;
+        if (size < header_size || view->length != STATS_ENTRY_SIZE) {
+            return CODEC_TRUNCATED;
+        }
+    }
+    view->passwords = (const char *)buffer + header_size;
+
+    if (view->length > MAX_PASSWORD_LENGTH) {
+        return CODEC_BAD_LENGTH;
+    }
+    size_t payload = (size_t)view->count * view->length;
+    if (view->encoding == ENCODING_PACKED) {
+        const Generator *generator = generator_lookup(view->type);
+        if (generator == NULL) {
+            return CODEC_BAD_TYPE;
+        }
+        payload = packing_size(payload, packing_bits(generator->alphabet_size));
+    }
+    if (header_size + payload > size) {
+        return CODEC_TRUNCATED;
+    }
+    return CODEC_OK;
+}
+
+const char *codec_status_message(CodecStatus status) {
+    switch (status) {
+        case CODEC_OK:			return "ok";
+        case CODEC_TRUNCATED:	return "message truncated";
+        case CODEC_BAD_VERSION:	return "unsupported protocol version";
+        case CODEC_BAD_TYPE:	return "invalid password type";
+        case CODEC_BAD_LENGTH:	return "invalid password length";
+        case CODEC_BAD_COUNT:	return "invalid password count";
+        case CODEC_BAD_OPERATION:	return "unknown operation";
+        case CODEC_BAD_FLAGS:	return "unknown request flags";
+        case CODEC_NO_SPACE:	return "buffer too small";
+        default:				return "unknown error";
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - END RESPONSES - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,484 @@
+/**
+ * @file codec.h
+ * @brief In-place encoder and decoder for the client-server messages.
+ *
+ * The codec never copies a message into an intermediate structure: requests
+ * are decoded as views over the receive buffer and responses are written
+ * directly into the send buffer, with the passwords generated in place at
+ * their final offset. Both the compact format described in `protocol.h` and
+ * the legacy `PasswordRequest`/`PasswordResponse` structures are supported.
+ *
+ * Every function checks the buffer bounds it is given and never reads or
+ * writes outside of them, whatever the content of the buffer.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef CODEC_H_
+#define CODEC_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/protocol/protocol.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @enum CodecStatus
+ * @brief Result of a decoding or encoding operation.
+ */
+typedef enum {
+    CODEC_OK,				/**< The message is valid */
+    CODEC_TRUNCATED,		/**< The buffer is shorter than the message it should contain */
+    CODEC_BAD_VERSION,		/**< The compact message has an unsupported version */
+    CODEC_BAD_TYPE,			/**< The password type is not a known type */
+    CODEC_BAD_LENGTH,		/**< The password length is out of range */
+    CODEC_BAD_COUNT,		/**< The number of passwords is zero */
+    CODEC_BAD_OPERATION,	/**< The operation is unknown */
+    CODEC_BAD_FLAGS,		/**< A flag bit outside `REQUEST_FLAGS_KNOWN` is set */
+    CODEC_NO_SPACE			/**< The output buffer is too small for the message */
+} CodecStatus;
+
+/**
+ * @struct RequestView
+ * @brief Decoded fields of a request, pointing back into the receive buffer.
+ *
+ * The same structure is filled in by the client before encoding a request.
+ */
+typedef struct {
+    char type;					/**< Password type as sent on the wire ('n', 'a', ...) */
+    uint8_t length;				/**< Password length */
+    uint16_t count;				/**< Number of passwords requested */
+    uint8_t operation;			/**< Requested operation (`RequestOperation`) */
+    uint8_t flags;				/**< Request flags */
+    uint32_t request_id;		/**< Request identifier (stream id for stream operations) */
+    uint32_t deadline_us;		/**< Time budget from reception, 0 for none (`REQUEST_FLAG_DEADLINE`) */
+    uint64_t cookie;			/**< Anti-spoofing cookie, 0 for none (`REQUEST_FLAG_COOKIE`) */
+    uint32_t key_id;			/**< Key encrypting the answer, 0 for none (`REQUEST_FLAG_ENCRYPTED`) */
+    uint32_t tenant_id;			/**< Tenant sending the request, 0 for none (`REQUEST_FLAG_TENANT`) */
+    uint32_t tenant_time;		/**< Unix time the tenant signed the request at (`REQUEST_FLAG_TENANT`) */
+    bool legacy;				/**< `true` if the request used the `PasswordRequest` layout */
+    const unsigned char *raw;	/**< Start of the message in the receive buffer */
+    size_t raw_size;			/**< Size of the message in the receive buffer */
+    const unsigned char *body;	/**< Operation-specific body following the header */
+    size_t body_size;			/**< Size of `body`, without the MAC of a tenant */
+} RequestView;
+
+/**
+ * @struct SubscribeOptions
+ * @brief Body of an `OP_SUBSCRIBE` request.
+ */
+typedef struct {
+    uint32_t rate;				/**< Passwords per second, 0 for no limit */
+    uint32_t credits;			/**< Datagrams the server may send before more credit is granted */
+} SubscribeOptions;
+
+/**
+ * @struct BulkOptions
+ * @brief Body of an `OP_BULK` request.
+ */
+typedef struct {
+    uint64_t total;				/**< Number of passwords to send */
+    uint8_t framing;			/**< `BulkFraming` used between passwords */
+} BulkOptions;
+
+/**
+ * @struct StatsSummary
+ * @brief Summary of the clients in a `STATUS_STATS` answer.
+ */
+typedef struct {
+    uint32_t window_ms;			/**< Period the figures cover */
+    uint64_t packets;			/**< Datagrams received in the period */
+    uint32_t unique;			/**< Estimated distinct clients */
+    uint32_t estimate;			/**< Estimated datagrams of the address asked about, never below the true count */
+} StatsSummary;
+
+/**
+ * @struct StatsEntry
+ * @brief One heavy hitter of a `STATUS_STATS` answer.
+ */
+typedef struct {
+    uint32_t address;			/**< IPv4 address of the client, in network byte order */
+    uint32_t count;				/**< Datagrams it sent, at most */
+    uint32_t error;				/**< Most `count` may exceed the true count by */
+} StatsEntry;
+
+/**
+ * @struct ResponseView
+ * @brief Decoded fields of a compact response, pointing back into the receive buffer.
+ */
+typedef struct {
+    ResponseStatus status;		/**< Outcome of the request */
+    char type;					/**< Password type */
+    uint8_t length;				/**< Length of every password in the payload */
+    uint8_t encoding;			/**< Payload encoding */
+    uint16_t count;				/**< Number of passwords in the payload */
+    uint32_t request_id;		/**< Identifier of the request being answered (or stream id) */
+    uint32_t sequence;			/**< Sequence number of a stream datagram, 0 otherwise */
+    uint64_t cookie;			/**< Cookie of a `STATUS_COOKIE_REQUIRED` answer, 0 otherwise */
+    const char *passwords;		/**< First character of the first password (first entry of a `STATUS_STATS` answer) */
+} ResponseView;
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - REQUESTS - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Decodes a request received from the network.
+ *
+ * Compact requests are recognised by their magic byte; anything else is
+ * decoded as a legacy `PasswordRequest` (type letter followed by the length
+ * as a decimal string).
+ *
+ * @param[in] buffer The received datagram.
+ * @param[in] size Number of bytes received.
+ * @param[out] view Decoded request, valid as long as `buffer` is.
+ * @return `CODEC_OK` if the request is well-formed, an error status otherwise.
+ * @note On error, `view->legacy` still tells which format the sender used, so
+ *       that a matching error response can be produced.
+ */
+CodecStatus codec_decode_request(const unsigned char *buffer, size_t size, RequestView *view);
+
+/**
+ * @brief Checks a type and a length against the protocol: a password type of `MIN_PASSWORD_LENGTH`
+ * to `MAX_PASSWORD_LENGTH` characters, an identifier type of exactly the length of its text,
+ * random bytes of `MIN_RANDOM_BYTES_LENGTH` to `MAX_PASSWORD_LENGTH` bytes, or a template of
+ * 1 to `MAX_PASSWORD_LENGTH` characters.
+ * @param[in] type The type byte.
+ * @param[in] length The length.
+ * @return `CODEC_OK`, `CODEC_BAD_TYPE` or `CODEC_BAD_LENGTH`.
+ */
+CodecStatus codec_check_type(char type, unsigned int length);
+
+/**
+ * @brief Tells whether a type byte asks for raw random bytes (`RANDOM_BYTES_TYPE`, either case).
+ * @param[in] type The type byte.
+ */
+static inline bool codec_is_random_bytes(char type) {
+    return (type | 0x20) == RANDOM_BYTES_TYPE;
+}
+
+/**
+ * @brief Tells whether a type byte asks for passwords following a template (`TEMPLATE_TYPE`, either case).
+ * @param[in] type The type byte.
+ */
+static inline bool codec_is_template(char type) {
+    return (type | 0x20) == TEMPLATE_TYPE;
+}
+
+/**
+ * @brief Encodes a compact request.
+ * @details The deadline, cookie, key and tenant extensions are added, and their flags set,
+ * when `request->deadline_us`, `request->cookie`, `request->key_id` and `request->tenant_id`
+ * are not 0. A request of a tenant must then be completed with `codec_sign_request`.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request Fields to encode (`legacy`, `raw` and `raw_size` are ignored).
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_request(unsigned char *buffer, size_t capacity, const RequestView *request);
+
+/**
+ * @brief Encodes an `OP_SUBSCRIBE` request.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request Header fields (`request_id` is the stream id, `count` the passwords per datagram).
+ * @param[in] options Rate and initial credits.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_subscribe(unsigned char *buffer, size_t capacity, const RequestView *request,
+                              const SubscribeOptions *options);
+
+/**
+ * @brief Encodes an `OP_CREDIT` request.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] stream_id Stream receiving the credit.
+ * @param[in] credits Number of additional datagrams granted.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_credit(unsigned char *buffer, size_t capacity, uint32_t stream_id, uint32_t credits);
+
+/**
+ * @brief Encodes an `OP_UNSUBSCRIBE` request.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] stream_id Stream to close.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_unsubscribe(unsigned char *buffer, size_t capacity, uint32_t stream_id);
+
+/**
+ * @brief Encodes an `OP_BULK` request.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request Header fields (type, length, request id).
+ * @param[in] options Total and framing.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_bulk(unsigned char *buffer, size_t capacity, const RequestView *request, const BulkOptions *options);
+
+/**
+ * @brief Encodes an `OP_GENERATE` request for passwords following a template.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request Header fields and extensions (`length` is the length the template produces).
+ * @param[in] text The template.
+ * @param[in] size Size of `text`, at most `TEMPLATE_MAX_SIZE`.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_template(unsigned char *buffer, size_t capacity, const RequestView *request, const char *text,
+                             size_t size);
+
+/**
+ * @brief Reads the body of a decoded `OP_BULK` request.
+ * @param[in] request A successfully decoded bulk request.
+ * @param[out] options Total and framing.
+ */
+void codec_bulk_options(const RequestView *request, BulkOptions *options);
+
+/**
+ * @brief Reads the body of a decoded `OP_SUBSCRIBE` request.
+ * @param[in] request A successfully decoded subscribe request.
+ * @param[out] options Rate and initial credits.
+ */
+void codec_subscribe_options(const RequestView *request, SubscribeOptions *options);
+
+/**
+ * @brief Reads the body of a decoded `OP_CREDIT` request.
+ * @param[in] request A successfully decoded credit request.
+ * @return The number of datagrams granted.
+ */
+uint32_t codec_credit_amount(const RequestView *request);
+
+/**
+ * @brief Encodes an `OP_STATS` request.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request_id Identifier echoed in the answer.
+ * @param[in] address IPv4 address to estimate the datagrams of, in network byte order, 0 for none.
+ * @return Number of bytes written, or 0 if `buffer` is too small.
+ */
+size_t codec_encode_stats_request(unsigned char *buffer, size_t capacity, uint32_t request_id, uint32_t address);
+
+/**
+ * @brief Reads the body of a decoded `OP_STATS` request.
+ * @param[in] request A successfully decoded stats request.
+ * @return The address asked about, in network byte order, 0 for none.
+ */
+uint32_t codec_stats_address(const RequestView *request);
+
+/**
+ * @brief Appends the MAC of a tenant to an encoded request (header, extensions and body).
+ * @param[in,out] buffer The request.
+ * @param[in] size Size of the request.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] key The key of the tenant (`SIPHASH_KEY_SIZE` bytes).
+ * @return Size of the signed request, or 0 if the MAC does not fit in `buffer`.
+ */
+size_t codec_sign_request(unsigned char *buffer, size_t size, size_t capacity, const unsigned char *key);
+
+/**
+ * @brief Checks the MAC of a decoded request of a tenant.
+ * @param[in] request A successfully decoded request with `REQUEST_FLAG_TENANT`.
+ * @param[in] key The key of `request->tenant_id` (`SIPHASH_KEY_SIZE` bytes).
+ * @return `true` if the request was signed with `key` and not altered since.
+ */
+bool codec_verify_request(const RequestView *request, const unsigned char *key);
+
+/* - - - - - - - - - - - - - - - - - - - END REQUESTS - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RESPONSES - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Bits per character of the packed answer to a request (see `libs/packing`).
+ * @param[in] request A successfully decoded request.
+ * @return The bits, or 0 if the answer is not packed: no `REQUEST_FLAG_PACKED`, an
+ * encrypted answer, or a type that is not a password type.
+ */
+unsigned int codec_packed_bits(const RequestView *request);
+
+/**
+ * @brief Number of passwords that a response to `request` can carry.
+ *
+ * Legacy requests always get exactly one password; compact `OP_GENERATE`
+ * requests get the requested count, capped by the datagram size (less the
+ * trailer when the answer is encrypted, more passwords when it is packed:
+ * their plain response then takes up to `MAX_UNPACKED_RESPONSE_SIZE` bytes);
+ * the other operations get none, whatever their length field says.
+ *
+ * @param[in] request A successfully decoded request.
+ * @return The number of passwords to generate.
+ */
+uint16_t codec_response_count(const RequestView *request);
+
+/**
+ * @brief Writes the response header for `request` into the send buffer.
+ *
+ * After this call the caller generates the passwords directly at the
+ * addresses returned by `codec_response_password`.
+ *
+ * @param[out] buffer The send buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request The request being answered.
+ * @param[in] status Outcome of the request.
+ * @param[in] count Number of passwords that will follow (0 for errors).
+ * @return Total size of the response (header and payload), or 0 if it does not fit in `buffer`.
+ */
+size_t codec_encode_response(unsigned char *buffer, size_t capacity, const RequestView *request,
+                             ResponseStatus status, uint16_t count);
+
+/**
+ * @brief Encodes a `STATUS_COOKIE_REQUIRED` answer.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request The compact request being answered.
+ * @param[in] cookie The cookie the client must send.
+ * @return Total size of the response, or 0 if it does not fit in `buffer`.
+ */
+size_t codec_encode_cookie_response(unsigned char *buffer, size_t capacity, const RequestView *request, uint64_t cookie);
+
+/**
+ * @brief Encodes a `STATUS_STATS` answer.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] request The stats request being answered.
+ * @param[in] summary Summary of the clients.
+ * @param[in] entries The heavy hitters, heaviest first.
+ * @param[in] count Number of `entries`; those that do not fit in `capacity` are left out.
+ * @return Total size of the response, or 0 if not even the summary fits in `buffer`.
+ */
+size_t codec_encode_stats(unsigned char *buffer, size_t capacity, const RequestView *request,
+                          const StatsSummary *summary, const StatsEntry *entries, uint16_t count);
+
+/**
+ * @brief Reads the summary of a decoded `STATUS_STATS` answer.
+ * @param[in] buffer The received datagram.
+ * @param[out] summary The summary.
+ */
+void codec_stats_summary(const unsigned char *buffer, StatsSummary *summary);
+
+/**
+ * @brief Reads one heavy hitter of a decoded `STATUS_STATS` answer.
+ * @param[in] response The decoded answer.
+ * @param[in] index Position of the entry, below `response->count`.
+ * @param[out] entry The heavy hitter.
+ */
+void codec_stats_entry(const ResponseView *response, uint16_t index, StatsEntry *entry);
+
+/**
+ * @brief Encrypts the passwords of an encoded response in place and appends the trailer.
+ * @details The nonce is the request id followed by `nonce_counter`; the header, with its
+ * encoding set to `ENCODING_CHACHA20_POLY1305`, is authenticated along with the passwords.
+ * @param[in,out] buffer The response, as written by `codec_encode_response` and the generator.
+ * @param[in] size Size of the response.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] key The key of the request (`AEAD_KEY_SIZE` bytes).
+ * @param[in] nonce_counter A value never used before with this key.
+ * @return Size of the encrypted response, or 0 if the trailer does not fit in `buffer`.
+ */
+size_t codec_seal_response(unsigned char *buffer, size_t size, size_t capacity, const unsigned char *key,
+                           uint64_t nonce_counter);
+
+/**
+ * @brief Bit-packs the passwords of an encoded response in place, when its request asked for it.
+ * @details The encoding of the header becomes `ENCODING_PACKED`; responses without passwords,
+ * and responses to requests whose answer is not packed (`codec_packed_bits`), are left as they are.
+ * @param[in,out] buffer The response, as written by `codec_encode_response` and the generator.
+ * @param[in] size Size of the response.
+ * @param[in] request The request the response answers.
+ * @return Size of the response once packed.
+ */
+size_t codec_pack_response(unsigned char *buffer, size_t size, const RequestView *request);
+
+/**
+ * @brief Expands the passwords of a packed response.
+ * @details On success the encoding of `response` becomes `ENCODING_PLAIN` and its passwords
+ * point to `passwords`.
+ * @param[in,out] response A response decoded with `ENCODING_PACKED`.
+ * @param[out] passwords Destination of the characters.
+ * @param[in] capacity Size of `passwords`.
+ * @return `false` if the passwords do not fit or a character is out of the alphabet of the type.
+ */
+bool codec_unpack_response(ResponseView *response, char *passwords, size_t capacity);
+
+/**
+ * @brief Authenticates an encrypted response and decrypts its passwords in place.
+ * @details On success the encoding of `response` becomes `ENCODING_PLAIN`.
+ * @param[in,out] buffer The received datagram.
+ * @param[in] size Number of bytes received.
+ * @param[in,out] response The response decoded from `buffer`.
+ * @param[in] key The key the request named (`AEAD_KEY_SIZE` bytes).
+ * @return `false` if the response is not authentic or its size is wrong; `buffer` is then unchanged.
+ */
+bool codec_open_response(unsigned char *buffer, size_t size, ResponseView *response, const unsigned char *key);
+
+/**
+ * @brief Returns where the `index`-th password of a response must be written.
+ * @param[in] buffer The send buffer passed to `codec_encode_response`.
+ * @param[in] request The request being answered.
+ * @param[in] index Position of the password in the batch.
+ * @return Pointer to the first character of the password slot.
+ */
+static inline char *codec_response_password(unsigned char *buffer, const RequestView *request, uint16_t index) {
+    if (request->legacy) {
+        return (char *)buffer;
+    }
+    return (char *)buffer + RESPONSE_HEADER_SIZE + (size_t)index * request->length;
+}
+
+/**
+ * @brief Writes the header of a stream datagram into the send buffer.
+ * @param[out] buffer The send buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] subscription The subscribe request that opened the stream.
+ * @param[in] status `STATUS_STREAM_DATA` or `STATUS_STREAM_END`.
+ * @param[in] count Number of passwords that will follow.
+ * @param[in] sequence Sequence number of the datagram in the stream.
+ * @return Total size of the datagram, or 0 if it does not fit in `buffer`.
+ */
+size_t codec_encode_stream(unsigned char *buffer, size_t capacity, const RequestView *subscription,
+                           ResponseStatus status, uint16_t count, uint32_t sequence);
+
+/**
+ * @brief Returns where the `index`-th password of a stream datagram must be written.
+ * @param[in] buffer The send buffer passed to `codec_encode_stream`.
+ * @param[in] length Password length of the stream.
+ * @param[in] index Position of the password in the datagram.
+ * @return Pointer to the first character of the password slot.
+ */
+static inline char *codec_stream_password(unsigned char *buffer, uint8_t length, uint16_t index) {
+    return (char *)buffer + STREAM_HEADER_SIZE + (size_t)index * length;
+}
+
+/**
+ * @brief Decodes a compact response received by the client.
+ * @param[in] buffer The received datagram.
+ * @param[in] size Number of bytes received.
+ * @param[out] view Decoded response, valid as long as `buffer` is.
+ * @return `CODEC_OK` if the response is well-formed, an error status otherwise.
+ */
+CodecStatus codec_decode_response(const unsigned char *buffer, size_t size, ResponseView *view);
+
+/**
+ * @brief Returns a readable description of a codec status.
+ * @param[in] status The status to describe.
+ * @return A static, null-terminated string.
+ */
+const char *codec_status_message(CodecStatus status);
+
+/* - - - - - - - - - - - - - - - - - - - END RESPONSES - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* CODEC_H_ */
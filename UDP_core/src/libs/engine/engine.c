@@ -0,0 +1,718 @@
+/**
+ * @file engine.c
+ * @brief Implementation of the in-process embedding API.
+ *
+ * A context owns the shared state: the policy, the entropy of every type and
+ * length (computed once), the SipHash key, the uniqueness filter and the sorted
+ * hashes of the breached passwords. An engine owns a CSPRNG stream and only
+ * touches the shared state through atomic operations, so engines on different
+ * threads never take a lock.
+ *
+ * When the policy has nothing to check, a batch is a plain run of the generator;
+ * otherwise every password is drawn, checked and redrawn if needed, up to
+ * `PASSGEN_MAX_ATTEMPTS` times. Identifiers and random bytes skip the policy:
+ * every engine is a worker of `libs/identifier`, with its own sequences, and
+ * hands out its keystream as random bytes. Templates go through the policy
+ * except for the character classes, and every engine caches their programs.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "engine.h"
+#include "libs/clock/clock.h"
+#include "libs/codec/codec.h"
+#include "libs/generator/generator.h"
+#include "libs/identifier/identifier.h"
+#include "libs/random/random.h"
+#include "libs/siphash/siphash.h"
+#include "libs/template/template.h"
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define CLASS_COUNT 4					/**< Lowercase, uppercase, digit, symbol */
+#define TYPE_COUNT (UNAMBIGUOUS + 1)	/**< Number of password types */
+#define FILTER_BITS_PER_ENTRY 16		/**< Size of the uniqueness filter per remembered password */
+#define FILTER_HASHES 4					/**< Bits set per password in the uniqueness filter */
+#define BREACHED_LINE_SIZE 256			/**< Longest line read from a breached password list */
+
+/**
+ * @struct UniqueFilter
+ * @brief Two Bloom filters used in turn: passwords are inserted in the current one and looked up in
+ * both; when the current one has received `capacity` passwords the older one is cleared and becomes
+ * current. At least the last `capacity` passwords are therefore always remembered.
+ * @details A password is entered by a 32-bit fingerprint of its keyed hash, the unit other
+ * contexts exchange; two of the last million passwords share one with a probability well below
+ * the false positive rate of the filters themselves.
+ */
+typedef struct {
+    uint64_t *words[2];		/**< Bits of the two filters */
+    uint64_t mask;			/**< Number of bits of one filter minus one (a power of two) */
+    uint64_t capacity;		/**< Insertions before the filters rotate */
+    uint64_t inserted;		/**< Insertions so far (atomic) */
+    unsigned int current;	/**< Filter receiving the insertions (atomic) */
+} UniqueFilter;
+
+struct PassgenContext {
+    PassgenPolicy policy;									/**< Rules applied by every engine */
+    double entropy[TYPE_COUNT][MAX_PASSWORD_LENGTH + 1];	/**< Entropy of every type and length under the policy */
+    uint8_t required_classes[TYPE_COUNT];					/**< Class mask every password must cover, 0 if none */
+    unsigned char key[SIPHASH_KEY_SIZE];					/**< Key of the password hashes */
+    UniqueFilter filter;									/**< Recently generated passwords */
+    PassgenIssueObserver observer;							/**< Told about every password entering the filter */
+    void *observer_argument;								/**< Argument of `observer` */
+    uint64_t *breached;										/**< Sorted hashes of the breached passwords */
+    size_t breached_count;									/**< Number of hashes in `breached` */
+    bool checked;											/**< Passwords must be checked one by one */
+    unsigned int node;										/**< Node number of the Snowflake IDs */
+    PassgenStats stats;										/**< Counters (atomic) */
+};
+
+struct PassgenEngine {
+    RandomStream stream;		/**< Private CSPRNG stream, first for its alignment */
+    PassgenContext *context;	/**< Shared state */
+    uint64_t deadline_ns;		/**< Generations are abandoned after this time, 0 for never */
+    IdentifierState identifiers;	/**< Worker of the identifiers */
+    TemplateCache templates;		/**< Programs of the templates asked for */
+};
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CLASSES - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Returns the class of a character: 0 lowercase, 1 uppercase, 2 digit, 3 symbol.
+ */
+static inline unsigned int character_class(unsigned char character) {
+    if (islower(character)) {
+        return 0;
+    }
+    if (isupper(character)) {
+        return 1;
+    }
+    return isdigit(character) ? 2 : 3;
+}
+
+/**
+ * @brief Returns the mask of the classes present in a string.
+ */
+static uint8_t class_mask(const char *characters, size_t length) {
+    uint8_t mask = 0;
+    for (size_t i = 0; i < length; i++) {
+        mask |= (uint8_t)(1u << character_class((unsigned char)characters[i]));
+    }
+    return mask;
+}
+
+/**
+ * @brief Counts the characters of each class in the alphabet of a generator.
+ */
+static void alphabet_classes(const Generator *generator, uint32_t sizes[CLASS_COUNT]) {
+    memset(sizes, 0, CLASS_COUNT * sizeof(sizes[0]));
+    for (uint32_t i = 0; i < generator->alphabet_size; i++) {
+        sizes[character_class((unsigned char)generator->alphabet[i])]++;
+    }
+}
+
+/**
+ * @brief Computes the entropy of a password type and length.
+ * @details With `require_every_class` the number of acceptable passwords is counted by
+ * inclusion-exclusion over the classes of the alphabet: the passwords drawn from every
+ * subset of classes, with alternating signs.
+ */
+static double compute_entropy(const Generator *generator, unsigned int length, bool require_every_class) {
+    uint32_t sizes[CLASS_COUNT];
+    alphabet_classes(generator, sizes);
+
+    if (!require_every_class) {
+        return length * log2((double)generator->alphabet_size);
+    }
+
+    uint8_t present = 0;
+    for (unsigned int c = 0; c < CLASS_COUNT; c++) {
+        present |= (uint8_t)((sizes[c] > 0) << c);
+    }
+
+    double count = 0;
+    for (uint8_t subset = present; ; subset = (uint8_t)((subset - 1) & present)) {
+        uint32_t size = 0;
+        for (unsigned int c = 0; c < CLASS_COUNT; c++) {
+            size += (subset >> c & 1) ? sizes[c] : 0;
+        }
+        double term = 1;
+        for (unsigned int i = 0; i < length; i++) {
+            term *= size;
+        }
+        bool negative = (__builtin_popcount(present) - __builtin_popcount(subset)) & 1;
+        count += negative ? -term : term;
+        if (subset == 0) {
+            break;
+        }
+    }
+    return count >= 1 ? log2(count) : 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CLASSES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - FILTERS - - - - - - - - - - - - - - - - - - - - */
+
+static bool unique_filter_init(UniqueFilter *filter, size_t capacity) {
+    uint64_t bits = 64;
+    while (bits < (uint64_t)capacity * FILTER_BITS_PER_ENTRY) {
+        bits <<= 1;
+    }
+    filter->words[0] = calloc(bits / 64, sizeof(uint64_t));
+    filter->words[1] = calloc(bits / 64, sizeof(uint64_t));
+    filter->mask = bits - 1;
+    filter->capacity = capacity > 0 ? capacity : 1;
+    filter->inserted = 0;
+    filter->current = 0;
+    return filter->words[0] != NULL && filter->words[1] != NULL;
+}
+
+static bool filter_contains(const uint64_t *words, const uint64_t positions[FILTER_HASHES]) {
+    for (unsigned int i = 0; i < FILTER_HASHES; i++) {
+        if (!(__atomic_load_n(&words[positions[i] >> 6], __ATOMIC_RELAXED) >> (positions[i] & 63) & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Inserts a password fingerprint unless it is already remembered.
+ * @return `false` if the fingerprint was (probably) seen before.
+ */
+static bool unique_filter_insert(UniqueFilter *filter, uint32_t fingerprint) {
+    uint64_t positions[FILTER_HASHES];
+    uint64_t spread = fingerprint * 0x9E3779B97F4A7C15ull;	/**< Odd multiplier: a bijection spreading into 64 bits */
+    uint64_t step = (spread >> 32) | 1;		/**< Double hashing: odd step over a power-of-two table */
+    for (unsigned int i = 0; i < FILTER_HASHES; i++) {
+        positions[i] = (spread + i * step) & filter->mask;
+    }
+
+    unsigned int current = __atomic_load_n(&filter->current, __ATOMIC_ACQUIRE);
+    if (filter_contains(filter->words[current], positions) || filter_contains(filter->words[current ^ 1], positions)) {
+        return false;
+    }
+    for (unsigned int i = 0; i < FILTER_HASHES; i++) {
+        __atomic_fetch_or(&filter->words[current][positions[i] >> 6], UINT64_C(1) << (positions[i] & 63), __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_add_fetch(&filter->inserted, 1, __ATOMIC_RELAXED) % filter->capacity == 0) {
+        uint64_t *older = filter->words[current ^ 1];
+        for (uint64_t i = 0; i <= filter->mask >> 6; i++) {
+            __atomic_store_n(&older[i], 0, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&filter->current, current ^ 1, __ATOMIC_RELEASE);
+    }
+    return true;
+}
+
+static int compare_hashes(const void *left, const void *right) {
+    uint64_t a = *(const uint64_t *)left, b = *(const uint64_t *)right;
+    return (a > b) - (a < b);
+}
+
+static bool breached_contains(const PassgenContext *context, uint64_t hash) {
+    size_t low = 0, high = context->breached_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (context->breached[middle] < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < context->breached_count && context->breached[low] == hash;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END FILTERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CONTEXT - - - - - - - - - - - - - - - - - - - - */
+
+void passgen_policy_default(PassgenPolicy *policy) {
+    *policy = (PassgenPolicy){
+        .min_entropy_bits = 0,
+        .require_every_class = false,
+        .unique = false,
+        .unique_capacity = PASSGEN_DEFAULT_UNIQUE_CAPACITY,
+    };
+}
+
+PassgenStatus passgen_context_create(const PassgenPolicy *policy, PassgenContext **context) {
+    PassgenContext *created = calloc(1, sizeof(*created));
+    if (created == NULL) {
+        return PASSGEN_NO_MEMORY;
+    }
+    if (policy != NULL) {
+        created->policy = *policy;
+    } else {
+        passgen_policy_default(&created->policy);
+    }
+
+    for (unsigned int type = 0; type < TYPE_COUNT; type++) {
+        const Generator *generator = generator_for_type((PasswordType)type);
+        uint32_t sizes[CLASS_COUNT];
+        alphabet_classes(generator, sizes);
+        for (unsigned int c = 0; c < CLASS_COUNT; c++) {
+            created->required_classes[type] |= (uint8_t)((sizes[c] > 0) << c);
+        }
+        if (!created->policy.require_every_class || __builtin_popcount(created->required_classes[type]) < 2) {
+            created->required_classes[type] = 0;	/**< A single-class alphabet always satisfies the rule */
+        }
+        for (unsigned int length = MIN_PASSWORD_LENGTH; length <= MAX_PASSWORD_LENGTH; length++) {
+            created->entropy[type][length] = compute_entropy(generator, length, created->required_classes[type] != 0);
+        }
+    }
+
+    RandomStream *stream = random_thread_stream();
+    random_stream_bytes(stream, created->key, sizeof(created->key));
+
+    if (created->policy.unique && !unique_filter_init(&created->filter, created->policy.unique_capacity)) {
+        passgen_context_destroy(created);
+        return PASSGEN_NO_MEMORY;
+    }
+    created->checked = created->policy.require_every_class || created->policy.unique;
+    *context = created;
+    return PASSGEN_OK;
+}
+
+void passgen_context_set_key(PassgenContext *context, const unsigned char *key) {
+    memcpy(context->key, key, sizeof(context->key));
+}
+
+void passgen_context_set_node(PassgenContext *context, unsigned int node) {
+    context->node = node;
+}
+
+void passgen_context_observe(PassgenContext *context, PassgenIssueObserver observer, void *argument) {
+    context->observer = observer;
+    context->observer_argument = argument;
+}
+
+bool passgen_context_remember(PassgenContext *context, uint32_t fingerprint) {
+    return !context->policy.unique || unique_filter_insert(&context->filter, fingerprint);
+}
+
+PassgenStatus passgen_context_load_breached(PassgenContext *context, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return PASSGEN_IO_ERROR;
+    }
+
+    size_t capacity = context->breached_count > 0 ? context->breached_count * 2 : 1024;
+    uint64_t *hashes = realloc(context->breached, capacity * sizeof(uint64_t));
+    if (hashes == NULL) {
+        fclose(file);
+        return PASSGEN_NO_MEMORY;
+    }
+    context->breached = hashes;
+
+    char line[BREACHED_LINE_SIZE];
+    bool continuation = false;		/**< The previous read ended in the middle of a long line */
+    while (fgets(line, sizeof(line), file) != NULL) {
+        size_t length = strcspn(line, "\r\n");
+        bool complete = line[length] != '\0' || feof(file);
+        if (continuation || !complete || length == 0) {
+            continuation = !complete;
+            continue;			/**< Lines longer than any password are skipped */
+        }
+
+        if (context->breached_count == capacity) {
+            capacity *= 2;
+            hashes = realloc(context->breached, capacity * sizeof(uint64_t));
+            if (hashes == NULL) {
+                fclose(file);
+                return PASSGEN_NO_MEMORY;
+            }
+            context->breached = hashes;
+        }
+        context->breached[context->breached_count++] = siphash24(context->key, line, length);
+    }
+    bool failed = ferror(file) != 0;
+    fclose(file);
+
+    qsort(context->breached, context->breached_count, sizeof(uint64_t), compare_hashes);
+    size_t unique = 0;
+    for (size_t i = 0; i < context->breached_count; i++) {
+        if (unique == 0 || context->breached[i] != context->breached[unique - 1]) {
+            context->breached[unique++] = context->breached[i];
+        }
+    }
+    context->breached_count = unique;
+    context->checked = context->checked || unique > 0;
+    return failed ? PASSGEN_IO_ERROR : PASSGEN_OK;
+}
+
+void passgen_context_destroy(PassgenContext *context) {
+    if (context == NULL) {
+        return;
+    }
+    free(context->filter.words[0]);
+    free(context->filter.words[1]);
+    free(context->breached);
+    memset(context->key, 0, sizeof(context->key));
+    free(context);
+}
+
+void passgen_context_stats(const PassgenContext *context, PassgenStats *stats) {
+    stats->passwords = __atomic_load_n(&context->stats.passwords, __ATOMIC_RELAXED);
+    stats->class_rejections = __atomic_load_n(&context->stats.class_rejections, __ATOMIC_RELAXED);
+    stats->duplicate_rejections = __atomic_load_n(&context->stats.duplicate_rejections, __ATOMIC_RELAXED);
+    stats->breach_rejections = __atomic_load_n(&context->stats.breach_rejections, __ATOMIC_RELAXED);
+    stats->policy_rejections = __atomic_load_n(&context->stats.policy_rejections, __ATOMIC_RELAXED);
+    stats->deadline_expirations = __atomic_load_n(&context->stats.deadline_expirations, __ATOMIC_RELAXED);
+    stats->identifiers = __atomic_load_n(&context->stats.identifiers, __ATOMIC_RELAXED);
+    stats->random_bytes = __atomic_load_n(&context->stats.random_bytes, __ATOMIC_RELAXED);
+}
+
+PassgenStatus passgen_validate(const PassgenContext *context, char type, unsigned int length) {
+    const IdentifierFormat *format = identifier_lookup(type);
+    if (format != NULL) {
+        return length == format->length ? PASSGEN_OK : PASSGEN_BAD_LENGTH;
+    }
+    if (codec_is_random_bytes(type)) {
+        return length >= MIN_RANDOM_BYTES_LENGTH && length <= MAX_PASSWORD_LENGTH ? PASSGEN_OK : PASSGEN_BAD_LENGTH;
+    }
+    const Generator *generator = generator_lookup(type);
+    if (generator == NULL) {
+        return PASSGEN_BAD_TYPE;
+    }
+    if (length < MIN_PASSWORD_LENGTH || length > MAX_PASSWORD_LENGTH) {
+        return PASSGEN_BAD_LENGTH;
+    }
+    if (context->entropy[generator->type][length] < context->policy.min_entropy_bits) {
+        return PASSGEN_POLICY_REJECTED;
+    }
+    return PASSGEN_OK;
+}
+
+bool passgen_is_breached(const PassgenContext *context, const char *password, size_t length) {
+    return context->breached_count > 0 && breached_contains(context, siphash24(context->key, password, length));
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CONTEXT - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - ENTROPY - - - - - - - - - - - - - - - - - - - - */
+
+double passgen_entropy_bits(const PassgenContext *context, char type, unsigned int length) {
+    const Generator *generator = generator_lookup(type);
+    if (generator == NULL || length < MIN_PASSWORD_LENGTH || length > MAX_PASSWORD_LENGTH) {
+        return -1;
+    }
+    if (context != NULL) {
+        return context->entropy[generator->type][length];
+    }
+    return compute_entropy(generator, length, false);
+}
+
+double passgen_estimate_entropy(const char *password, size_t length) {
+    static const uint32_t class_sizes[CLASS_COUNT] = { 26, 26, 10, 33 };	/**< Printable ASCII symbols */
+    uint8_t mask = class_mask(password, length);
+    uint32_t pool = 0;
+    for (unsigned int c = 0; c < CLASS_COUNT; c++) {
+        pool += (mask >> c & 1) ? class_sizes[c] : 0;
+    }
+    return pool > 0 ? length * log2((double)pool) : 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END ENTROPY - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - ENGINE - - - - - - - - - - - - - - - - - - - - */
+
+PassgenStatus passgen_engine_create(PassgenContext *context, PassgenEngine **engine) {
+#if defined WIN32
+    PassgenEngine *created = _aligned_malloc(sizeof(PassgenEngine), _Alignof(PassgenEngine));
+#else
+    PassgenEngine *created = aligned_alloc(_Alignof(PassgenEngine), sizeof(PassgenEngine));
+#endif
+    if (created == NULL) {
+        return PASSGEN_NO_MEMORY;
+    }
+    created->context = context;
+    created->deadline_ns = 0;
+    identifier_state_init(&created->identifiers, context->node);
+    if (!random_stream_init(&created->stream)) {
+        passgen_engine_destroy(created);
+        return PASSGEN_NO_ENTROPY;
+    }
+    template_cache_init(&created->templates, &created->stream);
+    *engine = created;
+    return PASSGEN_OK;
+}
+
+void passgen_engine_destroy(PassgenEngine *engine) {
+    if (engine == NULL) {
+        return;
+    }
+    volatile unsigned char *state = (volatile unsigned char *)&engine->stream;
+    for (size_t i = 0; i < sizeof(engine->stream); i++) {
+        state[i] = 0;		/**< Do not leave the key and the unread keystream in freed memory */
+    }
+#if defined WIN32
+    _aligned_free(engine);
+#else
+    free(engine);
+#endif
+}
+
+PassgenContext *passgen_engine_context(const PassgenEngine *engine) {
+    return engine->context;
+}
+
+void passgen_engine_set_deadline(PassgenEngine *engine, uint64_t deadline_ns) {
+    engine->deadline_ns = deadline_ns;
+}
+
+/**
+ * @brief Tells whether the deadline of the engine has passed.
+ */
+static inline bool deadline_passed(const PassgenEngine *engine) {
+    return engine->deadline_ns != 0 && clock_now_ns() >= engine->deadline_ns;
+}
+
+/**
+ * @brief Checks a drawn password against the breached set and the uniqueness filter, entering it in the latter.
+ * @param[in,out] stats Counters of the current call.
+ * @return `false` if the password must be drawn again.
+ */
+static bool accept_password(PassgenContext *context, const char *password, unsigned int length,
+                            PassgenStats *stats) {
+    if (context->breached_count == 0 && !context->policy.unique) {
+        return true;
+    }
+    uint64_t hash = siphash24(context->key, password, length);
+    if (context->breached_count > 0 && breached_contains(context, hash)) {
+        stats->breach_rejections++;
+        return false;
+    }
+    if (context->policy.unique) {
+        if (!unique_filter_insert(&context->filter, (uint32_t)hash)) {
+            stats->duplicate_rejections++;
+            return false;
+        }
+        if (context->observer != NULL) {
+            context->observer(context->observer_argument, (uint32_t)hash);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Draws passwords until one satisfies the policy.
+ * @param[in,out] stats Counters of the current call, added to the context by the caller.
+ */
+static PassgenStatus draw_checked(PassgenEngine *engine, const Generator *generator, unsigned int length,
+                                  char *password, PassgenStats *stats) {
+    PassgenContext *context = engine->context;
+    uint8_t required = context->required_classes[generator->type];
+
+    for (unsigned int attempt = 0; attempt < PASSGEN_MAX_ATTEMPTS; attempt++) {
+        generator_fill(generator, password, (int)length, &engine->stream);
+        if (required != 0 && class_mask(password, length) != required) {
+            stats->class_rejections++;
+            continue;
+        }
+        if (accept_password(context, password, length, stats)) {
+            return PASSGEN_OK;
+        }
+    }
+    return PASSGEN_EXHAUSTED;
+}
+
+static void publish_stats(PassgenContext *context, const PassgenStats *stats) {
+    if (stats->passwords > 0) {
+        __atomic_fetch_add(&context->stats.passwords, stats->passwords, __ATOMIC_RELAXED);
+    }
+    if (stats->identifiers > 0) {
+        __atomic_fetch_add(&context->stats.identifiers, stats->identifiers, __ATOMIC_RELAXED);
+    }
+    if (stats->random_bytes > 0) {
+        __atomic_fetch_add(&context->stats.random_bytes, stats->random_bytes, __ATOMIC_RELAXED);
+    }
+    if (stats->class_rejections > 0) {
+        __atomic_fetch_add(&context->stats.class_rejections, stats->class_rejections, __ATOMIC_RELAXED);
+    }
+    if (stats->duplicate_rejections > 0) {
+        __atomic_fetch_add(&context->stats.duplicate_rejections, stats->duplicate_rejections, __ATOMIC_RELAXED);
+    }
+    if (stats->breach_rejections > 0) {
+        __atomic_fetch_add(&context->stats.breach_rejections, stats->breach_rejections, __ATOMIC_RELAXED);
+    }
+    if (stats->policy_rejections > 0) {
+        __atomic_fetch_add(&context->stats.policy_rejections, stats->policy_rejections, __ATOMIC_RELAXED);
+    }
+    if (stats->deadline_expirations > 0) {
+        __atomic_fetch_add(&context->stats.deadline_expirations, stats->deadline_expirations, __ATOMIC_RELAXED);
+    }
+}
+
+PassgenStatus passgen_generate_batch(PassgenEngine *engine, char type, unsigned int length, size_t count, char *passwords) {
+    PassgenContext *context = engine->context;
+    PassgenStatus status = passgen_validate(context, type, length);
+    if (status == PASSGEN_OK && count == 0) {
+        status = PASSGEN_BAD_COUNT;
+    }
+    if (status != PASSGEN_OK) {
+        if (status == PASSGEN_POLICY_REJECTED) {
+            __atomic_fetch_add(&context->stats.policy_rejections, 1, __ATOMIC_RELAXED);
+        }
+        return status;
+    }
+
+    PassgenStats stats = { 0 };
+    const IdentifierFormat *format = identifier_lookup(type);
+    if (format != NULL || codec_is_random_bytes(type)) {
+        /* A few nanoseconds per identifier or per block of bytes: one look at the clock for the whole batch */
+        if (deadline_passed(engine)) {
+            stats.deadline_expirations++;
+            status = PASSGEN_DEADLINE_EXCEEDED;
+        } else if (format != NULL) {
+            identifier_fill(&engine->identifiers, format, passwords, count, &engine->stream);
+            stats.identifiers = count;
+        } else {
+            /* Straight from the keystream buffer to the destination, wiped behind */
+            random_stream_bytes(&engine->stream, passwords, count * length);
+            stats.random_bytes = count * length;
+        }
+        publish_stats(context, &stats);
+        return status;
+    }
+
+    const Generator *generator = generator_lookup(type);
+    for (size_t done = 0; done < count && status == PASSGEN_OK; ) {
+        /* The clock is read once per block: before the first draw, then between blocks */
+        if (deadline_passed(engine)) {
+            stats.deadline_expirations++;
+            status = PASSGEN_DEADLINE_EXCEEDED;
+            break;
+        }
+        size_t end = count - done > PASSGEN_DEADLINE_CHECK_INTERVAL ? done + PASSGEN_DEADLINE_CHECK_INTERVAL : count;
+        if (!context->checked) {
+            /* Nothing to check: the length-specialised function fills every password in place */
+            for (size_t i = done; i < end; i++) {
+                generator_fill(generator, passwords + i * length, (int)length, &engine->stream);
+            }
+            stats.passwords += end - done;
+        } else {
+            for (size_t i = done; i < end && status == PASSGEN_OK; i++) {
+                status = draw_checked(engine, generator, length, passwords + i * length, &stats);
+                stats.passwords += status == PASSGEN_OK;
+            }
+        }
+        done = end;
+    }
+    publish_stats(context, &stats);
+    return status;
+}
+
+PassgenStatus passgen_generate_template(PassgenEngine *engine, const char *text, size_t size, unsigned int length,
+                                        size_t count, char *passwords) {
+    PassgenContext *context = engine->context;
+    const TemplateProgram *program = template_cache_lookup(&engine->templates, text, size);
+    if (program == NULL) {
+        return PASSGEN_BAD_TEMPLATE;
+    }
+    if (length != program->length) {
+        return PASSGEN_BAD_LENGTH;
+    }
+    if (count == 0) {
+        return PASSGEN_BAD_COUNT;
+    }
+    if (program->entropy_bits < context->policy.min_entropy_bits) {
+        __atomic_fetch_add(&context->stats.policy_rejections, 1, __ATOMIC_RELAXED);
+        return PASSGEN_POLICY_REJECTED;
+    }
+
+    /* The character classes are the template's business: only the breached set and the uniqueness filter apply */
+    bool checked = context->breached_count > 0 || context->policy.unique;
+    PassgenStats stats = { 0 };
+    PassgenStatus status = PASSGEN_OK;
+    for (size_t done = 0; done < count && status == PASSGEN_OK; ) {
+        if (deadline_passed(engine)) {
+            stats.deadline_expirations++;
+            status = PASSGEN_DEADLINE_EXCEEDED;
+            break;
+        }
+        size_t end = count - done > PASSGEN_DEADLINE_CHECK_INTERVAL ? done + PASSGEN_DEADLINE_CHECK_INTERVAL : count;
+        if (!checked) {
+            template_run(program, passwords + done * length, end - done, &engine->stream);
+            stats.passwords += end - done;
+        } else {
+            for (size_t i = done; i < end && status == PASSGEN_OK; i++) {
+                char *password = passwords + i * length;
+                status = PASSGEN_EXHAUSTED;
+                for (unsigned int attempt = 0; attempt < PASSGEN_MAX_ATTEMPTS && status != PASSGEN_OK; attempt++) {
+                    template_run(program, password, 1, &engine->stream);
+                    status = accept_password(context, password, length, &stats) ? PASSGEN_OK : PASSGEN_EXHAUSTED;
+                }
+                stats.passwords += status == PASSGEN_OK;
+            }
+        }
+        done = end;
+    }
+    publish_stats(context, &stats);
+    return status;
+}
+
+PassgenStatus passgen_generate(PassgenEngine *engine, char type, unsigned int length, char *password) {
+    PassgenStatus status = passgen_generate_batch(engine, type, length, 1, password);
+    password[status == PASSGEN_OK ? length : 0] = '\0';
+    return status;
+}
+
+size_t passgen_engine_respond(PassgenEngine *engine, const unsigned char *request, size_t request_size,
+                              unsigned char *response, size_t capacity) {
+    RequestView view;
+    if (codec_decode_request(request, request_size, &view) != CODEC_OK || view.operation != OP_GENERATE) {
+        return codec_encode_response(response, capacity, &view, STATUS_BAD_REQUEST, 0);
+    }
+
+    uint16_t count = codec_response_count(&view);
+    size_t response_size = codec_encode_response(response, capacity, &view, STATUS_OK, count);
+    if (response_size == 0) {
+        return 0;
+    }
+    /* The passwords of a response are contiguous, in the compact and in the legacy layout */
+    char *passwords = codec_response_password(response, &view, 0);
+    PassgenStatus status = codec_is_template(view.type)
+        ? passgen_generate_template(engine, (const char *)view.body, view.body_size, view.length, count, passwords)
+        : passgen_generate_batch(engine, view.type, view.length, count, passwords);
+    switch (status) {
+        case PASSGEN_OK:
+            return response_size;
+        case PASSGEN_EXHAUSTED:
+            return codec_encode_response(response, capacity, &view, STATUS_UNAVAILABLE, 0);
+        case PASSGEN_DEADLINE_EXCEEDED:
+            return codec_encode_response(response, capacity, &view, STATUS_DEADLINE_EXCEEDED, 0);
+        default:
+            return codec_encode_response(response, capacity, &view, STATUS_BAD_REQUEST, 0);
+    }
+}
+
+const char *passgen_status_message(PassgenStatus status) {
+    switch (status) {
+        case PASSGEN_OK:				return "success";
+        case PASSGEN_BAD_TYPE:			return "invalid password type";
+        case PASSGEN_BAD_LENGTH:		return "password length out of range";
+        case PASSGEN_BAD_COUNT:			return "no password requested";
+        case PASSGEN_POLICY_REJECTED:	return "rejected by the password policy";
+        case PASSGEN_EXHAUSTED:			return "no password satisfying the policy could be generated";
+        case PASSGEN_NO_MEMORY:			return "out of memory";
+        case PASSGEN_NO_ENTROPY:		return "no entropy source available";
+        case PASSGEN_IO_ERROR:			return "cannot read the file";
+        case PASSGEN_DEADLINE_EXCEEDED:	return "the deadline passed before the passwords were generated";
+        case PASSGEN_BAD_TEMPLATE:		return "invalid template";
+    }
+    return "unknown status";
+}
+
+/* - - - - - - - - - - - - - - - - - - - END ENGINE - - - - - - - - - - - - - - - - - - - */
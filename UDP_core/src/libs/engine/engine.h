@@ -0,0 +1,339 @@
+/**
+ * @file engine.h
+ * @brief Stable C API embedding the password service in-process.
+ *
+ * The API exposes the same pipeline as the network server: request
+ * validation, the generation policy, the uniqueness filter, the breached
+ * password check and batch generation, plus entropy estimates. The server is
+ * itself built on this API, so a password generated in-process and one
+ * received over UDP or TCP go through exactly the same code.
+ *
+ * Two objects are involved:
+ * - a `PassgenContext` holds what is shared: the policy, the uniqueness filter
+ *   and the breached password set. It is created once and may be used by any
+ *   number of threads at the same time;
+ * - a `PassgenEngine` is a per-thread handle on a context, with its own
+ *   CSPRNG. An engine must only be used by one thread at a time.
+ *
+ * The same calls also hand out unique identifiers (UUIDv4, UUIDv7, ULID and
+ * Snowflake IDs, see `libs/identifier`): a request naming an identifier type
+ * with the length of its text gets identifiers instead of passwords. The
+ * policy does not apply to them; the time-ordered ones are monotonic within
+ * an engine. Likewise a request for raw random bytes (`RANDOM_BYTES_TYPE`)
+ * gets bytes of the engine's CSPRNG keystream, copied once, from the keystream
+ * buffer to their place in the caller's buffer. Passwords can also follow a
+ * template such as `Cvc-9999-XX` (see `libs/template`), compiled once per
+ * engine and then only looked up.
+ *
+ * The header only depends on the C standard library and can be included from
+ * C++ (see `engine.hpp` for a RAII wrapper). Its types are opaque, so new
+ * fields can be added without breaking the callers.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef ENGINE_H_
+#define ENGINE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define PASSGEN_API_VERSION 1					/**< Incremented on incompatible changes */
+#define PASSGEN_MAX_ATTEMPTS 64					/**< Draws per password before the policy gives up */
+#define PASSGEN_DEFAULT_UNIQUE_CAPACITY (1u << 20)	/**< Passwords remembered by the uniqueness filter */
+#define PASSGEN_DEADLINE_CHECK_INTERVAL 32			/**< Passwords generated between two looks at the clock */
+
+/**
+ * @enum PassgenStatus
+ * @brief Result of an engine call.
+ */
+typedef enum {
+    PASSGEN_OK,					/**< Success */
+    PASSGEN_BAD_TYPE,			/**< Unknown password type */
+    PASSGEN_BAD_LENGTH,			/**< Length outside of [MIN_PASSWORD_LENGTH, MAX_PASSWORD_LENGTH] */
+    PASSGEN_BAD_COUNT,			/**< Zero passwords requested */
+    PASSGEN_POLICY_REJECTED,	/**< The type and length cannot satisfy the policy (e.g. too little entropy) */
+    PASSGEN_EXHAUSTED,			/**< No acceptable password found in `PASSGEN_MAX_ATTEMPTS` draws */
+    PASSGEN_NO_MEMORY,			/**< Allocation failure */
+    PASSGEN_NO_ENTROPY,			/**< The operating system provided no entropy */
+    PASSGEN_IO_ERROR,			/**< A file could not be read */
+    PASSGEN_DEADLINE_EXCEEDED,	/**< The deadline of the engine passed before the passwords were generated */
+    PASSGEN_BAD_TEMPLATE		/**< The template does not compile */
+} PassgenStatus;
+
+/**
+ * @struct PassgenPolicy
+ * @brief Rules every generated password must follow.
+ */
+typedef struct {
+    double min_entropy_bits;	/**< Requests whose passwords would carry less entropy are rejected, 0 for no minimum */
+    bool require_every_class;	/**< Every character class of the alphabet (lower, upper, digit, symbol) appears */
+    bool unique;				/**< No password is handed out twice among the last `unique_capacity` */
+    size_t unique_capacity;		/**< Passwords remembered by the uniqueness filter */
+} PassgenPolicy;
+
+/**
+ * @struct PassgenStats
+ * @brief Counters of a context, summed over all its engines.
+ */
+typedef struct {
+    uint64_t passwords;				/**< Passwords handed out */
+    uint64_t class_rejections;		/**< Draws discarded for missing a character class */
+    uint64_t duplicate_rejections;	/**< Draws discarded by the uniqueness filter */
+    uint64_t breach_rejections;		/**< Draws discarded for being in the breached set */
+    uint64_t policy_rejections;		/**< Requests rejected by the policy */
+    uint64_t deadline_expirations;	/**< Generations abandoned because their deadline passed */
+    uint64_t identifiers;			/**< Identifiers handed out */
+    uint64_t random_bytes;			/**< Raw random bytes handed out */
+} PassgenStats;
+
+/**
+ * @brief Receives the fingerprint of every password the uniqueness filter lets through.
+ * @details Called on the thread of the engine that drew the password, before it is handed out.
+ * @param[in] argument The argument given to `passgen_context_observe`.
+ * @param[in] fingerprint 32 bits of the keyed hash of the password.
+ */
+typedef void (*PassgenIssueObserver)(void *argument, uint32_t fingerprint);
+
+typedef struct PassgenContext PassgenContext;	/**< Shared state, thread-safe */
+typedef struct PassgenEngine PassgenEngine;		/**< Per-thread handle */
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - CONTEXT - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Fills a policy with the defaults: no minimum, no class requirement, no uniqueness filter.
+ * @param[out] policy The policy.
+ */
+void passgen_policy_default(PassgenPolicy *policy);
+
+/**
+ * @brief Creates a context.
+ * @param[in] policy The policy, `NULL` for the defaults.
+ * @param[out] context Receives the context.
+ * @return `PASSGEN_OK`, `PASSGEN_NO_MEMORY` or `PASSGEN_NO_ENTROPY`.
+ */
+PassgenStatus passgen_context_create(const PassgenPolicy *policy, PassgenContext **context);
+
+/**
+ * @brief Replaces the random key of the password hashes.
+ * @details Contexts sharing a key give a password the same fingerprint, so that they can
+ * exchange the fingerprints of their uniqueness filters (see `passgen_context_remember`).
+ * @param[in,out] context The context, before the breached passwords are loaded and before any engine uses it.
+ * @param[in] key The key, 16 bytes.
+ */
+void passgen_context_set_key(PassgenContext *context, const unsigned char *key);
+
+/**
+ * @brief Sets the node number written in the Snowflake IDs of the engines of a context.
+ * @details Processes sharing a node number may hand out the same Snowflake IDs; the
+ * engines of one process are told apart by their worker number.
+ * @param[in,out] context The context, before any engine is created on it.
+ * @param[in] node The node number, 0 to 15 (0 by default).
+ */
+void passgen_context_set_node(PassgenContext *context, unsigned int node);
+
+/**
+ * @brief Registers the function told about every password entering the uniqueness filter.
+ * @param[in,out] context The context, before any engine uses it.
+ * @param[in] observer The function, `NULL` for none; it must be thread-safe if engines run on several threads.
+ * @param[in] argument Passed to `observer`.
+ */
+void passgen_context_observe(PassgenContext *context, PassgenIssueObserver observer, void *argument);
+
+/**
+ * @brief Enters the fingerprint of a password issued elsewhere in the uniqueness filter.
+ * @details The engines then discard the password as if they had issued it themselves.
+ * @param[in,out] context The context, with a key shared with the issuer.
+ * @param[in] fingerprint The fingerprint, as given to the issuer's observer.
+ * @return `false` if the fingerprint was (probably) remembered already, `true` otherwise
+ *         and when the policy does not ask for unique passwords.
+ */
+bool passgen_context_remember(PassgenContext *context, uint32_t fingerprint);
+
+/**
+ * @brief Loads a list of breached passwords, one per line; generated passwords found in it are discarded.
+ * @param[in,out] context The context, before any engine uses it.
+ * @param[in] path The file to read.
+ * @return `PASSGEN_OK`, `PASSGEN_IO_ERROR` or `PASSGEN_NO_MEMORY`.
+ */
+PassgenStatus passgen_context_load_breached(PassgenContext *context, const char *path);
+
+/**
+ * @brief Destroys a context. Its engines must have been destroyed first.
+ * @param[in] context The context, may be `NULL`.
+ */
+void passgen_context_destroy(PassgenContext *context);
+
+/**
+ * @brief Reads the counters of a context.
+ * @param[in] context The context.
+ * @param[out] stats The counters.
+ */
+void passgen_context_stats(const PassgenContext *context, PassgenStats *stats);
+
+/**
+ * @brief Checks a type and length against the protocol limits and the policy.
+ * @details An identifier type is only checked against the length of its text, random bytes
+ * against `MIN_RANDOM_BYTES_LENGTH` and `MAX_PASSWORD_LENGTH`.
+ * @param[in] context The context.
+ * @param[in] type Password type ('n', 'a', 'm', 's', 'u'), identifier type ('r', 't', 'l', 'f')
+ *                 or random bytes ('b'), either case.
+ * @param[in] length Password length.
+ * @return `PASSGEN_OK`, `PASSGEN_BAD_TYPE`, `PASSGEN_BAD_LENGTH` or `PASSGEN_POLICY_REJECTED`.
+ */
+PassgenStatus passgen_validate(const PassgenContext *context, char type, unsigned int length);
+
+/**
+ * @brief Tells whether a password is in the breached set of a context.
+ * @param[in] context The context.
+ * @param[in] password The password (not necessarily terminated).
+ * @param[in] length Length of the password.
+ * @return `true` if the password is known to be breached.
+ */
+bool passgen_is_breached(const PassgenContext *context, const char *password, size_t length);
+
+/* - - - - - - - - - - - - - - - - - - - END CONTEXT - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - ENTROPY - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Exact entropy of a generated password.
+ * @details With `require_every_class` the passwords missing a class are excluded from the
+ * count of possible passwords, which lowers the entropy slightly.
+ * @param[in] context The context whose policy applies, `NULL` for no policy.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @return The entropy in bits, or a negative value for an invalid type or length.
+ */
+double passgen_entropy_bits(const PassgenContext *context, char type, unsigned int length);
+
+/**
+ * @brief Estimates the entropy of an arbitrary password from the character classes it uses.
+ * @details The estimate assumes every character was drawn uniformly from the union of the
+ * classes present; it is an upper bound for human-chosen passwords.
+ * @param[in] password The password.
+ * @param[in] length Length of the password.
+ * @return The estimate in bits.
+ */
+double passgen_estimate_entropy(const char *password, size_t length);
+
+/* - - - - - - - - - - - - - - - - - - - END ENTROPY - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - ENGINE - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Creates a per-thread engine on a context.
+ * @param[in] context The context.
+ * @param[out] engine Receives the engine.
+ * @return `PASSGEN_OK`, `PASSGEN_NO_MEMORY` or `PASSGEN_NO_ENTROPY`.
+ */
+PassgenStatus passgen_engine_create(PassgenContext *context, PassgenEngine **engine);
+
+/**
+ * @brief Destroys an engine, wiping its CSPRNG state.
+ * @param[in] engine The engine, may be `NULL`.
+ */
+void passgen_engine_destroy(PassgenEngine *engine);
+
+/**
+ * @brief Returns the context an engine was created on.
+ * @param[in] engine The engine.
+ * @return The context.
+ */
+PassgenContext *passgen_engine_context(const PassgenEngine *engine);
+
+/**
+ * @brief Sets the time after which the engine abandons a generation.
+ * @details The clock is looked at before a generation starts and then every
+ * `PASSGEN_DEADLINE_CHECK_INTERVAL` passwords, so that a large batch or a policy that
+ * hashes every draw stops soon after the deadline with `PASSGEN_DEADLINE_EXCEEDED`.
+ * The deadline stays in force until it is changed.
+ * @param[in,out] engine The engine.
+ * @param[in] deadline_ns Monotonic time (`clock_now_ns`), 0 for no deadline.
+ */
+void passgen_engine_set_deadline(PassgenEngine *engine, uint64_t deadline_ns);
+
+/**
+ * @brief Generates one null-terminated password.
+ * @param[in,out] engine The engine.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[out] password Buffer of at least `length + 1` characters.
+ * @return `PASSGEN_OK` or the reason of the failure.
+ */
+PassgenStatus passgen_generate(PassgenEngine *engine, char type, unsigned int length, char *password);
+
+/**
+ * @brief Generates passwords back to back, without terminators.
+ * @details For an identifier type, `count` identifiers strictly increasing within the
+ * engine (UUIDv4 aside), the clock being read once for the whole batch.
+ * @param[in,out] engine The engine.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[in] count Number of passwords.
+ * @param[out] passwords Buffer of at least `count * length` characters.
+ * @return `PASSGEN_OK` or the reason of the failure (the buffer content is then unspecified).
+ */
+PassgenStatus passgen_generate_batch(PassgenEngine *engine, char type, unsigned int length, size_t count, char *passwords);
+
+/**
+ * @brief Generates passwords following a template, back to back, without terminators.
+ * @details The template is compiled on its first use and its program cached by the
+ * engine. The policy applies, except for `require_every_class`: the entropy of the
+ * template must reach the minimum, and the breached set and the uniqueness filter
+ * are checked as for the other types.
+ * @param[in,out] engine The engine.
+ * @param[in] text The template (see `libs/template`), not necessarily terminated.
+ * @param[in] size Size of `text`, at most `TEMPLATE_MAX_SIZE`.
+ * @param[in] length Length of the passwords of the template.
+ * @param[in] count Number of passwords.
+ * @param[out] passwords Buffer of at least `count * length` characters.
+ * @return `PASSGEN_OK`, `PASSGEN_BAD_TEMPLATE` or another reason of the failure.
+ */
+PassgenStatus passgen_generate_template(PassgenEngine *engine, const char *text, size_t size, unsigned int length,
+                                        size_t count, char *passwords);
+
+/**
+ * @brief Answers a wire-format generation request, as the server does.
+ * @details Compact and legacy requests are accepted; invalid requests and requests
+ * rejected by the policy get a `STATUS_BAD_REQUEST` answer, a generation that
+ * overruns the engine deadline a `STATUS_DEADLINE_EXCEEDED` one. The deadline field
+ * of the request is relative to its reception, which only the caller knows: it is
+ * applied through `passgen_engine_set_deadline`. The answer is never packed: a
+ * request with `REQUEST_FLAG_PACKED` gets the larger count of a packed answer, in
+ * up to `MAX_UNPACKED_RESPONSE_SIZE` bytes, which `codec_pack_response` then packs.
+ * @param[in,out] engine The engine.
+ * @param[in] request The raw request.
+ * @param[in] request_size Size of the request.
+ * @param[out] response Buffer receiving the response.
+ * @param[in] capacity Size of `response`.
+ * @return The size of the response, 0 if nothing can be answered.
+ */
+size_t passgen_engine_respond(PassgenEngine *engine, const unsigned char *request, size_t request_size,
+                              unsigned char *response, size_t capacity);
+
+/**
+ * @brief Returns a human-readable description of a status.
+ * @param[in] status The status.
+ * @return A static string.
+ */
+const char *passgen_status_message(PassgenStatus status);
+
+/* - - - - - - - - - - - - - - - - - - - END ENGINE - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* ENGINE_H_ */
@@ -0,0 +1,180 @@
+/**
+ * @file engine.hpp
+ * @brief Header-only C++ wrapper of the embedding API (`engine.h`).
+ *
+ * `passgen::Context` and `passgen::Engine` own the C handles and release them
+ * in their destructors; failures are reported as `passgen::Error` exceptions.
+ * One context is shared by the whole program, one engine is created per thread:
+ *
+ * @code
+ * passgen::Context context;                       // default policy
+ * thread_local passgen::Engine engine(context);
+ * std::string password = engine.generate('s', 16);
+ * @endcode
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef ENGINE_HPP_
+#define ENGINE_HPP_
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "engine.h"
+
+namespace passgen {
+
+/**
+ * @class Error
+ * @brief Exception carrying the status of a failed call.
+ */
+class Error : public std::runtime_error {
+public:
+    explicit Error(PassgenStatus status) : std::runtime_error(passgen_status_message(status)), status_(status) {}
+
+    PassgenStatus status() const noexcept { return status_; }
+
+private:
+    PassgenStatus status_;
+};
+
+inline void check(PassgenStatus status) {
+    if (status != PASSGEN_OK) {
+        throw Error(status);
+    }
+}
+
+/**
+ * @class Policy
+ * @brief `PassgenPolicy` initialised with the defaults.
+ */
+struct Policy : PassgenPolicy {
+    Policy() noexcept { passgen_policy_default(this); }
+};
+
+/**
+ * @class Context
+ * @brief Shared state, usable from any number of threads.
+ */
+class Context {
+public:
+    explicit Context(const PassgenPolicy &policy = Policy()) { check(passgen_context_create(&policy, &handle_)); }
+    ~Context() { passgen_context_destroy(handle_); }
+
+    Context(const Context &) = delete;
+    Context &operator=(const Context &) = delete;
+    Context(Context &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Context &operator=(Context &&other) noexcept {
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+
+    /** Shares the key of the password hashes with other contexts; must be called before `load_breached`. */
+    void set_key(const unsigned char *key) noexcept { passgen_context_set_key(handle_, key); }
+
+    /** Sets the node number of the Snowflake IDs; must be called before any engine is created. */
+    void set_node(unsigned int node) noexcept { passgen_context_set_node(handle_, node); }
+
+    /** Enters the fingerprint of a password issued by a context sharing the key. */
+    bool remember(uint32_t fingerprint) noexcept { return passgen_context_remember(handle_, fingerprint); }
+
+    /** Loads a breached password list; must be called before any engine is created. */
+    void load_breached(const std::string &path) { check(passgen_context_load_breached(handle_, path.c_str())); }
+
+    bool is_breached(std::string_view password) const {
+        return passgen_is_breached(handle_, password.data(), password.size());
+    }
+
+    PassgenStatus validate(char type, unsigned int length) const { return passgen_validate(handle_, type, length); }
+
+    double entropy_bits(char type, unsigned int length) const { return passgen_entropy_bits(handle_, type, length); }
+
+    PassgenStats stats() const {
+        PassgenStats stats;
+        passgen_context_stats(handle_, &stats);
+        return stats;
+    }
+
+    PassgenContext *get() const noexcept { return handle_; }
+
+private:
+    PassgenContext *handle_ = nullptr;
+};
+
+/**
+ * @class Engine
+ * @brief Per-thread generator bound to a context, which must outlive it.
+ */
+class Engine {
+public:
+    explicit Engine(Context &context) { check(passgen_engine_create(context.get(), &handle_)); }
+    ~Engine() { passgen_engine_destroy(handle_); }
+
+    Engine(const Engine &) = delete;
+    Engine &operator=(const Engine &) = delete;
+    Engine(Engine &&other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    Engine &operator=(Engine &&other) noexcept {
+        std::swap(handle_, other.handle_);
+        return *this;
+    }
+
+    std::string generate(char type, unsigned int length) {
+        std::string password(length, '\0');
+        check(passgen_generate_batch(handle_, type, length, 1, password.data()));
+        return password;
+    }
+
+    /** Generates `count` passwords into one buffer, `length` characters each, without separators. */
+    std::string generate_batch(char type, unsigned int length, size_t count) {
+        std::string passwords(length * count, '\0');
+        check(passgen_generate_batch(handle_, type, length, count, passwords.data()));
+        return passwords;
+    }
+
+    /** Generates `count` passwords following a template into one buffer, without separators. */
+    std::string generate_template(std::string_view text, unsigned int length, size_t count = 1) {
+        std::string passwords(length * count, '\0');
+        check(passgen_generate_template(handle_, text.data(), text.size(), length, count, passwords.data()));
+        return passwords;
+    }
+
+    std::vector<std::string> generate_list(char type, unsigned int length, size_t count) {
+        std::string passwords = generate_batch(type, length, count);
+        std::vector<std::string> list;
+        list.reserve(count);
+        for (size_t i = 0; i < count; i++) {
+            list.emplace_back(passwords, i * length, length);
+        }
+        return list;
+    }
+
+    /** Abandons the generations still running at `deadline_ns` (monotonic clock), 0 for never. */
+    void set_deadline(uint64_t deadline_ns) noexcept { passgen_engine_set_deadline(handle_, deadline_ns); }
+
+    size_t respond(const unsigned char *request, size_t request_size, unsigned char *response, size_t capacity) {
+        return passgen_engine_respond(handle_, request, request_size, response, capacity);
+    }
+
+    PassgenEngine *get() const noexcept { return handle_; }
+
+private:
+    PassgenEngine *handle_ = nullptr;
+};
+
+/** Entropy of a password type and length without any policy. */
+inline double entropy_bits(char type, unsigned int length) { return passgen_entropy_bits(nullptr, type, length); }
+
+/** Class-based entropy estimate of an arbitrary password. */
+inline double estimate_entropy(std::string_view password) {
+    return passgen_estimate_entropy(password.data(), password.size());
+}
+
+} // namespace passgen
+
+#endif /* ENGINE_HPP_ */
@@ -0,0 +1,157 @@
+/**
+ * @file generator.c
+ * @brief Implementation of the table-driven password generation engine.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stddef.h>
+#include "generator.h"
+
+/* - - - - - - - - - - - - - - - - - - - - ALPHABETS - - - - - - - - - - - - - - - - - - - - */
+
+static const char numeric_alphabet[] = "0123456789";
+static const char alpha_alphabet[] = "abcdefghijklmnopqrstuvwxyz";
+static const char mixed_alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+static const char secure_alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%^&*()";
+static const char unambiguous_alphabet[] = "abcdefghjkmnpqrtuvwxyACDEFGHJKLMNPQRTUVWXY34679!@#$%^&*()";
+
+/* - - - - - - - - - - - - - - - - - - - END ALPHABETS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - KERNELS - - - - - - - - - - - - - - - - - - - - */
+
+#define GENERATOR_CHUNK 32	/**< Largest number of characters drawn with a single `random_stream_take` */
+
+/**
+ * @brief Slow path: replaces the characters whose random draw was biased.
+ *
+ * Called with the same random bytes used by `fill_characters`, before any
+ * other byte is taken from the stream, so that it can find the rejected
+ * positions again. It runs for less than 1% of the passwords.
+ */
+static __attribute__((noinline)) void redraw_rejected(char *output, const char *alphabet, uint32_t size, int length,
+                                                      const unsigned char *bytes, RandomStream *stream) {
+    const uint32_t threshold = (65536u - size) % size;
+    int rejected[GENERATOR_CHUNK];
+    int rejected_count = 0;
+
+    for (int i = 0; i < length; i++) {
+        uint32_t product = ((uint32_t)bytes[2 * i] | (uint32_t)bytes[2 * i + 1] << 8) * size;
+        if ((product & 0xFFFF) < threshold) {
+            rejected[rejected_count++] = i;
+        }
+    }
+    for (int i = 0; i < rejected_count; i++) {
+        output[rejected[i]] = alphabet[random_uniform(stream, size)];
+    }
+}
+
+/**
+ * @brief Draws up to `GENERATOR_CHUNK` uniformly distributed characters from `alphabet`.
+ *
+ * Each character uses 16 random bits, mapped to the alphabet with a
+ * multiply-and-shift; the rare biased values are flagged in the same pass and
+ * redrawn afterwards. The function is always inlined so that, when `size` and
+ * `length` are compile-time constants, the loop is fully unrolled, the
+ * rejection threshold is folded and the body is vectorised.
+ */
+static inline __attribute__((always_inline)) void fill_characters(char *output, const char *alphabet, const uint32_t size,
+                                                                  const int length, RandomStream *stream) {
+    const uint32_t threshold = (65536u - size) % size;
+    const unsigned char *bytes = random_stream_take(stream, 2 * (size_t)length);
+    uint32_t any_rejected = 0;
+
+    for (int i = 0; i < length; i++) {
+        uint32_t product = ((uint32_t)bytes[2 * i] | (uint32_t)bytes[2 * i + 1] << 8) * size;
+        output[i] = alphabet[product >> 16];
+        any_rejected |= (product & 0xFFFF) < threshold;
+    }
+    if (__builtin_expect(any_rejected != 0, 0)) {
+        redraw_rejected(output, alphabet, size, length, bytes, stream);
+    }
+}
+
+/**
+ * @brief Defines the generic and the length-specialised functions of one alphabet.
+ *
+ * `name##_any` serves every length; `name##_8`, `name##_12`, `name##_16` and
+ * `name##_32` are compiled with a constant length.
+ */
+#define DEFINE_GENERATOR_FUNCTIONS(name, alphabet)                                             \
+    static void name##_any(char *password, int length, RandomStream *stream) {                 \
+        fill_characters(password, alphabet, sizeof(alphabet) - 1, length, stream);             \
+    }                                                                                          \
+    DEFINE_FIXED_LENGTH_FUNCTION(name, alphabet, 8)                                            \
+    DEFINE_FIXED_LENGTH_FUNCTION(name, alphabet, 12)                                           \
+    DEFINE_FIXED_LENGTH_FUNCTION(name, alphabet, 16)                                           \
+    DEFINE_FIXED_LENGTH_FUNCTION(name, alphabet, 32)
+
+#define DEFINE_FIXED_LENGTH_FUNCTION(name, alphabet, fixed_length)                             \
+    static void name##_##fixed_length(char *password, int length, RandomStream *stream) {      \
+        (void)length;                                                                          \
+        fill_characters(password, alphabet, sizeof(alphabet) - 1, fixed_length, stream);       \
+    }
+
+/**
+ * @brief Expands to the `by_length` table of an alphabet: specialised functions
+ *        for 8, 12, 16 and 32 characters, the generic one everywhere else.
+ */
+#define LENGTH_TABLE(name) {                                                                   \
+    name##_any, name##_any, name##_any, name##_any, name##_any, name##_any, name##_any,        \
+    name##_any, name##_8,   name##_any, name##_any, name##_any, name##_12,  name##_any,        \
+    name##_any, name##_any, name##_16,  name##_any, name##_any, name##_any, name##_any,        \
+    name##_any, name##_any, name##_any, name##_any, name##_any, name##_any, name##_any,        \
+    name##_any, name##_any, name##_any, name##_any, name##_32 }
+
+PROTOCOL_STATIC_ASSERT(MAX_PASSWORD_LENGTH == 32, "LENGTH_TABLE must have MAX_PASSWORD_LENGTH + 1 entries");
+PROTOCOL_STATIC_ASSERT(MAX_PASSWORD_LENGTH <= GENERATOR_CHUNK, "A password must be drawn in a single chunk");
+
+DEFINE_GENERATOR_FUNCTIONS(numeric, numeric_alphabet)
+DEFINE_GENERATOR_FUNCTIONS(alpha, alpha_alphabet)
+DEFINE_GENERATOR_FUNCTIONS(mixed, mixed_alphabet)
+DEFINE_GENERATOR_FUNCTIONS(secure, secure_alphabet)
+DEFINE_GENERATOR_FUNCTIONS(unambiguous, unambiguous_alphabet)
+
+/* - - - - - - - - - - - - - - - - - - - END KERNELS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - TABLES - - - - - - - - - - - - - - - - - - - - */
+
+#define GENERATOR(password_type, wire, name) {                                                 \
+    .type = password_type,                                                                     \
+    .wire_type = wire,                                                                         \
+    .alphabet = name##_alphabet,                                                               \
+    .alphabet_size = sizeof(name##_alphabet) - 1,                                              \
+    .by_length = LENGTH_TABLE(name)                                                            \
+}
+
+static const Generator generators[] = {
+    [NUMERIC] = GENERATOR(NUMERIC, 'n', numeric),
+    [ALPHA] = GENERATOR(ALPHA, 'a', alpha),
+    [MIXED] = GENERATOR(MIXED, 'm', mixed),
+    [SECURE] = GENERATOR(SECURE, 's', secure),
+    [UNAMBIGUOUS] = GENERATOR(UNAMBIGUOUS, 'u', unambiguous),
+};
+
+const Generator *const generator_table[256] = {
+    ['n'] = &generators[NUMERIC],     ['N'] = &generators[NUMERIC],
+    ['a'] = &generators[ALPHA],       ['A'] = &generators[ALPHA],
+    ['m'] = &generators[MIXED],       ['M'] = &generators[MIXED],
+    ['s'] = &generators[SECURE],      ['S'] = &generators[SECURE],
+    ['u'] = &generators[UNAMBIGUOUS], ['U'] = &generators[UNAMBIGUOUS],
+};
+
+const Generator *generator_for_type(PasswordType type) {
+    return &generators[type];
+}
+
+void generator_fill_any(const Generator *generator, char *output, size_t length, RandomStream *stream) {
+    while (length > 0) {
+        int chunk = length < GENERATOR_CHUNK ? (int)length : GENERATOR_CHUNK;
+        fill_characters(output, generator->alphabet, generator->alphabet_size, chunk, stream);
+        output += chunk;
+        length -= (size_t)chunk;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END TABLES - - - - - - - - - - - - - - - - - - - */
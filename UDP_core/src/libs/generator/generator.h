@@ -0,0 +1,91 @@
+/**
+ * @file generator.h
+ * @brief Table-driven password generation engine.
+ *
+ * Every password type is described by a `Generator`, found with a single
+ * table lookup indexed by the type byte received on the wire (both cases are
+ * accepted). Each generator holds one function per password length: the most
+ * common lengths (8, 12, 16 and 32) point to versions specialised at compile
+ * time for that alphabet and length, whose loops the compiler fully unrolls
+ * and vectorises; the other lengths share a generic version.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef GENERATOR_H_
+#define GENERATOR_H_
+
+#include <stdint.h>
+
+#include "libs/password/password.h"
+#include "libs/protocol/protocol.h"
+#include "libs/random/random.h"
+
+/* - - - - - - - - - - - - - - - - - - - - GENERATORS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Writes `length` password characters (no terminator) using `stream` as randomness.
+ */
+typedef void (*GeneratorFunction)(char *password, int length, RandomStream *stream);
+
+/**
+ * @struct Generator
+ * @brief Description of one password type and its generation functions.
+ */
+typedef struct {
+    PasswordType type;										/**< Password type generated */
+    char wire_type;											/**< Canonical (lowercase) wire type byte */
+    const char *alphabet;									/**< Characters the password is drawn from */
+    uint32_t alphabet_size;									/**< Number of characters in `alphabet` */
+    GeneratorFunction by_length[MAX_PASSWORD_LENGTH + 1];	/**< Generation function for each length */
+} Generator;
+
+/**
+ * @brief Generators indexed by the wire type byte; `NULL` for unknown types.
+ */
+extern const Generator *const generator_table[256];
+
+/**
+ * @brief Finds the generator for a type byte received on the wire.
+ * @param[in] wire_type The type byte ('n', 'A', ...).
+ * @return The generator, or `NULL` if the byte names no password type.
+ */
+static inline const Generator *generator_lookup(char wire_type) {
+    return generator_table[(unsigned char)wire_type];
+}
+
+/**
+ * @brief Finds the generator for a `PasswordType`.
+ * @param[in] type The password type.
+ * @return The generator for `type`.
+ */
+const Generator *generator_for_type(PasswordType type);
+
+/**
+ * @brief Writes one password of `length` characters (no terminator).
+ * @param[in] generator The generator to use.
+ * @param[out] password Destination of at least `length` characters.
+ * @param[in] length Password length, between 1 and `MAX_PASSWORD_LENGTH`.
+ * @param[in,out] stream Source of randomness.
+ */
+static inline void generator_fill(const Generator *generator, char *password, int length, RandomStream *stream) {
+    generator->by_length[length](password, length, stream);
+}
+
+/**
+ * @brief Writes `length` characters of any length, drawn from the generator's alphabet.
+ *
+ * Unlike `generator_fill`, `length` is not limited to `MAX_PASSWORD_LENGTH`.
+ *
+ * @param[in] generator The generator providing the alphabet.
+ * @param[out] output Destination of at least `length` characters.
+ * @param[in] length Number of characters to write.
+ * @param[in,out] stream Source of randomness.
+ */
+void generator_fill_any(const Generator *generator, char *output, size_t length, RandomStream *stream);
+
+/* - - - - - - - - - - - - - - - - - - END GENERATORS - - - - - - - - - - - - - - - - - - - */
+
+#endif /* GENERATOR_H_ */
@@ -0,0 +1,322 @@
+/**
+ * @file gossip.c
+ * @brief Implementation of the cluster messages.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "gossip.h"
+
+#define FINGERPRINT_SPACE (1ull << 32)	/**< Values a fingerprint can take */
+#define MAX_RICE_BITS 31				/**< Largest Rice parameter, that of a single fingerprint */
+
+/* - - - - - - - - - - - - - - - - - - - - BYTE ORDER - - - - - - - - - - - - - - - - - - - - */
+
+static inline uint32_t load_be32(const unsigned char *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline uint64_t load_be64(const unsigned char *p) {
+    return ((uint64_t)load_be32(p) << 32) | load_be32(p + 4);
+}
+
+static inline void store_be32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+static inline void store_be64(unsigned char *p, uint64_t value) {
+    store_be32(p, (uint32_t)(value >> 32));
+    store_be32(p + 4, (uint32_t)value);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END BYTE ORDER - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RICE CODING - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @struct BitWriter
+ * @brief Appends bits to a buffer, most significant first.
+ */
+typedef struct {
+    unsigned char *out;		/**< Destination */
+    size_t size;			/**< Bytes written */
+    uint64_t bits;			/**< Bits not written yet, in the low `pending` bits */
+    unsigned int pending;	/**< Number of them, below 8 between two calls */
+} BitWriter;
+
+/**
+ * @brief Appends the low `count` bits of `value`, `count` at most 32.
+ */
+static inline void put_bits(BitWriter *writer, uint64_t value, unsigned int count) {
+    writer->bits = (writer->bits << count) | value;
+    writer->pending += count;
+    while (writer->pending >= 8) {
+        writer->pending -= 8;
+        writer->out[writer->size++] = (unsigned char)(writer->bits >> writer->pending);
+    }
+}
+
+/**
+ * @brief Appends a quotient in unary (that many ones, then a zero) and a remainder of `rice_bits` bits.
+ */
+static void put_rice(BitWriter *writer, uint64_t value, unsigned int rice_bits) {
+    uint64_t quotient = value >> rice_bits;
+    for (; quotient >= 32; quotient -= 32) {
+        put_bits(writer, 0xFFFFFFFFu, 32);
+    }
+    put_bits(writer, ((1ull << quotient) - 1) << 1, (unsigned int)quotient + 1);
+    put_bits(writer, value & ((1ull << rice_bits) - 1), rice_bits);
+}
+
+/**
+ * @struct BitReader
+ * @brief Reads bits from a buffer, most significant first.
+ */
+typedef struct {
+    const unsigned char *in;	/**< Source */
+    size_t size;				/**< Size of `in` */
+    size_t next;				/**< Next byte to load */
+    uint64_t bits;				/**< Loaded bits, left-aligned, zeros after them */
+    unsigned int available;		/**< Number of them */
+} BitReader;
+
+static inline void refill(BitReader *reader) {
+    while (reader->available <= 56 && reader->next < reader->size) {
+        reader->bits |= (uint64_t)reader->in[reader->next++] << (56 - reader->available);
+        reader->available += 8;
+    }
+}
+
+static inline void consume(BitReader *reader, unsigned int count) {
+    reader->bits = count < 64 ? reader->bits << count : 0;
+    reader->available -= count;
+}
+
+/**
+ * @brief Reads a value written by `put_rice`.
+ * @return `false` if the buffer ends first.
+ */
+static bool get_rice(BitReader *reader, unsigned int rice_bits, uint64_t *value) {
+    uint64_t quotient = 0;
+    while (true) {
+        refill(reader);
+        if (reader->available == 0) {
+            return false;
+        }
+        /* The bits after the loaded ones are zeros: the run of ones stops there at the latest */
+        unsigned int ones = ~reader->bits == 0 ? 64 : (unsigned int)__builtin_clzll(~reader->bits);
+        if (ones < reader->available) {
+            quotient += ones;
+            consume(reader, ones + 1);
+            break;
+        }
+        quotient += reader->available;
+        consume(reader, reader->available);
+        if (quotient >= FINGERPRINT_SPACE) {
+            return false;
+        }
+    }
+    refill(reader);
+    if (reader->available < rice_bits) {
+        return false;
+    }
+    uint64_t remainder = rice_bits == 0 ? 0 : reader->bits >> (64 - rice_bits);
+    consume(reader, rice_bits);
+    *value = (quotient << rice_bits) | remainder;
+    return true;
+}
+
+/**
+ * @brief Rice parameter of `count` values spread over the fingerprint space: the largest
+ * `p` with `count * 2^p <= 2^32`. The quotients then add up to less than `2 * count`.
+ */
+static unsigned int rice_bits_for(size_t count) {
+    unsigned int bits = MAX_RICE_BITS;
+    while (bits > 0 && ((uint64_t)count << bits) > FINGERPRINT_SPACE) {
+        bits--;
+    }
+    return bits;
+}
+
+/**
+ * @brief Largest number of fingerprints, at most `count`, whose Rice code surely fits in `payload_bits`.
+ * @details With parameter `p`, `n` fingerprints take `n * (p + 1)` bits of remainders and stop
+ * bits plus their quotients, less than `2^(32 - p) <= 2n` ones: below `n * (p + 3)` bits.
+ * Every parameter is tried with the largest count it applies to.
+ */
+static size_t fitting_count(size_t count, size_t payload_bits) {
+    size_t best = 0;
+    for (unsigned int bits = 0; bits <= MAX_RICE_BITS; bits++) {
+        uint64_t highest = FINGERPRINT_SPACE >> bits;		/**< Largest count taking this parameter */
+        uint64_t lowest = bits == MAX_RICE_BITS ? 1 : (FINGERPRINT_SPACE >> (bits + 1)) + 1;
+        uint64_t fitting = payload_bits / (bits + 3);
+        uint64_t candidate = count < highest ? count : highest;
+        candidate = candidate < fitting ? candidate : fitting;
+        if (candidate >= lowest && candidate > best) {
+            best = (size_t)candidate;
+        }
+    }
+    return best;
+}
+
+static int compare_fingerprints(const void *a, const void *b) {
+    uint32_t first = *(const uint32_t *)a;
+    uint32_t second = *(const uint32_t *)b;
+    return (first > second) - (first < second);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END RICE CODING - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - MESSAGES - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Writes the header of a datagram.
+ */
+static void encode_header(unsigned char *buffer, GossipKind kind, uint8_t sender, uint8_t origin, uint8_t rice_bits,
+                          uint64_t incarnation, uint64_t first, uint32_t count, size_t payload_size) {
+    store_be32(buffer, GOSSIP_MAGIC);
+    buffer[4] = (unsigned char)kind;
+    buffer[5] = sender;
+    buffer[6] = origin;
+    buffer[7] = rice_bits;
+    store_be64(buffer + 8, incarnation);
+    store_be64(buffer + 16, first);
+    store_be32(buffer + 24, count);
+    store_be32(buffer + 28, (uint32_t)payload_size);
+}
+
+/**
+ * @brief Appends the MAC of a datagram after its payload.
+ * @return Size of the datagram.
+ */
+static size_t append_mac(unsigned char *buffer, size_t payload_size, const unsigned char mac_key[SIPHASH_KEY_SIZE]) {
+    size_t size = GOSSIP_HEADER_SIZE + payload_size;
+    store_be64(buffer + size, siphash24(mac_key, buffer, size));
+    return size + GOSSIP_MAC_SIZE;
+}
+
+/**
+ * @brief Derives 16 bytes from the cluster key and a label.
+ */
+static void derive_key(const unsigned char cluster_key[SIPHASH_KEY_SIZE], const char *label,
+                       unsigned char key[SIPHASH_KEY_SIZE]) {
+    unsigned char input[32];
+    size_t length = strlen(label);
+    memcpy(input, label, length);
+    for (unsigned char half = 0; half < 2; half++) {
+        input[length] = half;
+        uint64_t hash = siphash24(cluster_key, input, length + 1);
+        for (int i = 0; i < 8; i++) {
+            key[half * 8 + i] = (unsigned char)(hash >> (8 * i));
+        }
+    }
+}
+
+void gossip_derive_keys(const unsigned char cluster_key[SIPHASH_KEY_SIZE], unsigned char fingerprint_key[SIPHASH_KEY_SIZE],
+                        unsigned char mac_key[SIPHASH_KEY_SIZE]) {
+    derive_key(cluster_key, "passgen fingerprint", fingerprint_key);
+    derive_key(cluster_key, "passgen gossip mac", mac_key);
+}
+
+size_t gossip_encode_delta(unsigned char *buffer, size_t capacity, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                           uint8_t sender, uint8_t origin, uint64_t incarnation, uint64_t first,
+                           uint32_t *fingerprints, size_t count, size_t *taken) {
+    capacity = capacity < GOSSIP_DATAGRAM_SIZE ? capacity : GOSSIP_DATAGRAM_SIZE;
+    *taken = 0;
+    if (capacity <= GOSSIP_HEADER_SIZE + GOSSIP_MAC_SIZE) {
+        return 0;
+    }
+    size_t chosen = fitting_count(count, (capacity - GOSSIP_HEADER_SIZE - GOSSIP_MAC_SIZE) * 8);
+    if (chosen == 0) {
+        return 0;
+    }
+    unsigned int rice_bits = rice_bits_for(chosen);
+    qsort(fingerprints, chosen, sizeof(fingerprints[0]), compare_fingerprints);
+
+    BitWriter writer = { .out = buffer + GOSSIP_HEADER_SIZE, .size = 0, .bits = 0, .pending = 0 };
+    uint32_t previous = 0;
+    for (size_t i = 0; i < chosen; i++) {
+        put_rice(&writer, fingerprints[i] - previous, rice_bits);
+        previous = fingerprints[i];
+    }
+    if (writer.pending > 0) {
+        put_bits(&writer, 0, 8 - writer.pending);	/**< Zero padding to the byte */
+    }
+
+    encode_header(buffer, GOSSIP_DELTA, sender, origin, (uint8_t)rice_bits, incarnation, first, (uint32_t)chosen,
+                  writer.size);
+    *taken = chosen;
+    return append_mac(buffer, writer.size, mac_key);
+}
+
+size_t gossip_encode_digest(unsigned char *buffer, size_t capacity, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                            uint8_t sender, uint64_t incarnation, const GossipDigestEntry *entries, size_t count) {
+    size_t payload_size = count * GOSSIP_DIGEST_ENTRY_SIZE;
+    if (count > GOSSIP_MAX_NODES || capacity < GOSSIP_HEADER_SIZE + payload_size + GOSSIP_MAC_SIZE) {
+        return 0;
+    }
+    unsigned char *entry = buffer + GOSSIP_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++, entry += GOSSIP_DIGEST_ENTRY_SIZE) {
+        store_be32(entry, entries[i].origin);
+        store_be64(entry + 4, entries[i].incarnation);
+        store_be64(entry + 12, entries[i].received);
+    }
+    encode_header(buffer, GOSSIP_DIGEST, sender, 0, 0, incarnation, 0, (uint32_t)count, payload_size);
+    return append_mac(buffer, payload_size, mac_key);
+}
+
+bool gossip_decode(const unsigned char *buffer, size_t size, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                   GossipMessage *message) {
+    if (size < GOSSIP_HEADER_SIZE + GOSSIP_MAC_SIZE || load_be32(buffer) != GOSSIP_MAGIC) {
+        return false;
+    }
+    *message = (GossipMessage){ .kind = buffer[4], .sender = buffer[5], .origin = buffer[6], .rice_bits = buffer[7],
+                                .incarnation = load_be64(buffer + 8), .first = load_be64(buffer + 16),
+                                .count = load_be32(buffer + 24), .payload = buffer + GOSSIP_HEADER_SIZE,
+                                .payload_size = load_be32(buffer + 28) };
+    if (message->payload_size != size - GOSSIP_HEADER_SIZE - GOSSIP_MAC_SIZE
+        || load_be64(buffer + size - GOSSIP_MAC_SIZE) != siphash24(mac_key, buffer, size - GOSSIP_MAC_SIZE)
+        || message->sender == 0 || message->sender > GOSSIP_MAX_NODES) {
+        return false;
+    }
+    if (message->kind == GOSSIP_DELTA) {
+        return message->origin != 0 && message->origin <= GOSSIP_MAX_NODES && message->rice_bits <= MAX_RICE_BITS
+            && message->count > 0 && message->count <= message->payload_size * 8;
+    }
+    return message->kind == GOSSIP_DIGEST && message->count <= GOSSIP_MAX_NODES
+        && message->payload_size == (size_t)message->count * GOSSIP_DIGEST_ENTRY_SIZE;
+}
+
+bool gossip_delta_fingerprints(const GossipMessage *message, uint32_t *fingerprints, size_t capacity) {
+    BitReader reader = { .in = message->payload, .size = message->payload_size, .next = 0, .bits = 0, .available = 0 };
+    uint64_t value = 0;
+    if (message->count > capacity) {
+        return false;
+    }
+    for (uint32_t i = 0; i < message->count; i++) {
+        uint64_t gap;
+        if (!get_rice(&reader, message->rice_bits, &gap) || value + gap >= FINGERPRINT_SPACE) {
+            return false;
+        }
+        value += gap;
+        fingerprints[i] = (uint32_t)value;
+    }
+    return true;
+}
+
+void gossip_digest_entry(const GossipMessage *message, size_t index, GossipDigestEntry *entry) {
+    const unsigned char *bytes = message->payload + index * GOSSIP_DIGEST_ENTRY_SIZE;
+    uint32_t origin = load_be32(bytes);
+    entry->origin = origin <= GOSSIP_MAX_NODES ? (uint8_t)origin : 0;	/**< 0: no such node */
+    entry->incarnation = load_be64(bytes + 4);
+    entry->received = load_be64(bytes + 12);
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END MESSAGES - - - - - - - - - - - - - - - - - - - - */
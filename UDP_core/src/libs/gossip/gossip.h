@@ -0,0 +1,180 @@
+/**
+ * @file gossip.h
+ * @brief Messages the nodes of a cluster exchange to keep their passwords unique.
+ *
+ * Every node of a cluster shares the cluster key: its uniqueness filter hashes
+ * the passwords under a key derived from it, so a password has the same 32-bit
+ * fingerprint on every node, and a node enters the fingerprints issued by the
+ * others in its own filter. The nodes exchange two kinds of datagrams:
+ *
+ * - a delta carries fingerprints issued by one node, its origin. An origin
+ *   numbers its fingerprints from 0 in each incarnation (one run of the node):
+ *   the node id, the incarnation and the sequence numbers partition the space of
+ *   the fingerprints between the nodes, so a delta names exactly which ones it
+ *   carries and a receiver knows which ones it missed. The fingerprints of a
+ *   delta form a set: they are sorted and their gaps Rice-coded, a Golomb-coded
+ *   set of about `log2(2^32 / count) + 1.5` bits per fingerprint instead of 32;
+ * - a digest tells a peer, for every origin, up to which sequence number the
+ *   sender received everything. The peer sends again what is missing of its own
+ *   fingerprints (anti-entropy repair), which also fills the filter of a node
+ *   that just started.
+ *
+ * Layout of a datagram (integers big-endian):
+ *
+ * | Offset | Size | Field                                                              |
+ * |--------|------|--------------------------------------------------------------------|
+ * | +0     | 4    | magic and version, "PGC1"                                          |
+ * | +4     | 1    | kind (`GossipKind`)                                                |
+ * | +5     | 1    | sender node id (1 to `GOSSIP_MAX_NODES`)                           |
+ * | +6     | 1    | origin node id of a delta, 0 for a digest                          |
+ * | +7     | 1    | Rice parameter of a delta, 0 for a digest                          |
+ * | +8     | 8    | incarnation of the origin (delta) or of the sender (digest)        |
+ * | +16    | 8    | sequence number of the first fingerprint of a delta, 0 for a digest |
+ * | +24    | 4    | fingerprints of a delta, entries of a digest                       |
+ * | +28    | 4    | payload size                                                       |
+ * | +32    | ...  | payload: Rice-coded gaps (delta) or 20-byte entries (digest)       |
+ * | end    | 8    | SipHash-2-4 MAC of everything before, under the MAC key            |
+ *
+ * A digest entry is an origin id (4 bytes), its incarnation (8) and the number of
+ * its fingerprints received without a gap (8).
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef GOSSIP_H_
+#define GOSSIP_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/siphash/siphash.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - - GOSSIP - - - - - - - - - - - - - - - - - - - - */
+
+#define GOSSIP_MAGIC 0x50474331u			/**< "PGC1": magic and version */
+#define GOSSIP_HEADER_SIZE 32				/**< Header of a datagram */
+#define GOSSIP_MAC_SIZE 8					/**< MAC ending a datagram */
+#define GOSSIP_DATAGRAM_SIZE 1400			/**< Largest datagram, below the usual path MTU: no IP fragmentation */
+#define GOSSIP_DIGEST_ENTRY_SIZE 20			/**< One origin of a digest */
+#define GOSSIP_MAX_NODES 16					/**< Nodes of a cluster, ids 1 to 16 */
+#define GOSSIP_MAX_DELTA_COUNT ((GOSSIP_DATAGRAM_SIZE - GOSSIP_HEADER_SIZE - GOSSIP_MAC_SIZE) * 8)	/**< Most fingerprints of a delta: one bit each at least */
+
+/**
+ * @enum GossipKind
+ * @brief Kind of a datagram.
+ */
+typedef enum {
+    GOSSIP_DELTA = 1,		/**< Fingerprints issued by the origin */
+    GOSSIP_DIGEST = 2		/**< What the sender received of every origin */
+} GossipKind;
+
+/**
+ * @struct GossipMessage
+ * @brief A decoded datagram, pointing back into the receive buffer.
+ */
+typedef struct {
+    uint8_t kind;					/**< `GossipKind` */
+    uint8_t sender;					/**< Node that sent the datagram */
+    uint8_t origin;					/**< Node that issued the fingerprints of a delta */
+    uint8_t rice_bits;				/**< Rice parameter of a delta */
+    uint64_t incarnation;			/**< Incarnation of the origin (delta) or of the sender (digest) */
+    uint64_t first;					/**< Sequence number of the first fingerprint of a delta */
+    uint32_t count;					/**< Fingerprints of a delta, entries of a digest */
+    const unsigned char *payload;	/**< Rice-coded gaps or digest entries */
+    size_t payload_size;			/**< Size of `payload` */
+} GossipMessage;
+
+/**
+ * @struct GossipDigestEntry
+ * @brief What a node received of one origin.
+ */
+typedef struct {
+    uint8_t origin;					/**< The origin */
+    uint64_t incarnation;			/**< Its incarnation the figure is about */
+    uint64_t received;				/**< Fingerprints received without a gap, from sequence number 0 */
+} GossipDigestEntry;
+
+/**
+ * @brief Derives the two keys of a node from the cluster key.
+ * @param[in] cluster_key The key shared by the cluster.
+ * @param[out] fingerprint_key Key of the password hashes, given to the engine context.
+ * @param[out] mac_key Key of the datagram MACs.
+ */
+void gossip_derive_keys(const unsigned char cluster_key[SIPHASH_KEY_SIZE], unsigned char fingerprint_key[SIPHASH_KEY_SIZE],
+                        unsigned char mac_key[SIPHASH_KEY_SIZE]);
+
+/**
+ * @brief Encodes a delta with as many of the given fingerprints as fit in one datagram.
+ * @details The fingerprints taken are the first ones of the array, which is sorted in place.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`, at most `GOSSIP_DATAGRAM_SIZE` is used.
+ * @param[in] mac_key Key of the MAC.
+ * @param[in] sender Node sending the delta.
+ * @param[in] origin Node that issued the fingerprints.
+ * @param[in] incarnation Incarnation of the origin.
+ * @param[in] first Sequence number of `fingerprints[0]`.
+ * @param[in,out] fingerprints The fingerprints, in sequence order; the ones taken are sorted.
+ * @param[in] count Number of `fingerprints`.
+ * @param[out] taken Number of fingerprints encoded.
+ * @return Size of the datagram, 0 if not even one fingerprint fits in `buffer`.
+ */
+size_t gossip_encode_delta(unsigned char *buffer, size_t capacity, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                           uint8_t sender, uint8_t origin, uint64_t incarnation, uint64_t first,
+                           uint32_t *fingerprints, size_t count, size_t *taken);
+
+/**
+ * @brief Encodes a digest.
+ * @param[out] buffer Destination buffer.
+ * @param[in] capacity Size of `buffer`.
+ * @param[in] mac_key Key of the MAC.
+ * @param[in] sender Node sending the digest.
+ * @param[in] incarnation Incarnation of the sender.
+ * @param[in] entries What the sender received of every origin.
+ * @param[in] count Number of `entries`, at most `GOSSIP_MAX_NODES`.
+ * @return Size of the datagram, 0 if it does not fit in `buffer`.
+ */
+size_t gossip_encode_digest(unsigned char *buffer, size_t capacity, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                            uint8_t sender, uint64_t incarnation, const GossipDigestEntry *entries, size_t count);
+
+/**
+ * @brief Checks and decodes a received datagram.
+ * @param[in] buffer The datagram.
+ * @param[in] size Its size.
+ * @param[in] mac_key Key of the MAC.
+ * @param[out] message The decoded header.
+ * @return `false` if the datagram is malformed or its MAC does not match.
+ */
+bool gossip_decode(const unsigned char *buffer, size_t size, const unsigned char mac_key[SIPHASH_KEY_SIZE],
+                   GossipMessage *message);
+
+/**
+ * @brief Decodes the fingerprints of a delta.
+ * @param[in] message A decoded delta.
+ * @param[out] fingerprints Receives `message->count` fingerprints, in increasing order.
+ * @param[in] capacity Entries of `fingerprints`.
+ * @return `false` if the payload does not hold `message->count` fingerprints or they do not fit.
+ */
+bool gossip_delta_fingerprints(const GossipMessage *message, uint32_t *fingerprints, size_t capacity);
+
+/**
+ * @brief Reads one entry of a digest.
+ * @param[in] message A decoded digest.
+ * @param[in] index Entry number, below `message->count`.
+ * @param[out] entry The entry.
+ */
+void gossip_digest_entry(const GossipMessage *message, size_t index, GossipDigestEntry *entry);
+
+/* - - - - - - - - - - - - - - - - - - - - END GOSSIP - - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* GOSSIP_H_ */
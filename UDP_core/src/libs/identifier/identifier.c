@@ -0,0 +1,212 @@
+/**
+ * @file identifier.c
+ * @brief Implementation of the identifier generation.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include "identifier.h"
+
+#define UUID_V7_RAND_A_MASK 0xFFFull					/**< 12 bits of `rand_a` */
+#define UUID_LOW_MASK ((1ull << 62) - 1)				/**< 62 bits after the variant (`rand_b` of a UUIDv7) */
+#define ULID_HIGH_MASK 0xFFFFull						/**< Top 16 of the 80 random bits */
+#define SNOWFLAKE_SEQUENCE_MASK 0xFFFull				/**< 12-bit sequence number */
+#define SNOWFLAKE_TIME_MASK ((1ull << 41) - 1)			/**< 41-bit milliseconds */
+
+static const IdentifierFormat formats[IDENTIFIER_KIND_COUNT] = {
+    [IDENTIFIER_UUID_V4] = { IDENTIFIER_UUID_V4, 'r', 32 },
+    [IDENTIFIER_UUID_V7] = { IDENTIFIER_UUID_V7, 't', 32 },
+    [IDENTIFIER_ULID] = { IDENTIFIER_ULID, 'l', 26 },
+    [IDENTIFIER_SNOWFLAKE] = { IDENTIFIER_SNOWFLAKE, 'f', 16 },
+};
+
+const IdentifierFormat *const identifier_table[256] = {
+    ['r'] = &formats[IDENTIFIER_UUID_V4],   ['R'] = &formats[IDENTIFIER_UUID_V4],
+    ['t'] = &formats[IDENTIFIER_UUID_V7],   ['T'] = &formats[IDENTIFIER_UUID_V7],
+    ['l'] = &formats[IDENTIFIER_ULID],      ['L'] = &formats[IDENTIFIER_ULID],
+    ['f'] = &formats[IDENTIFIER_SNOWFLAKE], ['F'] = &formats[IDENTIFIER_SNOWFLAKE],
+};
+
+static uint32_t next_worker;	/**< Workers started by the process (atomic) */
+
+/* - - - - - - - - - - - - - - - - - - - - - ENCODING - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief One lane per byte of a 64-bit value, wide enough for the two hex digits of the byte.
+ *
+ * GCC lowers the operations to one or two SSE2/NEON instructions each: the
+ * 16 digits of a value are computed at once, without a table lookup.
+ */
+typedef uint8_t hex_bytes_t __attribute__((vector_size(8)));
+typedef uint16_t hex_lanes_t __attribute__((vector_size(16)));
+
+/**
+ * @brief One lane per base32 digit: two of them hold the 26 digits of a 128-bit value.
+ * @details The lanes are signed so that the comparisons map to a single SSE2 instruction.
+ */
+typedef int8_t base32_lanes_t __attribute__((vector_size(16)));
+
+void identifier_hex64(uint64_t value, char *output) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap64(value);		/**< Most significant byte first */
+#endif
+    hex_bytes_t bytes;
+    memcpy(&bytes, &value, sizeof(bytes));
+    hex_lanes_t lanes = __builtin_convertvector(bytes, hex_lanes_t);
+    hex_lanes_t high = lanes >> 4;
+    hex_lanes_t low = lanes & 15;
+
+    /* '0' to '9', then 'a' to 'f': the letters are 39 characters further than the digits would be */
+    high += '0' + ((hex_lanes_t)(high > 9) & ('a' - '0' - 10));
+    low += '0' + ((hex_lanes_t)(low > 9) & ('a' - '0' - 10));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    hex_lanes_t characters = high | low << 8;
+#else
+    hex_lanes_t characters = high << 8 | low;
+#endif
+    memcpy(output, &characters, sizeof(characters));
+}
+
+/**
+ * @brief Maps 16 digits from 0 to 31 to Crockford's alphabet: the digits, then the letters without I, L, O and U.
+ */
+static inline base32_lanes_t crockford_characters(base32_lanes_t digits) {
+    base32_lanes_t characters = digits + '0' + ((digits > 9) & ('A' - '0' - 10));
+    return characters - (digits > 17) - (digits > 19) - (digits > 21) - (digits > 26);	/**< true is -1: one letter further */
+}
+
+void identifier_base32(uint64_t high, uint64_t low, char *output) {
+    /* The digits are extracted in scalar registers (a shift and a mask each), the alphabet mapped in vector ones */
+    int8_t digits[2 * sizeof(base32_lanes_t)] = { 0 };
+    digits[0] = (int8_t)(high >> 61);		/**< 26 digits hold 130 bits: the first one only 3 */
+    for (int i = 1; i < 13; i++) {
+        digits[i] = (int8_t)(high >> (61 - 5 * i) & 31);
+    }
+    digits[13] = (int8_t)((high & 1) << 4 | low >> 60);
+    for (int i = 14; i < 26; i++) {
+        digits[i] = (int8_t)(low >> (125 - 5 * i) & 31);
+    }
+
+    base32_lanes_t first, second;
+    memcpy(&first, digits, sizeof(first));
+    memcpy(&second, digits + sizeof(first), sizeof(second));
+    first = crockford_characters(first);
+    second = crockford_characters(second);
+    memcpy(output, &first, sizeof(first));
+    memcpy(output + sizeof(first), &second, 26 - sizeof(first));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END ENCODING - - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - SEQUENCES - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Reads the wall clock from the coarse source: a few milliseconds of resolution, no system call.
+ * @return Milliseconds since the Unix epoch.
+ */
+static inline uint64_t wall_clock_ms(void) {
+    struct timespec now;
+#if defined CLOCK_REALTIME_COARSE
+    clock_gettime(CLOCK_REALTIME_COARSE, &now);
+#else
+    timespec_get(&now, TIME_UTC);
+#endif
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Starts the counter of a new millisecond: random with its top bit clear, so that
+ * it can be incremented at least 2^(bits - 1) times, or 0 without a stream (Snowflake).
+ */
+static inline void reseed(IdentifierSequence *sequence, uint64_t high_mask, uint64_t low_mask, RandomStream *stream) {
+    if (stream == NULL) {
+        sequence->high = sequence->low = 0;
+        return;
+    }
+    const unsigned char *bytes = random_stream_take(stream, 16);
+    memcpy(&sequence->high, bytes, sizeof(sequence->high));
+    memcpy(&sequence->low, bytes + 8, sizeof(sequence->low));
+    sequence->high &= high_mask >> 1;
+    sequence->low &= low_mask;
+}
+
+/**
+ * @brief Moves a sequence to its next identifier, strictly greater than the previous one.
+ * @param[in] now_ms The wall clock; the logical clock keeps its value when the wall clock is behind it.
+ */
+static inline void advance(IdentifierSequence *sequence, uint64_t now_ms, uint64_t high_mask, uint64_t low_mask,
+                           RandomStream *stream) {
+    if (now_ms > sequence->time_ms) {
+        sequence->time_ms = now_ms;
+        reseed(sequence, high_mask, low_mask, stream);
+        return;
+    }
+    sequence->low = (sequence->low + 1) & low_mask;
+    if (sequence->low == 0) {
+        sequence->high = (sequence->high + 1) & high_mask;
+        if (sequence->high == 0) {
+            sequence->time_ms++;	/**< Counter exhausted: borrow the next millisecond */
+            reseed(sequence, high_mask, low_mask, stream);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END SEQUENCES - - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - IDENTIFIERS - - - - - - - - - - - - - - - - - - - - - */
+
+void identifier_state_init(IdentifierState *state, unsigned int node) {
+    uint32_t worker = __atomic_fetch_add(&next_worker, 1, __ATOMIC_RELAXED) % IDENTIFIER_WORKERS_PER_NODE;
+    memset(state, 0, sizeof(*state));
+    state->worker = (uint16_t)((node % IDENTIFIER_MAX_NODES) * IDENTIFIER_WORKERS_PER_NODE + worker);
+}
+
+void identifier_fill(IdentifierState *state, const IdentifierFormat *format, char *output, size_t count,
+                     RandomStream *stream) {
+    IdentifierSequence *sequence = &state->sequences[format->kind];
+    uint64_t now_ms = wall_clock_ms();
+
+    switch (format->kind) {
+        case IDENTIFIER_UUID_V4:
+            for (size_t i = 0; i < count; i++, output += 32) {
+                const unsigned char *bytes = random_stream_take(stream, 16);
+                uint64_t high, low;
+                memcpy(&high, bytes, sizeof(high));
+                memcpy(&low, bytes + 8, sizeof(low));
+                identifier_hex64((high & ~0xF000ull) | 0x4000, output);		/**< Version 4 */
+                identifier_hex64((low & UUID_LOW_MASK) | 1ull << 63, output + 16);	/**< Variant 10 */
+            }
+            break;
+        case IDENTIFIER_UUID_V7:
+            for (size_t i = 0; i < count; i++, output += 32) {
+                advance(sequence, now_ms, UUID_V7_RAND_A_MASK, UUID_LOW_MASK, stream);
+                identifier_hex64(sequence->time_ms << 16 | 0x7000 | sequence->high, output);
+                identifier_hex64(sequence->low | 1ull << 63, output + 16);
+            }
+            break;
+        case IDENTIFIER_ULID:
+            for (size_t i = 0; i < count; i++, output += 26) {
+                advance(sequence, now_ms, ULID_HIGH_MASK, UINT64_MAX, stream);
+                identifier_base32(sequence->time_ms << 16 | sequence->high, sequence->low, output);
+            }
+            break;
+        case IDENTIFIER_SNOWFLAKE:
+            if (now_ms < IDENTIFIER_SNOWFLAKE_EPOCH_MS) {
+                now_ms = IDENTIFIER_SNOWFLAKE_EPOCH_MS;
+            }
+            for (size_t i = 0; i < count; i++, output += 16) {
+                advance(sequence, now_ms, 0, SNOWFLAKE_SEQUENCE_MASK, NULL);
+                uint64_t elapsed_ms = (sequence->time_ms - IDENTIFIER_SNOWFLAKE_EPOCH_MS) & SNOWFLAKE_TIME_MASK;
+                identifier_hex64(elapsed_ms << 22 | (uint64_t)state->worker << 12 | sequence->low, output);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END IDENTIFIERS - - - - - - - - - - - - - - - - - - - - */
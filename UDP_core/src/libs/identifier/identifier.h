@@ -0,0 +1,152 @@
+/**
+ * @file identifier.h
+ * @brief Generation of unique identifiers: UUIDv4, UUIDv7, ULID and Snowflake IDs.
+ *
+ * The identifiers are served like the passwords: a request names an identifier
+ * type instead of a password type, with the length of its text, and receives
+ * `count` of them back to back. Every type has a fixed text:
+ *
+ * | Wire type | Identifier                      | Length | Text                                  |
+ * |-----------|---------------------------------|--------|---------------------------------------|
+ * | 'r'       | UUIDv4 (RFC 9562), random       | 32     | lowercase hex, without hyphens        |
+ * | 't'       | UUIDv7 (RFC 9562), time-ordered | 32     | lowercase hex, without hyphens        |
+ * | 'l'       | ULID                            | 26     | Crockford base32, uppercase           |
+ * | 'f'       | Snowflake, 64 bits              | 16     | lowercase hex                         |
+ *
+ * A UUID has no hyphens so that it fits in `MAX_PASSWORD_LENGTH`; both texts
+ * sort like the 128-bit values.
+ *
+ * The time-ordered identifiers are generated by workers, one per engine, each
+ * with its own state and no shared counter. Within a worker they are strictly
+ * increasing: the worker keeps a logical clock, the wall clock read once per
+ * batch (coarse clock), that never goes back. An identifier drawn in the same
+ * millisecond as the previous one increments its random part (UUIDv7, ULID,
+ * "monotonic random") or its sequence number (Snowflake); when that overflows,
+ * the logical clock borrows the next millisecond instead of waiting for it.
+ *
+ * A Snowflake ID is a 41-bit count of milliseconds since
+ * `IDENTIFIER_SNOWFLAKE_EPOCH_MS`, a 10-bit worker (4 bits of node, 6 bits of
+ * worker within the node) and a 12-bit sequence number. Its uniqueness relies on
+ * the workers having different numbers: at most 64 workers per process, and one
+ * node number per process of a deployment.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef IDENTIFIER_H_
+#define IDENTIFIER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/random/random.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - IDENTIFIERS - - - - - - - - - - - - - - - - - - - - */
+
+#define IDENTIFIER_SNOWFLAKE_EPOCH_MS 1704067200000ull	/**< 2024-01-01T00:00:00Z, time 0 of the Snowflake IDs */
+#define IDENTIFIER_MAX_NODES 16							/**< Nodes told apart by the Snowflake IDs */
+#define IDENTIFIER_WORKERS_PER_NODE 64					/**< Workers told apart within a node */
+
+/**
+ * @enum IdentifierKind
+ * @brief Kinds of identifiers.
+ */
+typedef enum {
+    IDENTIFIER_UUID_V4,		/**< 122 random bits */
+    IDENTIFIER_UUID_V7,		/**< 48-bit Unix milliseconds, 74 monotonic random bits */
+    IDENTIFIER_ULID,		/**< 48-bit Unix milliseconds, 80 monotonic random bits */
+    IDENTIFIER_SNOWFLAKE,	/**< 41-bit milliseconds, 10-bit worker, 12-bit sequence */
+    IDENTIFIER_KIND_COUNT	/**< Number of kinds */
+} IdentifierKind;
+
+/**
+ * @struct IdentifierFormat
+ * @brief Description of one identifier type.
+ */
+typedef struct {
+    IdentifierKind kind;	/**< Kind of identifier */
+    char wire_type;			/**< Canonical (lowercase) wire type byte */
+    uint8_t length;			/**< Characters of its text */
+} IdentifierFormat;
+
+/**
+ * @struct IdentifierSequence
+ * @brief Monotonic state of one time-ordered kind within a worker.
+ */
+typedef struct {
+    uint64_t time_ms;		/**< Logical clock of the last identifier, never decreasing */
+    uint64_t high;			/**< Upper part of the counter (UUIDv7 `rand_a`, top 16 random bits of a ULID) */
+    uint64_t low;			/**< Lower part of the counter (UUIDv7 `rand_b`, low 64 random bits of a ULID, Snowflake sequence) */
+} IdentifierSequence;
+
+/**
+ * @struct IdentifierState
+ * @brief State of one worker.
+ */
+typedef struct {
+    uint16_t worker;										/**< Worker field of the Snowflake IDs */
+    IdentifierSequence sequences[IDENTIFIER_KIND_COUNT];	/**< By kind; unused for UUIDv4 */
+} IdentifierState;
+
+/**
+ * @brief Identifier formats indexed by the wire type byte; `NULL` for other types.
+ */
+extern const IdentifierFormat *const identifier_table[256];
+
+/**
+ * @brief Finds the identifier format of a type byte received on the wire.
+ * @param[in] wire_type The type byte ('r', 'T', ...), both cases accepted.
+ * @return The format, or `NULL` if the byte names no identifier type.
+ */
+static inline const IdentifierFormat *identifier_lookup(char wire_type) {
+    return identifier_table[(unsigned char)wire_type];
+}
+
+/**
+ * @brief Initialises the state of a new worker, with the next worker number of the process.
+ * @param[out] state The state.
+ * @param[in] node Node number, below `IDENTIFIER_MAX_NODES`.
+ */
+void identifier_state_init(IdentifierState *state, unsigned int node);
+
+/**
+ * @brief Writes `count` identifiers back to back, without terminators.
+ * @details The wall clock is read once for the whole batch.
+ * @param[in,out] state The worker.
+ * @param[in] format The identifier type.
+ * @param[out] output Destination of `count * format->length` characters.
+ * @param[in] count Number of identifiers.
+ * @param[in,out] stream Source of randomness.
+ */
+void identifier_fill(IdentifierState *state, const IdentifierFormat *format, char *output, size_t count,
+                     RandomStream *stream);
+
+/**
+ * @brief Writes a 64-bit value as 16 lowercase hex digits, most significant first.
+ * @param[in] value The value.
+ * @param[out] output Destination of 16 characters.
+ */
+void identifier_hex64(uint64_t value, char *output);
+
+/**
+ * @brief Writes a 128-bit value as 26 Crockford base32 digits, most significant first.
+ * @param[in] high The upper 64 bits.
+ * @param[in] low The lower 64 bits.
+ * @param[out] output Destination of 26 characters.
+ */
+void identifier_base32(uint64_t high, uint64_t low, char *output);
+
+/* - - - - - - - - - - - - - - - - - - - END IDENTIFIERS - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* IDENTIFIER_H_ */
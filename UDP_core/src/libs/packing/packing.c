@@ -0,0 +1,141 @@
+/**
+ * @file packing.c
+ * @brief Implementation of the bit-packed password characters.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+
+#include "packing.h"
+
+#define PACKING_TABLE_SIZE (1u << PACKING_MAX_BITS)		/**< Entries of the tables of the symbols */
+#define DECODE_STEP 8									/**< Symbols expanded per step of the decoder */
+
+/* - - - - - - - - - - - - - - - - - - - - - ENCODING - - - - - - - - - - - - - - - - - - - - - */
+
+size_t packing_encode(const char *alphabet, uint32_t alphabet_size, const char *characters, size_t symbols,
+                      unsigned char *output) {
+    uint8_t indices[256] = { 0 };		/**< Index of every character, built per call: a few dozen stores */
+    unsigned int bits = packing_bits(alphabet_size);
+    uint64_t accumulator = 0;
+    unsigned int pending = 0;			/**< Bits of `accumulator` not written yet */
+    size_t written = 0;
+
+    for (uint32_t i = 0; i < alphabet_size; i++) {
+        indices[(unsigned char)alphabet[i]] = (uint8_t)i;
+    }
+    for (size_t i = 0; i < symbols; i++) {
+        accumulator |= (uint64_t)indices[(unsigned char)characters[i]] << pending;
+        pending += bits;
+        while (pending >= 8) {
+            output[written++] = (unsigned char)accumulator;
+            accumulator >>= 8;
+            pending -= 8;
+        }
+    }
+    if (pending > 0) {
+        output[written++] = (unsigned char)accumulator;
+    }
+    return written;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END ENCODING - - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - DECODING - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief A group of packed symbols: its 8 bytes, then the same bytes moved down by one, seen as 16-bit lanes.
+ *
+ * A group of 8 symbols takes `bits` bytes, at most 7: symbol `j` starts in byte
+ * `j * bits / 8` and ends in the next one. Lanes 0 to 3 start at the even bytes,
+ * lanes 4 to 7 at the odd ones: a word shuffle (SSE2 has them, unlike byte
+ * shuffles) gives every symbol the lane starting at its first byte, and a
+ * multiplication by `2^(8 - j * bits % 8)` (a shift per lane) brings it to bit 8.
+ */
+typedef uint64_t packed_words_t __attribute__((vector_size(16)));
+typedef uint16_t packed_lanes_t __attribute__((vector_size(16)));
+
+/**
+ * @brief Expands a group of 8 symbols of `bits` bits each from 8 readable bytes.
+ * @details Inlined with a constant `bits`, so that the shuffle mask and the multipliers are constants.
+ * @return The lanes of the symbols that are not in the alphabet, all ones.
+ */
+static inline __attribute__((always_inline)) packed_lanes_t expand8(const unsigned char *input, const char *table,
+                                                                    uint16_t alphabet_size, char *output,
+                                                                    unsigned int bits) {
+    packed_lanes_t select;
+    packed_lanes_t multipliers;
+    uint64_t word;
+
+    memcpy(&word, input, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    for (unsigned int j = 0; j < 8; j++) {
+        unsigned int offset = j * bits;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        select[j] = (uint16_t)(offset / 8 % 2 * 4 + 3 - offset / 16);	/**< The lanes of a word are in reverse order */
+#else
+        select[j] = (uint16_t)(offset / 8 % 2 * 4 + offset / 16);
+#endif
+        multipliers[j] = (uint16_t)(1u << (8 - offset % 8));
+    }
+    packed_lanes_t lanes = __builtin_shuffle((packed_lanes_t)(packed_words_t){ word, word >> 8 }, select);
+    packed_lanes_t symbols = (lanes * multipliers) >> 8 & (uint16_t)((1u << bits) - 1);
+    for (unsigned int j = 0; j < 8; j++) {
+        output[j] = table[symbols[j]];
+    }
+    return (packed_lanes_t)(symbols >= alphabet_size);
+}
+
+/**
+ * @brief Expands every symbol with a constant `bits`: whole groups straight from the input, the rest from a padded copy.
+ */
+static inline __attribute__((always_inline)) bool decode_bits(const char *table, uint16_t alphabet_size,
+                                                              const unsigned char *input, size_t symbols,
+                                                              char *output, unsigned int bits) {
+    size_t size = packing_size(symbols, bits);
+    packed_lanes_t invalid = { 0 };
+    size_t done = 0;
+
+    /* A group reads 8 bytes but consumes `bits`: it stays within the input while 8 bytes remain */
+    for (; symbols - done >= DECODE_STEP && size - done / 8 * bits >= sizeof(uint64_t); done += DECODE_STEP) {
+        invalid |= expand8(input + done / 8 * bits, table, alphabet_size, output + done, bits);
+    }
+
+    /* Fewer than 8 bytes left, at most 14 symbols: the padding decodes to symbols that are not checked */
+    unsigned char tail[2 * sizeof(uint64_t)] = { 0 };
+    char characters[2 * DECODE_STEP];
+    size_t left = symbols - done;
+    memcpy(tail, input + done / 8 * bits, size - done / 8 * bits);
+    for (size_t i = 0; i < left; i += DECODE_STEP) {
+        expand8(tail + i / 8 * bits, table, alphabet_size, characters + i, bits);
+    }
+    unsigned int rejected = 0;
+    for (size_t i = 0; i < left; i++) {
+        rejected |= characters[i] == 0;
+    }
+    memcpy(output + done, characters, left);
+    for (unsigned int j = 0; j < 8; j++) {
+        rejected |= invalid[j];
+    }
+    return rejected == 0;
+}
+
+bool packing_decode(const char *alphabet, uint32_t alphabet_size, const unsigned char *input, size_t symbols,
+                    char *output) {
+    char table[PACKING_TABLE_SIZE] = { 0 };		/**< Character of every symbol, 0 past the alphabet */
+    memcpy(table, alphabet, alphabet_size);
+
+    switch (packing_bits(alphabet_size)) {
+        case 4: return decode_bits(table, (uint16_t)alphabet_size, input, symbols, output, 4);
+        case 5: return decode_bits(table, (uint16_t)alphabet_size, input, symbols, output, 5);
+        case 6: return decode_bits(table, (uint16_t)alphabet_size, input, symbols, output, 6);
+        case 7: return decode_bits(table, (uint16_t)alphabet_size, input, symbols, output, 7);
+        default: return false;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END DECODING - - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,93 @@
+/**
+ * @file packing.h
+ * @brief Bit-packed password characters: the index of every character in its
+ * alphabet, in as few bits as the alphabet needs.
+ *
+ * A numeric password carries 3.3 bits per character, an alphabetic one 4.7
+ * and a mixed one 5.2, but every character takes 8 bits on the wire. Packed,
+ * a character takes `packing_bits` bits: 4 for the digits, 5 for the letters,
+ * 6 for the mixed and unambiguous alphabets, 7 for the secure one. The symbols
+ * of a response form one little-endian bit stream, password after password:
+ * symbol `i` holds bits `i * bits` to `i * bits + bits - 1`, bit `p` of the
+ * stream being bit `p % 8` of byte `p / 8`; the last byte is padded with zeros.
+ *
+ * The encoder runs on the server, after the passwords were checked against the
+ * policy and written to the audit log. The decoder runs on the client: it
+ * expands 8 symbols per step in vector registers (GCC vector extensions: a word
+ * shuffle, a multiplication and a mask, a comparison with the alphabet size)
+ * and maps them to their characters with a table lookup.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef PACKING_H_
+#define PACKING_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - PACKING - - - - - - - - - - - - - - - - - - - - */
+
+#define PACKING_MIN_BITS 4		/**< Bits of the smallest alphabet that is packed (the digits) */
+#define PACKING_MAX_BITS 7		/**< Bits of the largest alphabet that can be packed */
+
+/**
+ * @brief Bits of a packed symbol of an alphabet: the base-2 logarithm of its size, rounded up.
+ * @param[in] alphabet_size Number of characters of the alphabet.
+ * @return The bits, or 0 if the alphabet cannot be packed (fewer than 9 or more than 128 characters).
+ */
+static inline unsigned int packing_bits(uint32_t alphabet_size) {
+    if (alphabet_size <= 1u << (PACKING_MIN_BITS - 1) || alphabet_size > 1u << PACKING_MAX_BITS) {
+        return 0;
+    }
+    return 32 - (unsigned int)__builtin_clz(alphabet_size - 1);
+}
+
+/**
+ * @brief Bytes taken by packed symbols.
+ * @param[in] symbols Number of symbols.
+ * @param[in] bits Bits per symbol.
+ */
+static inline size_t packing_size(size_t symbols, unsigned int bits) {
+    return (symbols * bits + 7) / 8;
+}
+
+/**
+ * @brief Packs characters of an alphabet.
+ * @details The output may be the input itself: every byte is written after the characters it packs were read.
+ * @param[in] alphabet The characters of the alphabet, at most `1 << PACKING_MAX_BITS`.
+ * @param[in] alphabet_size Number of characters of the alphabet.
+ * @param[in] characters The characters, all of them in `alphabet`.
+ * @param[in] symbols Number of characters.
+ * @param[out] output Destination of `packing_size(symbols, packing_bits(alphabet_size))` bytes.
+ * @return The number of bytes written.
+ */
+size_t packing_encode(const char *alphabet, uint32_t alphabet_size, const char *characters, size_t symbols,
+                      unsigned char *output);
+
+/**
+ * @brief Expands packed symbols back to the characters of their alphabet.
+ * @param[in] alphabet The characters of the alphabet.
+ * @param[in] alphabet_size Number of characters of the alphabet.
+ * @param[in] input The packed symbols.
+ * @param[in] symbols Number of symbols.
+ * @param[out] output Destination of `symbols` characters.
+ * @return `false` if a symbol is not the index of a character of the alphabet (the output is then unspecified).
+ */
+bool packing_decode(const char *alphabet, uint32_t alphabet_size, const unsigned char *input, size_t symbols,
+                    char *output);
+
+/* - - - - - - - - - - - - - - - - - - - END PACKING - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* PACKING_H_ */
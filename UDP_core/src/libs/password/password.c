@@ -0,0 +1,215 @@
+/**
+ * @file password.c
+ * @brief Implementation of password generation functions based on specified types and lengths.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian
+ *
+ * This file provides the entry points for generating passwords of various types:
+ * numeric, alphabetic, alphanumeric, secure, and unambiguous. The characters are
+ * produced by the table-driven engine in `generator.c`.
+ *
+ * It also provides the validation helpers used by the client before a request is
+ * sent (type, length and termination controls), so that both programs share the
+ * exact same rules.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <ctype.h>
+#include <string.h>
+#include "password.h"
+#include "libs/generator/generator.h"
+#include "libs/identifier/identifier.h"
+#include "libs/random/random.h"
+#include "libs/template/template.h"
+
+
+/* - - - - - - - - - - - - - - - - - PASSWORD GENERATION - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Writes the characters of a password based on the specified type and length.
+ *
+ * This function is the main interface for password generation. It delegates the
+ * password creation to the generator registered for `type` (see `generator.h`),
+ * drawing randomness from the calling thread's CSPRNG stream, and writes exactly
+ * `length` characters, without a terminator, so that passwords can be generated
+ * in place inside a packet buffer.
+ *
+ * @param[out] password Pointer to the first character of the destination.
+ * @param[in] type The type of password to generate (see `PasswordType` enum).
+ * @param[in] length The desired length of the password. Must be a positive integer.
+ *
+ * @pre The `password` array should have enough space to hold `length` characters.
+ * @pre `type` should be one of the valid values in the `PasswordType` enum.
+ * @post The first `length` characters of `password` contain a password of the specified type.
+ */
+void fill_password(char *password, PasswordType type, int length) {
+    const Generator *generator = generator_for_type(type);
+    if (length <= MAX_PASSWORD_LENGTH) {
+        generator_fill(generator, password, length, random_thread_stream());
+    } else {
+        generator_fill_any(generator, password, (size_t)length, random_thread_stream());
+    }
+}
+
+/**
+ * @brief Answers a decoded generation request, writing the response in place.
+ *
+ * The generator is found with a single table lookup on the wire type byte and
+ * every password is generated at its final offset in `buffer`. Identifiers come
+ * from a worker of the calling thread, on node 0; random bytes from its stream;
+ * templates from the thread's own cache of programs. A template that does not
+ * compile, or not to the requested length, is answered `STATUS_BAD_REQUEST`.
+ *
+ * @param[in] request A request accepted by `codec_decode_request`.
+ * @param[out] buffer Buffer receiving the response.
+ * @param[in] capacity Size of `buffer`.
+ * @return The size of the response, 0 if it does not fit.
+ */
+size_t generate_response(const RequestView *request, unsigned char *buffer, size_t capacity) {
+    static _Thread_local IdentifierState identifiers;
+    static _Thread_local bool identifiers_ready;
+    static _Thread_local TemplateCache templates;
+    static _Thread_local bool templates_ready;
+    const Generator *generator = generator_lookup(request->type);	/**< Validated by the codec */
+    const IdentifierFormat *format = identifier_lookup(request->type);
+    RandomStream *stream = random_thread_stream();
+
+    uint16_t count = codec_response_count(request);
+    size_t response_size = codec_encode_response(buffer, capacity, request, STATUS_OK, count);
+    if (format != NULL) {
+        if (!identifiers_ready) {
+            identifier_state_init(&identifiers, 0);
+            identifiers_ready = true;
+        }
+        if (response_size > 0) {
+            identifier_fill(&identifiers, format, codec_response_password(buffer, request, 0), count, stream);
+        }
+        return response_size;
+    }
+    if (codec_is_random_bytes(request->type)) {
+        if (response_size > 0) {
+            random_stream_bytes(stream, codec_response_password(buffer, request, 0), (size_t)count * request->length);
+        }
+        return response_size;
+    }
+    if (codec_is_template(request->type)) {
+        if (!templates_ready) {
+            template_cache_init(&templates, stream);
+            templates_ready = true;
+        }
+        const TemplateProgram *program = template_cache_lookup(&templates, (const char *)request->body,
+                                                               request->body_size);
+        if (program == NULL || program->length != request->length) {
+            return codec_encode_response(buffer, capacity, request, STATUS_BAD_REQUEST, 0);
+        }
+        if (response_size > 0) {
+            template_run(program, codec_response_password(buffer, request, 0), count, stream);
+        }
+        return response_size;
+    }
+    for (uint16_t i = 0; i < count && response_size > 0; i++) {
+        generator_fill(generator, codec_response_password(buffer, request, i), request->length, stream);
+    }
+    return response_size;
+}
+
+/**
+ * @brief Generates a null-terminated password based on the specified type and length.
+ *
+ * @param[out] password Pointer to a pre-allocated array where the password will be stored.
+ * @param[in] type The type of password to generate (see `PasswordType` enum).
+ * @param[in] length The desired length of the password. Must be a positive integer.
+ *
+ * @pre The `password` array should have enough space to hold `length + 1` characters.
+ * @pre `type` should be one of the valid values in the `PasswordType` enum.
+ * @post The `password` array contains a null-terminated password of the specified type.
+ */
+void generate_password(char *password, PasswordType type, int length) {
+    fill_password(password, type, length);
+    password[length] = '\0';	/**< Null-terminate the password */
+}
+
+/* - - - - - - - - - - - - - - - - END PASSWORD GENERATION - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - PASSWORD CONTROLS - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Determines whether password generation should continue based on the specified ending type.
+ *
+ * This function checks if the current password type differs from a specified ending type.
+ * If the two types are identical (case insensitive), generation should stop.
+ *
+ * @param[in] type The current password type being processed.
+ * @param[in] type_for_ending The type used to indicate the end of password generation.
+ *
+ * @return `true` if `type` is not equal to `type_for_ending`, indicating generation can continue.
+ * @return `false` if `type` is equal to `type_for_ending`, signaling generation should stop.
+ *
+ * @pre `type` and `type_for_ending` must be valid characters.
+ * @post The function returns a boolean value indicating whether generation should proceed.
+ * @note The comparison is case insensitive.
+ */
+bool keep_generating(const char type, const char type_for_ending) {
+    return tolower(type) != tolower(type_for_ending);
+}
+
+
+/**
+ * @brief Checks whether the specified type is among the allowed types for password generation.
+ *
+ * This function verifies if a given type character is present in a string of allowed types.
+ * The comparison is case sensitive.
+ *
+ * @param[in] allowed_type A null-terminated string containing all valid types.
+ * @param[in] type The type to validate.
+ *
+ * @return `true` if `type` is found in `allowed_type`.
+ * @return `false` if `type` is not found in `allowed_type`.
+ *
+ * @pre `allowed_type` must be a valid null-terminated string.
+ * @pre `type` must be a valid character.
+ * @post The function returns a boolean indicating whether the type is valid.
+ * @warning Passing `NULL` as `allowed_type` results in undefined behavior.
+ */
+bool control_type(const char *allowed_type, const char type) {
+    return strchr(allowed_type, type) != NULL;
+}
+
+
+/**
+ * @brief Validates whether the password length is within the allowed range and is a positive integer.
+ *
+ * This function first checks that the input string `length` contains only numeric characters.
+ * It then converts the string to an integer and validates that the integer is within the
+ * range defined by `min_length` and `max_length`.
+ *
+ * @param[in] length A null-terminated string representing the requested password length.
+ * @param[in] min_length The minimum allowable length for a password.
+ * @param[in] max_length The maximum allowable length for a password.
+ *
+ * @return `true` if `length` is a numeric string representing a value within the range.
+ * @return `false` if `length` is not numeric or falls outside the allowed range.
+ *
+ * @pre `length` must be a valid null-terminated string.
+ * @pre `min_length` and `max_length` must be positive integers, and `min_length < max_length`.
+ * @post The function returns a boolean indicating the validity of the password length.
+ * @note Leading zeros in the `length` string are ignored during validation.
+ * @warning Overflow is not handled explicitly when converting large strings to integers.
+ */
+bool control_length(const char *length, const int min_length, const int max_length) {
+    // Check if all characters in `length` are digits
+    for (int i = 0; length[i] != '\0'; i++) {
+        if (!isdigit(length[i])) {
+            return false;
+        }
+    }
+
+    // Convert `length` to an integer and validate the range
+    int numerical_length = atoi(length);
+    return numerical_length >= min_length && numerical_length <= max_length;
+}
+
+/* - - - - - - - - - - - - - - - END PASSWORD CONTROLS - - - - - - - - - - - - - - - - */
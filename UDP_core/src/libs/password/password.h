@@ -0,0 +1,159 @@
+/**
+ * @file password.h
+ * @brief Header file providing functions to generate and validate passwords
+ *        based on specified criteria.
+ *
+ * This header is shared by the client and the server: the server uses the
+ * generation functions, the client uses the controls to validate user input
+ * before a request is sent.
+ *
+ * @version 1.1.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef PASSWORD_H_
+#define PASSWORD_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "libs/codec/codec.h"
+
+
+/* - - - - - - - - - - - - - - - - - - - PASSWORD TYPES - - - - - - - - - - - - - - - - - */
+
+/**
+ * @enum PasswordType
+ * @brief Enumerates the types of passwords that can be generated.
+ *
+ * This enumeration defines the different formats of passwords that the system can generate:
+ * - `NUMERIC`: Generates a password consisting of numeric digits only (0-9).
+ * - `ALPHA`: Generates a password using lowercase alphabetic characters (a-z).
+ * - `MIXED`: Generates a password drawn uniformly from lowercase alphabetic characters and numeric digits.
+ * - `SECURE`: Generates a password using lowercase and uppercase alphabetic characters, digits, and symbols.
+ * - `UNAMBIGUOUS`: Generates a secure password excluding ambiguous characters (e.g., O/0, l/1, etc.).
+ */
+typedef enum {
+    NUMERIC,     /**< Numeric password: digits only (0-9) */
+    ALPHA,       /**< Lowercase alphabetic password: letters only (a-z) */
+    MIXED,       /**< Lowercase alphanumeric password: letters and digits */
+    SECURE,      /**< Secure password: uppercase, lowercase, digits, and symbols */
+    UNAMBIGUOUS  /**< Unambiguous secure password: excludes similar-looking characters */
+} PasswordType;
+
+/* - - - - - - - - - - - - - - - - - - END PASSWORD TYPES - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - PASSWORD GENERATION - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Generates a password based on the specified type and length.
+ *
+ * This function creates a password using the specified `type` (NUMERIC, ALPHA, MIXED, SECURE, UNAMBIGUOUS)
+ * and the desired length. The generated password is stored in the `password` array, which must
+ * be pre-allocated by the caller. The `password` will be null-terminated.
+ *
+ * ### Password Type Details:
+ * - **NUMERIC**: Only numeric digits (e.g., "837261").
+ * - **ALPHA**: Only lowercase alphabetic characters (e.g., "qwerty").
+ * - **MIXED**: Combination of lowercase alphabetic characters and digits (e.g., "abc123").
+ * - **SECURE**: Combination of lowercase/uppercase letters, digits, and symbols (e.g., "Pa$sW0rd!").
+ * - **UNAMBIGUOUS**: Similar to SECURE but excludes ambiguous characters like `O`, `0`, `l`, `1` (e.g., "Tg@8%Yk").
+ *
+ * @param[out] password A pre-allocated array to store the generated password.
+ *                      Must have space for at least `length + 1` characters
+ *                      (to account for the null terminator).
+ * @param[in] type The type of password to generate, as defined in the `PasswordType` enum.
+ * @param[in] length The desired length of the generated password (must be > 0).
+ *
+ * @pre `password` must be a valid pointer to a pre-allocated array.
+ * @pre `length` must be greater than zero and less than or equal to the maximum supported length.
+ * @post The `password` array will be populated with a null-terminated password of the specified type and length.
+ * @note Every character is drawn uniformly from the alphabet of `type` using a ChaCha20-based CSPRNG.
+ * @note The behavior is undefined if `password` is not allocated or `length` is invalid.
+ */
+void generate_password(char *password, PasswordType type, int length);
+
+/**
+ * @brief Writes the characters of a password without a null terminator.
+ *
+ * Same as `generate_password`, but writes exactly `length` characters. It is
+ * used to generate passwords in place, at their final offset in a response
+ * buffer, where consecutive passwords are not separated by terminators.
+ *
+ * @param[out] password Pointer to the first character of the destination.
+ * @param[in] type The type of password to generate, as defined in the `PasswordType` enum.
+ * @param[in] length The desired length of the generated password (must be > 0).
+ *
+ * @pre `password` must point to at least `length` writable characters.
+ * @post The first `length` characters of `password` contain the generated password.
+ */
+void fill_password(char *password, PasswordType type, int length);
+
+/**
+ * @brief Answers a decoded generation request, writing the response in place.
+ *
+ * The passwords are generated directly at their final offset in the response
+ * buffer. The server answers its requests with this function, and the client
+ * library uses it to serve requests locally with the same engine and CSPRNG.
+ *
+ * @param[in] request A request accepted by `codec_decode_request`.
+ * @param[out] buffer Buffer receiving the response.
+ * @param[in] capacity Size of `buffer`.
+ * @return The size of the response, 0 if it does not fit.
+ */
+size_t generate_response(const RequestView *request, unsigned char *buffer, size_t capacity);
+
+/* - - - - - - - - - - - - - - - - - END PASSWORD GENERATION - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - PASSWORD CONTROLS - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Determines whether password generation should continue.
+ *
+ * Compares the current password type (`type`) to a termination type (`type_for_ending`).
+ * Password generation continues only if they differ.
+ *
+ * @param[in] type The current type of password being processed.
+ * @param[in] type_for_ending The type signaling termination of generation.
+ * @pre `type` and `type_for_ending` should be valid single characters.
+ * @return `true` if `type` is different from `type_for_ending`, allowing generation to continue.
+ * @return `false` if `type` matches `type_for_ending`, signaling the end of generation.
+ */
+bool keep_generating(const char type, const char type_for_ending);
+
+
+/**
+ * @brief Validates the requested password type against allowed values.
+ *
+ * Ensures that the `type` is among a predefined set of allowed characters.
+ * Examples of valid types might include numeric ('n'), alphabetic ('a'), mixed ('m'), etc.
+ *
+ * @param[in] allowed_type A string containing valid password types (e.g., "nams").
+ * @param[in] type The specific password type to validate.
+ * @pre `allowed_type` should not be NULL and must be null-terminated.
+ * @pre `type` should be a single character.
+ * @return `true` if `type` is present in `allowed_type`.
+ * @return `false` if `type` is not in `allowed_type`.
+ */
+bool control_type(const char *allowed_type, const char type);
+
+
+/**
+ * @brief Verifies if the requested password length is valid.
+ *
+ * Ensures the `length` string represents a positive integer within the specified range
+ * (`[min_length, max_length]`). Handles invalid or non-numeric input gracefully.
+ *
+ * @param[in] length A string representing the desired password length.
+ * @param[in] min_length The minimum allowable password length.
+ * @param[in] max_length The maximum allowable password length.
+ * @pre `length` should be a null-terminated numeric string.
+ * @return `true` if `length` is numeric and within the valid range.
+ * @return `false` if `length` is invalid, negative, or out of range.
+ */
+bool control_length(const char *length, const int min_length, const int max_length);
+
+/* - - - - - - - - - - - - - - - - - END PASSWORD CONTROLS - - - - - - - - - - - - - - - - - */
+
+#endif /* PASSWORD_H_ */
@@ -0,0 +1,251 @@
+/**
+ * @file prefetch.c
+ * @brief Implementation of the client-side prefetch buffer.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "prefetch.h"
+#include "libs/clock/clock.h"
+#include "libs/codec/codec.h"
+
+/*
+ * The tag of a refill request carries the pool index in its low 32 bits and
+ * the number of passwords requested in the high 32 bits, so that a failed
+ * request can be taken off `in_flight` without any other bookkeeping.
+ */
+#define REFILL_TAG(pool, count) ((uint64_t)(pool) | ((uint64_t)(count) << 32))
+#define REFILL_POOL(tag) ((size_t)((tag) & 0xFFFFFFFFu))
+#define REFILL_COUNT(tag) ((size_t)((tag) >> 32))
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Clears memory holding passwords; the stores cannot be removed by the optimiser.
+ */
+static void wipe(void *memory, size_t size) {
+    volatile unsigned char *bytes = memory;
+    while (size-- > 0) {
+        *bytes++ = 0;
+    }
+}
+
+/**
+ * @brief Returns the ring entry at `index` positions from the oldest password.
+ */
+static char *pool_entry(const Prefetcher *prefetcher, const PrefetchPool *pool, size_t index) {
+    size_t slot = (pool->head + index) % prefetcher->config.capacity;
+    return pool->passwords + slot * pool->length;
+}
+
+/**
+ * @brief Removes the oldest password of a pool, wiping it.
+ */
+static void pool_drop(Prefetcher *prefetcher, PrefetchPool *pool) {
+    wipe(pool_entry(prefetcher, pool, 0), pool->length);
+    pool->head = (pool->head + 1) % prefetcher->config.capacity;
+    pool->count--;
+}
+
+/**
+ * @brief Finds the pool of a (type, length), creating it on first use.
+ * @return The pool, or `NULL` if the pair is invalid or no pool is left.
+ */
+static PrefetchPool *find_pool(Prefetcher *prefetcher, char type, uint8_t length) {
+    if (codec_check_type(type, length) != CODEC_OK) {
+        return NULL;
+    }
+    for (size_t i = 0; i < prefetcher->pool_count; i++) {
+        PrefetchPool *pool = &prefetcher->pools[i];
+        if (pool->type == type && pool->length == length) {
+            return pool;
+        }
+    }
+    if (prefetcher->pool_count == PREFETCH_MAX_POOLS) {
+        return NULL;
+    }
+
+    PrefetchPool *pool = &prefetcher->pools[prefetcher->pool_count];
+    *pool = (PrefetchPool){ .type = type, .length = length, .failure = STATUS_OK };
+    pool->passwords = malloc(prefetcher->config.capacity * length);
+    pool->arrival_ns = malloc(prefetcher->config.capacity * sizeof(uint64_t));
+    if (pool->passwords == NULL || pool->arrival_ns == NULL) {
+        free(pool->passwords);
+        free(pool->arrival_ns);
+        return NULL;
+    }
+    prefetcher->pool_count++;
+    return pool;
+}
+
+/**
+ * @brief Discards the passwords of a pool that exceeded the maximum age.
+ */
+static void expire_pool(Prefetcher *prefetcher, PrefetchPool *pool, uint64_t now_ns) {
+    uint64_t max_age_ns = prefetcher->config.max_age_ms * NANOSECONDS_PER_MILLISECOND;
+
+    if (max_age_ns == 0) {
+        return;
+    }
+    while (pool->count > 0 && now_ns - pool->arrival_ns[pool->head] > max_age_ns) {
+        pool_drop(prefetcher, pool);
+        prefetcher->stats.expired++;
+    }
+}
+
+/**
+ * @brief Puts refill requests in flight when a pool is below its low-water mark.
+ * @param[in] force Refill even above the low-water mark (empty pool with nothing in flight).
+ */
+static void refill_pool(Prefetcher *prefetcher, PrefetchPool *pool, bool force) {
+    size_t capacity = prefetcher->config.capacity;
+
+    if (!force && pool->count + pool->in_flight >= prefetcher->config.low_water) {
+        return;
+    }
+    while (pool->count + pool->in_flight < capacity && client_can_submit(prefetcher->client)) {
+        size_t count = capacity - pool->count - pool->in_flight;
+        if (count > client_max_count(prefetcher->client, pool->type, pool->length)) {
+            count = client_max_count(prefetcher->client, pool->type, pool->length);
+        }
+        client_submit(prefetcher->client, pool->type, pool->length, (uint16_t)count,
+                      REFILL_TAG(pool - prefetcher->pools, count));
+        pool->in_flight += count;
+        prefetcher->stats.refills++;
+    }
+}
+
+/**
+ * @brief Client callback: appends the passwords of a refill to their pool.
+ */
+static void store_refill(void *context, uint64_t tag, const ResponseView *response) {
+    Prefetcher *prefetcher = context;
+    PrefetchPool *pool = &prefetcher->pools[REFILL_POOL(tag)];
+    uint64_t now_ns = clock_now_ns();
+
+    pool->in_flight -= REFILL_COUNT(tag);
+    if (response == NULL || response->status != STATUS_OK) {
+        pool->failure = response == NULL ? STATUS_UNAVAILABLE : (ResponseStatus)response->status;
+        return;
+    }
+    pool->failure = STATUS_OK;
+    for (uint16_t i = 0; i < response->count && pool->count < prefetcher->config.capacity; i++) {
+        size_t slot = (pool->head + pool->count) % prefetcher->config.capacity;
+        memcpy(pool->passwords + slot * pool->length, response->passwords + (size_t)i * response->length, pool->length);
+        pool->arrival_ns[slot] = now_ns;
+        pool->count++;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - PREFETCH - - - - - - - - - - - - - - - - - - - - */
+
+PrefetchConfig prefetch_default_config(void) {
+    return (PrefetchConfig){
+        .capacity = PREFETCH_DEFAULT_CAPACITY,
+        .low_water = PREFETCH_DEFAULT_CAPACITY / 4,
+        .max_age_ms = PREFETCH_DEFAULT_MAX_AGE_MS
+    };
+}
+
+void prefetch_init(Prefetcher *prefetcher, PassgenClient *client, const PrefetchConfig *config) {
+    memset(prefetcher, 0, sizeof(*prefetcher));
+    prefetcher->client = client;
+    prefetcher->config = *config;
+}
+
+bool prefetch_warm(Prefetcher *prefetcher, char type, uint8_t length) {
+    PrefetchPool *pool = find_pool(prefetcher, type, length);
+    if (pool == NULL) {
+        return false;
+    }
+    refill_pool(prefetcher, pool, true);
+    return true;
+}
+
+ResponseStatus prefetch_take(Prefetcher *prefetcher, char type, uint8_t length, char *password) {
+    PrefetchPool *pool = find_pool(prefetcher, type, length);
+    if (pool == NULL) {
+        return STATUS_BAD_REQUEST;
+    }
+
+    /* Collect the refills that already arrived, without blocking; above the
+       low-water mark they can stay in the socket buffer and the hand-out makes no system call */
+    if (pool->in_flight > 0 && pool->count < prefetcher->config.low_water && !prefetch_poll(prefetcher, 0)) {
+        return STATUS_UNAVAILABLE;
+    }
+    expire_pool(prefetcher, pool, clock_now_ns());
+
+    if (pool->count == 0) {
+        prefetcher->stats.misses++;
+        pool->failure = STATUS_OK;
+        while (pool->count == 0) {
+            if (pool->in_flight == 0) {
+                if (pool->failure != STATUS_OK) {
+                    return pool->failure;
+                }
+                refill_pool(prefetcher, pool, true);
+            }
+            if (client_poll(prefetcher->client, -1, store_refill, prefetcher) < 0) {
+                return STATUS_UNAVAILABLE;
+            }
+        }
+    } else {
+        prefetcher->stats.hits++;
+    }
+
+    memcpy(password, pool_entry(prefetcher, pool, 0), length);
+    pool_drop(prefetcher, pool);
+    refill_pool(prefetcher, pool, false);
+    return STATUS_OK;
+}
+
+ResponseStatus prefetch_try_take(Prefetcher *prefetcher, char type, uint8_t length, char *password) {
+    PrefetchPool *pool = find_pool(prefetcher, type, length);
+    if (pool == NULL) {
+        return STATUS_BAD_REQUEST;
+    }
+
+    expire_pool(prefetcher, pool, clock_now_ns());
+    if (pool->count == 0) {
+        prefetcher->stats.misses++;
+        refill_pool(prefetcher, pool, pool->in_flight == 0);
+        return STATUS_UNAVAILABLE;
+    }
+    prefetcher->stats.hits++;
+    memcpy(password, pool_entry(prefetcher, pool, 0), length);
+    pool_drop(prefetcher, pool);
+    refill_pool(prefetcher, pool, false);
+    return STATUS_OK;
+}
+
+bool prefetch_poll(Prefetcher *prefetcher, int timeout_ms) {
+    if (prefetcher->client->outstanding > 0
+        && client_poll(prefetcher->client, timeout_ms, store_refill, prefetcher) < 0) {
+        return false;
+    }
+
+    uint64_t now_ns = clock_now_ns();
+    for (size_t i = 0; i < prefetcher->pool_count; i++) {
+        expire_pool(prefetcher, &prefetcher->pools[i], now_ns);
+        refill_pool(prefetcher, &prefetcher->pools[i], false);
+    }
+    return true;
+}
+
+void prefetch_close(Prefetcher *prefetcher) {
+    for (size_t i = 0; i < prefetcher->pool_count; i++) {
+        PrefetchPool *pool = &prefetcher->pools[i];
+        wipe(pool->passwords, prefetcher->config.capacity * pool->length);
+        free(pool->passwords);
+        free(pool->arrival_ns);
+    }
+    prefetcher->pool_count = 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END PREFETCH - - - - - - - - - - - - - - - - - - - */
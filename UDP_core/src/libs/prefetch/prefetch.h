@@ -0,0 +1,149 @@
+/**
+ * @file prefetch.h
+ * @brief Local buffer of prefetched passwords on top of the client library.
+ *
+ * An application that needs passwords at a steady rate should not pay a
+ * network round trip for each of them. A `Prefetcher` keeps one pool of
+ * passwords per (type, length) and hands them out with a copy; when a pool
+ * falls below its low-water mark, batch requests to refill it are put in
+ * flight without waiting for them. Their answers are collected by the next
+ * `prefetch_take` or `prefetch_poll`, which never block while the pool still
+ * has passwords.
+ *
+ * A password is wiped from the pool as soon as it is handed out, and
+ * passwords older than the configured maximum age are wiped unused.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/client/client.h"
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define PREFETCH_MAX_POOLS 16				/**< Distinct (type, length) pairs served */
+#define PREFETCH_DEFAULT_CAPACITY 1024		/**< Passwords kept per pool unless configured otherwise */
+#define PREFETCH_DEFAULT_MAX_AGE_MS 60000	/**< Staleness limit unless configured otherwise */
+
+/**
+ * @struct PrefetchConfig
+ * @brief Sizing of the pools.
+ */
+typedef struct {
+    size_t capacity;		/**< Passwords kept per pool */
+    size_t low_water;		/**< A refill starts when a pool holds fewer passwords than this */
+    uint64_t max_age_ms;	/**< Passwords older than this are discarded, 0 keeps them forever */
+} PrefetchConfig;
+
+/**
+ * @struct PrefetchPool
+ * @brief Passwords of one (type, length), oldest first.
+ */
+typedef struct {
+    char type;					/**< Password type */
+    uint8_t length;				/**< Password length */
+    char *passwords;			/**< Ring of `capacity` passwords of `length` characters */
+    uint64_t *arrival_ns;		/**< Arrival time of each ring entry */
+    size_t head;				/**< Oldest password */
+    size_t count;				/**< Passwords in the pool */
+    size_t in_flight;			/**< Passwords requested and not arrived yet */
+    ResponseStatus failure;		/**< Status of the last failed refill, `STATUS_OK` if none */
+} PrefetchPool;
+
+/**
+ * @struct PrefetchStats
+ * @brief Counters of a prefetcher.
+ */
+typedef struct {
+    uint64_t hits;		/**< Passwords handed out without waiting */
+    uint64_t misses;	/**< Passwords that had to wait for a refill */
+    uint64_t refills;	/**< Batch requests sent */
+    uint64_t expired;	/**< Passwords discarded for being too old */
+} PrefetchStats;
+
+/**
+ * @struct Prefetcher
+ * @brief The pools and the client refilling them.
+ */
+typedef struct {
+    PassgenClient *client;					/**< Client used for the refills, dedicated to the prefetcher */
+    PrefetchConfig config;					/**< Sizing of the pools */
+    size_t pool_count;						/**< Pools created so far */
+    PrefetchPool pools[PREFETCH_MAX_POOLS];	/**< Pools, created on first use */
+    PrefetchStats stats;					/**< Counters */
+} Prefetcher;
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - PREFETCH - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Returns the default sizing: 1024 passwords per pool, refill below a quarter, one minute of staleness.
+ * @return The default configuration.
+ */
+PrefetchConfig prefetch_default_config(void);
+
+/**
+ * @brief Initialises a prefetcher. No pool is filled until it is first used.
+ * @param[out] prefetcher The prefetcher.
+ * @param[in] client An open client, only used by this prefetcher from now on.
+ * @param[in] config Sizing of the pools (`capacity` > 0, `low_water` <= `capacity`).
+ */
+void prefetch_init(Prefetcher *prefetcher, PassgenClient *client, const PrefetchConfig *config);
+
+/**
+ * @brief Starts filling the pool of a (type, length) ahead of its first use.
+ * @param[in,out] prefetcher The prefetcher.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @return `false` if the pair is invalid or every pool is in use.
+ */
+bool prefetch_warm(Prefetcher *prefetcher, char type, uint8_t length);
+
+/**
+ * @brief Hands out one password, waiting for a refill only if its pool is empty.
+ * @param[in,out] prefetcher The prefetcher.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[out] password Buffer of `length` characters receiving the password (not terminated).
+ * @return `STATUS_OK`, `STATUS_BAD_REQUEST` for an invalid pair, or the status of the failed refill.
+ */
+ResponseStatus prefetch_take(Prefetcher *prefetcher, char type, uint8_t length, char *password);
+
+/**
+ * @brief Hands out one password only if its pool holds one, never waiting.
+ * @details An empty pool counts as a miss and starts a refill; its answer is collected
+ * by a later `prefetch_poll`, which an event loop calls when the client socket is readable.
+ * @param[in,out] prefetcher The prefetcher.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[out] password Buffer of `length` characters receiving the password (not terminated).
+ * @return `STATUS_OK`, `STATUS_BAD_REQUEST` for an invalid pair or `STATUS_UNAVAILABLE` if the pool is empty.
+ */
+ResponseStatus prefetch_try_take(Prefetcher *prefetcher, char type, uint8_t length, char *password);
+
+/**
+ * @brief Collects the refills that arrived and discards stale passwords.
+ * @param[in,out] prefetcher The prefetcher.
+ * @param[in] timeout_ms Maximum wait for an answer (0 never blocks).
+ * @return `false` on a socket error.
+ */
+bool prefetch_poll(Prefetcher *prefetcher, int timeout_ms);
+
+/**
+ * @brief Wipes and frees every pool. The client is left open.
+ * @param[in,out] prefetcher The prefetcher.
+ */
+void prefetch_close(Prefetcher *prefetcher);
+
+/* - - - - - - - - - - - - - - - - - - - END PREFETCH - - - - - - - - - - - - - - - - - - - */
+
+#endif /* PREFETCH_H_ */
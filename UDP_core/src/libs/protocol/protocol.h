@@ -0,0 +1,467 @@
+/**
+ * @file protocol.h
+ * @brief Header file used to define constants, structs, and protocol-specific
+ * data structures shared by `UDP_client.c` and `UDP_server.c`.
+ *
+ * This file centralizes the communication parameters, such as buffer size,
+ * password constraints, and data structures for request-response handling.
+ * It lives in the core library so that the client and the server can never
+ * disagree on the wire layout; the layout itself is checked at compile time.
+ *
+ * @version 1.1.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+/**
+ * @brief Compile-time assertion usable from both C11 and C++ translation units.
+ */
+#if defined(__cplusplus)
+#define PROTOCOL_STATIC_ASSERT(condition, message) static_assert(condition, message)
+#else
+#define PROTOCOL_STATIC_ASSERT(condition, message) _Static_assert(condition, message)
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - CONSTANTS - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Defines the maximum size of the buffer used for communication.
+ *
+ * The buffer serves multiple purposes, such as:
+ * - Storing server names.
+ * - Handling password lengths during requests.
+ * - General communication needs between client and server.
+ *
+ * Using a large buffer size ensures flexibility for various operations,
+ * while avoiding memory overflow risks.
+ */
+#define BUFFER_SIZE 1024        /**< Maximum dimension of the buffer */
+
+
+/**
+ * @brief Maximum allowable length for a generated password.
+ *
+ * Passwords longer than this value will not be accepted by the client or server.
+ * This constant ensures compatibility and usability across different systems.
+ */
+#define MAX_PASSWORD_LENGTH 32  /**< Maximum password length */
+
+/**
+ * @brief Minimum allowable length for a generated password.
+ *
+ * Passwords shorter than this value are considered insecure and will be rejected.
+ */
+#define MIN_PASSWORD_LENGTH 6  /**< Minimum allowed password length */
+
+
+/**
+ * @brief Default port number used for client-server communication.
+ *
+ * The client will connect to the server using this port unless specified otherwise.
+ * The default value of 8080 is commonly used for development and testing purposes.
+ */
+#define DEFAULT_PORT 8080       /**< Default port number for communication */
+
+/**
+ * @brief Default IP address for server-client communication.
+ * The default IP is set to `127.0.0.1`, which is the loopback address for local communication.
+ */
+#define DEFAULT_IP "127.0.0.1"  /**< IP address used for the connection */
+
+/* - - - - - - - - - - - - - - - - - - - END CONSTANTS - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - STRUCTURES  - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @struct PasswordRequest
+ * @brief Represents the client's request for password generation.
+ *
+ * This structure is sent from the client to the server and includes:
+ * - `type`: Specifies the type of password (e.g., numeric, alphanumeric, etc.).
+ * - `length`: A string indicating the desired length of the generated password.
+ *
+ * @note The `length` is stored as a string to facilitate flexible input validation
+ *       and to avoid integer overflow issues during parsing.
+ */
+typedef struct {
+    char type;        				/**< Type of password requested ('n', 'a', 'm', etc.) */
+    char length[BUFFER_SIZE];       /**< Desired length of the password as a string */
+} PasswordRequest;
+
+/**
+ * @struct PasswordResponse
+ * @brief Represents the server's response containing the generated password.
+ *
+ * This structure is sent from the server to the client and includes:
+ * - `password`: The actual password generated by the server.
+ *
+ * @note The `password` field is null-terminated to ensure proper handling as a C string.
+ */
+typedef struct {
+    char password[MAX_PASSWORD_LENGTH + 1];  /**< The generated password */
+} PasswordResponse;
+
+/* - - - - - - - - - - - - - - - - - - - END OF STRUCTURES - - - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - COMPACT WIRE FORMAT - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Maximum size of a datagram exchanged by client and server.
+ *
+ * Chosen so that a datagram fits in a single Ethernet frame (1500 bytes MTU
+ * minus the IPv4 and UDP headers) and never needs IP fragmentation.
+ */
+#define MAX_DATAGRAM_SIZE 1472
+
+/**
+ * @brief First byte of every compact message.
+ *
+ * Legacy `PasswordRequest` messages start with an ASCII type letter, so a
+ * non-ASCII magic byte lets the server tell the two formats apart.
+ */
+#define PROTOCOL_MAGIC 0xA7
+#define PROTOCOL_VERSION 1		/**< Version of the compact wire format */
+
+/**
+ * @brief Layout of a compact request header (all integers big-endian).
+ *
+ * | Offset | Size | Field                                   |
+ * |--------|------|-----------------------------------------|
+ * | 0      | 1    | magic (`PROTOCOL_MAGIC`)                |
+ * | 1      | 1    | version (`PROTOCOL_VERSION`)            |
+ * | 2      | 1    | password type ('n', 'a', 'm', 's', 'u') |
+ * | 3      | 1    | password length                         |
+ * | 4      | 2    | number of passwords requested           |
+ * | 6      | 1    | operation (`RequestOperation`)          |
+ * | 7      | 1    | flags (`REQUEST_FLAG_*`)                |
+ * | 8      | 4    | request id, echoed in the response      |
+ *
+ * Some operations append a fixed-size body after the header (see below), after
+ * the deadline, cookie, key and tenant extensions when there are some, in this
+ * order. A request of a tenant ends with its MAC (`TENANT_MAC_SIZE`).
+ */
+#define REQUEST_HEADER_SIZE 12
+
+/**
+ * @brief Type of the requests for raw random bytes ('b', either case).
+ *
+ * The "passwords" of such a request are `length` bytes, of any value, straight
+ * from the CSPRNG of the server: `count` of them make `count * length` bytes
+ * of seed material. The length may be as short as `MIN_RANDOM_BYTES_LENGTH`, so
+ * that a request with a length of 1 asks for exactly `count` bytes. Random
+ * bytes are only served in the compact format (a legacy answer is a string),
+ * and over the TCP bulk endpoint with `FRAMING_LENGTH_PREFIX`; a server may
+ * limit the bytes each client takes (`STATUS_QUOTA_EXCEEDED`).
+ */
+#define RANDOM_BYTES_TYPE 'b'
+#define MIN_RANDOM_BYTES_LENGTH 1	/**< Shortest unit of random bytes */
+
+/**
+ * @brief Type of the requests for passwords following a template ('p', either case).
+ *
+ * The body of such an `OP_GENERATE` request is the template itself, 1 to
+ * `TEMPLATE_MAX_SIZE` bytes without a terminator (see `libs/template` for the
+ * language), and its length field the number of characters the template
+ * produces, 1 to `MAX_PASSWORD_LENGTH`. A template that does not compile, or
+ * that produces another length, is answered `STATUS_BAD_REQUEST`. Templates
+ * are only served in the compact format, one datagram at a time: they have no
+ * stream nor bulk transfer.
+ */
+#define TEMPLATE_TYPE 'p'
+#define TEMPLATE_MAX_SIZE 64		/**< Longest template */
+
+/**
+ * @enum RequestOperation
+ * @brief What the client asks the server to do.
+ * @details The control operations (`OP_CREDIT`, `OP_UNSUBSCRIBE` and `OP_STATS`)
+ * carry no passwords: their type and length fields must be 0.
+ */
+typedef enum {
+    OP_GENERATE = 0,	/**< Answer with `count` passwords (single or batch request) */
+    OP_SUBSCRIBE = 1,	/**< Open a stream identified by the request id (body: `SUBSCRIBE_BODY_SIZE`) */
+    OP_CREDIT = 2,		/**< Grant more datagrams to an open stream (body: `CREDIT_BODY_SIZE`) */
+    OP_UNSUBSCRIBE = 3,	/**< Close an open stream */
+    OP_BULK = 4,		/**< TCP only: stream a large number of passwords (body: `BULK_BODY_SIZE`) */
+    OP_STATS = 5		/**< Loopback only: report the heaviest and distinct clients (body: `STATS_BODY_SIZE`) */
+} RequestOperation;
+
+/**
+ * @enum RequestPriority
+ * @brief Priority class asked for by a request, in the `REQUEST_FLAG_PRIORITY` bits of the flags.
+ * @details With `PRIORITY_AUTO` the server classifies the request by its source and its size.
+ */
+typedef enum {
+    PRIORITY_AUTO = 0,			/**< Let the server decide */
+    PRIORITY_INTERACTIVE = 1,	/**< A user is waiting: served before any bulk traffic */
+    PRIORITY_BULK = 2			/**< Throughput traffic: shared fairly between clients */
+} RequestPriority;
+
+#define REQUEST_FLAG_PRIORITY 0x03	/**< Flag bits holding the `RequestPriority` */
+#define REQUEST_FLAG_DEADLINE 0x04	/**< A deadline extension follows the header */
+#define REQUEST_FLAG_COOKIE 0x08	/**< A cookie extension follows */
+#define REQUEST_FLAG_ENCRYPTED 0x10	/**< A key extension follows */
+#define REQUEST_FLAG_TENANT 0x20	/**< A tenant extension follows, and a MAC ends the request */
+#define REQUEST_FLAG_PACKED 0x40	/**< Bit-pack the passwords of the answer (`ENCODING_PACKED`) */
+#define REQUEST_FLAGS_KNOWN 0x7F	/**< Every flag defined; a request with another bit set is refused, since
+                                     *   the extension it announces would be read as its body */
+
+/**
+ * @brief Deadline extension of a request, present when `REQUEST_FLAG_DEADLINE` is set.
+ *
+ * | Offset | Size | Field                                                    |
+ * |--------|------|----------------------------------------------------------|
+ * | 12     | 4    | time budget in microseconds, counted from reception      |
+ *
+ * The client sets it to the time after which it will no longer read the answer;
+ * the server drops the request, or answers `STATUS_DEADLINE_EXCEEDED`, once the
+ * budget is spent. Servers that predate the extension ignore it.
+ */
+#define DEADLINE_EXTENSION_SIZE 4
+
+/**
+ * @brief Cookie extension of a request, present when `REQUEST_FLAG_COOKIE` is set.
+ *
+ * An 8-byte value handed out by the server in a `STATUS_COOKIE_REQUIRED` answer
+ * and echoed unchanged. It proves that the client receives the datagrams sent to
+ * its address: a server that requires cookies (`-k`) sends no answer larger than
+ * `COOKIE_FREE_RESPONSE_SIZE`, and opens no stream, for a request without a valid
+ * one, so that it cannot be used to flood a spoofed address. A cookie is only
+ * valid for the address and port it was given to, for one to two minutes.
+ */
+#define COOKIE_EXTENSION_SIZE 8
+#define COOKIE_FREE_RESPONSE_SIZE (RESPONSE_HEADER_SIZE + MAX_PASSWORD_LENGTH)	/**< Largest answer to a request without a cookie */
+
+/**
+ * @brief Key extension of a request, present when `REQUEST_FLAG_ENCRYPTED` is set.
+ *
+ * | Offset | Size | Field                                                    |
+ * |--------|------|----------------------------------------------------------|
+ * | +0     | 4    | id of a key shared by the client and the server (not 0)  |
+ *
+ * The passwords of the answer are encrypted with that key
+ * (`ENCODING_CHACHA20_POLY1305`); a server that does not know the key answers
+ * `STATUS_UNAUTHORIZED`. Only `OP_GENERATE` requests can be encrypted.
+ */
+#define KEY_EXTENSION_SIZE 4
+
+/**
+ * @brief Tenant extension of a request, present when `REQUEST_FLAG_TENANT` is set.
+ *
+ * | Offset | Size | Field                                                    |
+ * |--------|------|----------------------------------------------------------|
+ * | +0     | 4    | id of the tenant sending the request (not 0)             |
+ * | +4     | 4    | time of the signature, in seconds since the Unix epoch   |
+ *
+ * The request then ends with a `TENANT_MAC_SIZE`-byte MAC, after the body: the
+ * SipHash-2-4, under the key of the tenant, of every byte before it, stored
+ * big-endian. A server that serves tenants (`-A`) answers `STATUS_UNAUTHORIZED`
+ * to a request without a valid MAC, or signed more than `TENANT_TIME_WINDOW_S`
+ * away from its own clock, so that a captured request cannot be replayed once
+ * the window is over, and charges the others to their tenant's quota
+ * (`STATUS_QUOTA_EXCEEDED`).
+ */
+#define TENANT_EXTENSION_SIZE 8
+#define TENANT_TIME_WINDOW_S 30		/**< Largest distance between the time of a signature and the server's clock */
+#define TENANT_MAC_SIZE 8
+
+/**
+ * @brief Body of an `OP_SUBSCRIBE` request.
+ *
+ * | Offset | Size | Field                                              |
+ * |--------|------|----------------------------------------------------|
+ * | 12     | 4    | rate limit in passwords per second (0: no limit)   |
+ * | 16     | 4    | initial credits, in datagrams                      |
+ *
+ * The `count` field of the header is the number of passwords packed in each
+ * stream datagram (capped by the datagram size).
+ */
+#define SUBSCRIBE_BODY_SIZE 8
+
+/**
+ * @brief Body of an `OP_CREDIT` request: 4 bytes with the number of extra datagrams granted.
+ */
+#define CREDIT_BODY_SIZE 4
+
+/**
+ * @brief Body of an `OP_BULK` request, sent over the TCP bulk endpoint.
+ *
+ * | Offset | Size | Field                                    |
+ * |--------|------|------------------------------------------|
+ * | 12     | 8    | total number of passwords                |
+ * | 20     | 1    | framing (`BulkFraming`)                  |
+ *
+ * The server answers with a response header (count 0) and then writes the
+ * framed passwords until the total is reached, and closes the connection.
+ * The `count` field of the request header is ignored.
+ */
+#define BULK_BODY_SIZE 9
+
+/**
+ * @brief Body of an `OP_STATS` request: 4 bytes with an IPv4 address whose datagrams
+ * are to be estimated, as sent on the wire (network byte order), or 0 for none.
+ * @details The type, length and count fields of the header are ignored. The server
+ * answers `STATUS_STATS`, or `STATUS_UNAUTHORIZED` to a request from outside 127.0.0.0/8.
+ */
+#define STATS_BODY_SIZE 4
+
+/**
+ * @enum BulkFraming
+ * @brief How passwords are delimited on the TCP bulk endpoint.
+ */
+typedef enum {
+    FRAMING_NEWLINE = 0,		/**< Each password is followed by '\n' */
+    FRAMING_LENGTH_PREFIX = 1	/**< Each password is preceded by its length in one byte */
+} BulkFraming;
+
+/**
+ * @brief Layout of a compact response header (all integers big-endian).
+ *
+ * | Offset | Size | Field                                  |
+ * |--------|------|----------------------------------------|
+ * | 0      | 1    | magic (`PROTOCOL_MAGIC`)               |
+ * | 1      | 1    | version (`PROTOCOL_VERSION`)           |
+ * | 2      | 1    | status (`ResponseStatus`)              |
+ * | 3      | 1    | password type                          |
+ * | 4      | 1    | password length                        |
+ * | 5      | 1    | payload encoding (`ResponseEncoding`)  |
+ * | 6      | 2    | number of passwords in the payload     |
+ * | 8      | 4    | request id copied from the request     |
+ *
+ * The header is followed by `count * length` password characters, one
+ * password after the other, without separators or terminators.
+ *
+ * Datagrams of a stream (status `STATUS_STREAM_DATA` or `STATUS_STREAM_END`)
+ * carry the stream id in the request id field and a 4-byte sequence number
+ * right after the header, so that the client can detect lost datagrams; the
+ * passwords follow the sequence number.
+ *
+ * A `STATUS_COOKIE_REQUIRED` answer carries the cookie to use, 8 bytes, right
+ * after the header.
+ *
+ * A `STATUS_STATS` answer carries a summary of the clients seen in the last
+ * `window` milliseconds right after the header, then `count` heavy hitters of
+ * `length` (`STATS_ENTRY_SIZE`) bytes each, heaviest first:
+ *
+ * | Offset | Size | Field                                                     |
+ * |--------|------|-----------------------------------------------------------|
+ * | 12     | 4    | window in milliseconds                                    |
+ * | 16     | 8    | datagrams received in the window                          |
+ * | 24     | 4    | estimated distinct clients                                |
+ * | 28     | 4    | estimated datagrams of the address in the request         |
+ * | 32     | 12*n | heavy hitters: address, datagrams (at most), overestimate |
+ *
+ * The addresses are in network byte order, as in the request.
+ *
+ * With `ENCODING_CHACHA20_POLY1305` the passwords are encrypted in place and
+ * followed by a trailer:
+ *
+ * | Size | Field                                                             |
+ * |------|-------------------------------------------------------------------|
+ * | 8    | nonce counter of the server                                       |
+ * | 16   | Poly1305 tag of the header (additional data) and of the passwords |
+ *
+ * The nonce is the request id followed by the nonce counter, both big-endian;
+ * the counter never repeats for a key, retransmissions included.
+ *
+ * With `ENCODING_PACKED` the `count * length` characters are replaced by their
+ * indices in the alphabet of the type, in a bit stream of `ceil(log2(size))`
+ * bits per character (see `libs/packing`): `packing_size(count * length, bits)`
+ * bytes. A server packs the answer to an `OP_GENERATE` request that sets
+ * `REQUEST_FLAG_PACKED`, when its type is a password type ('n', 'a', 'm', 's',
+ * 'u') and it is not encrypted; it then sends up to
+ * `MAX_PACKED_BATCH_COUNT(length, bits)` passwords. Servers that predate the
+ * flag ignore it and answer `ENCODING_PLAIN`.
+ */
+#define RESPONSE_HEADER_SIZE 12
+#define STREAM_HEADER_SIZE (RESPONSE_HEADER_SIZE + 4)	/**< Header of a stream datagram */
+#define SEALED_TRAILER_SIZE (8 + 16)					/**< Trailer of an encrypted response */
+#define STATS_SUMMARY_SIZE 20							/**< Summary of a `STATUS_STATS` answer */
+#define STATS_ENTRY_SIZE 12								/**< Heavy hitter of a `STATUS_STATS` answer */
+
+/**
+ * @enum ResponseEncoding
+ * @brief How the passwords of a response are encoded, in the `encoding` byte of the header.
+ */
+typedef enum {
+    ENCODING_PLAIN = 0,				/**< The password characters */
+    ENCODING_CHACHA20_POLY1305 = 1,	/**< The characters encrypted, followed by `SEALED_TRAILER_SIZE` bytes */
+    ENCODING_PACKED = 2				/**< The indices of the characters in their alphabet, bit-packed */
+} ResponseEncoding;
+
+/**
+ * @brief Maximum number of passwords that fit in one response of the given length.
+ */
+#define MAX_BATCH_COUNT(length) ((MAX_DATAGRAM_SIZE - RESPONSE_HEADER_SIZE) / (length))
+
+/**
+ * @brief Maximum number of passwords that fit in one encrypted response of the given length.
+ */
+#define MAX_SEALED_BATCH_COUNT(length) ((MAX_DATAGRAM_SIZE - RESPONSE_HEADER_SIZE - SEALED_TRAILER_SIZE) / (length))
+
+/**
+ * @brief Maximum number of passwords that fit in one packed response of the given length, `bits` bits per character.
+ */
+#define MAX_PACKED_BATCH_COUNT(length, bits) ((MAX_DATAGRAM_SIZE - RESPONSE_HEADER_SIZE) * 8 / ((length) * (bits)))
+
+/**
+ * @brief Size of a response before it is packed, or after it is unpacked: up to twice the datagram (4-bit digits).
+ */
+#define MAX_UNPACKED_RESPONSE_SIZE (RESPONSE_HEADER_SIZE + (MAX_DATAGRAM_SIZE - RESPONSE_HEADER_SIZE) * 2)
+
+/**
+ * @brief Maximum number of passwords that fit in one stream datagram of the given length.
+ */
+#define MAX_STREAM_COUNT(length) ((MAX_DATAGRAM_SIZE - STREAM_HEADER_SIZE) / (length))
+
+/**
+ * @brief A stream that receives no credit for this long is closed by the server.
+ */
+#define STREAM_IDLE_TIMEOUT_MS 5000
+
+/**
+ * @enum ResponseStatus
+ * @brief Outcome of a request, carried in the compact response header.
+ */
+typedef enum {
+    STATUS_OK = 0,			/**< The payload contains the generated passwords */
+    STATUS_BAD_REQUEST = 1,	/**< The request was malformed or out of range */
+    STATUS_STREAM_DATA = 2,	/**< Stream datagram: sequence number and passwords follow */
+    STATUS_STREAM_END = 3,	/**< The stream was closed (unsubscribed or timed out) */
+    STATUS_UNAVAILABLE = 4,	/**< The server cannot accept the request right now */
+    STATUS_DEADLINE_EXCEEDED = 5,	/**< The deadline of the request passed before it was answered */
+    STATUS_COOKIE_REQUIRED = 6,		/**< Send the request again with the cookie that follows the header */
+    STATUS_UNAUTHORIZED = 7,		/**< The server does not know the key or the tenant of the request, or the tenant may not ask it */
+    STATUS_QUOTA_EXCEEDED = 8,		/**< The tenant of the request, or its sender for random bytes, has used up its quota for now */
+    STATUS_STATS = 9				/**< The summary and the heavy hitters of the clients follow the header */
+} ResponseStatus;
+
+/* - - - - - - - - - - - - - - - - - END COMPACT WIRE FORMAT - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - LAYOUT CHECKS - - - - - - - - - - - - - - - - - - - - */
+
+/*
+ * Both structures are sent as raw bytes with `sizeof`, so any padding the
+ * compiler might insert would silently change the wire format. They only
+ * contain `char` members, which must keep them packed on every ABI.
+ */
+PROTOCOL_STATIC_ASSERT(sizeof(PasswordRequest) == 1 + BUFFER_SIZE,
+                       "PasswordRequest must not contain padding");
+PROTOCOL_STATIC_ASSERT(sizeof(PasswordResponse) == MAX_PASSWORD_LENGTH + 1,
+                       "PasswordResponse must not contain padding");
+PROTOCOL_STATIC_ASSERT(MAX_PASSWORD_LENGTH < 256,
+                       "The compact header stores the password length in one byte");
+PROTOCOL_STATIC_ASSERT(sizeof(PasswordRequest) <= MAX_DATAGRAM_SIZE,
+                       "A legacy request must fit in one datagram");
+PROTOCOL_STATIC_ASSERT(MAX_BATCH_COUNT(MIN_PASSWORD_LENGTH) <= 0xFFFF,
+                       "The batch count must fit in the 16-bit count field");
+PROTOCOL_STATIC_ASSERT(MAX_PACKED_BATCH_COUNT(MIN_PASSWORD_LENGTH, 4) <= 0xFFFF,
+                       "The packed batch count must fit in the 16-bit count field");
+PROTOCOL_STATIC_ASSERT(MIN_PASSWORD_LENGTH > 0 && MIN_PASSWORD_LENGTH <= MAX_PASSWORD_LENGTH,
+                       "Password length bounds are inconsistent");
+
+/* - - - - - - - - - - - - - - - - - - END LAYOUT CHECKS - - - - - - - - - - - - - - - - - - */
+
+#endif // PROTOCOL_H
@@ -0,0 +1,215 @@
+/**
+ * @file random.c
+ * @brief Implementation of the buffered ChaCha20 random number generator.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#define _CRT_RAND_S
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/random.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "random.h"
+#include "libs/protocol/protocol.h"
+
+/* - - - - - - - - - - - - - - - - - - - - CHACHA20 - - - - - - - - - - - - - - - - - - - - */
+
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = ROTL32(d, 16); \
+    c += d; b ^= c; b = ROTL32(b, 12); \
+    a += b; d ^= a; d = ROTL32(d, 8);  \
+    c += d; b ^= c; b = ROTL32(b, 7)
+
+static inline void store_le32(unsigned char *p, uint32_t value) {
+    p[0] = (unsigned char)value;
+    p[1] = (unsigned char)(value >> 8);
+    p[2] = (unsigned char)(value >> 16);
+    p[3] = (unsigned char)(value >> 24);
+}
+
+static inline uint32_t load_le32(const unsigned char *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+/**
+ * @brief Eight 32-bit lanes: each lane holds the same state word of a different block.
+ *
+ * GCC lowers the operations to AVX2 when available and to pairs of SSE2/NEON
+ * instructions otherwise, so eight blocks are computed in parallel everywhere.
+ */
+typedef uint32_t lanes_t __attribute__((vector_size(32)));
+
+#define CHACHA_LANES 8	/**< Blocks computed by one call to `chacha20_blocks` */
+
+/**
+ * @brief Computes eight consecutive ChaCha20 blocks (RFC 8439, 64-bit counter, zero nonce).
+ * @param[in] key The 256-bit key.
+ * @param[in] counter The counter of the first block.
+ * @param[out] out The 512 bytes of keystream.
+ */
+static void chacha20_blocks(const uint32_t key[8], uint64_t counter, unsigned char out[CHACHA_LANES * RANDOM_BLOCK_SIZE]) {
+    static const uint32_t constants[4] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    lanes_t input[16];
+    lanes_t x[16];
+
+    for (int i = 0; i < 4; i++) {
+        input[i] = (lanes_t){ 0 } + constants[i];
+        input[4 + i] = (lanes_t){ 0 } + key[i];
+        input[8 + i] = (lanes_t){ 0 } + key[4 + i];
+    }
+    for (int lane = 0; lane < CHACHA_LANES; lane++) {
+        input[12][lane] = (uint32_t)(counter + (uint64_t)lane);
+        input[13][lane] = (uint32_t)((counter + (uint64_t)lane) >> 32);
+    }
+    input[14] = input[15] = (lanes_t){ 0 };
+    memcpy(x, input, sizeof(x));
+
+    for (int round = 0; round < 10; round++) {
+        QUARTER_ROUND(x[0], x[4], x[8],  x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9],  x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8],  x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        lanes_t word = x[i] + input[i];
+        for (int lane = 0; lane < CHACHA_LANES; lane++) {
+            store_le32(out + lane * RANDOM_BLOCK_SIZE + 4 * i, word[lane]);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CHACHA20 - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - STREAM - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Reads `size` bytes from the operating system's entropy source.
+ */
+static bool read_os_entropy(unsigned char *buffer, size_t size) {
+#if defined WIN32
+    for (size_t i = 0; i < size; i += sizeof(unsigned int)) {
+        unsigned int value;
+        if (rand_s(&value) != 0) {
+            return false;
+        }
+        memcpy(buffer + i, &value, size - i < sizeof(value) ? size - i : sizeof(value));
+    }
+    return true;
+#else
+    size_t filled = 0;
+    while (filled < size) {
+        ssize_t got = getrandom(buffer + filled, size - filled, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        filled += (size_t)got;
+    }
+    if (filled == size) {
+        return true;
+    }
+
+    /* Kernels without getrandom(): fall back to the device file */
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    while (filled < size) {
+        ssize_t got = read(fd, buffer + filled, size - filled);
+        if (got <= 0) {
+            close(fd);
+            return false;
+        }
+        filled += (size_t)got;
+    }
+    close(fd);
+    return true;
+#endif
+}
+
+void random_stream_init_with_key(RandomStream *stream, const unsigned char key[RANDOM_KEY_SIZE]) {
+    for (int i = 0; i < 8; i++) {
+        stream->key[i] = load_le32(key + 4 * i);
+    }
+    stream->counter = 0;
+    stream->position = RANDOM_BUFFER_SIZE;	/**< Force a refill on first use */
+    stream->handed = RANDOM_BUFFER_SIZE;
+}
+
+bool random_stream_init(RandomStream *stream) {
+    unsigned char seed[RANDOM_KEY_SIZE];
+    if (!read_os_entropy(seed, sizeof(seed))) {
+        return false;
+    }
+    random_stream_init_with_key(stream, seed);
+    memset(seed, 0, sizeof(seed));
+    return true;
+}
+
+void random_stream_refill(RandomStream *stream) {
+    PROTOCOL_STATIC_ASSERT(RANDOM_BUFFER_BLOCKS % CHACHA_LANES == 0, "Refills must use whole batches of blocks");
+
+    for (int block = 0; block < RANDOM_BUFFER_BLOCKS; block += CHACHA_LANES) {
+        chacha20_blocks(stream->key, stream->counter, stream->buffer + block * RANDOM_BLOCK_SIZE);
+        stream->counter += CHACHA_LANES;
+    }
+
+    /* The first 32 bytes of the new keystream become the next key and are never handed out */
+    for (int i = 0; i < 8; i++) {
+        stream->key[i] = load_le32(stream->buffer + 4 * i);
+    }
+    memset(stream->buffer, 0, RANDOM_KEY_SIZE);
+    stream->position = RANDOM_KEY_SIZE;
+    stream->handed = RANDOM_KEY_SIZE;
+}
+
+void random_stream_bytes(RandomStream *stream, void *buffer, size_t size) {
+    unsigned char *out = buffer;
+    memset(stream->buffer + stream->handed, 0, stream->position - stream->handed);	/**< Bytes of the previous take */
+    while (size > 0) {
+        size_t available = RANDOM_BUFFER_SIZE - stream->position;
+        if (available == 0) {
+            random_stream_refill(stream);
+            available = RANDOM_MAX_TAKE;
+        }
+        size_t chunk = size < available ? size : available;
+        memcpy(out, stream->buffer + stream->position, chunk);
+        memset(stream->buffer + stream->position, 0, chunk);	/**< Handed-out bytes are not kept */
+        stream->position += chunk;
+        out += chunk;
+        size -= chunk;
+    }
+    stream->handed = stream->position;
+}
+
+RandomStream *random_thread_stream(void) {
+    static _Thread_local RandomStream stream;
+    static _Thread_local bool initialised = false;
+
+    if (!initialised) {
+        if (!random_stream_init(&stream)) {
+            /* No entropy source: refuse to produce predictable output */
+            abort();
+        }
+        initialised = true;
+    }
+    return &stream;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END STREAM - - - - - - - - - - - - - - - - - - - */
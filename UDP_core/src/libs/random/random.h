@@ -0,0 +1,131 @@
+/**
+ * @file random.h
+ * @brief Buffered cryptographically secure random number generator.
+ *
+ * Random bytes come from a ChaCha20 keystream seeded by the operating system.
+ * The keystream is produced 1 KiB at a time into a per-stream buffer, so that
+ * generators can take the random bytes they need for a whole password with a
+ * single bounds check. After every refill the key is replaced with fresh
+ * keystream output ("fast key erasure"), and the bytes handed out by a call
+ * are wiped from the buffer by the next call on the stream, so a later
+ * compromise of the state does not reveal bytes that were already used.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* - - - - - - - - - - - - - - - - - - - - STREAM - - - - - - - - - - - - - - - - - - - - */
+
+#define RANDOM_BLOCK_SIZE 64								/**< Size of one ChaCha20 block */
+#define RANDOM_BUFFER_BLOCKS 16								/**< Blocks generated per refill */
+#define RANDOM_KEY_SIZE 32									/**< Size of the ChaCha20 key */
+#define RANDOM_BUFFER_SIZE (RANDOM_BLOCK_SIZE * RANDOM_BUFFER_BLOCKS)	/**< Keystream bytes generated per refill */
+#define RANDOM_MAX_TAKE (RANDOM_BUFFER_SIZE - RANDOM_KEY_SIZE)		/**< Usable bytes per refill */
+
+/**
+ * @struct RandomStream
+ * @brief State of one buffered keystream.
+ *
+ * A stream must only be used by one thread at a time; `random_thread_stream`
+ * returns a private stream for the calling thread.
+ */
+typedef struct {
+    uint32_t key[8];								/**< Current ChaCha20 key */
+    uint64_t counter;								/**< Block counter */
+    size_t position;								/**< Next unread byte in `buffer` */
+    size_t handed;									/**< Start of the bytes handed out but not wiped yet, up to `position` */
+    unsigned char buffer[RANDOM_BUFFER_SIZE] __attribute__((aligned(64)));	/**< Keystream, the first `RANDOM_KEY_SIZE` bytes are never handed out */
+} RandomStream;
+
+/**
+ * @brief Seeds a stream from the operating system's entropy source.
+ * @param[out] stream The stream to initialise.
+ * @return `true` on success, `false` if no entropy source was available.
+ */
+bool random_stream_init(RandomStream *stream);
+
+/**
+ * @brief Seeds a stream from a caller-provided key (deterministic output).
+ * @param[out] stream The stream to initialise.
+ * @param[in] key A 32-byte key.
+ * @note Only meant for benchmarks and reproducible tests.
+ */
+void random_stream_init_with_key(RandomStream *stream, const unsigned char key[RANDOM_KEY_SIZE]);
+
+/**
+ * @brief Generates the next buffer of keystream and rotates the key.
+ * @param[in,out] stream The stream to refill.
+ */
+void random_stream_refill(RandomStream *stream);
+
+/**
+ * @brief Hands out `size` consecutive random bytes from the stream.
+ *
+ * The returned pointer stays valid until the next call on the same stream,
+ * which wipes the bytes. The bytes are consumed: they will never be returned
+ * again.
+ *
+ * @param[in,out] stream The stream to read from.
+ * @param[in] size Number of bytes needed, at most `RANDOM_MAX_TAKE`.
+ * @return Pointer to `size` random bytes inside the stream buffer.
+ */
+static inline const unsigned char *random_stream_take(RandomStream *stream, size_t size) {
+    memset(stream->buffer + stream->handed, 0, stream->position - stream->handed);	/**< Bytes of the previous call */
+    if (stream->position + size > RANDOM_BUFFER_SIZE) {
+        random_stream_refill(stream);
+    }
+    const unsigned char *bytes = stream->buffer + stream->position;
+    stream->handed = stream->position;
+    stream->position += size;
+    return bytes;
+}
+
+/**
+ * @brief Returns a uniformly distributed integer in `[0, bound)`.
+ *
+ * Uses a 16-bit multiply-and-shift with rejection of the few biased values.
+ *
+ * @param[in,out] stream The stream to read from.
+ * @param[in] bound Exclusive upper bound, between 1 and 65536.
+ * @return The random integer.
+ */
+static inline uint32_t random_uniform(RandomStream *stream, uint32_t bound) {
+    const uint32_t threshold = (65536u - bound) % bound;
+    for (;;) {
+        const unsigned char *bytes = random_stream_take(stream, 2);
+        uint32_t product = ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8) * bound;
+        if ((product & 0xFFFF) >= threshold) {
+            return product >> 16;
+        }
+    }
+}
+
+/**
+ * @brief Fills `buffer` with `size` random bytes of any length.
+ * @param[in,out] stream The stream to read from.
+ * @param[out] buffer Destination.
+ * @param[in] size Number of bytes to write.
+ */
+void random_stream_bytes(RandomStream *stream, void *buffer, size_t size);
+
+/**
+ * @brief Returns the random stream private to the calling thread.
+ *
+ * The stream is seeded from the operating system on first use.
+ *
+ * @return The calling thread's stream.
+ */
+RandomStream *random_thread_stream(void);
+
+/* - - - - - - - - - - - - - - - - - - - END STREAM - - - - - - - - - - - - - - - - - - - */
+
+#endif /* RANDOM_H_ */
@@ -0,0 +1,330 @@
+/**
+ * @file resolver.c
+ * @brief Implementation of the asynchronous, cached resolver.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#include <ws2tcpip.h>
+#else
+#include <time.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "resolver.h"
+#include "libs/clock/clock.h"
+
+/* - - - - - - - - - - - - - - - - - - - - THREADS - - - - - - - - - - - - - - - - - - - - */
+
+/*
+ * Minimal portability layer: a mutex, a condition variable waited on with a
+ * monotonic deadline, and one thread.
+ */
+
+static void resolver_run(Resolver *resolver);
+
+#if defined WIN32
+
+static bool sync_init(Resolver *resolver) {
+    InitializeCriticalSection(&resolver->lock);
+    InitializeConditionVariable(&resolver->wake);
+    return true;
+}
+
+static void sync_destroy(Resolver *resolver) {
+    DeleteCriticalSection(&resolver->lock);
+}
+
+static void sync_lock(Resolver *resolver) {
+    EnterCriticalSection(&resolver->lock);
+}
+
+static void sync_unlock(Resolver *resolver) {
+    LeaveCriticalSection(&resolver->lock);
+}
+
+static void sync_broadcast(Resolver *resolver) {
+    WakeAllConditionVariable(&resolver->wake);
+}
+
+static void sync_wait_until(Resolver *resolver, uint64_t deadline_ns) {
+    uint64_t now_ns = clock_now_ns();
+    DWORD wait_ms = deadline_ns == UINT64_MAX ? INFINITE
+        : deadline_ns <= now_ns ? 0 : (DWORD)((deadline_ns - now_ns) / NANOSECONDS_PER_MILLISECOND + 1);
+    SleepConditionVariableCS(&resolver->wake, &resolver->lock, wait_ms);
+}
+
+static DWORD WINAPI thread_main(LPVOID context) {
+    resolver_run(context);
+    return 0;
+}
+
+static bool thread_start(Resolver *resolver) {
+    resolver->thread = CreateThread(NULL, 0, thread_main, resolver, 0, NULL);
+    return resolver->thread != NULL;
+}
+
+static void thread_join(Resolver *resolver) {
+    WaitForSingleObject(resolver->thread, INFINITE);
+    CloseHandle(resolver->thread);
+}
+
+#else
+
+static bool sync_init(Resolver *resolver) {
+    pthread_condattr_t attributes;
+    bool created;
+
+    if (pthread_mutex_init(&resolver->lock, NULL) != 0) {
+        return false;
+    }
+    pthread_condattr_init(&attributes);
+    pthread_condattr_setclock(&attributes, CLOCK_MONOTONIC);	/**< Deadlines come from clock_now_ns */
+    created = pthread_cond_init(&resolver->wake, &attributes) == 0;
+    pthread_condattr_destroy(&attributes);
+    if (!created) {
+        pthread_mutex_destroy(&resolver->lock);
+    }
+    return created;
+}
+
+static void sync_destroy(Resolver *resolver) {
+    pthread_cond_destroy(&resolver->wake);
+    pthread_mutex_destroy(&resolver->lock);
+}
+
+static void sync_lock(Resolver *resolver) {
+    pthread_mutex_lock(&resolver->lock);
+}
+
+static void sync_unlock(Resolver *resolver) {
+    pthread_mutex_unlock(&resolver->lock);
+}
+
+static void sync_broadcast(Resolver *resolver) {
+    pthread_cond_broadcast(&resolver->wake);
+}
+
+static void sync_wait_until(Resolver *resolver, uint64_t deadline_ns) {
+    if (deadline_ns == UINT64_MAX) {
+        pthread_cond_wait(&resolver->wake, &resolver->lock);
+        return;
+    }
+    struct timespec deadline = {
+        .tv_sec = (time_t)(deadline_ns / NANOSECONDS_PER_SECOND),
+        .tv_nsec = (long)(deadline_ns % NANOSECONDS_PER_SECOND)
+    };
+    pthread_cond_timedwait(&resolver->wake, &resolver->lock, &deadline);
+}
+
+static void *thread_main(void *context) {
+    resolver_run(context);
+    return NULL;
+}
+
+static bool thread_start(Resolver *resolver) {
+    return pthread_create(&resolver->thread, NULL, thread_main, resolver) == 0;
+}
+
+static void thread_join(Resolver *resolver) {
+    pthread_join(resolver->thread, NULL);
+}
+
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - END THREADS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Orders addresses so that two results can be compared whatever order the resolver returned.
+ */
+static int compare_addresses(const void *a, const void *b) {
+    uint32_t left = ntohl(((const struct sockaddr_in *)a)->sin_addr.s_addr);
+    uint32_t right = ntohl(((const struct sockaddr_in *)b)->sin_addr.s_addr);
+    return (left > right) - (left < right);
+}
+
+/**
+ * @brief Resolves a name with the blocking `getaddrinfo`, on the helper thread only.
+ * @return Number of distinct IPv4 addresses found, sorted; 0 on failure.
+ */
+static unsigned int resolve_name(const char *host, unsigned short port, struct sockaddr_in *addresses) {
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_DGRAM, .ai_protocol = IPPROTO_UDP };
+    struct addrinfo *results;
+    unsigned int count = 0;
+
+    if (getaddrinfo(host, NULL, &hints, &results) != 0) {
+        return 0;
+    }
+    for (const struct addrinfo *result = results; result != NULL && count < RESOLVER_MAX_ADDRESSES; result = result->ai_next) {
+        struct sockaddr_in address = *(const struct sockaddr_in *)result->ai_addr;
+        bool duplicate = false;
+
+        address.sin_port = htons(port);
+        for (unsigned int i = 0; i < count && !duplicate; i++) {
+            duplicate = addresses[i].sin_addr.s_addr == address.sin_addr.s_addr;
+        }
+        if (!duplicate) {
+            addresses[count++] = address;
+        }
+    }
+    freeaddrinfo(results);
+    qsort(addresses, count, sizeof(*addresses), compare_addresses);
+    return count;
+}
+
+/**
+ * @brief Stores the outcome of a resolution in the cache.
+ * @pre The lock is held.
+ */
+static void store_result(Resolver *resolver, ResolverEntry *entry, const struct sockaddr_in *addresses,
+                         unsigned int count, uint64_t now_ns) {
+    resolver->stats.lookups++;
+    entry->attempted = true;
+    if (count == 0) {
+        resolver->stats.failures++;
+        entry->refresh_ns = now_ns + RESOLVER_RETRY_MS * NANOSECONDS_PER_MILLISECOND;	/**< Keep serving the old addresses */
+        return;
+    }
+    entry->refresh_ns = now_ns + resolver->ttl_ns / 4 * 3;
+    if (count != entry->address_count || memcmp(addresses, entry->addresses, count * sizeof(*addresses)) != 0) {
+        memcpy(entry->addresses, addresses, count * sizeof(*addresses));
+        entry->address_count = count;
+        resolver->stats.changes++;
+        __atomic_add_fetch(&resolver->generation, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/**
+ * @brief Body of the helper thread: resolves each name when its refresh time comes.
+ */
+static void resolver_run(Resolver *resolver) {
+    sync_lock(resolver);
+    while (!resolver->stopping) {
+        ResolverEntry *due = NULL;
+        uint64_t next_ns = UINT64_MAX;
+        uint64_t now_ns = clock_now_ns();
+
+        for (size_t i = 0; i < resolver->entry_count; i++) {
+            if (resolver->entries[i].refresh_ns < next_ns) {
+                next_ns = resolver->entries[i].refresh_ns;
+                due = &resolver->entries[i];
+            }
+        }
+        if (due == NULL || next_ns > now_ns) {
+            sync_wait_until(resolver, next_ns);
+            continue;
+        }
+
+        char host[RESOLVER_MAX_HOST_LENGTH + 1];
+        unsigned short port = due->port;
+        struct sockaddr_in addresses[RESOLVER_MAX_ADDRESSES];
+
+        memcpy(host, due->host, sizeof(host));
+        sync_unlock(resolver);
+        unsigned int count = resolve_name(host, port, addresses);
+        sync_lock(resolver);
+
+        store_result(resolver, due, addresses, count, clock_now_ns());
+        sync_broadcast(resolver);
+    }
+    sync_unlock(resolver);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RESOLVER - - - - - - - - - - - - - - - - - - - - */
+
+bool resolver_init(Resolver *resolver, uint64_t ttl_ms) {
+    memset(resolver, 0, sizeof(*resolver));
+    resolver->ttl_ns = (ttl_ms != 0 ? ttl_ms : RESOLVER_DEFAULT_TTL_MS) * NANOSECONDS_PER_MILLISECOND;
+    return sync_init(resolver);
+}
+
+bool resolver_add(Resolver *resolver, const char *host, unsigned short port) {
+    if (resolver->running || resolver->entry_count == RESOLVER_MAX_NAMES || strlen(host) > RESOLVER_MAX_HOST_LENGTH) {
+        return false;
+    }
+    ResolverEntry *entry = &resolver->entries[resolver->entry_count++];
+    memset(entry, 0, sizeof(*entry));
+    strcpy(entry->host, host);
+    entry->port = port;
+    entry->refresh_ns = 0;	/**< Resolved as soon as the thread starts */
+    return true;
+}
+
+bool resolver_start(Resolver *resolver) {
+    resolver->running = thread_start(resolver);
+    return resolver->running;
+}
+
+bool resolver_wait(Resolver *resolver, int timeout_ms) {
+    uint64_t deadline_ns = clock_now_ns() + (uint64_t)timeout_ms * NANOSECONDS_PER_MILLISECOND;
+    bool resolved = false;
+
+    sync_lock(resolver);
+    for (;;) {
+        bool pending = false;
+        resolved = false;
+        for (size_t i = 0; i < resolver->entry_count; i++) {
+            pending = pending || !resolver->entries[i].attempted;
+            resolved = resolved || resolver->entries[i].address_count > 0;
+        }
+        if (!pending || clock_now_ns() >= deadline_ns) {
+            break;
+        }
+        sync_wait_until(resolver, deadline_ns);
+    }
+    sync_unlock(resolver);
+    return resolved;
+}
+
+size_t resolver_addresses(Resolver *resolver, struct sockaddr_in *addresses, size_t capacity) {
+    size_t count = 0;
+
+    sync_lock(resolver);
+    for (size_t i = 0; i < resolver->entry_count; i++) {
+        const ResolverEntry *entry = &resolver->entries[i];
+        for (unsigned int a = 0; a < entry->address_count && count < capacity; a++) {
+            addresses[count++] = entry->addresses[a];
+        }
+    }
+    sync_unlock(resolver);
+    return count;
+}
+
+void resolver_update_client(void *context, PassgenClient *client) {
+    Resolver *resolver = context;
+    struct sockaddr_in addresses[CLIENT_MAX_SERVERS];
+    uint64_t generation = __atomic_load_n(&resolver->generation, __ATOMIC_ACQUIRE);
+
+    if (generation == resolver->client_generation) {
+        return;
+    }
+    resolver->client_generation = generation;
+    size_t count = resolver_addresses(resolver, addresses, CLIENT_MAX_SERVERS);
+    if (count > 0) {
+        client_set_servers(client, addresses, count);
+    }
+}
+
+void resolver_stop(Resolver *resolver) {
+    if (resolver->running) {
+        sync_lock(resolver);
+        resolver->stopping = true;
+        sync_broadcast(resolver);
+        sync_unlock(resolver);
+        thread_join(resolver);
+        resolver->running = false;
+    }
+    sync_destroy(resolver);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END RESOLVER - - - - - - - - - - - - - - - - - - - */
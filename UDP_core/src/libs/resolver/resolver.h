@@ -0,0 +1,154 @@
+/**
+ * @file resolver.h
+ * @brief Asynchronous, cached host name resolution for the client library.
+ *
+ * The names are resolved with `getaddrinfo` on a helper thread, never on the
+ * thread sending requests. Every result is cached for a configurable time to
+ * live and refreshed in the background when three quarters of it have
+ * elapsed; until the refresh completes, and whenever it fails, the last
+ * addresses keep being used. `getaddrinfo` does not report the DNS record
+ * TTL, so the same TTL applies to every name.
+ *
+ * Installed as the server source of a `PassgenClient`, the resolver hands the
+ * load balancer every address of every name whenever the set changes, so a
+ * long-lived client follows DNS changes on its own.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef RESOLVER_H_
+#define RESOLVER_H_
+
+#if defined WIN32
+#include <winsock2.h>
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <netinet/in.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/client/client.h"
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define RESOLVER_MAX_NAMES CLIENT_MAX_SERVERS		/**< Names a resolver can follow */
+#define RESOLVER_MAX_ADDRESSES 8					/**< Addresses kept per name */
+#define RESOLVER_MAX_HOST_LENGTH 255				/**< Longest host name */
+#define RESOLVER_DEFAULT_TTL_MS 60000				/**< Time to live of a result unless configured otherwise */
+#define RESOLVER_RETRY_MS 1000						/**< Delay before retrying a failed resolution */
+
+/**
+ * @struct ResolverEntry
+ * @brief A name and its cached addresses.
+ */
+typedef struct {
+    char host[RESOLVER_MAX_HOST_LENGTH + 1];					/**< Host name or numeric address */
+    unsigned short port;										/**< Port of the server */
+    struct sockaddr_in addresses[RESOLVER_MAX_ADDRESSES];		/**< Last addresses resolved */
+    unsigned int address_count;									/**< Addresses in `addresses`, 0 before the first success */
+    bool attempted;												/**< At least one resolution completed, successful or not */
+    uint64_t refresh_ns;										/**< When the next resolution starts */
+} ResolverEntry;
+
+/**
+ * @struct ResolverStats
+ * @brief Counters of a resolver.
+ */
+typedef struct {
+    uint64_t lookups;	/**< Calls to `getaddrinfo` */
+    uint64_t failures;	/**< Calls that failed (the previous addresses were kept) */
+    uint64_t changes;	/**< Times the address set of a name changed */
+} ResolverStats;
+
+/**
+ * @struct Resolver
+ * @brief The cache and its helper thread.
+ */
+typedef struct {
+#if defined WIN32
+    HANDLE thread;								/**< Helper thread */
+    CRITICAL_SECTION lock;						/**< Protects everything below */
+    CONDITION_VARIABLE wake;					/**< Signals the helper thread and the waiters */
+#else
+    pthread_t thread;							/**< Helper thread */
+    pthread_mutex_t lock;						/**< Protects everything below */
+    pthread_cond_t wake;						/**< Signals the helper thread and the waiters */
+#endif
+    bool running;								/**< The helper thread was started */
+    bool stopping;								/**< The helper thread must exit */
+    uint64_t ttl_ns;							/**< Time to live of a result */
+    size_t entry_count;							/**< Names followed */
+    ResolverEntry entries[RESOLVER_MAX_NAMES];	/**< The names */
+    uint64_t generation;						/**< Incremented when any address set changes, read atomically */
+    uint64_t client_generation;					/**< Generation last handed to the client */
+    ResolverStats stats;						/**< Counters */
+} Resolver;
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - RESOLVER - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Initialises an empty resolver.
+ * @param[out] resolver The resolver.
+ * @param[in] ttl_ms Time to live of a result (0 for `RESOLVER_DEFAULT_TTL_MS`).
+ * @return `false` if the synchronisation objects could not be created.
+ */
+bool resolver_init(Resolver *resolver, uint64_t ttl_ms);
+
+/**
+ * @brief Adds a name to follow. Must be called before `resolver_start`.
+ * @param[in,out] resolver The resolver.
+ * @param[in] host Host name or numeric address.
+ * @param[in] port Port of the server.
+ * @return `false` if the name is too long or the resolver is full.
+ */
+bool resolver_add(Resolver *resolver, const char *host, unsigned short port);
+
+/**
+ * @brief Starts the helper thread, which resolves every name at once.
+ * @param[in,out] resolver The resolver.
+ * @return `false` if the thread could not be created.
+ */
+bool resolver_start(Resolver *resolver);
+
+/**
+ * @brief Waits until every name has been resolved once (successfully or not).
+ * @param[in,out] resolver The resolver.
+ * @param[in] timeout_ms Maximum wait.
+ * @return `true` if at least one address is known.
+ */
+bool resolver_wait(Resolver *resolver, int timeout_ms);
+
+/**
+ * @brief Copies every cached address of every name.
+ * @param[in,out] resolver The resolver.
+ * @param[out] addresses Array receiving the addresses.
+ * @param[in] capacity Entries in `addresses`.
+ * @return Number of addresses copied.
+ */
+size_t resolver_addresses(Resolver *resolver, struct sockaddr_in *addresses, size_t capacity);
+
+/**
+ * @brief `ClientServerSource` handing the cached addresses to a client when they change.
+ * @param[in] context The resolver.
+ * @param[in,out] client The client.
+ * @note Without a change this only reads one counter, it never takes the lock.
+ */
+void resolver_update_client(void *context, PassgenClient *client);
+
+/**
+ * @brief Stops the helper thread and releases the synchronisation objects.
+ * @param[in,out] resolver The resolver.
+ */
+void resolver_stop(Resolver *resolver);
+
+/* - - - - - - - - - - - - - - - - - - - END RESOLVER - - - - - - - - - - - - - - - - - - - */
+
+#endif /* RESOLVER_H_ */
@@ -0,0 +1,152 @@
+/**
+ * @file siphash.c
+ * @brief Implementation of SipHash-2-4 (Aumasson and Bernstein, 2012).
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include "siphash.h"
+
+static inline uint64_t load_le64(const unsigned char *p) {
+    return (uint64_t)p[0] | ((uint64_t)p[1] << 8) | ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24)
+        | ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) | ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+}
+
+static inline uint64_t rotate_left(uint64_t value, unsigned int bits) {
+    return (value << bits) | (value >> (64 - bits));
+}
+
+#define SIPROUND(v0, v1, v2, v3) do { \
+        v0 += v1; v1 = rotate_left(v1, 13); v1 ^= v0; v0 = rotate_left(v0, 32); \
+        v2 += v3; v3 = rotate_left(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = rotate_left(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = rotate_left(v1, 17); v1 ^= v2; v2 = rotate_left(v2, 32); \
+    } while (0)
+
+uint64_t siphash24(const unsigned char key[SIPHASH_KEY_SIZE], const void *data, size_t size) {
+    const unsigned char *in = data;
+    uint64_t k0 = load_le64(key);
+    uint64_t k1 = load_le64(key + 8);
+    uint64_t v0 = k0 ^ 0x736f6d6570736575ull;
+    uint64_t v1 = k1 ^ 0x646f72616e646f6dull;
+    uint64_t v2 = k0 ^ 0x6c7967656e657261ull;
+    uint64_t v3 = k1 ^ 0x7465646279746573ull;
+    size_t blocks = size / 8;
+
+    for (size_t i = 0; i < blocks; i++, in += 8) {
+        uint64_t m = load_le64(in);
+        v3 ^= m;
+        SIPROUND(v0, v1, v2, v3);
+        SIPROUND(v0, v1, v2, v3);
+        v0 ^= m;
+    }
+
+    /* Last block: remaining bytes, with the message length in the top byte */
+    uint64_t last = (uint64_t)size << 56;
+    for (size_t i = 0; i < size % 8; i++) {
+        last |= (uint64_t)in[i] << (8 * i);
+    }
+    v3 ^= last;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    SIPROUND(v0, v1, v2, v3);
+    return v0 ^ v1 ^ v2 ^ v3;
+}
+
+/**
+ * @brief Four 64-bit lanes, one message each; AVX2 when available, pairs of SSE2/NEON otherwise.
+ */
+typedef uint64_t siphash_lanes_t __attribute__((vector_size(32)));
+
+#define SIPHASH_LANES 4		/**< Messages hashed together by `siphash24_pairs` */
+#define ROTATE_LANES(lanes, bits) (((lanes) << (bits)) | ((lanes) >> (64 - (bits))))
+
+#define SIPROUND_LANES(v0, v1, v2, v3) do { \
+        v0 += v1; v1 = ROTATE_LANES(v1, 13); v1 ^= v0; v0 = ROTATE_LANES(v0, 32); \
+        v2 += v3; v3 = ROTATE_LANES(v3, 16); v3 ^= v2; \
+        v0 += v3; v3 = ROTATE_LANES(v3, 21); v3 ^= v0; \
+        v2 += v1; v1 = ROTATE_LANES(v1, 17); v1 ^= v2; v2 = ROTATE_LANES(v2, 32); \
+    } while (0)
+
+void siphash24_pairs(const unsigned char key[SIPHASH_KEY_SIZE], const uint64_t (*messages)[2], size_t count,
+                     uint64_t *hashes) {
+    const uint64_t k0 = load_le64(key);
+    const uint64_t k1 = load_le64(key + 8);
+    const siphash_lanes_t zero = { 0 };
+    const uint64_t last = (uint64_t)16 << 56;	/**< Empty final block of a 16-byte message */
+    size_t done = 0;
+
+    for (; done + SIPHASH_LANES <= count; done += SIPHASH_LANES) {
+        siphash_lanes_t v0 = zero + (k0 ^ 0x736f6d6570736575ull);
+        siphash_lanes_t v1 = zero + (k1 ^ 0x646f72616e646f6dull);
+        siphash_lanes_t v2 = zero + (k0 ^ 0x6c7967656e657261ull);
+        siphash_lanes_t v3 = zero + (k1 ^ 0x7465646279746573ull);
+        siphash_lanes_t m0, m1;
+
+        for (int lane = 0; lane < SIPHASH_LANES; lane++) {
+            m0[lane] = messages[done + lane][0];
+            m1[lane] = messages[done + lane][1];
+        }
+        v3 ^= m0;
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+        v0 ^= m0;
+        v3 ^= m1;
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+        v0 ^= m1;
+        v3 ^= last;
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+        v0 ^= last;
+        v2 ^= 0xff;
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+        SIPROUND_LANES(v0, v1, v2, v3);
+
+        siphash_lanes_t result = v0 ^ v1 ^ v2 ^ v3;
+        for (int lane = 0; lane < SIPHASH_LANES; lane++) {
+            hashes[done + lane] = result[lane];
+        }
+    }
+
+    /* Fewer than four messages left */
+    for (; done < count; done++) {
+        unsigned char bytes[16];
+        for (int i = 0; i < 8; i++) {
+            bytes[i] = (unsigned char)(messages[done][0] >> (8 * i));
+            bytes[8 + i] = (unsigned char)(messages[done][1] >> (8 * i));
+        }
+        hashes[done] = siphash24(key, bytes, sizeof(bytes));
+    }
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') {
+        return (c | 0x20) - 'a' + 10;
+    }
+    return -1;
+}
+
+bool siphash_parse_key(const char *hex, unsigned char key[SIPHASH_KEY_SIZE]) {
+    for (int i = 0; i < SIPHASH_KEY_SIZE; i++) {
+        int high = hex_digit(hex[2 * i]);
+        int low = high < 0 ? -1 : hex_digit(hex[2 * i + 1]);
+        if (low < 0) {
+            return false;
+        }
+        key[i] = (unsigned char)(high << 4 | low);
+    }
+    return hex_digit(hex[2 * SIPHASH_KEY_SIZE]) < 0;
+}
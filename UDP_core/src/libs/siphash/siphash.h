@@ -0,0 +1,62 @@
+/**
+ * @file siphash.h
+ * @brief SipHash-2-4, a fast keyed hash (pseudo-random function).
+ *
+ * Used wherever a hash must not be predictable by whoever chooses the input:
+ * the uniqueness filter and the breached-password set of the engine, the
+ * anti-spoofing cookies of the server and the MACs of the tenants' requests. Without the key nobody can craft inputs
+ * that collide on purpose, nor forge a cookie.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef SIPHASH_H_
+#define SIPHASH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+#define SIPHASH_KEY_SIZE 16		/**< Size of a SipHash key */
+
+/**
+ * @brief Computes SipHash-2-4 of a message.
+ * @param[in] key A 16-byte secret key.
+ * @param[in] data The message.
+ * @param[in] size Size of the message.
+ * @return The 64-bit hash.
+ */
+uint64_t siphash24(const unsigned char key[SIPHASH_KEY_SIZE], const void *data, size_t size);
+
+/**
+ * @brief Computes SipHash-2-4 of many 16-byte messages, four at a time.
+ * @details Each message is given as its two little-endian 64-bit words, so that
+ * `hashes[i]` equals `siphash24` of the 16 bytes of `messages[i]` stored little-endian.
+ * Four messages go through the rounds together in vector registers.
+ * @param[in] key A 16-byte secret key.
+ * @param[in] messages The messages.
+ * @param[in] count Number of messages.
+ * @param[out] hashes The `count` hashes.
+ */
+void siphash24_pairs(const unsigned char key[SIPHASH_KEY_SIZE], const uint64_t (*messages)[2], size_t count,
+                     uint64_t *hashes);
+
+/**
+ * @brief Reads a key written as 32 hexadecimal digits.
+ * @param[in] hex The digits; parsing stops after the 32nd.
+ * @param[out] key The key.
+ * @return `false` if `hex` does not start with 32 hexadecimal digits followed by a non-digit.
+ */
+bool siphash_parse_key(const char *hex, unsigned char key[SIPHASH_KEY_SIZE]);
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SIPHASH_H_ */
@@ -0,0 +1,274 @@
+/**
+ * @file sketch.c
+ * @brief Implementation of the client sketches.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sketch.h"
+
+/* - - - - - - - - - - - - - - - - - - - - HASHING - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Mixes a key with the seed (finaliser of MurmurHash3): every bit of the result
+ * depends on every bit of the key.
+ */
+static inline uint64_t sketch_hash(uint64_t seed, uint32_t key) {
+    uint64_t hash = seed ^ key;
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+/**
+ * @brief Column of a key in one row of the Count-Min sketch (double hashing over the two halves).
+ */
+static inline unsigned int cms_column(uint64_t hash, unsigned int row) {
+    uint32_t first = (uint32_t)hash;
+    uint32_t step = (uint32_t)(hash >> 32) | 1;
+    return (first + row * step) & (SKETCH_CMS_WIDTH - 1);
+}
+
+/**
+ * @brief Slot of the heavy-hitter index where the search for a key starts.
+ */
+static inline unsigned int top_home(uint64_t hash) {
+    return (unsigned int)(hash >> 40) & (SKETCH_TOP_SLOTS - 1);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HASHING - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - SPACE-SAVING - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Finds the counter of a key.
+ * @return Its position in `top`, or -1 if the key is not monitored.
+ */
+static int find_counter(const SketchSet *set, uint32_t key, uint64_t hash) {
+    for (unsigned int slot = top_home(hash); set->top_index[slot] != 0; slot = (slot + 1) & (SKETCH_TOP_SLOTS - 1)) {
+        int position = set->top_index[slot] - 1;
+        if (set->top[position].key == key) {
+            return position;
+        }
+    }
+    return -1;
+}
+
+static void index_insert(SketchSet *set, uint64_t hash, unsigned int position) {
+    unsigned int slot = top_home(hash);
+    while (set->top_index[slot] != 0) {
+        slot = (slot + 1) & (SKETCH_TOP_SLOTS - 1);
+    }
+    set->top_index[slot] = (uint8_t)(position + 1);
+}
+
+/**
+ * @brief Removes a key from the index, moving back the entries that probed past it.
+ */
+static void index_remove(SketchSet *set, uint32_t key) {
+    unsigned int hole = top_home(sketch_hash(set->seed, key));
+    while (set->top[set->top_index[hole] - 1].key != key) {
+        hole = (hole + 1) & (SKETCH_TOP_SLOTS - 1);
+    }
+    set->top_index[hole] = 0;
+    for (unsigned int slot = (hole + 1) & (SKETCH_TOP_SLOTS - 1); set->top_index[slot] != 0;
+         slot = (slot + 1) & (SKETCH_TOP_SLOTS - 1)) {
+        unsigned int home = top_home(sketch_hash(set->seed, set->top[set->top_index[slot] - 1].key));
+        /* The entry stays if its home lies cyclically in (hole, slot] */
+        if (((slot - home) & (SKETCH_TOP_SLOTS - 1)) < ((slot - hole) & (SKETCH_TOP_SLOTS - 1))) {
+            continue;
+        }
+        set->top_index[hole] = set->top_index[slot];
+        set->top_index[slot] = 0;
+        hole = slot;
+    }
+}
+
+/**
+ * @brief Finds the smallest counter by a scan.
+ * @details Only needed when a key may be admitted: the scan over `SKETCH_TOP_K` counts
+ * is cheaper overall than a heap repaired at every datagram of a monitored key.
+ * @return Its position in `top`.
+ */
+static unsigned int find_smallest(const SketchSet *set) {
+    unsigned int smallest = 0;
+    for (unsigned int i = 1; i < set->top_count; i++) {
+        smallest = set->top[i].count < set->top[smallest].count ? i : smallest;
+    }
+    return smallest;
+}
+
+/**
+ * @brief Starts monitoring a key; the summary must not be full.
+ */
+static void top_append(SketchSet *set, const SketchCounter *counter, uint64_t hash) {
+    unsigned int position = set->top_count++;
+    set->top[position] = *counter;
+    index_insert(set, hash, position);
+}
+
+/**
+ * @brief Counts a datagram in the Space-Saving summary.
+ * @details A monitored key gets one more. Another key takes the place of the smallest
+ * counter once its Count-Min estimate exceeds it: until then the key cannot have sent
+ * more than the smallest count, which is all an unmonitored key may claim, and the
+ * replacement is skipped for the many clients that send a datagram now and then. The
+ * newcomer starts at its estimate, an upper bound. `floor` never exceeds the smallest
+ * count, so comparing with it first spares most of the scans.
+ */
+static void top_add(SketchSet *set, uint32_t key, uint64_t hash, uint32_t estimate) {
+    int position = find_counter(set, key, hash);
+    if (position >= 0) {
+        set->top[position].count++;
+        return;
+    }
+    if (set->top_count < SKETCH_TOP_K) {
+        top_append(set, &(SketchCounter){ .key = key, .count = 1, .error = 0 }, hash);
+        return;
+    }
+    if (estimate <= set->floor) {
+        return;
+    }
+    SketchCounter *smallest = &set->top[find_smallest(set)];
+    set->floor = smallest->count;
+    if (estimate <= smallest->count) {
+        return;
+    }
+    index_remove(set, smallest->key);
+    index_insert(set, hash, (unsigned int)(smallest - set->top));
+    smallest->key = key;
+    smallest->count = estimate;
+    smallest->error = estimate - 1;
+}
+
+/**
+ * @brief Smallest count of a summary, the most a key it does not monitor can have had.
+ */
+static uint32_t top_floor(const SketchSet *set) {
+    return set->top_count < SKETCH_TOP_K ? 0 : set->top[find_smallest(set)].count;
+}
+
+static int compare_counters(const void *a, const void *b) {
+    const SketchCounter *first = a;
+    const SketchCounter *second = b;
+    return (first->count < second->count) - (first->count > second->count);	/**< Largest first */
+}
+
+/* - - - - - - - - - - - - - - - - - - END SPACE-SAVING - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - SKETCHES - - - - - - - - - - - - - - - - - - - - */
+
+void sketch_init(SketchSet *set, uint64_t seed) {
+    memset(set, 0, sizeof(*set));
+    set->seed = seed;
+}
+
+void sketch_add(SketchSet *set, uint32_t key) {
+    uint64_t hash = sketch_hash(set->seed, key);
+
+    /* HyperLogLog: the register chosen by the top bits keeps the longest run of leading zeros of the others */
+    uint64_t rest = (hash << SKETCH_HLL_BITS) | (1ull << (SKETCH_HLL_BITS - 1));
+    uint8_t rank = (uint8_t)(__builtin_clzll(rest) + 1);
+    uint8_t *reg = &set->registers[hash >> (64 - SKETCH_HLL_BITS)];
+    *reg = rank > *reg ? rank : *reg;
+
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        uint32_t count = ++set->counts[row][cms_column(hash, row)];
+        estimate = count < estimate ? count : estimate;
+    }
+    top_add(set, key, hash, estimate);
+    set->packets++;
+}
+
+void sketch_merge(SketchSet *target, const SketchSet *source) {
+    for (unsigned int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        target->registers[i] = source->registers[i] > target->registers[i] ? source->registers[i] : target->registers[i];
+    }
+    for (unsigned int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        for (unsigned int column = 0; column < SKETCH_CMS_WIDTH; column++) {
+            target->counts[row][column] += source->counts[row][column];
+        }
+    }
+    target->packets += source->packets;
+
+    /* Every key of either summary, with the floor of the other summary when it is missing there */
+    SketchCounter candidates[2 * SKETCH_TOP_K];
+    size_t candidate_count = 0;
+    uint32_t target_floor = top_floor(target);
+    uint32_t source_floor = top_floor(source);
+    for (unsigned int i = 0; i < target->top_count; i++) {
+        SketchCounter counter = target->top[i];
+        int position = find_counter(source, counter.key, sketch_hash(source->seed, counter.key));
+        counter.count += position >= 0 ? source->top[position].count : source_floor;
+        counter.error += position >= 0 ? source->top[position].error : source_floor;
+        candidates[candidate_count++] = counter;
+    }
+    for (unsigned int i = 0; i < source->top_count; i++) {
+        SketchCounter counter = source->top[i];
+        if (find_counter(target, counter.key, sketch_hash(target->seed, counter.key)) >= 0) {
+            continue;
+        }
+        counter.count += target_floor;
+        counter.error += target_floor;
+        candidates[candidate_count++] = counter;
+    }
+    qsort(candidates, candidate_count, sizeof(candidates[0]), compare_counters);
+
+    target->top_count = 0;
+    memset(target->top_index, 0, sizeof(target->top_index));
+    for (size_t i = 0; i < candidate_count && i < SKETCH_TOP_K; i++) {
+        top_append(target, &candidates[i], sketch_hash(target->seed, candidates[i].key));
+    }
+    target->floor = top_floor(target);
+}
+
+uint64_t sketch_unique(const SketchSet *set) {
+    const double registers = SKETCH_HLL_REGISTERS;
+    uint32_t ranks[64 - SKETCH_HLL_BITS + 2] = { 0 };	/**< Registers holding each rank */
+    double sum = 0;
+
+    for (unsigned int i = 0; i < SKETCH_HLL_REGISTERS; i++) {
+        ranks[set->registers[i]]++;
+    }
+    for (unsigned int rank = 0; rank < sizeof(ranks) / sizeof(ranks[0]); rank++) {
+        sum += ldexp(ranks[rank], -(int)rank);
+    }
+    unsigned int zeros = ranks[0];
+    double estimate = 0.7213 / (1 + 1.079 / registers) * registers * registers / sum;
+    if (estimate <= 2.5 * registers && zeros > 0) {
+        estimate = registers * log(registers / zeros);	/**< Few clients: linear counting is more accurate */
+    }
+    return (uint64_t)(estimate + 0.5);
+}
+
+uint32_t sketch_estimate(const SketchSet *set, uint32_t key) {
+    uint64_t hash = sketch_hash(set->seed, key);
+    uint32_t estimate = UINT32_MAX;
+    for (unsigned int row = 0; row < SKETCH_CMS_DEPTH; row++) {
+        uint32_t count = set->counts[row][cms_column(hash, row)];
+        estimate = count < estimate ? count : estimate;
+    }
+    return estimate;
+}
+
+size_t sketch_top(const SketchSet *set, SketchCounter *counters, size_t capacity) {
+    SketchCounter sorted[SKETCH_TOP_K];
+    memcpy(sorted, set->top, set->top_count * sizeof(sorted[0]));
+    qsort(sorted, set->top_count, sizeof(sorted[0]), compare_counters);
+
+    size_t count = set->top_count < capacity ? set->top_count : capacity;
+    memcpy(counters, sorted, count * sizeof(counters[0]));
+    return count;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END SKETCHES - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,126 @@
+/**
+ * @file sketch.h
+ * @brief Streaming sketches of the clients of a server.
+ *
+ * Three summaries of constant size, updated once per received datagram:
+ * - a HyperLogLog counting the distinct clients (about 1.6% standard error);
+ * - a Count-Min sketch estimating how many datagrams any client sent, never
+ *   below the true count;
+ * - a Space-Saving summary keeping the `SKETCH_TOP_K` heaviest clients, each
+ *   with its count and the most that count may overestimate.
+ *
+ * The three hash a client with a single 64-bit mix of its IPv4 address and of a
+ * seed, so a datagram costs one hash, a register update, `SKETCH_CMS_DEPTH`
+ * increments and a probe of the heavy-hitter index. A client that is not among
+ * the heavy hitters only replaces one once its Count-Min estimate exceeds the
+ * smallest of their counts, which spares the replacement to the occasional senders.
+ *
+ * Sketches built with the same seed can be merged: each worker of a server can
+ * keep its own set, or a set per time window, and the sets are merged only when
+ * somebody asks for the figures.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef SKETCH_H_
+#define SKETCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - SKETCHES - - - - - - - - - - - - - - - - - - - - */
+
+#define SKETCH_HLL_BITS 12								/**< Index bits of the HyperLogLog */
+#define SKETCH_HLL_REGISTERS (1u << SKETCH_HLL_BITS)	/**< Registers of the HyperLogLog */
+#define SKETCH_CMS_DEPTH 4								/**< Rows of the Count-Min sketch */
+#define SKETCH_CMS_WIDTH 2048							/**< Counters per row, a power of two */
+#define SKETCH_TOP_K 64									/**< Clients kept by the Space-Saving summary */
+#define SKETCH_TOP_SLOTS (4 * SKETCH_TOP_K)				/**< Entries of its index, a power of two, mostly empty for short probes */
+
+/**
+ * @struct SketchCounter
+ * @brief One monitored client of the Space-Saving summary.
+ */
+typedef struct {
+    uint32_t key;		/**< IPv4 address, in network byte order */
+    uint32_t count;		/**< Estimated datagrams, never below the true count */
+    uint32_t error;		/**< Most `count` may exceed the true count by */
+} SketchCounter;
+
+/**
+ * @struct SketchSet
+ * @brief The three sketches of one worker or one time window.
+ */
+typedef struct {
+    uint64_t seed;									/**< Hash seed, equal in sets that are merged */
+    uint64_t packets;								/**< Datagrams added */
+    uint8_t registers[SKETCH_HLL_REGISTERS];		/**< HyperLogLog */
+    uint32_t counts[SKETCH_CMS_DEPTH][SKETCH_CMS_WIDTH];	/**< Count-Min sketch */
+    SketchCounter top[SKETCH_TOP_K];				/**< Space-Saving counters, in no particular order */
+    unsigned int top_count;							/**< Entries of `top` */
+    uint32_t floor;									/**< Smallest count of a full `top`, or less */
+    uint8_t top_index[SKETCH_TOP_SLOTS];			/**< Hash index of `top`: position plus one, 0 for empty */
+} SketchSet;
+
+/**
+ * @brief Empties a set.
+ * @param[out] set The set.
+ * @param[in] seed Hash seed; only sets with the same seed can be merged.
+ */
+void sketch_init(SketchSet *set, uint64_t seed);
+
+/**
+ * @brief Counts one datagram of a client.
+ * @param[in,out] set The set.
+ * @param[in] key IPv4 address of the client, in network byte order.
+ */
+void sketch_add(SketchSet *set, uint32_t key);
+
+/**
+ * @brief Adds the datagrams counted by `source` to `target`.
+ * @details The HyperLogLog and the Count-Min sketch merge exactly. The heavy
+ * hitters are merged as in Agarwal et al. (2012): a client missing from a full
+ * summary is assumed to have its smallest count, then the `SKETCH_TOP_K`
+ * largest are kept, so the counts remain upper bounds with their error.
+ * @param[in,out] target The set receiving the counts.
+ * @param[in] source A set with the same seed.
+ */
+void sketch_merge(SketchSet *target, const SketchSet *source);
+
+/**
+ * @brief Estimates the number of distinct clients.
+ * @param[in] set The set.
+ * @return The estimate.
+ */
+uint64_t sketch_unique(const SketchSet *set);
+
+/**
+ * @brief Estimates the datagrams sent by one client.
+ * @param[in] set The set.
+ * @param[in] key IPv4 address of the client, in network byte order.
+ * @return An estimate never below the true count.
+ */
+uint32_t sketch_estimate(const SketchSet *set, uint32_t key);
+
+/**
+ * @brief Lists the heaviest clients, heaviest first.
+ * @param[in] set The set.
+ * @param[out] counters Destination of at most `capacity` counters.
+ * @param[in] capacity Size of `counters`.
+ * @return Number of counters written.
+ */
+size_t sketch_top(const SketchSet *set, SketchCounter *counters, size_t capacity);
+
+/* - - - - - - - - - - - - - - - - - - - END SKETCHES - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SKETCH_H_ */
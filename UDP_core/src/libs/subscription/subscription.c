@@ -0,0 +1,290 @@
+/**
+ * @file subscription.c
+ * @brief Implementation of the client side of the password streams.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#include <winsock2.h>
+#define poll WSAPoll
+typedef int socklen_t;
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <errno.h>
+#include <sys/socket.h>
+#define closesocket close
+#endif
+
+#include <string.h>
+
+#include "subscription.h"
+#include "libs/clock/clock.h"
+
+#define SUBSCRIPTION_RECEIVE_BUFFER (1024 * 1024)	/**< Socket buffer able to hold a large window */
+#define SUBSCRIPTION_RECEIVE_BATCH 256				/**< Datagrams read per call before sending credits */
+#define SUBSCRIPTION_RETRY_NS (SUBSCRIPTION_RETRY_MS * NANOSECONDS_PER_MILLISECOND)
+#define SUBSCRIPTION_KEEPALIVE_NS (SUBSCRIPTION_KEEPALIVE_MS * NANOSECONDS_PER_MILLISECOND)
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Switches a socket to non-blocking mode.
+ */
+static bool set_nonblocking(int socket_descriptor) {
+#if defined WIN32
+    u_long enabled = 1;
+    return ioctlsocket(socket_descriptor, FIONBIO, &enabled) == 0;
+#else
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/**
+ * @brief Tells whether the last socket call failed only because it would have blocked.
+ */
+static bool would_block(void) {
+#if defined WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+#endif
+}
+
+/**
+ * @brief Datagrams granted and not received yet.
+ * @details 0 when the server sent past the credits, as after a subscribe sent again.
+ */
+static uint32_t in_flight(const PassgenSubscription *subscription) {
+    int32_t ahead = (int32_t)(subscription->granted - subscription->next_sequence);
+    return ahead > 0 ? (uint32_t)ahead : 0;
+}
+
+/**
+ * @brief Sends a request to the server of the subscription.
+ * @return `false` on a socket error other than a full send buffer.
+ */
+static bool send_request(const PassgenSubscription *subscription, const unsigned char *buffer, size_t size) {
+    if (sendto(subscription->socket, (const char *)buffer, size, 0, (const struct sockaddr *)&subscription->server,
+               sizeof(subscription->server)) != (int)size) {
+        return would_block();	/**< A full buffer is handled like a lost datagram */
+    }
+    return true;
+}
+
+/**
+ * @brief Sends the subscribe request, which (re)starts the server with `window` credits.
+ */
+static bool send_subscribe(PassgenSubscription *subscription, uint64_t now_ns) {
+    unsigned char buffer[REQUEST_HEADER_SIZE + COOKIE_EXTENSION_SIZE + SUBSCRIBE_BODY_SIZE];
+    SubscribeOptions options = { .rate = subscription->rate, .credits = subscription->window };
+    size_t size = codec_encode_subscribe(buffer, sizeof(buffer), &subscription->spec, &options);
+
+    subscription->granted = subscription->next_sequence + subscription->window;
+    subscription->subscribed_ns = subscription->credited_ns = now_ns;
+    subscription->stats.subscribes++;
+    return send_request(subscription, buffer, size);
+}
+
+/**
+ * @brief Grants the credits the server needs to keep `window` datagrams ahead.
+ * @param[in] stalled Nothing arrived since the last credit: the datagrams still counted in
+ *            flight are taken as lost, or the credit that granted them was.
+ */
+static bool send_credit(PassgenSubscription *subscription, bool stalled, uint64_t now_ns) {
+    unsigned char buffer[REQUEST_HEADER_SIZE + CREDIT_BODY_SIZE];
+    uint32_t ahead = stalled ? 0 : in_flight(subscription);
+    uint32_t credits = ahead < subscription->window ? subscription->window - ahead : 0;
+    size_t size = codec_encode_credit(buffer, sizeof(buffer), subscription->spec.request_id, credits);
+
+    subscription->granted = subscription->next_sequence + ahead + credits;
+    subscription->credited_ns = now_ns;
+    subscription->stats.credits++;
+    return send_request(subscription, buffer, size);
+}
+
+/**
+ * @brief Accounts for the sequence number of a datagram of the stream.
+ */
+static void record_sequence(PassgenSubscription *subscription, uint32_t sequence) {
+    int32_t ahead = (int32_t)(sequence - subscription->next_sequence);	/**< Signed: the sequence may wrap */
+    if (ahead >= 0) {
+        subscription->stats.lost += (uint32_t)ahead;
+        subscription->next_sequence = sequence + 1;
+        return;
+    }
+    subscription->stats.late++;
+    if (subscription->stats.lost > 0) {
+        subscription->stats.lost--;		/**< Counted as lost when a newer one arrived first */
+    }
+}
+
+/**
+ * @brief Handles an answer of the server that carries no passwords.
+ * @return `false` on a socket error.
+ */
+static bool handle_status(PassgenSubscription *subscription, const ResponseView *response, uint64_t now_ns) {
+    switch (response->status) {
+        case STATUS_COOKIE_REQUIRED:
+            /* The server wants proof of our address before it pushes anything to it */
+            subscription->spec.cookie = response->cookie;
+            if (subscription->retries++ >= SUBSCRIPTION_RETRIES) {
+                subscription->status = STATUS_UNAVAILABLE;
+                return true;
+            }
+            return send_subscribe(subscription, now_ns);
+        case STATUS_STREAM_END:
+            subscription->status = STATUS_STREAM_END;
+            return true;
+        case STATUS_DEADLINE_EXCEEDED:
+            return true;
+        default:
+            subscription->status = response->status;	/**< Refused, or a credit for a stream that is gone */
+            return true;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - SUBSCRIPTION - - - - - - - - - - - - - - - - - - - */
+
+bool subscription_open(PassgenSubscription *subscription, const struct sockaddr_in *server, char type,
+                       uint8_t length, uint16_t count, uint32_t rate, uint32_t window) {
+    int buffer_size = SUBSCRIPTION_RECEIVE_BUFFER;
+    uint16_t max_count = length > 0 ? (uint16_t)MAX_STREAM_COUNT(length) : 0;
+
+    memset(subscription, 0, sizeof(*subscription));
+    subscription->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (subscription->socket < 0) {
+        return false;
+    }
+    if (!set_nonblocking(subscription->socket)) {
+        closesocket(subscription->socket);
+        return false;
+    }
+    setsockopt(subscription->socket, SOL_SOCKET, SO_RCVBUF, (const char *)&buffer_size, sizeof(buffer_size));
+
+    uint64_t now_ns = clock_now_ns();
+    subscription->server = *server;
+    subscription->spec = (RequestView){
+        .type = type,
+        .length = length,
+        .count = count < max_count ? count : max_count,
+        .request_id = (uint32_t)(now_ns >> 10) | 1		/**< Not the id of a stream of an earlier run */
+    };
+    subscription->rate = rate;
+    subscription->window = window != 0 ? window : SUBSCRIPTION_DEFAULT_WINDOW;
+    subscription->status = STATUS_OK;
+    if (!send_subscribe(subscription, now_ns)) {
+        closesocket(subscription->socket);
+        return false;
+    }
+    return true;
+}
+
+int subscription_poll(PassgenSubscription *subscription, int timeout_ms, SubscriptionCallback callback,
+                      void *context) {
+    uint64_t now_ns = clock_now_ns();
+    int delivered = 0;
+
+    if (!subscription_active(subscription)) {
+        return 0;
+    }
+
+    /* Never sleep past the next retransmission of the subscribe or the next keepalive */
+    uint64_t due_ns = subscription->started ? subscription->credited_ns + SUBSCRIPTION_KEEPALIVE_NS
+                                            : subscription->subscribed_ns + SUBSCRIPTION_RETRY_NS;
+    int due_ms = due_ns <= now_ns ? 0
+        : (int)((due_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+    if (timeout_ms < 0 || due_ms < timeout_ms) {
+        timeout_ms = due_ms;
+    }
+
+    struct pollfd descriptor = { .fd = subscription->socket, .events = POLLIN };
+    if (poll(&descriptor, 1, timeout_ms) < 0 && !would_block()) {
+        return -1;
+    }
+
+    for (int i = 0; i < SUBSCRIPTION_RECEIVE_BATCH && (descriptor.revents & POLLIN) && subscription_active(subscription);
+         i++) {
+        unsigned char buffer[MAX_DATAGRAM_SIZE];
+        struct sockaddr_in sender;
+        socklen_t sender_size = sizeof(sender);
+        ResponseView response;
+
+        int received = recvfrom(subscription->socket, (char *)buffer, sizeof(buffer), 0,
+                                (struct sockaddr *)&sender, &sender_size);
+        if (received < 0) {
+            if (would_block()) {
+                break;
+            }
+            return -1;
+        }
+        if (sender.sin_addr.s_addr != subscription->server.sin_addr.s_addr
+            || sender.sin_port != subscription->server.sin_port
+            || codec_decode_response(buffer, (size_t)received, &response) != CODEC_OK
+            || response.request_id != subscription->spec.request_id) {
+            continue;	/**< Not a datagram of this stream */
+        }
+        if (response.status != STATUS_STREAM_DATA) {
+            if (!handle_status(subscription, &response, clock_now_ns())) {
+                return -1;
+            }
+            continue;
+        }
+        if (response.type != subscription->spec.type || response.length != subscription->spec.length
+            || response.count > subscription->spec.count || response.encoding != ENCODING_PLAIN) {
+            continue;	/**< Not what was subscribed to: a spoofed or broken datagram */
+        }
+
+        subscription->started = true;
+        subscription->received_ns = clock_now_ns();
+        record_sequence(subscription, response.sequence);
+        subscription->stats.datagrams++;
+        subscription->stats.passwords += response.count;
+        callback(context, &response);
+        delivered++;
+    }
+    if (!subscription_active(subscription)) {
+        return delivered;
+    }
+
+    now_ns = clock_now_ns();
+    if (!subscription->started) {
+        if (now_ns - subscription->subscribed_ns < SUBSCRIPTION_RETRY_NS) {
+            return delivered;
+        }
+        if (subscription->retries++ >= SUBSCRIPTION_RETRIES) {
+            subscription->status = STATUS_UNAVAILABLE;	/**< The server never opened the stream */
+            return delivered;
+        }
+        return send_subscribe(subscription, now_ns) ? delivered : -1;
+    }
+
+    bool keepalive = now_ns - subscription->credited_ns >= SUBSCRIPTION_KEEPALIVE_NS;
+    if (in_flight(subscription) < subscription->window / 2 || keepalive) {
+        bool stalled = keepalive && subscription->received_ns < subscription->credited_ns;
+        if (!send_credit(subscription, stalled, now_ns)) {
+            return -1;
+        }
+    }
+    return delivered;
+}
+
+void subscription_close(PassgenSubscription *subscription) {
+    unsigned char buffer[REQUEST_HEADER_SIZE];
+    size_t size = codec_encode_unsubscribe(buffer, sizeof(buffer), subscription->spec.request_id);
+
+    if (subscription->status == STATUS_OK) {
+        send_request(subscription, buffer, size);	/**< Best effort: the idle timeout closes it otherwise */
+        subscription->status = STATUS_STREAM_END;
+    }
+    closesocket(subscription->socket);
+    subscription->socket = -1;
+}
+
+/* - - - - - - - - - - - - - - - - - - END SUBSCRIPTION - - - - - - - - - - - - - - - - - - */
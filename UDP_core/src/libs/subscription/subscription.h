@@ -0,0 +1,146 @@
+/**
+ * @file subscription.h
+ * @brief Client side of the server-push password streams.
+ *
+ * A `PassgenSubscription` opens a stream on a server (`OP_SUBSCRIBE`) from a
+ * socket of its own and receives the datagrams the server pushes, without a
+ * request per datagram. The server may send `window` datagrams ahead of the
+ * consumer: whenever fewer than half of them are left, the subscription grants
+ * the difference (`OP_CREDIT`), so a consumer that stops polling stops the
+ * stream. A credit also goes out at least every `SUBSCRIPTION_KEEPALIVE_MS`,
+ * so that a slow stream is not closed by the idle timeout of the server; when
+ * nothing arrived since the previous credit, it grants a whole window again, in
+ * case the credit or every datagram it granted was lost.
+ *
+ * The sequence numbers of the datagrams tell which ones were lost: a datagram
+ * that skips numbers counts them as lost, a datagram older than the newest one
+ * counts as late and, if it was counted as lost, is not lost any more. Lost
+ * datagrams are not asked for again: the passwords are random, the consumer
+ * only receives fewer of them for the same credits.
+ *
+ * A subscribe request that is not answered by a datagram is sent again, and
+ * again with the cookie of a server that requires one (`-k`). Streams carry no
+ * key and no tenant: they are served in the clear to unauthenticated clients.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef SUBSCRIPTION_H_
+#define SUBSCRIPTION_H_
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/codec/codec.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define SUBSCRIPTION_DEFAULT_WINDOW 64		/**< Datagrams the server may send ahead unless configured otherwise */
+#define SUBSCRIPTION_KEEPALIVE_MS (STREAM_IDLE_TIMEOUT_MS / 4)	/**< Longest time without a credit */
+#define SUBSCRIPTION_RETRY_MS 200			/**< Time before an unanswered subscribe is sent again */
+#define SUBSCRIPTION_RETRIES 5				/**< Subscribes sent again before giving up */
+
+/**
+ * @struct SubscriptionStats
+ * @brief Counters of a subscription.
+ */
+typedef struct {
+    uint64_t datagrams;		/**< Datagrams of passwords received */
+    uint64_t passwords;		/**< Passwords they carried */
+    uint64_t lost;			/**< Datagrams skipped by the sequence numbers and never arrived */
+    uint64_t late;			/**< Datagrams that arrived after a newer one (reordered or duplicated) */
+    uint64_t credits;		/**< Credit messages sent */
+    uint64_t subscribes;	/**< Subscribe messages sent, retransmissions included */
+} SubscriptionStats;
+
+/**
+ * @struct PassgenSubscription
+ * @brief A stream opened on a server.
+ */
+typedef struct {
+    int socket;						/**< Non-blocking UDP socket of the stream */
+    struct sockaddr_in server;		/**< The server */
+    RequestView spec;				/**< Type, length, passwords per datagram, stream id and cookie */
+    uint32_t rate;					/**< Passwords per second, 0 for no limit */
+    uint32_t window;				/**< Datagrams the server may send ahead */
+    uint32_t granted;				/**< Credits granted since the subscription, counted like the sequence */
+    uint32_t next_sequence;			/**< One past the newest sequence number received */
+    bool started;					/**< A datagram arrived: the server opened the stream */
+    unsigned int retries;			/**< Subscribes sent again */
+    uint64_t subscribed_ns;			/**< When the last subscribe was sent */
+    uint64_t credited_ns;			/**< When the last subscribe or credit was sent */
+    uint64_t received_ns;			/**< When the last datagram arrived */
+    ResponseStatus status;			/**< `STATUS_OK` while open, `STATUS_STREAM_END` once closed, or the error */
+    SubscriptionStats stats;		/**< Counters */
+} PassgenSubscription;
+
+/**
+ * @brief Function receiving the datagrams of a stream.
+ * @param[in] context The pointer given to `subscription_poll`.
+ * @param[in] datagram The datagram: `count` passwords of the subscribed type and length, and
+ *            its `sequence`. The view is only valid during the call.
+ */
+typedef void (*SubscriptionCallback)(void *context, const ResponseView *datagram);
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - SUBSCRIPTION - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Opens a stream: creates the socket and sends the subscribe request.
+ * @param[out] subscription The subscription to initialise.
+ * @param[in] server Address of the server.
+ * @param[in] type Password type.
+ * @param[in] length Password length.
+ * @param[in] count Passwords per datagram, capped by the server at `MAX_STREAM_COUNT(length)`.
+ * @param[in] rate Passwords per second, 0 for as fast as the server and the credits allow.
+ * @param[in] window Datagrams the server may send ahead, 0 for `SUBSCRIPTION_DEFAULT_WINDOW`.
+ * @return `false` if the socket could not be created or the request not sent.
+ */
+bool subscription_open(PassgenSubscription *subscription, const struct sockaddr_in *server, char type,
+                       uint8_t length, uint16_t count, uint32_t rate, uint32_t window);
+
+/**
+ * @brief Tells whether the stream is still open.
+ */
+static inline bool subscription_active(const PassgenSubscription *subscription) {
+    return subscription->status == STATUS_OK;
+}
+
+/**
+ * @brief Waits for datagrams, delivers them, and sends the credits and retransmissions that are due.
+ * @param[in,out] subscription The subscription.
+ * @param[in] timeout_ms Maximum wait when nothing is pending on the socket (-1 waits for the next credit).
+ * @param[in] callback Function receiving each datagram.
+ * @param[in] context Pointer handed to `callback`.
+ * @return Number of datagrams delivered, or -1 on a socket error. The stream may have been
+ *         closed meanwhile: see `subscription_active` and `status`.
+ */
+int subscription_poll(PassgenSubscription *subscription, int timeout_ms, SubscriptionCallback callback,
+                      void *context);
+
+/**
+ * @brief Closes the stream (`OP_UNSUBSCRIBE`, best effort) and the socket.
+ * @param[in,out] subscription The subscription.
+ */
+void subscription_close(PassgenSubscription *subscription);
+
+/* - - - - - - - - - - - - - - - - - - END SUBSCRIPTION - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* SUBSCRIPTION_H_ */
@@ -0,0 +1,226 @@
+/**
+ * @file template.c
+ * @brief Implementation of the template compiler, cache and interpreter.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <string.h>
+
+#include "template.h"
+
+/* - - - - - - - - - - - - - - - - - - - - ALPHABETS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @struct TemplateCharset
+ * @brief Characters of one alphabet and the rejection threshold of its 16-bit draws.
+ */
+typedef struct {
+    const char *characters;		/**< The characters */
+    uint32_t size;				/**< Number of characters */
+    uint32_t threshold;			/**< Draws whose low 16 bits of product fall below it are biased */
+} TemplateCharset;
+
+#define CHARSET(text) { text, sizeof(text) - 1, (65536u - (sizeof(text) - 1)) % (sizeof(text) - 1) }
+
+static const TemplateCharset charsets[TEMPLATE_ALPHABET_COUNT] = {
+    [TEMPLATE_DIGIT] = CHARSET("0123456789"),
+    [TEMPLATE_LOWER] = CHARSET("abcdefghijklmnopqrstuvwxyz"),
+    [TEMPLATE_UPPER] = CHARSET("ABCDEFGHIJKLMNOPQRSTUVWXYZ"),
+    [TEMPLATE_LOWER_CONSONANT] = CHARSET("bcdfghjklmnpqrstvwxyz"),
+    [TEMPLATE_UPPER_CONSONANT] = CHARSET("BCDFGHJKLMNPQRSTVWXYZ"),
+    [TEMPLATE_LOWER_VOWEL] = CHARSET("aeiou"),
+    [TEMPLATE_UPPER_VOWEL] = CHARSET("AEIOU"),
+    [TEMPLATE_LOWER_HEX] = CHARSET("0123456789abcdef"),
+    [TEMPLATE_UPPER_HEX] = CHARSET("0123456789ABCDEF"),
+    [TEMPLATE_MIXED] = CHARSET("abcdefghijklmnopqrstuvwxyz0123456789"),
+    [TEMPLATE_SYMBOL] = CHARSET("!@#$%^&*()"),
+    [TEMPLATE_ANY] = CHARSET("abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%^&*()"),
+};
+
+/**
+ * @brief Alphabet of every class character of the language, `TEMPLATE_LITERAL` for the others.
+ */
+static const uint8_t class_table[128] = {
+    ['9'] = TEMPLATE_DIGIT,
+    ['a'] = TEMPLATE_LOWER,           ['A'] = TEMPLATE_UPPER,
+    ['c'] = TEMPLATE_LOWER_CONSONANT, ['C'] = TEMPLATE_UPPER_CONSONANT,
+    ['v'] = TEMPLATE_LOWER_VOWEL,     ['V'] = TEMPLATE_UPPER_VOWEL,
+    ['x'] = TEMPLATE_LOWER_HEX,       ['X'] = TEMPLATE_UPPER_HEX,
+    ['m'] = TEMPLATE_MIXED,
+    ['s'] = TEMPLATE_SYMBOL,
+    ['*'] = TEMPLATE_ANY,
+};
+
+/* - - - - - - - - - - - - - - - - - - - END ALPHABETS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - COMPILER - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Appends `repeat` characters of an alphabet, or copies of a literal, to a program.
+ * @return `false` if the passwords would be longer than `MAX_PASSWORD_LENGTH`.
+ */
+static bool emit(TemplateProgram *program, uint8_t alphabet, char literal, unsigned int repeat) {
+    if (program->length + repeat > MAX_PASSWORD_LENGTH) {
+        return false;
+    }
+    if (alphabet == TEMPLATE_LITERAL) {
+        memset(program->literals + (program->length - program->draws), literal, repeat);
+    } else {
+        program->draws += (uint8_t)repeat;
+        program->entropy_bits += repeat * log2((double)charsets[alphabet].size);
+    }
+    /* Consecutive characters of one alphabet, or consecutive literals, share an op */
+    if (program->op_count == 0 || program->ops[program->op_count - 1].alphabet != alphabet) {
+        program->ops[program->op_count++] = (TemplateOp){ .alphabet = alphabet, .count = 0 };
+    }
+    program->ops[program->op_count - 1].count += (uint8_t)repeat;
+    program->length += (uint8_t)repeat;
+    return true;
+}
+
+bool template_compile(const char *text, size_t size, TemplateProgram *program) {
+    int previous = -1;			/**< Alphabet of the previous character, -1 where `{n}` is not allowed */
+    char previous_literal = 0;
+
+    memset(program, 0, sizeof(*program));
+    for (size_t i = 0; i < size; i++) {
+        unsigned char character = (unsigned char)text[i];
+        unsigned int repeat = 1;
+        uint8_t alphabet = TEMPLATE_LITERAL;
+        bool repeated = character == '{';
+
+        if (repeated) {
+            unsigned int total = 0;
+            size_t digits = 0;
+            while (++i < size && isdigit((unsigned char)text[i]) && ++digits <= 2) {
+                total = total * 10 + (unsigned int)(text[i] - '0');
+            }
+            if (previous < 0 || i == size || text[i] != '}' || digits == 0 || digits > 2 || total == 0) {
+                return false;
+            }
+            repeat = total - 1;		/**< The previous character was emitted already */
+            alphabet = (uint8_t)previous;
+            character = (unsigned char)previous_literal;
+        } else if (character == '\\') {
+            if (++i == size) {
+                return false;
+            }
+            character = (unsigned char)text[i];
+        } else if (character < sizeof(class_table) && class_table[character] != TEMPLATE_LITERAL) {
+            alphabet = class_table[character];
+        } else if (isalnum(character)) {
+            return false;		/**< Reserved for future classes */
+        }
+        if (character < 0x20 || character > 0x7E) {
+            return false;		/**< Printable ASCII only: a password never holds a newline */
+        }
+
+        if (repeat > 0 && !emit(program, alphabet, (char)character, repeat)) {
+            return false;
+        }
+        previous = repeated ? -1 : alphabet;		/**< `{n}{m}` is an error */
+        previous_literal = (char)character;
+    }
+    return program->length > 0;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END COMPILER - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - INTERPRETER - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Slow path: replaces the characters of a password whose random draw was biased.
+ * @details Called with the bytes `template_run` drew, before any other byte is taken from
+ * the stream, so that it finds the rejected positions again; it runs for few passwords.
+ */
+static __attribute__((noinline)) void redraw_rejected(const TemplateProgram *program, char *output,
+                                                      const unsigned char *bytes, RandomStream *stream) {
+    uint8_t positions[MAX_PASSWORD_LENGTH];
+    uint8_t alphabets[MAX_PASSWORD_LENGTH];
+    unsigned int rejected = 0;
+    unsigned int position = 0;
+
+    for (unsigned int i = 0; i < program->op_count; i++) {
+        const TemplateOp *op = &program->ops[i];
+        const TemplateCharset *charset = &charsets[op->alphabet];
+        for (unsigned int j = 0; j < op->count && op->alphabet != TEMPLATE_LITERAL; j++, bytes += 2) {
+            uint32_t product = ((uint32_t)bytes[0] | (uint32_t)bytes[1] << 8) * charset->size;
+            if ((product & 0xFFFF) < charset->threshold) {
+                positions[rejected] = (uint8_t)(position + j);
+                alphabets[rejected++] = op->alphabet;
+            }
+        }
+        position += op->count;
+    }
+    for (unsigned int i = 0; i < rejected; i++) {
+        const TemplateCharset *charset = &charsets[alphabets[i]];
+        output[positions[i]] = charset->characters[random_uniform(stream, charset->size)];
+    }
+}
+
+void template_run(const TemplateProgram *program, char *output, size_t count, RandomStream *stream) {
+    for (size_t n = 0; n < count; n++, output += program->length) {
+        /* The 16-bit draws of the whole password at once: at most 64 bytes of the keystream buffer */
+        const unsigned char *bytes = random_stream_take(stream, 2 * (size_t)program->draws);
+        const unsigned char *next = bytes;
+        const char *literal = program->literals;
+        char *out = output;
+        uint32_t any_rejected = 0;
+
+        for (unsigned int i = 0; i < program->op_count; i++) {
+            const TemplateOp op = program->ops[i];
+            if (op.alphabet == TEMPLATE_LITERAL) {
+                memcpy(out, literal, op.count);
+                literal += op.count;
+                out += op.count;
+                continue;
+            }
+            const TemplateCharset *charset = &charsets[op.alphabet];
+            for (unsigned int j = 0; j < op.count; j++, next += 2) {
+                uint32_t product = ((uint32_t)next[0] | (uint32_t)next[1] << 8) * charset->size;
+                out[j] = charset->characters[product >> 16];
+                any_rejected |= (product & 0xFFFF) < charset->threshold;
+            }
+            out += op.count;
+        }
+        if (__builtin_expect(any_rejected != 0, 0)) {
+            redraw_rejected(program, output, bytes, stream);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - END INTERPRETER - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - - CACHE - - - - - - - - - - - - - - - - - - - - - */
+
+void template_cache_init(TemplateCache *cache, RandomStream *stream) {
+    memset(cache, 0, sizeof(*cache));
+    random_stream_bytes(stream, cache->key, sizeof(cache->key));
+}
+
+const TemplateProgram *template_cache_lookup(TemplateCache *cache, const char *text, size_t size) {
+    if (size == 0 || size > TEMPLATE_MAX_SIZE) {
+        return NULL;
+    }
+    uint64_t hash = siphash24(cache->key, text, size);
+    TemplateCacheEntry *entry = &cache->entries[hash & (TEMPLATE_CACHE_SLOTS - 1)];
+    if (entry->size == size && entry->hash == hash && memcmp(entry->text, text, size) == 0) {
+        return &entry->program;
+    }
+
+    /* Miss: the template takes the slot over, unless it does not compile */
+    entry->size = 0;
+    if (!template_compile(text, size, &entry->program)) {
+        return NULL;
+    }
+    entry->hash = hash;
+    entry->size = (uint8_t)size;
+    memcpy(entry->text, text, size);
+    return &entry->program;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END CACHE - - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,163 @@
+/**
+ * @file template.h
+ * @brief Passwords following a template, such as `Cvc-9999-XX` or `A{4}-9{4}`.
+ *
+ * A template describes a password character by character. A class letter is
+ * replaced by a character drawn from its alphabet; any other character that is
+ * neither a letter nor a digit stands for itself:
+ *
+ * | Character | Drawn from                                        | Size |
+ * |-----------|---------------------------------------------------|------|
+ * | `9`       | digits                                            | 10   |
+ * | `a` `A`   | lowercase, uppercase letters                      | 26   |
+ * | `c` `C`   | lowercase, uppercase consonants                   | 21   |
+ * | `v` `V`   | lowercase, uppercase vowels                       | 5    |
+ * | `x` `X`   | lowercase, uppercase hex digits                   | 16   |
+ * | `m`       | lowercase letters and digits (as the 'm' type)    | 36   |
+ * | `s`       | symbols of the 's' type                           | 10   |
+ * | `*`       | any character of the 's' type                     | 72   |
+ *
+ * `{n}` repeats the previous character n times in all (`9{4}` is `9999`), and
+ * `\` makes the next character a literal, a letter or a digit included. Other
+ * letters and digits are errors, so that new classes can be added later. The
+ * password has between 1 and `MAX_PASSWORD_LENGTH` characters.
+ *
+ * A template is compiled once into a short program of (alphabet, count) ops,
+ * consecutive characters of the same class or literals sharing one op. Every
+ * engine keeps the programs of the templates it was asked for in a cache
+ * indexed by a keyed hash of their text, so that a template is parsed once and
+ * then only looked up. The interpreter takes the random bytes of a whole
+ * password at once, 16 bits per drawn character, and writes the characters
+ * straight to their destination, with the same multiply-and-shift mapping and
+ * rare redraws as the built-in generators.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef TEMPLATE_H_
+#define TEMPLATE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/protocol/protocol.h"
+#include "libs/random/random.h"
+#include "libs/siphash/siphash.h"
+
+#if defined(__cplusplus)
+extern "C" {
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - TEMPLATES - - - - - - - - - - - - - - - - - - - - */
+
+#define TEMPLATE_CACHE_SLOTS 64		/**< Programs cached by an engine, a power of two */
+
+/**
+ * @enum TemplateAlphabet
+ * @brief Alphabet of a template op.
+ */
+typedef enum {
+    TEMPLATE_LITERAL,			/**< Characters copied from the literals of the program */
+    TEMPLATE_DIGIT,				/**< `9` */
+    TEMPLATE_LOWER,				/**< `a` */
+    TEMPLATE_UPPER,				/**< `A` */
+    TEMPLATE_LOWER_CONSONANT,	/**< `c` */
+    TEMPLATE_UPPER_CONSONANT,	/**< `C` */
+    TEMPLATE_LOWER_VOWEL,		/**< `v` */
+    TEMPLATE_UPPER_VOWEL,		/**< `V` */
+    TEMPLATE_LOWER_HEX,			/**< `x` */
+    TEMPLATE_UPPER_HEX,			/**< `X` */
+    TEMPLATE_MIXED,				/**< `m` */
+    TEMPLATE_SYMBOL,			/**< `s` */
+    TEMPLATE_ANY,				/**< `*` */
+    TEMPLATE_ALPHABET_COUNT		/**< Number of alphabets */
+} TemplateAlphabet;
+
+/**
+ * @struct TemplateOp
+ * @brief One instruction: `count` characters from one alphabet.
+ */
+typedef struct {
+    uint8_t alphabet;	/**< `TemplateAlphabet` */
+    uint8_t count;		/**< Characters written */
+} TemplateOp;
+
+/**
+ * @struct TemplateProgram
+ * @brief A compiled template.
+ */
+typedef struct {
+    uint8_t length;								/**< Characters of a password */
+    uint8_t draws;								/**< Of which drawn at random */
+    uint8_t op_count;							/**< Entries of `ops` */
+    TemplateOp ops[MAX_PASSWORD_LENGTH];		/**< The instructions, in order */
+    char literals[MAX_PASSWORD_LENGTH];			/**< Literal characters, in the order of their ops */
+    double entropy_bits;						/**< Entropy of a password */
+} TemplateProgram;
+
+/**
+ * @struct TemplateCacheEntry
+ * @brief A cached program and the text it was compiled from.
+ */
+typedef struct {
+    uint64_t hash;							/**< Keyed hash of `text` */
+    uint8_t size;							/**< Size of `text`, 0 for a free entry */
+    char text[TEMPLATE_MAX_SIZE];			/**< The template */
+    TemplateProgram program;				/**< Its program */
+} TemplateCacheEntry;
+
+/**
+ * @struct TemplateCache
+ * @brief Programs of the recently used templates, one entry per hash slot.
+ * @details A cache must only be used by one thread at a time.
+ */
+typedef struct {
+    unsigned char key[SIPHASH_KEY_SIZE];				/**< Key of the hashes, random */
+    TemplateCacheEntry entries[TEMPLATE_CACHE_SLOTS];	/**< Entries by slot */
+} TemplateCache;
+
+/**
+ * @brief Compiles a template.
+ * @param[in] text The template, not necessarily terminated.
+ * @param[in] size Size of `text`.
+ * @param[out] program The program.
+ * @return `false` if the template is not valid or its passwords would be empty or too long.
+ */
+bool template_compile(const char *text, size_t size, TemplateProgram *program);
+
+/**
+ * @brief Writes passwords of a template back to back, without terminators.
+ * @param[in] program The compiled template.
+ * @param[out] output Destination of `count * program->length` characters.
+ * @param[in] count Number of passwords.
+ * @param[in,out] stream Source of randomness.
+ */
+void template_run(const TemplateProgram *program, char *output, size_t count, RandomStream *stream);
+
+/**
+ * @brief Initialises an empty cache.
+ * @param[out] cache The cache.
+ * @param[in,out] stream Source of the key of the hashes.
+ */
+void template_cache_init(TemplateCache *cache, RandomStream *stream);
+
+/**
+ * @brief Finds the program of a template, compiling and caching it on a miss.
+ * @details A template that does not compile is not cached.
+ * @param[in,out] cache The cache.
+ * @param[in] text The template.
+ * @param[in] size Size of `text`.
+ * @return The program, valid until the next call, or `NULL` if the template is not valid.
+ */
+const TemplateProgram *template_cache_lookup(TemplateCache *cache, const char *text, size_t size);
+
+/* - - - - - - - - - - - - - - - - - - END TEMPLATES - - - - - - - - - - - - - - - - - - - */
+
+#if defined(__cplusplus)
+}
+#endif
+
+#endif /* TEMPLATE_H_ */
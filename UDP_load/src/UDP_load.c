@@ -0,0 +1,364 @@
+/**
+ * @file UDP_load.c
+ * @brief Load generator: interactive latency of the servers with and without bulk traffic.
+ * @details An interactive client asks for one password at a time at a fixed rate,
+ * whatever the answers do (open loop), and records the latency of every request
+ * from the instant it was due, so that a stalled server is not hidden by requests
+ * that were never sent. The run has two phases of the same duration: the
+ * interactive client alone, then next to `-b` bulk clients, each on a socket of
+ * its own and keeping its window full of requests for a whole datagram of
+ * passwords. Each phase prints the percentiles of the interactive latency and the
+ * bulk throughput, which shows whether the interactive p99 holds under bulk load.
+ * Every program of the project links the same optimised client and core libraries.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <poll.h>  			/**< Include for poll() used by the event loop */
+#include <arpa/inet.h>  	/**< Include ARP and Internet address family libraries */
+#include <netinet/in.h>  	/**< Include for internet address family structures */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/protocol/protocol.h"      /**< Include protocol definitions for communication */
+#include "libs/clock/clock.h"            /**< Include the monotonic clock */
+#include "libs/client/client.h"          /**< Include the pipelined client library */
+#include "libs/resolver/resolver.h"      /**< Include the asynchronous resolver */
+
+#define RESOLVE_TIMEOUT_MS 5000			/**< Time allowed for the first resolution of the servers */
+#define MAX_BULK_CLIENTS 64				/**< Bulk clients of one run */
+#define DEFAULT_DURATION_S 10			/**< Duration of each phase */
+#define DEFAULT_RATE 1000				/**< Interactive requests per second */
+#define DEFAULT_BULK_CLIENTS 4			/**< Bulk clients of the second phase */
+#define DEFAULT_LENGTH 16				/**< Length of the passwords */
+#define DRAIN_TIMEOUT_MS 2000			/**< Time left to the last answers after a phase */
+
+
+/**
+ * @struct LoadOptions
+ * @brief Command-line options.
+ */
+typedef struct {
+    const char *server_name;	/**< Servers as "host[:port]", comma separated (-s) */
+    unsigned short port;		/**< Default port of the servers (-p) */
+    unsigned int duration_s;	/**< Duration of each phase (-d) */
+    unsigned int rate;			/**< Interactive requests per second (-r) */
+    unsigned int bulk_clients;	/**< Bulk clients of the second phase, 0 for none (-b) */
+    unsigned int bulk_window;	/**< Bulk requests in flight per bulk client (-w) */
+    char type;					/**< Password type (-t) */
+    uint8_t length;				/**< Password length (-l) */
+    bool classify;				/**< Leave the priority classes to the servers (-a) */
+} LoadOptions;
+
+/**
+ * @struct Latencies
+ * @brief Latencies of the interactive requests of one phase.
+ */
+typedef struct {
+    uint64_t *samples;		/**< Latency of each answered request, in nanoseconds */
+    size_t count;			/**< Samples recorded */
+    size_t capacity;		/**< Room in `samples` */
+    uint64_t failed;		/**< Requests not answered after the last retransmission */
+    uint64_t rejected;		/**< Requests answered with an error status */
+    uint64_t skipped;		/**< Requests not sent because the window was full */
+} Latencies;
+
+/**
+ * @struct BulkCounters
+ * @brief What the bulk clients received during one phase.
+ */
+typedef struct {
+    uint64_t responses;		/**< Answers */
+    uint64_t passwords;		/**< Passwords they carried */
+    uint64_t failed;		/**< Requests not answered */
+} BulkCounters;
+
+
+/**
+ * @brief Prints an error message on the standard error.
+ * @param[in] error_message The error message to be displayed.
+ */
+void error_handler(const char *error_message) {
+    fputs(error_message, stderr);
+}
+
+/**
+ * @brief Prints the command-line usage.
+ */
+void show_usage() {
+    fprintf(stderr,
+            "Usage: UDP_load [-s servers] [-p port] [-d seconds] [-r rate] [-b clients] [-w window] [-t type] [-l length] [-a]\n"
+            "Sends rate single-password requests per second for seconds, then again next to clients bulk\n"
+            "clients with window requests in flight each, and prints the interactive latency percentiles of\n"
+            "both phases. The requests carry their priority class, or none with -a (the servers classify them).\n");
+}
+
+/**
+ * @brief Parses the command line.
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ * @param[out] options The options.
+ * @return `true` if the command line is valid.
+ */
+bool parse_options(int argc, char *argv[], LoadOptions *options) {
+    *options = (LoadOptions){
+        .server_name = DEFAULT_IP,
+        .port = DEFAULT_PORT,
+        .duration_s = DEFAULT_DURATION_S,
+        .rate = DEFAULT_RATE,
+        .bulk_clients = DEFAULT_BULK_CLIENTS,
+        .bulk_window = CLIENT_DEFAULT_WINDOW,
+        .type = 'a',
+        .length = DEFAULT_LENGTH,
+    };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-a") == 0) {
+            options->classify = true;
+            continue;
+        }
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 == argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        switch (argv[i - 1][1]) {
+        case 's': options->server_name = value; break;
+        case 'p': options->port = (unsigned short)atoi(value); break;
+        case 'd': options->duration_s = (unsigned int)atoi(value); break;
+        case 'r': options->rate = (unsigned int)atoi(value); break;
+        case 'b': options->bulk_clients = (unsigned int)atoi(value); break;
+        case 'w': options->bulk_window = (unsigned int)atoi(value); break;
+        case 't': options->type = value[0]; break;
+        case 'l': options->length = (uint8_t)atoi(value); break;
+        default: return false;
+        }
+    }
+    return options->port != 0 && options->duration_s > 0 && options->rate > 0
+        && options->bulk_clients <= MAX_BULK_CLIENTS
+        && options->bulk_window > 0 && options->bulk_window <= CLIENT_MAX_WINDOW
+        && codec_check_type(options->type, options->length) == CODEC_OK;
+}
+
+/**
+ * @brief Registers every server of the `-s` list with the resolver.
+ * @param[in,out] resolver The resolver.
+ * @param[in] options The command-line options.
+ * @return `false` if an entry is invalid or there are too many servers.
+ */
+bool add_servers(Resolver *resolver, const LoadOptions *options) {
+    char list[BUFFER_SIZE];
+
+    snprintf(list, sizeof(list), "%s", options->server_name);
+    for (char *entry = strtok(list, ","); entry != NULL; entry = strtok(NULL, ",")) {
+        unsigned short port = options->port;
+        char *separator = strchr(entry, ':');
+
+        if (separator != NULL) {
+            *separator = '\0';
+            port = (unsigned short)atoi(separator + 1);
+        }
+        if (port == 0 || !resolver_add(resolver, entry, port)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Opens a client balancing over the resolved servers.
+ * @param[out] client The client.
+ * @param[in,out] resolver The resolver, started.
+ * @param[in] window Requests in flight.
+ * @param[in] priority Priority class of the requests.
+ * @return `true` if the socket was created.
+ */
+bool open_client(PassgenClient *client, Resolver *resolver, unsigned int window, RequestPriority priority) {
+    struct sockaddr_in server_addresses[CLIENT_MAX_SERVERS];	/**< Addresses of the servers */
+
+    size_t count = resolver_addresses(resolver, server_addresses, CLIENT_MAX_SERVERS);
+    if (count == 0 || !client_open(client, &server_addresses[0])) {
+        return false;
+    }
+    client_set_servers(client, server_addresses, count);
+    client_set_server_source(client, resolver_update_client, resolver);
+    client_set_priority(client, priority);
+    client->window = window;
+    return true;
+}
+
+/**
+ * @brief Client callback of the interactive requests: the tag is the instant the request was due.
+ */
+void on_interactive(void *context, uint64_t tag, const ResponseView *response) {
+    Latencies *latencies = context;
+    if (response == NULL) {
+        latencies->failed++;
+    } else if (response->status != STATUS_OK) {
+        latencies->rejected++;
+    } else if (latencies->count < latencies->capacity) {
+        latencies->samples[latencies->count++] = clock_now_ns() - tag;
+    }
+}
+
+/**
+ * @brief Client callback of the bulk requests.
+ */
+void on_bulk(void *context, uint64_t tag, const ResponseView *response) {
+    BulkCounters *counters = context;
+    (void)tag;
+    if (response == NULL) {
+        counters->failed++;
+    } else if (response->status == STATUS_OK) {
+        counters->responses++;
+        counters->passwords += response->count;
+    }
+}
+
+static int compare_latencies(const void *a, const void *b) {
+    uint64_t left = *(const uint64_t *)a, right = *(const uint64_t *)b;
+    return (left > right) - (left < right);
+}
+
+/**
+ * @brief Latency below which `fraction` of the samples fall, in microseconds; the samples must be sorted.
+ */
+double percentile_us(const Latencies *latencies, double fraction) {
+    if (latencies->count == 0) {
+        return 0.0;
+    }
+    size_t index = (size_t)(fraction * (double)(latencies->count - 1) + 0.5);
+    return (double)latencies->samples[index] / NANOSECONDS_PER_MICROSECOND;
+}
+
+/**
+ * @brief Runs one phase and prints its report.
+ * @param[in] name Name of the phase.
+ * @param[in,out] interactive The interactive client, idle.
+ * @param[in,out] bulk The bulk clients, idle.
+ * @param[in] bulk_count Bulk clients taking part in the phase.
+ * @param[in] options The command-line options.
+ * @param[in,out] latencies Storage of the samples, emptied first.
+ */
+void run_phase(const char *name, PassgenClient *interactive, PassgenClient *bulk, unsigned int bulk_count,
+               const LoadOptions *options, Latencies *latencies) {
+    BulkCounters counters = { 0 };
+    uint64_t interval_ns = NANOSECONDS_PER_SECOND / options->rate;
+    uint64_t start_ns = clock_now_ns();
+    uint64_t end_ns = start_ns + options->duration_s * NANOSECONDS_PER_SECOND;
+    uint64_t next_ns = start_ns;
+    uint64_t sent = 0;
+
+    latencies->count = latencies->failed = latencies->rejected = latencies->skipped = 0;
+    while (true) {
+        uint64_t now_ns = clock_now_ns();
+        bool sending = now_ns < end_ns;
+        bool busy = interactive->outstanding > 0;
+        for (unsigned int i = 0; i < bulk_count; i++) {
+            busy = busy || bulk[i].outstanding > 0;
+        }
+        if (!sending && (!busy || now_ns > end_ns + DRAIN_TIMEOUT_MS * NANOSECONDS_PER_MILLISECOND)) {
+            break;
+        }
+
+        /* Open loop: every due request is sent, or counted as skipped when the window is full */
+        for (; sending && next_ns <= now_ns; next_ns += interval_ns, sent++) {
+            if (!client_submit(interactive, options->type, options->length, 1, next_ns)) {
+                latencies->skipped++;
+            }
+        }
+        for (unsigned int i = 0; sending && i < bulk_count; i++) {
+            uint16_t count = client_max_count(&bulk[i], options->type, options->length);
+            while (client_can_submit(&bulk[i]) && client_submit(&bulk[i], options->type, options->length, count, 0)) {
+            }
+        }
+
+        struct pollfd descriptors[1 + MAX_BULK_CLIENTS];
+        descriptors[0] = (struct pollfd){ .fd = interactive->socket, .events = POLLIN };
+        for (unsigned int i = 0; i < bulk_count; i++) {
+            descriptors[1 + i] = (struct pollfd){ .fd = bulk[i].socket, .events = POLLIN };
+        }
+        /* Wake up for the next interactive request, and at least every millisecond for the retransmissions */
+        int timeout_ms = sending && next_ns <= now_ns + NANOSECONDS_PER_MILLISECOND ? 0 : 1;
+        poll(descriptors, 1 + bulk_count, timeout_ms);
+
+        if (client_poll(interactive, 0, on_interactive, latencies) < 0) {
+            error_handler("Socket error on the interactive client.\n");
+            break;
+        }
+        for (unsigned int i = 0; i < bulk_count; i++) {
+            client_poll(&bulk[i], 0, on_bulk, &counters);
+        }
+    }
+
+    double seconds = (double)options->duration_s;
+    qsort(latencies->samples, latencies->count, sizeof(latencies->samples[0]), compare_latencies);
+    printf("%s: %llu interactive requests, %zu answered, %llu failed, %llu rejected, %llu skipped\n", name,
+           (unsigned long long)sent, latencies->count, (unsigned long long)latencies->failed,
+           (unsigned long long)latencies->rejected, (unsigned long long)latencies->skipped);
+    printf("  latency (us): p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n", percentile_us(latencies, 0.50),
+           percentile_us(latencies, 0.90), percentile_us(latencies, 0.99), percentile_us(latencies, 0.999),
+           percentile_us(latencies, 1.0));
+    if (bulk_count > 0) {
+        printf("  bulk: %u clients, %.0f answers/s, %.0f passwords/s, %llu failed\n", bulk_count,
+               (double)counters.responses / seconds, (double)counters.passwords / seconds,
+               (unsigned long long)counters.failed);
+    }
+    fflush(stdout);
+}
+
+/**
+ * @brief Entry point of the load generator.
+ * @param[in] argc Number of command line arguments.
+ * @param[in] argv Command line arguments.
+ * @return EXIT_SUCCESS The phases ran.
+ * @return EXIT_FAILURE Invalid options, or the servers cannot be reached.
+ */
+int main(int argc, char *argv[]) {
+    static PassgenClient interactive;				/**< Large (slot table): kept out of the stack */
+    static PassgenClient bulk[MAX_BULK_CLIENTS];
+    LoadOptions options;
+    Resolver resolver;
+    Latencies latencies = { 0 };
+
+    if (!parse_options(argc, argv, &options)) {
+        show_usage();
+        return EXIT_FAILURE;
+    }
+
+    latencies.capacity = (size_t)options.rate * options.duration_s + 1;
+    latencies.samples = malloc(latencies.capacity * sizeof(latencies.samples[0]));
+    if (latencies.samples == NULL || !resolver_init(&resolver, 0)) {
+        error_handler("Cannot allocate the latency samples.\n");
+        return EXIT_FAILURE;
+    }
+    bool opened = add_servers(&resolver, &options) && resolver_start(&resolver)
+        && resolver_wait(&resolver, RESOLVE_TIMEOUT_MS)
+        && open_client(&interactive, &resolver, CLIENT_MAX_WINDOW,
+                       options.classify ? PRIORITY_AUTO : PRIORITY_INTERACTIVE);
+    for (unsigned int i = 0; opened && i < options.bulk_clients; i++) {
+        opened = open_client(&bulk[i], &resolver, options.bulk_window, options.classify ? PRIORITY_AUTO : PRIORITY_BULK);
+    }
+    if (!opened) {
+        error_handler("Cannot reach the servers.\n");
+        resolver_stop(&resolver);
+        return EXIT_FAILURE;
+    }
+
+    run_phase("interactive alone", &interactive, bulk, 0, &options, &latencies);
+    if (options.bulk_clients > 0) {
+        run_phase("interactive under bulk load", &interactive, bulk, options.bulk_clients, &options, &latencies);
+    }
+
+    client_close(&interactive);
+    for (unsigned int i = 0; i < options.bulk_clients; i++) {
+        client_close(&bulk[i]);
+    }
+    resolver_stop(&resolver);
+    free(latencies.samples);
+    return EXIT_SUCCESS;
+}
@@ -2,15 +2,20 @@
  * @file UDP_server.c
  * @brief UDP server implementation in C for handling password generation requests.
  *        Listens for incoming client requests, processes them, and sends back responses.
- * @version 1.0.0
+ *        A single-threaded event loop also pushes the datagrams of the open streams.
+ * @version 1.1.0
  * @date 2024-12-15
  * @author Cristian Biallo
  */
 
 #if defined WIN32
-#include <winsock.h> 		/**< Include Winsock header for Windows */
+#include <winsock2.h> 		/**< Include Winsock 2 header for Windows (needed for WSAPoll) */
+#define poll WSAPoll		/**< WSAPoll has the same interface as poll */
 #else
 #include <unistd.h>  		/**< Include UNIX standard header for close() */
+#include <fcntl.h>  		/**< Include for fcntl() to make the socket non-blocking */
+#include <poll.h>  			/**< Include for poll() used by the event loop */
+#include <errno.h>  		/**< Include for errno */
 #include <sys/socket.h>  	/**< Include socket library for UNIX */
 #include <arpa/inet.h>  	/**< Include ARP and Internet address family libraries */
 #include <sys/types.h>   	/**< Include for socket types */
@@ -24,12 +29,72 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
-#include "libs/password/password.h"  /**< Include the header for password generation functions */
+#include "libs/engine/engine.h"      /**< Include the embedding API the server is built on */
 #include "libs/protocol/protocol.h"  /**< Include protocol definitions for communication */
+#include "libs/codec/codec.h"        /**< Include the in-place message codec */
+#include "libs/packing/packing.h"    /**< Include the size of the bit-packed answers */
+#include "libs/clock/clock.h"        /**< Include the monotonic clock */
+#include "libs/stream/stream.h"      /**< Include the server-push streams */
+#include "libs/scheduler/scheduler.h" /**< Include the priority classes and fair queuing */
+#include "libs/cookie/cookie.h"      /**< Include the anti-spoofing cookies */
+#include "libs/keyring/keyring.h"    /**< Include the keys encrypting the responses */
+#include "libs/tenant/tenant.h"      /**< Include the tenants, their quotas and their metrics */
+#include "libs/analytics/analytics.h" /**< Include the sketches of the clients */
+#include "libs/ratelimit/ratelimit.h" /**< Include the per-client budget of the random bytes */
+#if defined PASSGEN_TCP_BULK
+#include "libs/bulk/bulk.h"          /**< Include the TCP bulk endpoint */
+#endif
+#if defined PASSGEN_AUDIT
+#include "libs/audit/audit.h"        /**< Include the audit log of the issued passwords */
+#else
+typedef struct AuditLog AuditLog;	/**< No audit log on this platform: the pointers stay `NULL` */
+#define AUDIT_DEFAULT_SYNC_MS 0
+#endif
+#if defined PASSGEN_CLUSTER
+#include "libs/cluster/cluster.h"    /**< Include the uniqueness coordination between nodes */
+#else
+#define CLUSTER_MAX_PEERS 15		/**< No cluster on this platform: `-N` is refused */
+#endif
 #include "libs/utils/utils.h"    	 /**< Include utility functions */
 
 
+#define RECEIVE_WOULD_BLOCK (-2)	/**< Returned by receive_request when no datagram is pending */
+#define RECEIVE_BATCH 256			/**< Datagrams received per wake-up: more than are served, so that the backlog waits in the scheduler */
+#define SERVE_BATCH 32				/**< Requests served per wake-up before receiving again */
+#define SOCKET_RECEIVE_BUFFER (4 * 1024 * 1024)	/**< Lets a burst wait in the scheduler instead of being dropped by the kernel */
+#define LATENCY_REPORT_NS (10 * NANOSECONDS_PER_SECOND)	/**< Period of the per-class latency line */
+#define MAX_POLL_DESCRIPTORS 40		/**< The UDP socket, the gossip socket, the TCP listener and the bulk connections */
+#define AUDIT_KEY_VARIABLE "PASSGEN_AUDIT_KEY"	/**< Environment variable holding the audit key, 32 hex digits */
+#define CLUSTER_KEY_VARIABLE "PASSGEN_CLUSTER_KEY"	/**< Environment variable holding the cluster key, 32 hex digits */
+
+
+/**
+ * @struct ServerOptions
+ * @brief Command-line options.
+ */
+typedef struct {
+    unsigned short port;	/**< Port to listen on (-p), several servers can run side by side */
+    bool bulk_enabled;		/**< Open the TCP bulk endpoint (-T) */
+    PassgenPolicy policy;	/**< Generation policy (-e, -c, -u) */
+    const char *breached;	/**< Breached password list (-b), `NULL` for none */
+    bool report_expired;	/**< Answer the requests given up at their deadline (-D) */
+    bool cookies_required;	/**< Send large answers only to requests with a valid cookie (-k) */
+    const char *key_file;	/**< Keys of the encrypted answers (-K), `NULL` for none */
+    const char *tenant_file;	/**< Tenants allowed to send requests (-A), `NULL` to serve anyone */
+    uint32_t random_rate;	/**< Random bytes per second of one client (-r), 0 for no limit */
+    const char *audit_directory;	/**< Directory of the audit log (-a), `NULL` for none */
+    unsigned int audit_sync_ms;		/**< Time between two synchronisations of the audit log (-y) */
+    unsigned int node_id;			/**< Id of this node in its cluster (-N), 0 outside a cluster */
+    unsigned short cluster_port;	/**< Port of the gossip with the other nodes (-C) */
+    const char *cluster_peers[CLUSTER_MAX_PEERS];	/**< Gossip addresses of the other nodes (-P) */
+    unsigned int cluster_peer_count;				/**< Entries of `cluster_peers` */
+    const char *interactive_sources[SCHEDULER_MAX_SOURCE_RULES];	/**< Interactive networks (-i) */
+    unsigned int interactive_source_count;							/**< Entries of `interactive_sources` */
+} ServerOptions;
+
+
 /**
  * @brief Cleans up the Winsock library (Windows only).
  * @details This function ensures the proper termination of the Winsock library to release resources.
@@ -66,57 +131,307 @@ int initialize_socket() {
     return created_socket;
 }
 
+/**
+ * @brief Switches a socket to non-blocking mode.
+ * @param[in] socket_descriptor The socket to configure.
+ * @return `true` on success, `false` otherwise.
+ */
+bool set_nonblocking(int socket_descriptor) {
+#if defined WIN32
+    u_long enabled = 1;
+    return ioctlsocket(socket_descriptor, FIONBIO, &enabled) == 0;
+#else
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+/**
+ * @brief Tells whether the last socket call failed only because it would have blocked.
+ * @return `true` if the call should simply be retried later.
+ */
+bool socket_would_block() {
+#if defined WIN32
+    return WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+#endif
+}
+
+
+/**
+ * @brief Parses the command line: `[-p port] [-T] [-e bits] [-c] [-u] [-b file] [-D] [-k] [-K file] [-A file]
+ *        [-r bytes] [-a directory [-y ms]] [-N id -C port [-P a.b.c.d:port]...] [-i network]...`.
+ * @details `-e` rejects the requests whose passwords would carry fewer bits of entropy,
+ * `-c` requires every character class of the alphabet in every password, `-u` never
+ * hands out the same password twice among the last million, `-b` discards the
+ * passwords listed in a file. Each `-i a.b.c.d[/bits]` makes the requests of a
+ * network interactive unless they ask for another class. Requests whose deadline
+ * passes are dropped, or answered `STATUS_DEADLINE_EXCEEDED` with `-D`. With `-k`
+ * batches and streams are only served to clients that proved their address with a cookie.
+ * `-K` reads the keys clients may ask their answers to be encrypted with. With `-A` only the
+ * tenants listed in a file are served, each within its own quota and policy. `-r` gives every client address a
+ * budget of random bytes per second, and then refuses them over TCP bulk. With `-a` every
+ * password handed out is recorded in the audit log of a directory, synchronised every `-y`
+ * milliseconds (0 at every group commit). With `-N` the server is node `id` of a cluster: it
+ * gossips on port `-C` with the nodes listed by `-P` so that, with `-u`, no node hands out a
+ * password another one handed out recently; its Snowflake IDs carry the node number `id - 1`.
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ * @param[out] options The options.
+ * @return `true` if the command line is valid.
+ */
+bool parse_options(int argc, char *argv[], ServerOptions *options) {
+    *options = (ServerOptions){ .port = DEFAULT_PORT, .bulk_enabled = false, .breached = NULL,
+                                .report_expired = false, .cookies_required = false, .key_file = NULL,
+                                .tenant_file = NULL, .random_rate = 0, .audit_directory = NULL, .audit_sync_ms = AUDIT_DEFAULT_SYNC_MS,
+                                .node_id = 0, .cluster_port = 0, .cluster_peer_count = 0, .interactive_source_count = 0 };
+    passgen_policy_default(&options->policy);
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-T") == 0) {
+            options->bulk_enabled = true;
+        } else if (strcmp(argv[i], "-c") == 0) {
+            options->policy.require_every_class = true;
+        } else if (strcmp(argv[i], "-k") == 0) {
+            options->cookies_required = true;
+        } else if (strcmp(argv[i], "-D") == 0) {
+            options->report_expired = true;
+        } else if (strcmp(argv[i], "-u") == 0) {
+            options->policy.unique = true;
+        } else if (strcmp(argv[i], "-e") == 0 && i + 1 < argc && atof(argv[i + 1]) > 0) {
+            options->policy.min_entropy_bits = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc
+                   && options->interactive_source_count < SCHEDULER_MAX_SOURCE_RULES) {
+            options->interactive_sources[options->interactive_source_count++] = argv[++i];
+        } else if (strcmp(argv[i], "-K") == 0 && i + 1 < argc) {
+            options->key_file = argv[++i];
+        } else if (strcmp(argv[i], "-A") == 0 && i + 1 < argc) {
+            options->tenant_file = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc && atol(argv[i + 1]) > 0) {
+            options->random_rate = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+            options->audit_directory = argv[++i];
+        } else if (strcmp(argv[i], "-y") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0) {
+            options->audit_sync_ms = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-N") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0) {
+            options->node_id = (unsigned int)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-C") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0 && atoi(argv[i + 1]) < 65536) {
+            options->cluster_port = (unsigned short)atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-P") == 0 && i + 1 < argc && options->cluster_peer_count < CLUSTER_MAX_PEERS) {
+            options->cluster_peers[options->cluster_peer_count++] = argv[++i];
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            options->breached = argv[++i];
+        } else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0 && atoi(argv[i + 1]) < 65536) {
+            options->port = (unsigned short)atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return (options->node_id == 0) == (options->cluster_port == 0)
+        && (options->node_id != 0 || options->cluster_peer_count == 0);
+}
 
 /**
  * @brief Sets up the server address structure.
  * @param[out] server_address Pointer to the sockaddr_in structure to configure.
+ * @param[in] port Port to listen on.
  * @pre `server_address` must be a valid pointer.
  * @post The `server_address` structure is configured with default values.
  */
-void setup_server_address(struct sockaddr_in *server_address) {
+void setup_server_address(struct sockaddr_in *server_address, unsigned short port) {
     memset(server_address, 0, sizeof(*server_address));			/**< Clear the structure */
     server_address->sin_family = AF_INET;						/**< Set address family to AF_INET (IPv4) */
-    server_address->sin_port = htons(DEFAULT_PORT);				/**< Set server port, converting to network byte order */
+    server_address->sin_port = htons(port);						/**< Set server port, converting to network byte order */
     server_address->sin_addr.s_addr = inet_addr(DEFAULT_IP);	/**< Set server IP address */
 }
 
 
 /**
- * @brief Processes a password generation request and generates the password.
- * @param[in] request Pointer to the PasswordRequest structure containing client input.
- * @param[out] response Pointer to the PasswordResponse structure to store the generated password.
- * @pre `request` and `response` must be valid, initialized pointers.
- * @post The `response` structure is populated with a generated password.
+ * @brief Records the passwords of an answer in the audit log.
+ * @param[in,out] audit The audit log, `NULL` for none.
+ * @param[in] request The request answered.
+ * @param[in] client_address Address of the client.
+ * @param[in] response_buffer The answer encoded by the engine, not encrypted yet.
+ * @param[in] response_size Size of the answer.
+ * @return `false` if the passwords could not be recorded: they must not be handed out.
+ */
+bool audit_response(AuditLog *audit, const RequestView *request, const struct sockaddr_in *client_address,
+                    unsigned char *response_buffer, size_t response_size) {
+#if defined PASSGEN_AUDIT
+	if (audit == NULL) {
+		return true;
+	}
+	ResponseView response;
+	uint16_t count = 0;
+	if (request->legacy) {
+		count = response_buffer[0] != '\0';	/**< An empty string is a refusal */
+	} else if (codec_decode_response(response_buffer, response_size, &response) == CODEC_OK
+	           && response.status == STATUS_OK) {
+		count = response.count;
+	}
+	return count == 0 || audit_issue(audit, client_address, request->tenant_id, request->request_id, request->type,
+	                                 request->length, codec_response_password(response_buffer, request, 0),
+	                                 request->length, count);
+#else
+	(void)audit; (void)request; (void)client_address; (void)response_buffer; (void)response_size;
+	return true;
+#endif
+}
+
+/**
+ * @brief Processes a password generation request and writes the response in place.
+ * @details The request goes through the embedding API, exactly as an in-process caller's
+ * would; the passwords are generated directly at their final offset in the send buffer.
+ * They are recorded in the audit log, and when the request names a key they are then
+ * encrypted in place, the whole batch at once; when it asks for it they are bit-packed
+ * in place instead, so that the buffer must hold `MAX_UNPACKED_RESPONSE_SIZE` bytes.
+ * @param[in,out] engine The engine answering the request: the server's, or its tenant's.
+ * @param[in,out] keys The keys of the encrypted answers.
+ * @param[in,out] audit The audit log, `NULL` for none.
+ * @param[in] request The decoded request, a view over the receive buffer.
+ * @param[in] client_address Address of the client.
+ * @param[in] deadline_ns Time after which the answer is useless, 0 for none.
+ * @param[out] response_buffer The send buffer where the response is encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return The number of bytes of the response to send, 0 if there is nothing to send.
  */
-void handle_password_request(const PasswordRequest *request, PasswordResponse *response) {
-	int numerical_length = atoi(request->length);
-	PasswordType password_type;
+size_t handle_password_request(PassgenEngine *engine, Keyring *keys, AuditLog *audit, const RequestView *request,
+                               const struct sockaddr_in *client_address, uint64_t deadline_ns,
+                               unsigned char *response_buffer, size_t response_capacity) {
+	const unsigned char *key = NULL;
+	if (request->flags & REQUEST_FLAG_ENCRYPTED) {
+		key = keyring_find(keys, request->key_id);
+		if (key == NULL) {
+			return codec_encode_response(response_buffer, response_capacity, request, STATUS_UNAUTHORIZED, 0);
+		}
+	}
 
-	switch (tolower(request->type)) {
-		case 'n': password_type = NUMERIC; break;
-		case 'a': password_type = ALPHA; break;
-		case 'm': password_type = MIXED; break;
-		case 's': password_type = SECURE; break;
-		case 'u': password_type = UNAMBIGUOUS; break;
-		default: password_type = NUMERIC; break;
+	passgen_engine_set_deadline(engine, deadline_ns);
+	size_t response_size = passgen_engine_respond(engine, request->raw, request->raw_size, response_buffer,
+	                                              response_capacity);
+	passgen_engine_set_deadline(engine, 0);		/**< Streams and bulk jobs have no deadline */
+	if (!audit_response(audit, request, client_address, response_buffer, response_size)) {
+		return codec_encode_response(response_buffer, response_capacity, request, STATUS_UNAVAILABLE, 0);
+	}
+	if (key != NULL && response_size > RESPONSE_HEADER_SIZE) {	/**< Only answers carrying passwords are encrypted */
+		response_size = codec_seal_response(response_buffer, response_size, response_capacity, key,
+		                                    keyring_next_nonce(keys));
 	}
-	generate_password(response->password, password_type, numerical_length);
+	return codec_pack_response(response_buffer, response_size, request);	/**< Never with a key */
 }
 
+/**
+ * @brief Prints the address of a client that sent a request.
+ * @details Stream control messages are not logged: a stream consumer sends them continuously.
+ * @param[in] client_address Address of the client.
+ */
+void log_connection(const struct sockaddr_in *client_address) {
+    print_with_color("New connection from ", GREEN);
+    print_with_color(inet_ntoa(client_address->sin_addr), YELLOW);
+    print_with_color(":", CYAN);
+    printf("%d\n", ntohs(client_address->sin_port));
+}
+
+/**
+ * @brief Tells whether a client is on this host (127.0.0.0/8).
+ * @param[in] client_address Address of the client.
+ */
+bool is_loopback(const struct sockaddr_in *client_address) {
+	return (ntohl(client_address->sin_addr.s_addr) >> 24) == 127;
+}
 
 /**
- * @brief Sends a password response to the client.
+ * @brief Decodes a datagram in place and dispatches it according to its operation.
+ * @details With tenants, the request must carry the MAC of a known tenant, and is then
+ * checked against the policy and charged to the quota of that tenant. Random bytes are
+ * also charged to the budget of the client address. Stats requests
+ * come from the operators of the host: they are only answered on the loopback.
+ * @param[in,out] engine The server's engine.
+ * @param[in,out] keys The keys of the encrypted answers.
+ * @param[in,out] tenants The tenants, `NULL` to serve anyone.
+ * @param[in,out] analytics The sketches of the clients.
+ * @param[in,out] audit The audit log, `NULL` for none.
+ * @param[in,out] limiter The budgets of the random bytes.
+ * @param[in,out] streams The table of open streams.
  * @param[in] server_socket The server's socket descriptor.
- * @param[in] response_msg Pointer to the PasswordResponse structure to send.
+ * @param[in] request_buffer The received datagram.
+ * @param[in] request_size Number of bytes received.
+ * @param[in] client_address Address of the client that sent the datagram.
+ * @param[in] deadline_ns Time after which the answer is useless, 0 for none.
+ * @param[out] response_buffer The send buffer where the response is encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return The number of bytes of the response to send, 0 if there is nothing to send.
+ */
+size_t handle_datagram(PassgenEngine *engine, Keyring *keys, TenantTable *tenants, Analytics *analytics,
+                       AuditLog *audit, RateLimiter *limiter, StreamTable *streams, int server_socket, const unsigned char *request_buffer, size_t request_size,
+                       const struct sockaddr_in *client_address, uint64_t deadline_ns,
+                       unsigned char *response_buffer, size_t response_capacity) {
+	RequestView request;
+
+	if (codec_decode_request(request_buffer, request_size, &request) != CODEC_OK) {
+		log_connection(client_address);
+		return codec_encode_response(response_buffer, response_capacity, &request, STATUS_BAD_REQUEST, 0);
+	}
+
+	if (request.operation == OP_STATS) {
+		if (!is_loopback(client_address)) {
+			return codec_encode_response(response_buffer, response_capacity, &request, STATUS_UNAUTHORIZED, 0);
+		}
+		return analytics_answer(analytics, &request, clock_now_ns(), response_buffer, response_capacity);
+	}
+
+	Tenant *tenant = NULL;
+	if (tenants != NULL) {
+		tenant = tenant_authenticate(tenants, &request, time(NULL));
+		ResponseStatus admission = tenant == NULL ? STATUS_UNAUTHORIZED : tenant_admit(tenant, &request, clock_now_ns());
+		if (admission != STATUS_OK) {
+			return codec_encode_response(response_buffer, response_capacity, &request, admission, 0);
+		}
+	}
+
+	if (request.operation == OP_GENERATE) {
+		log_connection(client_address);
+		if (codec_is_random_bytes(request.type)
+		    && ratelimit_take(limiter, client_address->sin_addr.s_addr,
+		                      (uint64_t)codec_response_count(&request) * request.length, clock_now_ns()) != 0) {
+			return codec_encode_response(response_buffer, response_capacity, &request, STATUS_QUOTA_EXCEEDED, 0);
+		}
+		PassgenEngine *answering = tenant != NULL && tenant->engine != NULL ? tenant->engine : engine;
+		size_t response_size = handle_password_request(answering, keys, audit, &request, client_address, deadline_ns,
+		                                               response_buffer, response_capacity);
+		if (tenant != NULL && response_size > RESPONSE_HEADER_SIZE) {
+			tenant->metrics.passwords += codec_response_count(&request);
+		}
+		return response_size;
+	}
+
+	/* Stream operations are only answered when they fail: the stream datagrams are the acknowledgement */
+	ResponseStatus status = stream_handle_request(streams, server_socket, &request, tenant, client_address, clock_now_ns());
+	if (status == STATUS_OK) {
+		return 0;
+	}
+	return codec_encode_response(response_buffer, response_capacity, &request, status, 0);
+}
+
+
+/**
+ * @brief Sends a response to the client.
+ * @param[in] server_socket The server's socket descriptor.
+ * @param[in] response_buffer The encoded response.
+ * @param[in] response_size Number of bytes to send.
  * @param[in] client_address Pointer to the sockaddr_in structure containing the client's address.
  * @return `true` if the response was sent successfully, `false` otherwise.
  * @pre `server_socket` must be a valid UDP socket.
- * @pre `response_msg` and `client_address` must be valid pointers.
+ * @pre `response_buffer` and `client_address` must be valid pointers.
  * @post The client receives the password response if successful.
  */
-bool send_response(int server_socket, const PasswordResponse *response_msg, const struct sockaddr_in *client_address) {
-    if (sendto(server_socket, response_msg, sizeof(*response_msg), 0,
-               (struct sockaddr *)client_address, sizeof(*client_address)) != sizeof(*response_msg)) {
+bool send_response(int server_socket, const unsigned char *response_buffer, size_t response_size,
+                   const struct sockaddr_in *client_address) {
+    if (sendto(server_socket, (const char *)response_buffer, response_size, 0,
+               (struct sockaddr *)client_address, sizeof(*client_address)) != (int)response_size) {
+        if (socket_would_block()) {
+            return true;	/**< Send buffer full: the datagram is dropped, as the network could have done */
+        }
         error_handler("Error sending response (Password generated).\n");
         return false;
     }
@@ -124,24 +439,242 @@ bool send_response(int server_socket, const PasswordResponse *response_msg, cons
 }
 
 /**
- * @brief Receives a password generation request from the client.
+ * @brief Encodes the answer to a request whose deadline passed before it was served.
+ * @param[in] report_expired `false` to drop the request silently.
+ * @param[in] request_buffer The received datagram.
+ * @param[in] request_size Number of bytes received.
+ * @param[out] response_buffer The send buffer where the response is encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return The number of bytes of the response to send, 0 if there is nothing to send.
+ */
+size_t handle_expired_request(bool report_expired, const unsigned char *request_buffer, size_t request_size,
+                              unsigned char *response_buffer, size_t response_capacity) {
+	RequestView request;
+	if (!report_expired || codec_decode_request(request_buffer, request_size, &request) != CODEC_OK) {
+		return 0;	/**< Only requests with a deadline expire, and those are valid */
+	}
+	return codec_encode_response(response_buffer, response_capacity, &request, STATUS_DEADLINE_EXCEEDED, 0);
+}
+
+/**
+ * @brief Tells whether the engine gave up a request because its deadline passed during generation.
+ * @param[in] response_buffer The encoded response.
+ * @param[in] response_size Size of the response.
+ */
+bool response_is_expired(const unsigned char *response_buffer, size_t response_size) {
+	ResponseView response;
+	return codec_decode_response(response_buffer, response_size, &response) == CODEC_OK
+		&& response.status == STATUS_DEADLINE_EXCEEDED;
+}
+
+/**
+ * @brief Tells whether the answer to a request can be much larger than the request.
+ * @details Such answers need a cookie with `-k`: batches beyond one password and streams.
+ * The whole answer counts, the trailer of an encrypted one included. Legacy requests are
+ * longer than their answer.
+ * @param[in] request The decoded request.
+ */
+bool needs_cookie(const RequestView *request) {
+	if (request->legacy) {
+		return false;
+	}
+	if (request->operation == OP_SUBSCRIBE) {
+		return true;
+	}
+	if (request->operation != OP_GENERATE) {
+		return false;
+	}
+	size_t payload = (size_t)codec_response_count(request) * request->length;
+	unsigned int bits = codec_packed_bits(request);
+	size_t trailer = (request->flags & REQUEST_FLAG_ENCRYPTED) ? SEALED_TRAILER_SIZE : 0;
+	return RESPONSE_HEADER_SIZE + (bits != 0 ? packing_size(payload, bits) : payload) + trailer
+		> COOKIE_FREE_RESPONSE_SIZE;
+}
+
+/**
+ * @brief Challenges the received requests that need a cookie and carry no valid one.
+ * @details The cookies of the whole batch are verified together. A challenged request is
+ * answered `STATUS_COOKIE_REQUIRED` with the cookie of its sender, an answer barely larger
+ * than the request, and its slot is freed.
+ * @param[in] secret The cookie secret.
  * @param[in] server_socket The server's socket descriptor.
- * @param[out] request_msg Pointer to the PasswordRequest structure to store the client's request.
+ * @param[in,out] scheduler The scheduler owning the slots.
+ * @param[in,out] batch The received requests; the challenged ones are removed.
+ * @param[in] count Number of requests in `batch`.
+ * @param[out] response_buffer The send buffer where the challenges are encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return The number of requests left in `batch`, or -1 if a challenge could not be sent.
+ */
+int challenge_requests(const CookieSecret *secret, int server_socket, Scheduler *scheduler, PendingRequest **batch,
+                       size_t count, unsigned char *response_buffer, size_t response_capacity) {
+	CookieCheck checks[RECEIVE_BATCH];
+	size_t checked_positions[RECEIVE_BATCH];
+	size_t checked_count = 0;
+	uint64_t now_ns = clock_now_ns();
+
+	for (size_t i = 0; i < count; i++) {
+		RequestView request;
+		if (codec_decode_request(batch[i]->data, batch[i]->size, &request) == CODEC_OK && needs_cookie(&request)) {
+			checks[checked_count] = (CookieCheck){ .client = batch[i]->client, .cookie = request.cookie };
+			checked_positions[checked_count++] = i;
+		}
+	}
+	cookie_verify(secret, checks, checked_count, now_ns);
+
+	size_t kept = 0;
+	for (size_t i = 0, next_check = 0; i < count; i++) {
+		PendingRequest *pending = batch[i];
+		if (next_check < checked_count && checked_positions[next_check] == i && !checks[next_check++].valid) {
+			RequestView request;
+			codec_decode_request(pending->data, pending->size, &request);
+			size_t response_size = codec_encode_cookie_response(response_buffer, response_capacity, &request,
+			                                                    cookie_issue(secret, &pending->client, now_ns));
+			bool sent = send_response(server_socket, response_buffer, response_size, &pending->client);
+			scheduler_release(scheduler, pending);
+			if (!sent) {
+				return -1;
+			}
+			continue;
+		}
+		batch[kept++] = pending;
+	}
+	return (int)kept;
+}
+
+/**
+ * @brief Answers a request that the scheduler has no room for.
+ * @details The client is told at once that the server is busy rather than left to time out.
+ * @param[in] server_socket The server's socket descriptor.
+ * @param[in] request_buffer The received datagram.
+ * @param[in] request_size Number of bytes received.
+ * @param[in] client_address Address of the client that sent the datagram.
+ * @param[out] response_buffer The send buffer where the response is encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return `true` unless the response could not be sent.
+ */
+bool refuse_datagram(int server_socket, const unsigned char *request_buffer, size_t request_size,
+                     const struct sockaddr_in *client_address, unsigned char *response_buffer, size_t response_capacity) {
+	RequestView request;
+	ResponseStatus status = codec_decode_request(request_buffer, request_size, &request) == CODEC_OK
+		? STATUS_UNAVAILABLE : STATUS_BAD_REQUEST;
+	size_t response_size = codec_encode_response(response_buffer, response_capacity, &request, status, 0);
+	return response_size == 0 || send_response(server_socket, response_buffer, response_size, client_address);
+}
+
+/**
+ * @brief Prints the latency of each class since the previous report.
+ * @param[in,out] scheduler The scheduler whose measurement period is restarted.
+ */
+void report_latency(Scheduler *scheduler) {
+	static const char *class_names[CLASS_COUNT] = { "interactive", "bulk" };
+
+	print_with_color("Latency", CYAN);
+	for (int traffic_class = 0; traffic_class < CLASS_COUNT; traffic_class++) {
+		LatencySummary summary;
+		scheduler_take_summary(scheduler, (TrafficClass)traffic_class, &summary);
+		printf("%s %s: %llu served, %llu refused, %llu expired, p50 %llu us, p99 %llu us, max %llu us",
+		       traffic_class == 0 ? "" : " |", class_names[traffic_class], (unsigned long long)summary.count,
+		       (unsigned long long)summary.rejected, (unsigned long long)summary.expired, (unsigned long long)summary.p50_us,
+		       (unsigned long long)summary.p99_us, (unsigned long long)summary.max_us);
+	}
+	printf("\n");
+}
+
+#if defined PASSGEN_AUDIT
+/**
+ * @brief Prints the activity of the audit log since the previous report, if any.
+ * @param[in] audit The audit log.
+ * @param[in,out] reported The counters at the previous report, updated.
+ */
+void report_audit(const AuditLog *audit, AuditStats *reported) {
+	AuditStats stats;
+	audit_stats(audit, &stats);
+	if (audit_failed(audit)) {
+		error_handler("The audit log cannot be written: passwords are refused.\n");
+	} else if (stats.records != reported->records) {
+		print_with_color("Audit", CYAN);
+		printf(" %llu passwords recorded in %llu blocks, %llu syncs, %llu stalls, %llu segments since start\n",
+		       (unsigned long long)(stats.records - reported->records),
+		       (unsigned long long)(stats.blocks - reported->blocks),
+		       (unsigned long long)(stats.syncs - reported->syncs),
+		       (unsigned long long)(stats.stalls - reported->stalls), (unsigned long long)stats.segments);
+	}
+	*reported = stats;
+}
+#endif
+
+#if defined PASSGEN_CLUSTER
+/**
+ * @brief Joins the cluster named on the command line, sharing the uniqueness filter of the server.
+ * @details Called before the breached passwords are loaded: the filter hashes the passwords under
+ * a key derived from the cluster key, read from `PASSGEN_CLUSTER_KEY`.
+ * @param[out] cluster The cluster.
+ * @param[in] options The command-line options, with `-N`.
+ * @param[in,out] context The context of the server.
+ * @return `false` after printing why the cluster cannot be joined.
+ */
+bool join_cluster(Cluster *cluster, const ServerOptions *options, PassgenContext *context) {
+	if (!options->policy.unique) {
+		error_handler("A cluster node (-N) shares the uniqueness filter: it needs -u.\n");
+		return false;
+	}
+	if (options->tenant_file != NULL) {
+		error_handler("The tenants (-A) have their own filters, which a cluster (-N) does not share.\n");
+		return false;
+	}
+	if (options->node_id > GOSSIP_MAX_NODES) {
+		error_handler("The node id (-N) of a cluster goes from 1 to 16.\n");
+		return false;
+	}
+
+	ClusterOptions cluster_options = { .node_id = (uint8_t)options->node_id, .peer_count = options->cluster_peer_count };
+	const char *cluster_key = getenv(CLUSTER_KEY_VARIABLE);
+	if (cluster_key == NULL || !siphash_parse_key(cluster_key, cluster_options.key)) {
+		error_handler("A cluster node (-N) needs the key of the cluster, 32 hex digits in " CLUSTER_KEY_VARIABLE ".\n");
+		return false;
+	}
+	for (unsigned int i = 0; i < options->cluster_peer_count; i++) {
+		if (!cluster_parse_peer(options->cluster_peers[i], &cluster_options.peers[i])) {
+			error_handler("Invalid cluster peer: ");
+			error_handler(options->cluster_peers[i]);
+			error_handler("\n");
+			return false;
+		}
+	}
+	cluster_options.address = (struct sockaddr_in){ .sin_family = AF_INET, .sin_port = htons(options->cluster_port),
+	                                                .sin_addr.s_addr = htonl(INADDR_ANY) };
+	if (!cluster_open(cluster, &cluster_options, context)) {
+		error_handler("Cannot open the gossip socket of the cluster.\n");
+		return false;
+	}
+	return true;
+}
+#endif
+
+/**
+ * @brief Receives a datagram from a client.
+ * @param[in] server_socket The server's socket descriptor.
+ * @param[out] request_buffer Buffer receiving the raw request.
+ * @param[in] request_capacity Size of `request_buffer`.
  * @param[out] client_address Pointer to the sockaddr_in structure to store the client's address.
- * @return `true` if the request was received successfully, `false` otherwise.
+ * @return The number of bytes received, `RECEIVE_WOULD_BLOCK` if no datagram is pending,
+ *         or -1 if an error occurred.
  * @pre `server_socket` must be a valid UDP socket.
- * @pre `request_msg` and `client_address` must be valid pointers.
- * @post The `request_msg` and `client_address` structures are populated with client data if successful.
+ * @pre `request_buffer` and `client_address` must be valid pointers.
+ * @post The `request_buffer` and `client_address` are populated with client data if successful.
  */
-bool receive_request(int server_socket, PasswordRequest *request_msg, struct sockaddr_in *client_address) {
+int receive_request(int server_socket, unsigned char *request_buffer, size_t request_capacity,
+                    struct sockaddr_in *client_address) {
     unsigned int client_address_size = sizeof(*client_address);
-    int rcv_msg_size = recvfrom(server_socket, request_msg, sizeof(*request_msg), 0,
+    int rcv_msg_size = recvfrom(server_socket, (char *)request_buffer, request_capacity, 0,
                                 (struct sockaddr *)client_address, &client_address_size);
     if (rcv_msg_size < 0) {
+        if (socket_would_block()) {
+            return RECEIVE_WOULD_BLOCK;
+        }
         error_handler("Error receiving request (Password settings).\n");
-        return false;
     }
-    return true;
+    return rcv_msg_size;
 }
 
 
@@ -151,8 +684,122 @@ bool receive_request(int server_socket, PasswordRequest *request_msg, struct soc
  * @return EXIT_SUCCESS The server executed successfully.
  * @return EXIT_FAILURE An error occurred during execution.
  * @details Initializes the server, listens for client requests, and processes them in an infinite loop.
+ *          `-p` selects the port; with `-T` the TCP bulk endpoint is also opened on the same port and
+ *          served by the same loop.
  */
-int main() {
+int main(int argc, char *argv[]) {
+    ServerOptions options;
+
+    if (!parse_options(argc, argv, &options)) {
+        error_handler("Usage: UDP_server [-p port] [-T] [-e bits] [-c] [-u] [-b file] [-D] [-k] [-K file] [-A file] [-r bytes] [-a directory [-y ms]] [-N id -C port [-P a.b.c.d:port]...] [-i network[/bits]]...\n");
+        return EXIT_FAILURE;
+    }
+
+    CookieSecret cookies;	/**< Key of the anti-spoofing cookies, used with -k */
+    cookie_secret_init(&cookies);
+
+    Keyring keys;			/**< Keys of the encrypted answers, read with -K */
+    keyring_init(&keys);
+    if (options.key_file != NULL && !keyring_load(&keys, options.key_file)) {
+        error_handler("Cannot read the key file: ");
+        error_handler(options.key_file);
+        error_handler("\n");
+        return EXIT_FAILURE;
+    }
+
+    Scheduler scheduler;	/**< Received requests waiting to be served, by class */
+    if (!scheduler_init(&scheduler)) {
+        error_handler("Cannot allocate the request queues.\n");
+        return EXIT_FAILURE;
+    }
+    for (unsigned int i = 0; i < options.interactive_source_count; i++) {
+        if (!scheduler_add_source_rule(&scheduler, options.interactive_sources[i])) {
+            error_handler("Invalid interactive network: ");
+            error_handler(options.interactive_sources[i]);
+            error_handler("\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* One context and, the event loop being single-threaded, one engine */
+    PassgenContext *context;
+    PassgenEngine *engine;
+    PassgenStatus status = passgen_context_create(&options.policy, &context);
+#if defined PASSGEN_CLUSTER
+    Cluster cluster;		/**< Gossip with the other nodes, joined with -N */
+    bool clustered = options.node_id != 0;
+    if (status == PASSGEN_OK && clustered && !join_cluster(&cluster, &options, context)) {
+        return EXIT_FAILURE;
+    }
+#else
+    if (options.node_id != 0) {
+        error_handler("The cluster (-N) is not available on this platform.\n");
+        return EXIT_FAILURE;
+    }
+#endif
+    if (status == PASSGEN_OK && options.node_id != 0) {
+        passgen_context_set_node(context, options.node_id - 1);	/**< Nodes hand out distinct Snowflake IDs */
+    }
+    if (status == PASSGEN_OK && options.breached != NULL) {
+        status = passgen_context_load_breached(context, options.breached);
+    }
+    if (status == PASSGEN_OK) {
+        status = passgen_engine_create(context, &engine);
+    }
+    if (status != PASSGEN_OK) {
+        error_handler("Cannot start the password engine: ");
+        error_handler(passgen_status_message(status));
+        error_handler("\n");
+        return EXIT_FAILURE;
+    }
+
+    TenantTable tenant_table;	/**< Tenants of the server, read with -A and reloaded when the file changes */
+    TenantTable *tenants = NULL;
+    if (options.tenant_file != NULL) {
+        if (options.bulk_enabled) {
+            error_handler("The TCP bulk endpoint (-T) does not authenticate tenants (-A).\n");
+            return EXIT_FAILURE;
+        }
+        if (!tenant_table_load(&tenant_table, options.tenant_file, &options.policy, options.breached)) {
+            error_handler("Cannot read the tenant file: ");
+            error_handler(options.tenant_file);
+            error_handler("\n");
+            return EXIT_FAILURE;
+        }
+        tenants = &tenant_table;
+    }
+
+    Analytics analytics;	/**< Heavy hitters and distinct clients, answered to OP_STATS */
+    if (!analytics_init(&analytics, clock_now_ns())) {
+        error_handler("Cannot allocate the client sketches.\n");
+        return EXIT_FAILURE;
+    }
+
+    AuditLog *audit = NULL;	/**< Log of the issued passwords, opened with -a */
+#if defined PASSGEN_AUDIT
+    AuditLog audit_log;
+    if (options.audit_directory != NULL) {
+        AuditOptions audit_options = { .directory = options.audit_directory, .segment_size = AUDIT_DEFAULT_SEGMENT_SIZE,
+                                       .sync_interval_ms = options.audit_sync_ms };
+        const char *audit_key = getenv(AUDIT_KEY_VARIABLE);
+        if (audit_key == NULL || !siphash_parse_key(audit_key, audit_options.key)) {
+            error_handler("The audit log (-a) needs a key of 32 hex digits in " AUDIT_KEY_VARIABLE ".\n");
+            return EXIT_FAILURE;
+        }
+        if (!audit_open(&audit_log, &audit_options)) {
+            error_handler("Cannot open the audit log in: ");
+            error_handler(options.audit_directory);
+            error_handler("\n");
+            return EXIT_FAILURE;
+        }
+        audit = &audit_log;
+    }
+#else
+    if (options.audit_directory != NULL) {
+        error_handler("The audit log (-a) is not available on this platform.\n");
+        return EXIT_FAILURE;
+    }
+#endif
 
 #if defined WIN32
 	// Initialize Winsock
@@ -174,7 +821,7 @@ int main() {
 
     struct sockaddr_in server_address, client_address;
 
-    setup_server_address(&server_address);
+    setup_server_address(&server_address, options.port);
 
     if (bind(server_socket, (struct sockaddr *)&server_address, sizeof(server_address)) < 0) {
     	error_handler("Bind failed.\n");
@@ -183,30 +830,250 @@ int main() {
         return EXIT_FAILURE;
     }
 
+    int receive_buffer_size = SOCKET_RECEIVE_BUFFER;	/**< Best effort: the system may cap it */
+    setsockopt(server_socket, SOL_SOCKET, SO_RCVBUF, (const char *)&receive_buffer_size, sizeof(receive_buffer_size));
+
+    if (!set_nonblocking(server_socket)) {
+    	error_handler("Cannot make the socket non-blocking.\n");
+        closesocket(server_socket);
+        clear_winsock();
+        return EXIT_FAILURE;
+    }
+
+#if defined PASSGEN_TCP_BULK
+    BulkServer bulk;				/**< TCP bulk endpoint, enabled with -T */
+    bool bulk_enabled = options.bulk_enabled;
+
+    if (bulk_enabled && !bulk_server_open(&bulk, &server_address, engine)) {
+    	error_handler("Cannot open the TCP bulk endpoint.\n");
+        closesocket(server_socket);
+        clear_winsock();
+        return EXIT_FAILURE;
+    }
+#if defined PASSGEN_AUDIT
+    bulk.audit = audit;
+#endif
+    bulk.random_bytes = options.random_rate == 0;
+#endif
+
     print_with_color("Server listening...\n\n", BLUE);
 
+    unsigned char request_buffer[MAX_DATAGRAM_SIZE];	/**< Receive buffer of the requests refused without a slot */
+    unsigned char response_buffer[MAX_UNPACKED_RESPONSE_SIZE];	/**< Send buffer, encoded (and packed) in place */
+    StreamTable streams;								/**< Open server-push streams */
+    RateLimiter limiter;								/**< Budgets of the random bytes, enabled with -r */
+    bool send_blocked = false;							/**< The socket send buffer is full */
+    bool measured = false;								/**< Requests were served since the last latency report */
+    uint64_t cookie_challenges = 0;						/**< Requests challenged since the last report */
+    uint64_t next_report_ns = clock_now_ns() + LATENCY_REPORT_NS;
+
+    stream_table_init(&streams, engine);
+    ratelimit_init(&limiter, options.random_rate);
+    streams.limiter = &limiter;
+    streams.tenants = tenants;
+#if defined PASSGEN_AUDIT
+    streams.audit = audit;
+    AuditStats audit_reported = { 0 };					/**< Audit counters at the last report */
+#endif
+
     while (true) {
-        PasswordRequest request;
-        PasswordResponse response;
+        struct pollfd poll_descriptors[MAX_POLL_DESCRIPTORS];
+        size_t poll_count = 1;
+        uint64_t now_ns = clock_now_ns();
+        int timeout_ms = send_blocked ? -1 : stream_poll_timeout(&streams, now_ns);
+        if (scheduler_has_pending(&scheduler)) {
+            timeout_ms = 0;
+        } else if (measured) {
+            int report_ms = next_report_ns <= now_ns ? 0
+                : (int)((next_report_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+            if (timeout_ms < 0 || report_ms < timeout_ms) {
+                timeout_ms = report_ms;
+            }
+        }
 
-        if (!receive_request(server_socket, &request, &client_address)) {
+        poll_descriptors[0] = (struct pollfd){ .fd = server_socket, .events = POLLIN | (send_blocked ? POLLOUT : 0) };
+#if defined PASSGEN_CLUSTER
+        if (clustered) {
+            int cluster_timeout_ms = cluster_poll_timeout(&cluster, now_ns);
+            if (timeout_ms < 0 || cluster_timeout_ms < timeout_ms) {
+                timeout_ms = cluster_timeout_ms;
+            }
+            cluster_poll_descriptor(&cluster, &poll_descriptors[poll_count++]);	/**< Always at index 1 */
+        }
+#endif
+#if defined PASSGEN_TCP_BULK
+        size_t bulk_first = poll_count;		/**< The bulk descriptors follow the datagram sockets */
+        if (bulk_enabled) {
+            int bulk_timeout_ms = bulk_server_poll_timeout(&bulk, now_ns);
+            if (bulk_timeout_ms >= 0 && (timeout_ms < 0 || bulk_timeout_ms < timeout_ms)) {
+                timeout_ms = bulk_timeout_ms;
+            }
+            poll_count += bulk_server_poll_descriptors(&bulk, poll_descriptors + bulk_first,
+                                                       MAX_POLL_DESCRIPTORS - bulk_first);
+        }
+#endif
+
+        if (poll(poll_descriptors, poll_count, timeout_ms) < 0) {
+#if !defined WIN32
+            if (errno == EINTR) {
+                continue;
+            }
+#endif
+            error_handler("Error waiting for socket events.\n");
             closesocket(server_socket);
             clear_winsock();
             return EXIT_FAILURE;
         }
 
-        print_with_color("New connection from ", GREEN);
-        print_with_color(inet_ntoa(client_address.sin_addr), YELLOW);
-        print_with_color(":", CYAN);
-        printf("%d\n", ntohs(client_address.sin_port));
+        /* Receive first, so that an interactive request overtakes the bulk backlog */
+        PendingRequest *received[RECEIVE_BATCH];
+        size_t received_count = 0;
+        uint64_t woken_ns = clock_now_ns();		/**< Close enough for the epochs of the sketches */
+        for (int i = 0; i < RECEIVE_BATCH && (poll_descriptors[0].revents & POLLIN); i++) {
+            PendingRequest *pending = scheduler_acquire(&scheduler);
+            unsigned char *receive_buffer = pending != NULL ? pending->data : request_buffer;
+            struct sockaddr_in *sender = pending != NULL ? &pending->client : &client_address;
 
-        handle_password_request(&request, &response);
+            int request_size = receive_request(server_socket, receive_buffer, MAX_DATAGRAM_SIZE, sender);
+            if (request_size == RECEIVE_WOULD_BLOCK || request_size < 0) {
+                if (pending != NULL) {
+                    scheduler_release(&scheduler, pending);
+                }
+                if (request_size == RECEIVE_WOULD_BLOCK) {
+                    break;
+                }
+                closesocket(server_socket);
+                clear_winsock();
+                return EXIT_FAILURE;
+            }
+            analytics_record(&analytics, sender->sin_addr.s_addr, woken_ns);	/**< Served or refused, every sender counts */
 
-        if (!send_response(server_socket, &response, &client_address)) {
-            closesocket(server_socket);
-            clear_winsock();
-            return EXIT_FAILURE;
+            if (pending != NULL) {
+                pending->size = (size_t)request_size;
+                pending->received_ns = clock_now_ns();
+                received[received_count++] = pending;
+                continue;
+            }
+            scheduler_reject(&scheduler);
+            measured = true;
+            if (!refuse_datagram(server_socket, receive_buffer, (size_t)request_size, sender, response_buffer,
+                                 sizeof(response_buffer))) {
+                closesocket(server_socket);
+                clear_winsock();
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (options.cookies_required && received_count > 0) {
+            int kept = challenge_requests(&cookies, server_socket, &scheduler, received, received_count,
+                                          response_buffer, sizeof(response_buffer));
+            if (kept < 0) {
+                closesocket(server_socket);
+                clear_winsock();
+                return EXIT_FAILURE;
+            }
+            cookie_challenges += received_count - (size_t)kept;
+            measured = measured || (size_t)kept < received_count;
+            received_count = (size_t)kept;
+        }
+
+        for (size_t i = 0; i < received_count; i++) {
+            PendingRequest *pending = received[i];
+            if (scheduler_enqueue(&scheduler, pending, pending->size, pending->received_ns)) {
+                continue;
+            }
+            measured = true;
+            if (!refuse_datagram(server_socket, pending->data, pending->size, &pending->client, response_buffer,
+                                 sizeof(response_buffer))) {
+                closesocket(server_socket);
+                clear_winsock();
+                return EXIT_FAILURE;
+            }
+        }
+
+#if defined PASSGEN_CLUSTER
+        /* The fingerprints of the other nodes enter the filter before this batch is served */
+        if (clustered) {
+            cluster_handle(&cluster, poll_descriptors[1].revents, clock_now_ns());
+        }
+#endif
+
+        if (tenants != NULL) {
+            TenantReload reload = tenant_table_refresh(tenants, clock_now_ns());
+            if (reload == TENANT_RELOADED) {
+                stream_rebind_tenants(&streams, server_socket);
+                print_with_color("Tenant file reloaded\n", BLUE);
+            } else if (reload == TENANT_RELOAD_FAILED) {
+                error_handler("Cannot reload the tenant file, the previous tenants stay.\n");
+            }
+        }
+
+        for (int i = 0; i < SERVE_BATCH; i++) {
+            PendingRequest *next = scheduler_next(&scheduler);
+            if (next == NULL) {
+                break;
+            }
+
+            /* Work nobody will read is skipped: at dequeue, then by the engine between blocks of passwords */
+            size_t response_size;
+            bool expired = scheduler_is_expired(next, clock_now_ns());
+            if (expired) {
+                response_size = handle_expired_request(options.report_expired, next->data, next->size,
+                                                       response_buffer, sizeof(response_buffer));
+            } else {
+                response_size = handle_datagram(engine, &keys, tenants, &analytics, audit, &limiter, &streams, server_socket,
+                                                next->data, next->size, &next->client, next->deadline_ns,
+                                                response_buffer, sizeof(response_buffer));
+                expired = response_is_expired(response_buffer, response_size);
+                if (expired && !options.report_expired) {
+                    response_size = 0;
+                }
+            }
+
+            if (response_size > 0 && !send_response(server_socket, response_buffer, response_size, &next->client)) {
+                closesocket(server_socket);
+                clear_winsock();
+                return EXIT_FAILURE;
+            }
+            if (expired) {
+                scheduler_expire(&scheduler, next);
+            } else {
+                scheduler_complete(&scheduler, next, clock_now_ns());
+            }
+            measured = true;
         }
 
+        if (clock_now_ns() >= next_report_ns) {
+            if (measured) {
+                report_latency(&scheduler);
+                measured = false;
+            }
+            if (cookie_challenges > 0) {
+                printf("Cookies: %llu requests challenged\n", (unsigned long long)cookie_challenges);
+                cookie_challenges = 0;
+            }
+            if (tenants != NULL) {
+                tenant_report(tenants);
+            }
+            ratelimit_report(&limiter);
+#if defined PASSGEN_AUDIT
+            if (audit != NULL) {
+                report_audit(audit, &audit_reported);
+            }
+#endif
+#if defined PASSGEN_CLUSTER
+            if (clustered) {
+                cluster_report(&cluster);
+            }
+#endif
+            next_report_ns = clock_now_ns() + LATENCY_REPORT_NS;
+        }
+
+        send_blocked = stream_service(&streams, server_socket, clock_now_ns());
+#if defined PASSGEN_TCP_BULK
+        if (bulk_enabled) {
+            bulk_server_handle(&bulk, poll_descriptors + bulk_first, poll_count - bulk_first, clock_now_ns());
+        }
+#endif
     }
 }
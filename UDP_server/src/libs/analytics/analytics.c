@@ -0,0 +1,92 @@
+/**
+ * @file analytics.c
+ * @brief Implementation of the client analytics.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "analytics.h"
+#include "libs/random/random.h"
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Starts a new epoch once the current one is over.
+ * @details After an idle epoch the previous set would describe traffic older than
+ * the window, so it is emptied as well.
+ */
+static void analytics_rotate(Analytics *analytics, uint64_t now_ns) {
+    uint64_t elapsed_ns = now_ns - analytics->current_started_ns;
+    if (elapsed_ns < ANALYTICS_EPOCH_NS) {
+        return;
+    }
+    SketchSet *expired = analytics->previous;
+    analytics->previous = analytics->current;
+    analytics->previous_started_ns = analytics->current_started_ns;
+    analytics->current = expired;
+    if (elapsed_ns >= 2 * ANALYTICS_EPOCH_NS) {
+        sketch_init(analytics->previous, analytics->seed);
+        analytics->previous_started_ns = now_ns;
+    }
+    sketch_init(analytics->current, analytics->seed);
+    analytics->current_started_ns = now_ns;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - ANALYTICS - - - - - - - - - - - - - - - - - - - - */
+
+bool analytics_init(Analytics *analytics, uint64_t now_ns) {
+    analytics->sets = malloc(3 * sizeof(SketchSet));
+    if (analytics->sets == NULL) {
+        return false;
+    }
+    random_stream_bytes(random_thread_stream(), &analytics->seed, sizeof(analytics->seed));
+    analytics->current = &analytics->sets[0];
+    analytics->previous = &analytics->sets[1];
+    analytics->merged = &analytics->sets[2];
+    sketch_init(analytics->current, analytics->seed);
+    sketch_init(analytics->previous, analytics->seed);
+    analytics->current_started_ns = now_ns;
+    analytics->previous_started_ns = now_ns;
+    return true;
+}
+
+void analytics_destroy(Analytics *analytics) {
+    free(analytics->sets);
+    analytics->sets = NULL;
+}
+
+void analytics_record(Analytics *analytics, uint32_t address, uint64_t now_ns) {
+    analytics_rotate(analytics, now_ns);
+    sketch_add(analytics->current, address);
+}
+
+size_t analytics_answer(Analytics *analytics, const RequestView *request, uint64_t now_ns,
+                        unsigned char *response_buffer, size_t response_capacity) {
+    SketchCounter counters[SKETCH_TOP_K];
+    StatsEntry entries[SKETCH_TOP_K];
+
+    analytics_rotate(analytics, now_ns);
+    memcpy(analytics->merged, analytics->previous, sizeof(SketchSet));
+    sketch_merge(analytics->merged, analytics->current);
+
+    uint64_t unique = sketch_unique(analytics->merged);
+    uint64_t window_ms = (now_ns - analytics->previous_started_ns) / NANOSECONDS_PER_MILLISECOND;
+    uint32_t address = codec_stats_address(request);
+    StatsSummary summary = { .window_ms = (uint32_t)window_ms, .packets = analytics->merged->packets,
+                             .unique = unique > UINT32_MAX ? UINT32_MAX : (uint32_t)unique,
+                             .estimate = address != 0 ? sketch_estimate(analytics->merged, address) : 0 };
+
+    size_t count = sketch_top(analytics->merged, counters, SKETCH_TOP_K);
+    for (size_t i = 0; i < count; i++) {
+        entries[i] = (StatsEntry){ .address = counters[i].key, .count = counters[i].count, .error = counters[i].error };
+    }
+    return codec_encode_stats(response_buffer, response_capacity, request, &summary, entries, (uint16_t)count);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END ANALYTICS - - - - - - - - - - - - - - - - - - - */
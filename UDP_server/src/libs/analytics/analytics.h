@@ -0,0 +1,85 @@
+/**
+ * @file analytics.h
+ * @brief Heavy hitters, per-client rates and distinct clients of the server.
+ *
+ * Every received datagram, served or refused, is counted in the sketches of
+ * `libs/sketch`: who sends the most, how much any given address sent and how
+ * many distinct addresses were seen. Memory is constant whatever the number of
+ * clients and a datagram costs a few nanoseconds.
+ *
+ * The event loop being single-threaded, the sets are split by time rather than
+ * by worker: datagrams go to the set of the current epoch, and the set of the
+ * previous epoch is kept. An `OP_STATS` request merges the two on demand, so the
+ * figures always cover between one and two epochs.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef ANALYTICS_H_
+#define ANALYTICS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/clock/clock.h"
+#include "libs/codec/codec.h"
+#include "libs/sketch/sketch.h"
+
+/* - - - - - - - - - - - - - - - - - - - - ANALYTICS - - - - - - - - - - - - - - - - - - - - */
+
+#define ANALYTICS_EPOCH_NS (30 * NANOSECONDS_PER_SECOND)	/**< Lifetime of the set receiving the datagrams */
+
+/**
+ * @struct Analytics
+ * @brief The sketches of the current and of the previous epoch.
+ */
+typedef struct {
+    SketchSet *sets;				/**< The three sets below, one allocation */
+    SketchSet *current;				/**< Set of the current epoch */
+    SketchSet *previous;			/**< Set of the previous epoch, empty after an idle epoch */
+    SketchSet *merged;				/**< Scratch set of the answers */
+    uint64_t seed;					/**< Hash seed of the sets, random */
+    uint64_t current_started_ns;	/**< Start of the current epoch */
+    uint64_t previous_started_ns;	/**< Start of the period the previous set covers */
+} Analytics;
+
+/**
+ * @brief Allocates empty sets with a random seed.
+ * @param[out] analytics The sketches.
+ * @param[in] now_ns Current monotonic time.
+ * @return `false` if the sets cannot be allocated.
+ */
+bool analytics_init(Analytics *analytics, uint64_t now_ns);
+
+/**
+ * @brief Releases the sets.
+ * @param[in,out] analytics The sketches.
+ */
+void analytics_destroy(Analytics *analytics);
+
+/**
+ * @brief Counts a received datagram.
+ * @param[in,out] analytics The sketches.
+ * @param[in] address IPv4 address of the sender, in network byte order.
+ * @param[in] now_ns Current monotonic time.
+ */
+void analytics_record(Analytics *analytics, uint32_t address, uint64_t now_ns);
+
+/**
+ * @brief Answers an `OP_STATS` request with the merged figures of both epochs.
+ * @param[in,out] analytics The sketches.
+ * @param[in] request The decoded stats request.
+ * @param[in] now_ns Current monotonic time.
+ * @param[out] response_buffer The send buffer where the answer is encoded.
+ * @param[in] response_capacity Size of `response_buffer`.
+ * @return The number of bytes of the answer.
+ */
+size_t analytics_answer(Analytics *analytics, const RequestView *request, uint64_t now_ns,
+                        unsigned char *response_buffer, size_t response_capacity);
+
+/* - - - - - - - - - - - - - - - - - - - END ANALYTICS - - - - - - - - - - - - - - - - - - - */
+
+#endif /* ANALYTICS_H_ */
@@ -0,0 +1,365 @@
+/**
+ * @file bulk.c
+ * @brief Implementation of the TCP bulk download endpoint.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/tcp.h>
+
+#include "bulk.h"
+#include "libs/clock/clock.h"
+
+#define BULK_REQUEST_TIMEOUT_NS (BULK_REQUEST_TIMEOUT_MS * NANOSECONDS_PER_MILLISECOND)
+#define BULK_WRITES_PER_WAKEUP 8	/**< Bounded work per connection so that one job cannot starve the loop */
+
+/* - - - - - - - - - - - - - - - - - - - - CONNECTIONS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Switches a socket to non-blocking mode.
+ */
+static bool set_socket_nonblocking(int socket_descriptor) {
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Enables or disables `TCP_CORK` (Linux) on a connection.
+ */
+static void set_cork(int socket_descriptor, int enabled) {
+#if defined TCP_CORK
+    setsockopt(socket_descriptor, IPPROTO_TCP, TCP_CORK, &enabled, sizeof(enabled));
+#else
+    (void)socket_descriptor;
+    (void)enabled;
+#endif
+}
+
+/**
+ * @brief Closes a connection and frees its slot.
+ */
+static void close_connection(BulkServer *server, BulkConnection *connection) {
+    close(connection->socket);
+    connection->socket = -1;
+    server->active_count--;
+}
+
+/**
+ * @brief Fills a chunk with as many framed passwords as fit, generated in place.
+ *
+ * The passwords are generated back to back by one engine call at the end of the
+ * free space, then spread into their frames from the first one on: frame `i`
+ * never reaches the passwords that have not been moved yet.
+ *
+ * @return `false` if the engine could not generate the passwords, or the audit log record them.
+ */
+static bool fill_chunk(BulkServer *server, BulkConnection *connection, BulkChunk *chunk) {
+    const uint8_t length = connection->spec.length;
+    const size_t frame_size = (size_t)length + 1;
+    const bool newline = connection->options.framing == FRAMING_NEWLINE;
+    unsigned char *out = chunk->data + chunk->size;
+    size_t frames = (BULK_CHUNK_SIZE - chunk->size) / frame_size;
+
+    if (frames > connection->remaining) {
+        frames = (size_t)connection->remaining;
+    }
+    if (frames == 0) {
+        return true;
+    }
+    const unsigned char *passwords = out + frames;
+    if (passgen_generate_batch(server->engine, connection->spec.type, length, frames, (char *)passwords) != PASSGEN_OK) {
+        return false;
+    }
+#if defined PASSGEN_AUDIT
+    if (server->audit != NULL
+        && !audit_issue(server->audit, &connection->client, connection->spec.tenant_id, connection->spec.request_id,
+                        connection->spec.type, length, (const char *)passwords, length, frames)) {
+        return false;
+    }
+#endif
+    for (size_t i = 0; i < frames; i++, passwords += length) {
+        if (newline) {
+            memmove(out, passwords, length);
+            out[length] = '\n';
+        } else {
+            memmove(out + 1, passwords, length);
+            out[0] = length;
+        }
+        out += frame_size;
+    }
+    chunk->size += frames * frame_size;
+    connection->remaining -= frames;
+    server->passwords_sent += frames;
+    return true;
+}
+
+/**
+ * @brief Sends an error response header and closes the connection.
+ */
+static void reject_connection(BulkServer *server, BulkConnection *connection, const RequestView *request) {
+    unsigned char response[RESPONSE_HEADER_SIZE];
+    size_t size = codec_encode_response(response, sizeof(response), request, STATUS_BAD_REQUEST, 0);
+    if (!request->legacy) {
+        send(connection->socket, response, size, MSG_NOSIGNAL);	/**< Best effort */
+    }
+    close_connection(server, connection);
+}
+
+/**
+ * @brief Size of the request of a connection, as far as the bytes received so far tell.
+ * @details The header comes first; its flags then give the extensions, and the MAC of a
+ * tenant, that surround the body.
+ */
+static size_t expected_request_size(const BulkConnection *connection) {
+    if (connection->request_size > 0 && connection->request[0] != PROTOCOL_MAGIC) {
+        return connection->request_size;	/**< Legacy: refused as soon as it arrives */
+    }
+    if (connection->request_size < REQUEST_HEADER_SIZE) {
+        return REQUEST_HEADER_SIZE;
+    }
+    uint8_t flags = connection->request[7];
+    return BULK_REQUEST_SIZE + ((flags & REQUEST_FLAG_DEADLINE) ? DEADLINE_EXTENSION_SIZE : 0)
+        + ((flags & REQUEST_FLAG_COOKIE) ? COOKIE_EXTENSION_SIZE : 0)
+        + ((flags & REQUEST_FLAG_ENCRYPTED) ? KEY_EXTENSION_SIZE : 0)
+        + ((flags & REQUEST_FLAG_TENANT) ? TENANT_EXTENSION_SIZE + TENANT_MAC_SIZE : 0);
+}
+
+/**
+ * @brief Reads the request of a connection and, once complete, starts the transfer.
+ */
+static void read_request(BulkServer *server, BulkConnection *connection) {
+    size_t expected;
+    while ((expected = expected_request_size(connection)) > connection->request_size) {
+        ssize_t received = recv(connection->socket, connection->request + connection->request_size,
+                                expected - connection->request_size, 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            close_connection(server, connection);
+            return;
+        }
+        if (received < 0) {
+            return;	/**< Wait for the rest of the request */
+        }
+        connection->request_size += (size_t)received;
+    }
+
+    RequestView request;
+    CodecStatus status = codec_decode_request(connection->request, connection->request_size, &request);
+    if (status != CODEC_OK || request.operation != OP_BULK
+        || (codec_is_random_bytes(request.type) && !server->random_bytes)
+        || passgen_validate(passgen_engine_context(server->engine), request.type, request.length) != PASSGEN_OK) {
+        reject_connection(server, connection, &request);
+        return;
+    }
+
+    connection->spec = request;
+    codec_bulk_options(&request, &connection->options);
+    connection->remaining = connection->options.total;
+    connection->writing = true;
+    connection->front = 0;
+
+    /* The response header goes first, the passwords follow in the same chunk */
+    BulkChunk *first = &connection->chunks[0];
+    first->size = codec_encode_response(first->data, BULK_CHUNK_SIZE, &request, STATUS_OK, 0);
+    first->sent = 0;
+    connection->chunks[1].size = connection->chunks[1].sent = 0;
+    if (!fill_chunk(server, connection, first) || !fill_chunk(server, connection, &connection->chunks[1])) {
+        close_connection(server, connection);	/**< The policy cannot be met: the transfer ends short */
+        return;
+    }
+    set_cork(connection->socket, 1);
+}
+
+/**
+ * @brief Hands the pending output of both chunks to the kernel with one `sendmsg` per round.
+ */
+static void write_output(BulkServer *server, BulkConnection *connection) {
+    for (int round = 0; round < BULK_WRITES_PER_WAKEUP; round++) {
+        BulkChunk *front = &connection->chunks[connection->front];
+        BulkChunk *back = &connection->chunks[connection->front ^ 1];
+        struct iovec vectors[2] = {
+            { front->data + front->sent, front->size - front->sent },
+            { back->data + back->sent, back->size - back->sent }
+        };
+        struct msghdr message = { .msg_iov = vectors, .msg_iovlen = 2 };
+
+        if (vectors[0].iov_len == 0 && vectors[1].iov_len == 0) {
+            set_cork(connection->socket, 0);	/**< Flush the last partial segment */
+            shutdown(connection->socket, SHUT_WR);
+            server->jobs_completed++;
+            close_connection(server, connection);
+            return;
+        }
+
+        ssize_t written = sendmsg(connection->socket, &message, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                close_connection(server, connection);
+            }
+            return;
+        }
+
+        size_t from_front = (size_t)written < vectors[0].iov_len ? (size_t)written : vectors[0].iov_len;
+        front->sent += from_front;
+        back->sent += (size_t)written - from_front;
+
+        if (front->sent == front->size) {
+            /* The kernel owns a copy of the front chunk: regenerate it behind the back chunk */
+            front->size = front->sent = 0;
+            if (!fill_chunk(server, connection, front)) {
+                close_connection(server, connection);
+                return;
+            }
+            connection->front ^= 1;
+        }
+        if ((size_t)written < vectors[0].iov_len + vectors[1].iov_len) {
+            return;	/**< Socket buffer full: wait for POLLOUT */
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END CONNECTIONS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - BULK ENDPOINT - - - - - - - - - - - - - - - - - - - - */
+
+bool bulk_server_open(BulkServer *server, const struct sockaddr_in *address, PassgenEngine *engine) {
+    int enabled = 1;
+
+    memset(server, 0, sizeof(*server));
+    server->engine = engine;
+    server->random_bytes = true;
+    server->listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (server->listener < 0) {
+        return false;
+    }
+    setsockopt(server->listener, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    if (bind(server->listener, (const struct sockaddr *)address, sizeof(*address)) < 0
+        || listen(server->listener, SOMAXCONN) < 0
+        || !set_socket_nonblocking(server->listener)) {
+        close(server->listener);
+        return false;
+    }
+
+    server->connections = calloc(MAX_BULK_CONNECTIONS, sizeof(BulkConnection));
+    if (server->connections == NULL) {
+        close(server->listener);
+        return false;
+    }
+    for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS; i++) {
+        server->connections[i].socket = -1;
+    }
+    return true;
+}
+
+void bulk_server_close(BulkServer *server) {
+    for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS; i++) {
+        if (server->connections[i].socket >= 0) {
+            close_connection(server, &server->connections[i]);
+        }
+    }
+    free(server->connections);
+    server->connections = NULL;
+    close(server->listener);
+}
+
+size_t bulk_server_poll_descriptors(const BulkServer *server, struct pollfd *descriptors, size_t capacity) {
+    size_t count = 0;
+
+    if (capacity > 0 && server->active_count < MAX_BULK_CONNECTIONS) {
+        descriptors[count++] = (struct pollfd){ .fd = server->listener, .events = POLLIN };
+    }
+    for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS && count < capacity; i++) {
+        const BulkConnection *connection = &server->connections[i];
+        if (connection->socket >= 0) {
+            descriptors[count++] = (struct pollfd){
+                .fd = connection->socket,
+                .events = connection->writing ? POLLOUT : POLLIN
+            };
+        }
+    }
+    return count;
+}
+
+void bulk_server_handle(BulkServer *server, const struct pollfd *descriptors, size_t count, uint64_t now_ns) {
+    for (size_t d = 0; d < count; d++) {
+        if (descriptors[d].revents == 0) {
+            continue;
+        }
+
+        if (descriptors[d].fd == server->listener) {
+            for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS && server->active_count < MAX_BULK_CONNECTIONS; i++) {
+                BulkConnection *connection = &server->connections[i];
+                if (connection->socket >= 0) {
+                    continue;
+                }
+                socklen_t client_size = sizeof(connection->client);
+                int accepted = accept(server->listener, (struct sockaddr *)&connection->client, &client_size);
+                if (accepted < 0) {
+                    break;	/**< No more pending connections */
+                }
+                if (!set_socket_nonblocking(accepted)) {
+                    close(accepted);
+                    continue;
+                }
+                connection->socket = accepted;
+                connection->writing = false;
+                connection->request_size = 0;
+                connection->accepted_ns = now_ns;
+                server->active_count++;
+            }
+            continue;
+        }
+
+        for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS; i++) {
+            BulkConnection *connection = &server->connections[i];
+            if (connection->socket != descriptors[d].fd) {
+                continue;
+            }
+            if (connection->writing) {
+                write_output(server, connection);
+            } else {
+                read_request(server, connection);
+            }
+            break;
+        }
+    }
+
+    /* Connections that never sent their request would hold a slot forever */
+    for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS; i++) {
+        BulkConnection *connection = &server->connections[i];
+        if (connection->socket >= 0 && !connection->writing
+            && now_ns - connection->accepted_ns > BULK_REQUEST_TIMEOUT_NS) {
+            close_connection(server, connection);
+        }
+    }
+}
+
+int bulk_server_poll_timeout(const BulkServer *server, uint64_t now_ns) {
+    uint64_t next_ns = UINT64_MAX;
+
+    for (unsigned int i = 0; i < MAX_BULK_CONNECTIONS; i++) {
+        const BulkConnection *connection = &server->connections[i];
+        if (connection->socket >= 0 && !connection->writing) {
+            uint64_t expiry_ns = connection->accepted_ns + BULK_REQUEST_TIMEOUT_NS + 1;
+            if (expiry_ns < next_ns) {
+                next_ns = expiry_ns;
+            }
+        }
+    }
+    if (next_ns == UINT64_MAX) {
+        return -1;
+    }
+    if (next_ns <= now_ns) {
+        return 0;
+    }
+    return (int)((next_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END BULK ENDPOINT - - - - - - - - - - - - - - - - - - - */
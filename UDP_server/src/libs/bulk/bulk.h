@@ -0,0 +1,135 @@
+/**
+ * @file bulk.h
+ * @brief Optional TCP endpoint for very large password downloads.
+ *
+ * UDP responses are limited to one datagram; a job such as "ten million
+ * passwords" is simpler and faster over a reliable stream. A client connects,
+ * sends one `OP_BULK` request and reads the framed passwords until the server
+ * closes the connection.
+ *
+ * Connections are served by the server's event loop: every connection owns two
+ * output chunks that are filled with passwords generated in place and handed to
+ * the kernel together with one vectored `sendmsg` (the `writev` of sockets). A chunk is regenerated only once
+ * the kernel has taken all of it, so generation is paced by socket writability
+ * and memory use stays bounded. While a transfer is running the socket is
+ * corked (`TCP_CORK`) so that only full segments are sent; it is uncorked at the
+ * end to flush the last partial segment at once.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef BULK_H_
+#define BULK_H_
+
+#include <poll.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/codec/codec.h"
+#include "libs/engine/engine.h"
+#if defined PASSGEN_AUDIT
+#include "libs/audit/audit.h"
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - BULK ENDPOINT - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_BULK_CONNECTIONS 32						/**< Connections served at the same time */
+#define BULK_CHUNK_SIZE (64 * 1024)					/**< Size of each output chunk */
+#define BULK_REQUEST_SIZE (REQUEST_HEADER_SIZE + BULK_BODY_SIZE)	/**< Size of a bulk request without extensions */
+#define BULK_MAX_REQUEST_SIZE (BULK_REQUEST_SIZE + DEADLINE_EXTENSION_SIZE + COOKIE_EXTENSION_SIZE \
+                               + KEY_EXTENSION_SIZE + TENANT_EXTENSION_SIZE + TENANT_MAC_SIZE)	/**< Size of a bulk request with every extension */
+#define BULK_REQUEST_TIMEOUT_MS 5000				/**< Time allowed to send the request after connecting */
+
+/**
+ * @struct BulkChunk
+ * @brief One output buffer of a connection.
+ */
+typedef struct {
+    size_t size;							/**< Bytes filled */
+    size_t sent;							/**< Bytes already accepted by the kernel */
+    unsigned char data[BULK_CHUNK_SIZE];	/**< Framed passwords */
+} BulkChunk;
+
+/**
+ * @struct BulkConnection
+ * @brief State of one TCP connection.
+ */
+typedef struct {
+    int socket;								/**< Connected socket, -1 if the slot is free */
+    bool writing;							/**< `false` while the request is being read */
+    uint64_t accepted_ns;					/**< When the connection was accepted */
+    size_t request_size;					/**< Bytes of the request received so far */
+    unsigned char request[BULK_MAX_REQUEST_SIZE];	/**< Request being read */
+    struct sockaddr_in client;				/**< Address of the client */
+    RequestView spec;						/**< Decoded request (type, length, id) */
+    BulkOptions options;					/**< Total and framing */
+    uint64_t remaining;						/**< Passwords not generated yet */
+    unsigned int front;						/**< Chunk to be sent first */
+    BulkChunk chunks[2];					/**< Double-buffered output */
+} BulkConnection;
+
+/**
+ * @struct BulkServer
+ * @brief The TCP listener and its connections.
+ */
+typedef struct {
+    int listener;							/**< Listening socket */
+    PassgenEngine *engine;					/**< Engine generating the passwords of every connection */
+#if defined PASSGEN_AUDIT
+    AuditLog *audit;						/**< Log of the issued passwords, `NULL` for none */
+#endif
+    bool random_bytes;						/**< Random bytes are served: not while they have a per-client budget */
+    unsigned int active_count;				/**< Connections in use */
+    uint64_t passwords_sent;				/**< Passwords generated for bulk jobs since start */
+    uint64_t jobs_completed;				/**< Bulk jobs fully delivered */
+    BulkConnection *connections;			/**< `MAX_BULK_CONNECTIONS` slots */
+} BulkServer;
+
+/**
+ * @brief Opens the TCP listener on `address`.
+ * @param[out] server The bulk server to initialise.
+ * @param[in] address Address and port to listen on.
+ * @param[in] engine Engine generating the passwords, used by the calling thread only.
+ * @return `true` on success, `false` if the socket could not be created or bound.
+ */
+bool bulk_server_open(BulkServer *server, const struct sockaddr_in *address, PassgenEngine *engine);
+
+/**
+ * @brief Closes the listener and every connection.
+ * @param[in,out] server The bulk server.
+ */
+void bulk_server_close(BulkServer *server);
+
+/**
+ * @brief Appends the descriptors the event loop must watch, with the events of interest.
+ * @param[in] server The bulk server.
+ * @param[out] descriptors Array receiving the descriptors.
+ * @param[in] capacity Free entries in `descriptors`.
+ * @return Number of descriptors appended.
+ */
+size_t bulk_server_poll_descriptors(const BulkServer *server, struct pollfd *descriptors, size_t capacity);
+
+/**
+ * @brief Accepts connections, reads requests and writes output after `poll` returned.
+ * @param[in,out] server The bulk server.
+ * @param[in] descriptors The descriptors filled by `bulk_server_poll_descriptors`, with `revents` set.
+ * @param[in] count Number of entries in `descriptors`.
+ * @param[in] now_ns Current monotonic time.
+ */
+void bulk_server_handle(BulkServer *server, const struct pollfd *descriptors, size_t count, uint64_t now_ns);
+
+/**
+ * @brief Computes how long the event loop may sleep before a request timeout expires.
+ * @param[in] server The bulk server.
+ * @param[in] now_ns Current monotonic time.
+ * @return Milliseconds to wait, or -1 if no connection is waiting for its request.
+ */
+int bulk_server_poll_timeout(const BulkServer *server, uint64_t now_ns);
+
+/* - - - - - - - - - - - - - - - - - - - END BULK ENDPOINT - - - - - - - - - - - - - - - - - - - */
+
+#endif /* BULK_H_ */
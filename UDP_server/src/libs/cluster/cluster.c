@@ -0,0 +1,392 @@
+/**
+ * @file cluster.c
+ * @brief Implementation of the uniqueness coordination between the nodes of a cluster.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+#include "cluster.h"
+
+#define WINDOW_WORDS (CLUSTER_LOG_SIZE / 64)	/**< Words of the window of one origin */
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Switches a socket to non-blocking mode.
+ */
+static bool set_socket_nonblocking(int socket_descriptor) {
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Observer of the engine context: appends the fingerprint of an issued password to the log.
+ */
+static void record_issued(void *argument, uint32_t fingerprint) {
+    Cluster *cluster = argument;
+    cluster->log[cluster->issued % CLUSTER_LOG_SIZE] = fingerprint;
+    cluster->issued++;
+}
+
+/**
+ * @brief Oldest sequence number of this node still in the log.
+ */
+static inline uint64_t log_start(const Cluster *cluster) {
+    return cluster->issued > CLUSTER_LOG_SIZE ? cluster->issued - CLUSTER_LOG_SIZE : 0;
+}
+
+static inline bool window_test(const ClusterOrigin *origin, uint64_t sequence) {
+    uint64_t slot = sequence % CLUSTER_LOG_SIZE;
+    return (origin->window[slot / 64] >> (slot % 64)) & 1;
+}
+
+static inline void window_set(ClusterOrigin *origin, uint64_t sequence) {
+    uint64_t slot = sequence % CLUSTER_LOG_SIZE;
+    origin->window[slot / 64] |= 1ull << (slot % 64);
+}
+
+static inline void window_clear(ClusterOrigin *origin, uint64_t sequence) {
+    uint64_t slot = sequence % CLUSTER_LOG_SIZE;
+    origin->window[slot / 64] &= ~(1ull << (slot % 64));
+}
+
+/**
+ * @brief Sends a datagram, best effort: a lost delta is repaired after the next digest.
+ */
+static void send_datagram(Cluster *cluster, const unsigned char *datagram, size_t size, const struct sockaddr_in *address) {
+    if (sendto(cluster->socket, datagram, size, 0, (const struct sockaddr *)address, sizeof(*address)) == (ssize_t)size) {
+        cluster->stats.bytes_sent += size;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - SENDING - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Sends the fingerprints `[from, to)` of this node as deltas, to one peer or to all of them.
+ * @param[in] peer The peer, `NULL` for all of them.
+ * @param[in] max_datagrams Most deltas sent.
+ * @return The sequence number after the last fingerprint sent.
+ */
+static uint64_t send_deltas(Cluster *cluster, uint64_t from, uint64_t to, const struct sockaddr_in *peer,
+                            unsigned int max_datagrams) {
+    unsigned char datagram[GOSSIP_DATAGRAM_SIZE];
+
+    for (unsigned int sent = 0; from < to && sent < max_datagrams; sent++) {
+        size_t count = to - from < GOSSIP_MAX_DELTA_COUNT ? (size_t)(to - from) : GOSSIP_MAX_DELTA_COUNT;
+        for (size_t i = 0; i < count; i++) {
+            cluster->fingerprints[i] = cluster->log[(from + i) % CLUSTER_LOG_SIZE];
+        }
+
+        size_t taken;
+        size_t size = gossip_encode_delta(datagram, sizeof(datagram), cluster->mac_key, cluster->node_id,
+                                          cluster->node_id, cluster->incarnation, from, cluster->fingerprints, count,
+                                          &taken);
+        if (size == 0) {
+            break;
+        }
+        if (peer != NULL) {
+            send_datagram(cluster, datagram, size, peer);
+            cluster->stats.deltas_sent++;
+        } else {
+            for (unsigned int i = 0; i < cluster->peer_count; i++) {
+                send_datagram(cluster, datagram, size, &cluster->peers[i]);
+            }
+            cluster->stats.deltas_sent += cluster->peer_count;
+        }
+        from += taken;
+    }
+    return from;
+}
+
+/**
+ * @brief Pushes to all the peers the fingerprints issued since the previous round.
+ */
+static void push_round(Cluster *cluster) {
+    if (cluster->issued - cluster->pushed > CLUSTER_LOG_SIZE) {
+        cluster->pushed = cluster->issued - CLUSTER_LOG_SIZE;	/**< Overwritten in the log before being pushed */
+    }
+    uint64_t from = cluster->pushed;
+    cluster->pushed = send_deltas(cluster, from, cluster->issued, NULL, UINT32_MAX);
+    cluster->stats.fingerprints_pushed += cluster->pushed - from;
+}
+
+/**
+ * @brief Tells all the peers what this node received of every origin.
+ */
+static void send_digest(Cluster *cluster) {
+    GossipDigestEntry entries[GOSSIP_MAX_NODES];
+    size_t count = 0;
+    for (uint8_t id = 1; id <= GOSSIP_MAX_NODES; id++) {
+        const ClusterOrigin *origin = &cluster->origins[id];
+        if (id != cluster->node_id && origin->incarnation != 0) {
+            entries[count++] = (GossipDigestEntry){ .origin = id, .incarnation = origin->incarnation,
+                                                    .received = origin->received };
+        }
+    }
+
+    unsigned char datagram[GOSSIP_DATAGRAM_SIZE];
+    size_t size = gossip_encode_digest(datagram, sizeof(datagram), cluster->mac_key, cluster->node_id,
+                                       cluster->incarnation, entries, count);
+    for (unsigned int i = 0; i < cluster->peer_count; i++) {
+        send_datagram(cluster, datagram, size, &cluster->peers[i]);
+    }
+    cluster->settled = cluster->checkpoint;
+    cluster->checkpoint = cluster->pushed;
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - RECEIVING - - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Gives up the sequence numbers of an origin below `received`, counting the ones never received.
+ */
+static void slide_window(Cluster *cluster, ClusterOrigin *origin, uint64_t received) {
+    if (received - origin->received >= CLUSTER_LOG_SIZE) {
+        uint64_t marked = 0;
+        for (size_t i = 0; i < WINDOW_WORDS; i++) {
+            marked += (uint64_t)__builtin_popcountll(origin->window[i]);
+        }
+        memset(origin->window, 0, WINDOW_WORDS * sizeof(uint64_t));
+        cluster->stats.missed += received - origin->received - marked;
+        origin->received = received;
+        return;
+    }
+    for (; origin->received < received; origin->received++) {
+        if (window_test(origin, origin->received)) {
+            window_clear(origin, origin->received);
+        } else {
+            cluster->stats.missed++;
+        }
+    }
+}
+
+/**
+ * @brief Enters the fingerprints of a delta in the filter and marks them received.
+ */
+static void receive_delta(Cluster *cluster, const GossipMessage *message) {
+    if (message->origin == cluster->node_id) {
+        return;
+    }
+    ClusterOrigin *origin = &cluster->origins[message->origin];
+    if (message->incarnation < origin->incarnation) {
+        return;		/**< A delta of a previous run of the origin */
+    }
+    uint64_t end = message->first + message->count;
+    if (message->incarnation > origin->incarnation) {
+        /* New origin, or restarted: what is older than its log can no longer be repaired */
+        origin->incarnation = message->incarnation;
+        origin->received = end > CLUSTER_LOG_SIZE ? end - CLUSTER_LOG_SIZE : 0;
+        memset(origin->window, 0, WINDOW_WORDS * sizeof(uint64_t));
+    }
+    if (end <= origin->received) {
+        return;		/**< Already received, a repair crossed the original */
+    }
+    if (!gossip_delta_fingerprints(message, cluster->fingerprints, GOSSIP_MAX_DELTA_COUNT)) {
+        cluster->stats.rejected++;
+        return;
+    }
+    if (end - origin->received > CLUSTER_LOG_SIZE) {
+        slide_window(cluster, origin, end - CLUSTER_LOG_SIZE);
+    }
+
+    /* Only a delta received for the first time tells about collisions: a repeated one finds itself */
+    bool fresh = message->first >= origin->received;
+    uint64_t start = fresh ? message->first : origin->received;
+    for (uint64_t sequence = start; fresh && sequence < end; sequence++) {
+        fresh = !window_test(origin, sequence);
+    }
+    for (uint32_t i = 0; i < message->count; i++) {
+        if (!passgen_context_remember(cluster->context, cluster->fingerprints[i]) && fresh) {
+            cluster->stats.known++;
+        }
+    }
+    if (fresh) {
+        cluster->stats.fingerprints_received += message->count;
+    }
+
+    for (uint64_t sequence = start; sequence < end; sequence++) {
+        window_set(origin, sequence);
+    }
+    while (window_test(origin, origin->received)) {
+        window_clear(origin, origin->received);
+        origin->received++;
+    }
+}
+
+/**
+ * @brief Sends a peer again the fingerprints of this node its digest lacks.
+ */
+static void receive_digest(Cluster *cluster, const GossipMessage *message, const struct sockaddr_in *sender) {
+    uint64_t from = 0;
+    for (uint32_t i = 0; i < message->count; i++) {
+        GossipDigestEntry entry;
+        gossip_digest_entry(message, i, &entry);
+        if (entry.origin == cluster->node_id && entry.incarnation == cluster->incarnation) {
+            from = entry.received;
+        }
+    }
+    if (from < log_start(cluster)) {
+        from = log_start(cluster);
+    }
+    if (from < cluster->settled) {
+        uint64_t to = send_deltas(cluster, from, cluster->settled, sender, CLUSTER_REPAIR_DATAGRAMS);
+        cluster->stats.fingerprints_repaired += to - from;
+    }
+}
+
+/**
+ * @brief Receives and handles the pending datagrams.
+ */
+static void receive_datagrams(Cluster *cluster) {
+    unsigned char datagram[GOSSIP_DATAGRAM_SIZE];
+
+    for (int i = 0; i < CLUSTER_RECEIVE_BATCH; i++) {
+        struct sockaddr_in sender;
+        socklen_t sender_size = sizeof(sender);
+        ssize_t size = recvfrom(cluster->socket, datagram, sizeof(datagram), 0, (struct sockaddr *)&sender, &sender_size);
+        if (size < 0) {
+            break;		/**< Nothing pending, or an ICMP error of a peer that is down */
+        }
+
+        GossipMessage message;
+        if (!gossip_decode(datagram, (size_t)size, cluster->mac_key, &message)) {
+            cluster->stats.rejected++;
+            continue;
+        }
+        if (message.sender == cluster->node_id) {
+            continue;
+        }
+        if (message.kind == GOSSIP_DELTA) {
+            cluster->stats.deltas_received++;
+            cluster->stats.bytes_received += (uint64_t)size;
+            receive_delta(cluster, &message);
+        } else {
+            receive_digest(cluster, &message, &sender);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - - - CLUSTER - - - - - - - - - - - - - - - - - - - - - */
+
+bool cluster_open(Cluster *cluster, const ClusterOptions *options, PassgenContext *context) {
+    memset(cluster, 0, sizeof(*cluster));
+    if (options->node_id == 0 || options->node_id > GOSSIP_MAX_NODES || options->peer_count > CLUSTER_MAX_PEERS) {
+        return false;
+    }
+    cluster->log = malloc(CLUSTER_LOG_SIZE * sizeof(uint32_t));
+    uint64_t *windows = calloc((size_t)(GOSSIP_MAX_NODES + 1) * WINDOW_WORDS, sizeof(uint64_t));
+    if (cluster->log == NULL || windows == NULL) {
+        free(cluster->log);
+        free(windows);
+        return false;
+    }
+    for (unsigned int id = 0; id <= GOSSIP_MAX_NODES; id++) {
+        cluster->origins[id].window = windows + (size_t)id * WINDOW_WORDS;
+    }
+
+    cluster->socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (cluster->socket < 0
+        || bind(cluster->socket, (const struct sockaddr *)&options->address, sizeof(options->address)) < 0
+        || !set_socket_nonblocking(cluster->socket)) {
+        if (cluster->socket >= 0) {
+            close(cluster->socket);
+        }
+        free(cluster->log);
+        free(windows);
+        return false;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    cluster->incarnation = (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + (uint64_t)now.tv_nsec;
+    cluster->node_id = options->node_id;
+    cluster->context = context;
+    memcpy(cluster->peers, options->peers, options->peer_count * sizeof(options->peers[0]));
+    cluster->peer_count = options->peer_count;
+    cluster->next_round_ns = clock_now_ns();
+    cluster->next_digest_ns = cluster->next_round_ns;		/**< At once: the peers fill the filter of a new node */
+
+    unsigned char fingerprint_key[SIPHASH_KEY_SIZE];
+    gossip_derive_keys(options->key, fingerprint_key, cluster->mac_key);
+    passgen_context_set_key(context, fingerprint_key);
+    passgen_context_observe(context, record_issued, cluster);
+    return true;
+}
+
+void cluster_close(Cluster *cluster) {
+    passgen_context_observe(cluster->context, NULL, NULL);
+    close(cluster->socket);
+    free(cluster->log);
+    free(cluster->origins[0].window);
+}
+
+bool cluster_parse_peer(const char *text, struct sockaddr_in *address) {
+    char host[INET_ADDRSTRLEN];
+    const char *colon = strchr(text, ':');
+    if (colon == NULL || (size_t)(colon - text) >= sizeof(host)) {
+        return false;
+    }
+    memcpy(host, text, (size_t)(colon - text));
+    host[colon - text] = '\0';
+
+    char *end;
+    unsigned long port = strtoul(colon + 1, &end, 10);
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_port = htons((unsigned short)port);
+    return colon[1] != '\0' && *end == '\0' && port > 0 && port <= 65535
+        && inet_pton(AF_INET, host, &address->sin_addr) == 1;
+}
+
+void cluster_poll_descriptor(const Cluster *cluster, struct pollfd *descriptor) {
+    *descriptor = (struct pollfd){ .fd = cluster->socket, .events = POLLIN };
+}
+
+int cluster_poll_timeout(const Cluster *cluster, uint64_t now_ns) {
+    uint64_t due_ns = cluster->next_digest_ns;
+    if (cluster->issued != cluster->pushed && cluster->next_round_ns < due_ns) {
+        due_ns = cluster->next_round_ns;
+    }
+    return due_ns <= now_ns ? 0 : (int)((due_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+}
+
+void cluster_handle(Cluster *cluster, short revents, uint64_t now_ns) {
+    if (revents & POLLIN) {
+        receive_datagrams(cluster);
+    }
+    if (now_ns >= cluster->next_round_ns) {
+        push_round(cluster);
+        cluster->next_round_ns = now_ns + CLUSTER_ROUND_NS;
+    }
+    if (now_ns >= cluster->next_digest_ns) {
+        send_digest(cluster);
+        cluster->next_digest_ns = now_ns + CLUSTER_DIGEST_NS;
+    }
+}
+
+void cluster_report(Cluster *cluster) {
+    const ClusterStats *stats = &cluster->stats;
+    if (stats->deltas_sent == 0 && stats->deltas_received == 0 && stats->rejected == 0) {
+        return;
+    }
+    printf("Cluster: %llu fingerprints pushed, %llu repaired, %llu deltas sent (%llu bytes with the digests) | "
+           "%llu fingerprints received in %llu deltas (%llu bytes), %llu already known, %llu missed, %llu rejected\n",
+           (unsigned long long)stats->fingerprints_pushed, (unsigned long long)stats->fingerprints_repaired,
+           (unsigned long long)stats->deltas_sent, (unsigned long long)stats->bytes_sent,
+           (unsigned long long)stats->fingerprints_received, (unsigned long long)stats->deltas_received,
+           (unsigned long long)stats->bytes_received, (unsigned long long)stats->known,
+           (unsigned long long)stats->missed, (unsigned long long)stats->rejected);
+    memset(&cluster->stats, 0, sizeof(cluster->stats));
+}
+
+/* - - - - - - - - - - - - - - - - - - - - END CLUSTER - - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,172 @@
+/**
+ * @file cluster.h
+ * @brief Uniqueness of the passwords across the nodes of a cluster.
+ *
+ * The uniqueness filter (`-u`) of one server only knows the passwords that server
+ * issued. In a cluster every node tells its peers the fingerprints of the
+ * passwords it issues, over UDP, and enters theirs in its own filter, so that no
+ * node hands out a password another node handed out recently.
+ *
+ * Every `CLUSTER_ROUND_NS` a node pushes to all its peers the fingerprints it
+ * issued since the previous round, as deltas (see `libs/gossip`). Datagrams get
+ * lost: every `CLUSTER_DIGEST_NS` a node also sends its peers a digest of what it
+ * received of each of them, and each peer sends again the part of its own
+ * fingerprints the digest lacks, as long as it keeps them (`CLUSTER_LOG_SIZE`).
+ * A node that starts or restarts is filled the same way.
+ *
+ * A fingerprint arriving in a new delta that the filter already holds was issued
+ * by two nodes within the filter window (or is a false positive of the filter):
+ * the collisions between nodes are counted at the cost of a filter lookup. A
+ * password can still be issued twice by two nodes within about one round, before
+ * they have heard of each other.
+ *
+ * The event loop drives everything, from its own thread: the observer the cluster
+ * registers on the engine context must not be called from another thread.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef CLUSTER_H_
+#define CLUSTER_H_
+
+#include <poll.h>
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/clock/clock.h"
+#include "libs/engine/engine.h"
+#include "libs/gossip/gossip.h"
+
+/* - - - - - - - - - - - - - - - - - - - - - CLUSTER - - - - - - - - - - - - - - - - - - - - - */
+
+#define CLUSTER_MAX_PEERS (GOSSIP_MAX_NODES - 1)				/**< Peers of a node */
+#define CLUSTER_LOG_SIZE (1u << 18)								/**< Fingerprints kept for the repairs, and window of each origin */
+#define CLUSTER_ROUND_NS (10 * NANOSECONDS_PER_MILLISECOND)		/**< Period of the deltas */
+#define CLUSTER_DIGEST_NS (500 * NANOSECONDS_PER_MILLISECOND)	/**< Period of the digests */
+#define CLUSTER_REPAIR_DATAGRAMS 128							/**< Most deltas sent again for one digest */
+#define CLUSTER_RECEIVE_BATCH 64								/**< Datagrams received per wake-up */
+
+/**
+ * @struct ClusterOptions
+ * @brief Identity of a node and its peers.
+ */
+typedef struct {
+    uint8_t node_id;								/**< Id of this node, 1 to `GOSSIP_MAX_NODES`, unique in the cluster */
+    struct sockaddr_in address;						/**< Address the gossip is received on */
+    struct sockaddr_in peers[CLUSTER_MAX_PEERS];	/**< Gossip addresses of the other nodes */
+    unsigned int peer_count;						/**< Entries of `peers` */
+    unsigned char key[SIPHASH_KEY_SIZE];			/**< Key shared by the cluster */
+} ClusterOptions;
+
+/**
+ * @struct ClusterOrigin
+ * @brief What this node received of another node.
+ */
+typedef struct {
+    uint64_t incarnation;		/**< Incarnation of the origin, 0 before anything was received */
+    uint64_t received;			/**< Fingerprints received without a gap */
+    uint64_t *window;			/**< Received beyond `received`: bit `sequence % CLUSTER_LOG_SIZE` */
+} ClusterOrigin;
+
+/**
+ * @struct ClusterStats
+ * @brief Counters of the gossip.
+ */
+typedef struct {
+    uint64_t deltas_sent;				/**< Delta datagrams sent, counted once per peer */
+    uint64_t bytes_sent;				/**< Bytes of the datagrams sent */
+    uint64_t fingerprints_pushed;		/**< Fingerprints of this node pushed to the peers */
+    uint64_t fingerprints_repaired;		/**< Fingerprints of this node sent again after a digest */
+    uint64_t deltas_received;			/**< Delta datagrams received */
+    uint64_t bytes_received;			/**< Bytes of the datagrams received */
+    uint64_t fingerprints_received;		/**< Fingerprints received in new deltas */
+    uint64_t known;						/**< Of which already in the filter: collisions between nodes, or false positives */
+    uint64_t missed;					/**< Fingerprints of other nodes never received, given up */
+    uint64_t rejected;					/**< Datagrams with a bad MAC or a bad layout */
+} ClusterStats;
+
+/**
+ * @struct Cluster
+ * @brief The gossip socket, the log of this node and what it received of the others.
+ */
+typedef struct {
+    int socket;										/**< Gossip socket, non-blocking */
+    uint8_t node_id;								/**< Id of this node */
+    uint64_t incarnation;							/**< Start time of this node, nanoseconds since the Unix epoch */
+    unsigned char mac_key[SIPHASH_KEY_SIZE];		/**< Key of the datagram MACs */
+    PassgenContext *context;						/**< Context whose filter is shared */
+    struct sockaddr_in peers[CLUSTER_MAX_PEERS];	/**< Gossip addresses of the other nodes */
+    unsigned int peer_count;						/**< Entries of `peers` */
+    uint32_t *log;									/**< Fingerprints issued by this node: entry `sequence % CLUSTER_LOG_SIZE` */
+    uint64_t issued;								/**< Fingerprints issued by this node */
+    uint64_t pushed;								/**< Of which pushed to the peers */
+    uint64_t checkpoint;							/**< `pushed` at the last digest */
+    uint64_t settled;								/**< `pushed` at the digest before: a digest period old, received unless lost */
+    ClusterOrigin origins[GOSSIP_MAX_NODES + 1];	/**< By node id */
+    uint64_t next_round_ns;							/**< Time of the next deltas */
+    uint64_t next_digest_ns;						/**< Time of the next digests */
+    ClusterStats stats;								/**< Counters since the last report */
+    uint32_t fingerprints[GOSSIP_MAX_DELTA_COUNT];	/**< Scratch of one delta */
+} Cluster;
+
+/**
+ * @brief Opens the gossip socket and shares the filter of a context with the cluster.
+ * @details Sets the key of the context and registers an observer on it: call it before
+ * the breached passwords are loaded and before any engine uses the context.
+ * @param[out] cluster The cluster.
+ * @param[in] options Identity of the node and its peers.
+ * @param[in,out] context The context, whose policy asks for unique passwords.
+ * @return `false` if the socket cannot be bound or the log cannot be allocated.
+ */
+bool cluster_open(Cluster *cluster, const ClusterOptions *options, PassgenContext *context);
+
+/**
+ * @brief Closes the socket and frees the log.
+ * @param[in,out] cluster The cluster.
+ */
+void cluster_close(Cluster *cluster);
+
+/**
+ * @brief Parses the gossip address of a peer, `a.b.c.d:port`.
+ * @param[in] text The address.
+ * @param[out] address The parsed address.
+ * @return `false` if `text` is not such an address.
+ */
+bool cluster_parse_peer(const char *text, struct sockaddr_in *address);
+
+/**
+ * @brief Fills the descriptor the event loop must watch.
+ * @param[in] cluster The cluster.
+ * @param[out] descriptor The descriptor.
+ */
+void cluster_poll_descriptor(const Cluster *cluster, struct pollfd *descriptor);
+
+/**
+ * @brief Computes how long the event loop may sleep before the next deltas or digests are due.
+ * @param[in] cluster The cluster.
+ * @param[in] now_ns Current monotonic time.
+ * @return Milliseconds to wait.
+ */
+int cluster_poll_timeout(const Cluster *cluster, uint64_t now_ns);
+
+/**
+ * @brief Receives the pending datagrams, then sends the deltas and digests that are due.
+ * @param[in,out] cluster The cluster.
+ * @param[in] revents Events `poll` returned for the descriptor.
+ * @param[in] now_ns Current monotonic time.
+ */
+void cluster_handle(Cluster *cluster, short revents, uint64_t now_ns);
+
+/**
+ * @brief Prints the counters since the previous report, if anything happened, and resets them.
+ * @param[in,out] cluster The cluster.
+ */
+void cluster_report(Cluster *cluster);
+
+/* - - - - - - - - - - - - - - - - - - - - END CLUSTER - - - - - - - - - - - - - - - - - - - - */
+
+#endif /* CLUSTER_H_ */
@@ -0,0 +1,69 @@
+/**
+ * @file cookie.c
+ * @brief Implementation of the anti-spoofing cookies.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+
+#include "cookie.h"
+#include "libs/random/random.h"
+
+#define COOKIE_MAC_MASK 0x00FFFFFFFFFFFFFFull	/**< The 56 bits of SipHash output kept in a cookie */
+#define COOKIE_BATCH 64							/**< Cookies hashed by one call to `siphash24_pairs` */
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief The message authenticated by a cookie: the client endpoint and the window.
+ */
+static void cookie_message(const struct sockaddr_in *client, uint64_t window, uint64_t message[2]) {
+    message[0] = (uint64_t)client->sin_addr.s_addr | (uint64_t)client->sin_port << 32;
+    message[1] = window;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - COOKIES - - - - - - - - - - - - - - - - - - - - */
+
+void cookie_secret_init(CookieSecret *secret) {
+    random_stream_bytes(random_thread_stream(), secret->key, sizeof(secret->key));
+}
+
+uint64_t cookie_issue(const CookieSecret *secret, const struct sockaddr_in *client, uint64_t now_ns) {
+    uint64_t window = now_ns / COOKIE_WINDOW_NS;
+    uint64_t message[1][2];
+    uint64_t hash;
+
+    cookie_message(client, window, message[0]);
+    siphash24_pairs(secret->key, (const uint64_t (*)[2])message, 1, &hash);
+    /* The window byte is never 0 so that a cookie is never 0, which means "no cookie" */
+    uint64_t tag = (window & 0x7F) | 0x80;
+    return tag << 56 | (hash & COOKIE_MAC_MASK);
+}
+
+void cookie_verify(const CookieSecret *secret, CookieCheck *checks, size_t count, uint64_t now_ns) {
+    uint64_t window = now_ns / COOKIE_WINDOW_NS;
+    uint64_t messages[COOKIE_BATCH][2];
+    uint64_t hashes[COOKIE_BATCH];
+
+    for (size_t start = 0; start < count; start += COOKIE_BATCH) {
+        size_t batch = count - start < COOKIE_BATCH ? count - start : COOKIE_BATCH;
+
+        /* The tag gives the window the cookie was issued in, as long as it is recent */
+        for (size_t i = 0; i < batch; i++) {
+            CookieCheck *check = &checks[start + i];
+            uint64_t age = (window - (check->cookie >> 56)) & 0x7F;
+            check->valid = check->cookie != 0 && (check->cookie >> 63) && age <= 1 && age <= window;
+            cookie_message(&check->client, window - (check->valid ? age : 0), messages[i]);
+        }
+        siphash24_pairs(secret->key, (const uint64_t (*)[2])messages, batch, hashes);
+        for (size_t i = 0; i < batch; i++) {
+            CookieCheck *check = &checks[start + i];
+            check->valid = check->valid && (hashes[i] & COOKIE_MAC_MASK) == (check->cookie & COOKIE_MAC_MASK);
+        }
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END COOKIES - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,85 @@
+/**
+ * @file keyring.c
+ * @brief Implementation of the pre-shared key table.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "keyring.h"
+#include "libs/random/random.h"
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Parses one line of a key file into `entry`.
+ * @return 1 for a key, 0 for a blank or comment line, -1 for a malformed line.
+ */
+static int parse_line(const char *line, KeyringEntry *entry) {
+    line += strspn(line, " \t");
+    if (*line == '\0' || *line == '\r' || *line == '\n' || *line == '#') {
+        return 0;
+    }
+
+    char *end;
+    unsigned long long id = strtoull(line, &end, 10);
+    if (end == line || id == 0 || id > UINT32_MAX || (*end != ' ' && *end != '\t')) {
+        return -1;
+    }
+    line = end + strspn(end, " \t");
+    if (!aead_parse_key(line, entry->key)) {
+        return -1;
+    }
+    line += 2 * AEAD_KEY_SIZE;
+    line += strspn(line, " \t\r\n");
+    entry->id = (uint32_t)id;
+    return *line == '\0' ? 1 : -1;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - KEYRING - - - - - - - - - - - - - - - - - - - - */
+
+void keyring_init(Keyring *keyring) {
+    memset(keyring, 0, sizeof(*keyring));
+    random_stream_bytes(random_thread_stream(), &keyring->nonce_counter, sizeof(keyring->nonce_counter));
+}
+
+bool keyring_load(Keyring *keyring, const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+
+    char line[KEYRING_LINE_SIZE];
+    bool valid = true;
+    while (valid && fgets(line, sizeof(line), file) != NULL) {
+        KeyringEntry entry;
+        int parsed = parse_line(line, &entry);
+        if (parsed == 0) {
+            continue;
+        }
+        valid = parsed > 0 && keyring->count < KEYRING_MAX_KEYS && keyring_find(keyring, entry.id) == NULL;
+        if (valid) {
+            keyring->entries[keyring->count++] = entry;
+        }
+    }
+    valid = valid && ferror(file) == 0;
+    fclose(file);
+    return valid;
+}
+
+const unsigned char *keyring_find(const Keyring *keyring, uint32_t id) {
+    for (unsigned int i = 0; i < keyring->count; i++) {
+        if (keyring->entries[i].id == id) {
+            return keyring->entries[i].key;
+        }
+    }
+    return NULL;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END KEYRING - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,86 @@
+/**
+ * @file keyring.h
+ * @brief Pre-shared keys encrypting the responses.
+ *
+ * A client asks for an encrypted answer by naming one of the keys it shares
+ * with the server (`REQUEST_FLAG_ENCRYPTED`). The keys are read at start-up
+ * from a file given with `-K`, one per line:
+ *
+ *     # id  key (64 hexadecimal digits)
+ *     1     000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f
+ *
+ * The keyring also hands out the nonce counters. A single counter serves every
+ * key: it starts at a random value drawn at start-up and is incremented at each
+ * answer, so a nonce is never repeated within a run, even for retransmitted
+ * requests, and a collision between runs is as unlikely as guessing 64 random bits.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef KEYRING_H_
+#define KEYRING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/aead/aead.h"
+
+/* - - - - - - - - - - - - - - - - - - - - KEYRING - - - - - - - - - - - - - - - - - - - - */
+
+#define KEYRING_MAX_KEYS 64			/**< Keys a server can hold */
+#define KEYRING_LINE_SIZE 256		/**< Longest line of a key file */
+
+/**
+ * @struct KeyringEntry
+ * @brief A key and its id.
+ */
+typedef struct {
+    uint32_t id;						/**< Id sent in the key extension, never 0 */
+    unsigned char key[AEAD_KEY_SIZE];	/**< ChaCha20-Poly1305 key */
+} KeyringEntry;
+
+/**
+ * @struct Keyring
+ * @brief The keys of the server.
+ */
+typedef struct {
+    KeyringEntry entries[KEYRING_MAX_KEYS];	/**< The keys */
+    unsigned int count;						/**< Keys in `entries` */
+    uint64_t nonce_counter;					/**< Next nonce counter */
+} Keyring;
+
+/**
+ * @brief Initialises an empty keyring with a random nonce counter.
+ * @param[out] keyring The keyring.
+ */
+void keyring_init(Keyring *keyring);
+
+/**
+ * @brief Adds the keys of a file.
+ * @param[in,out] keyring The keyring.
+ * @param[in] path The key file.
+ * @return `false` if the file cannot be read, has a malformed line, repeats an id
+ *         or holds more than `KEYRING_MAX_KEYS` keys.
+ */
+bool keyring_load(Keyring *keyring, const char *path);
+
+/**
+ * @brief Finds a key by id.
+ * @param[in] keyring The keyring.
+ * @param[in] id The id of the key.
+ * @return The key, or `NULL` if the keyring does not hold it.
+ */
+const unsigned char *keyring_find(const Keyring *keyring, uint32_t id);
+
+/**
+ * @brief Takes the nonce counter of the next encrypted answer.
+ */
+static inline uint64_t keyring_next_nonce(Keyring *keyring) {
+    return keyring->nonce_counter++;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END KEYRING - - - - - - - - - - - - - - - - - - - */
+
+#endif /* KEYRING_H_ */
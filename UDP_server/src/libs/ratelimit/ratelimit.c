@@ -0,0 +1,61 @@
+/**
+ * @file ratelimit.c
+ * @brief Implementation of the per-client budget of the random bytes.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ratelimit.h"
+#include "libs/protocol/protocol.h"
+#include "libs/random/random.h"
+
+/* - - - - - - - - - - - - - - - - - - - - RATE LIMIT - - - - - - - - - - - - - - - - - - - - */
+
+void ratelimit_init(RateLimiter *limiter, uint32_t rate) {
+    memset(limiter, 0, sizeof(*limiter));
+    limiter->rate = rate;
+    limiter->burst = rate > MAX_DATAGRAM_SIZE ? rate : MAX_DATAGRAM_SIZE;	/**< A full answer must always fit */
+    random_stream_bytes(random_thread_stream(), limiter->key, sizeof(limiter->key));
+}
+
+uint64_t ratelimit_take(RateLimiter *limiter, uint32_t address, uint64_t bytes, uint64_t now_ns) {
+    if (limiter->rate == 0) {
+        limiter->stats.bytes += bytes;
+        return 0;
+    }
+
+    RateBucket *bucket = &limiter->buckets[siphash24(limiter->key, &address, sizeof(address)) & (RATELIMIT_SLOTS - 1)];
+    if (bucket->address != address) {
+        limiter->stats.evicted += bucket->address != 0;
+        *bucket = (RateBucket){ .address = address, .tokens = limiter->burst, .refilled_ns = now_ns };
+    }
+    bucket->tokens += (double)limiter->rate * (double)(now_ns - bucket->refilled_ns) / NANOSECONDS_PER_SECOND;
+    if (bucket->tokens > limiter->burst) {
+        bucket->tokens = limiter->burst;
+    }
+    bucket->refilled_ns = now_ns;
+
+    if (bucket->tokens < (double)bytes) {
+        limiter->stats.throttled++;
+        return (uint64_t)(((double)bytes - bucket->tokens) * NANOSECONDS_PER_SECOND / limiter->rate) + 1;
+    }
+    bucket->tokens -= (double)bytes;
+    limiter->stats.bytes += bytes;
+    return 0;
+}
+
+void ratelimit_report(RateLimiter *limiter) {
+    const RateLimitStats *stats = &limiter->stats;
+    if (stats->bytes == 0 && stats->throttled == 0) {
+        return;
+    }
+    printf("Random bytes: %llu handed out, %llu answers throttled, %llu clients evicted\n",
+           (unsigned long long)stats->bytes, (unsigned long long)stats->throttled, (unsigned long long)stats->evicted);
+    memset(&limiter->stats, 0, sizeof(limiter->stats));
+}
+
+/* - - - - - - - - - - - - - - - - - - - END RATE LIMIT - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,93 @@
+/**
+ * @file ratelimit.h
+ * @brief Per-client budget of the raw random bytes (`RANDOM_BYTES_TYPE`).
+ *
+ * A request for random bytes costs the server a memcpy from its keystream
+ * buffer and nothing else, so a single client could drain the whole output
+ * of a node. With `-r` every client address gets a token bucket of bytes,
+ * refilled continuously at the given rate and holding at most one second of
+ * it (never less than a datagram): a batch taking more than its sender has
+ * left is answered `STATUS_QUOTA_EXCEEDED`, a stream waits for its bucket.
+ *
+ * The buckets live in a fixed table indexed by a keyed hash of the address,
+ * so that the memory does not grow with the number of clients and nobody can
+ * pick addresses sharing a slot. A client whose slot is taken over by another
+ * address starts again with a full bucket: the table is sized well beyond the
+ * number of clients a node expects.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef RATELIMIT_H_
+#define RATELIMIT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/clock/clock.h"
+#include "libs/siphash/siphash.h"
+
+/* - - - - - - - - - - - - - - - - - - - - RATE LIMIT - - - - - - - - - - - - - - - - - - - - */
+
+#define RATELIMIT_SLOTS 4096	/**< Buckets of the table, a power of two */
+
+/**
+ * @struct RateBucket
+ * @brief Budget of one client address.
+ */
+typedef struct {
+    uint32_t address;			/**< IPv4 address of the client, network byte order, 0 for a free slot */
+    double tokens;				/**< Bytes it can still take */
+    uint64_t refilled_ns;		/**< Last refill of `tokens` */
+} RateBucket;
+
+/**
+ * @struct RateLimitStats
+ * @brief Counters since the last report.
+ */
+typedef struct {
+    uint64_t bytes;				/**< Random bytes handed out */
+    uint64_t throttled;			/**< Batches refused and stream datagrams held back */
+    uint64_t evicted;			/**< Buckets taken over by another address */
+} RateLimitStats;
+
+/**
+ * @struct RateLimiter
+ * @brief The buckets of every client.
+ */
+typedef struct {
+    uint32_t rate;								/**< Bytes per second of one client, 0 for no limit */
+    double burst;								/**< Capacity of a bucket */
+    unsigned char key[SIPHASH_KEY_SIZE];		/**< Key of the slot hash, random */
+    RateBucket buckets[RATELIMIT_SLOTS];		/**< Buckets by slot */
+    RateLimitStats stats;						/**< Counters since the last report */
+} RateLimiter;
+
+/**
+ * @brief Initialises a limiter with empty slots.
+ * @param[out] limiter The limiter.
+ * @param[in] rate Bytes per second of one client, 0 for no limit.
+ */
+void ratelimit_init(RateLimiter *limiter, uint32_t rate);
+
+/**
+ * @brief Takes random bytes from the budget of a client.
+ * @param[in,out] limiter The limiter.
+ * @param[in] address IPv4 address of the client, network byte order.
+ * @param[in] bytes Bytes the answer carries.
+ * @param[in] now_ns Current monotonic time.
+ * @return 0 if the bytes were taken, otherwise the nanoseconds after which the bucket will hold them.
+ */
+uint64_t ratelimit_take(RateLimiter *limiter, uint32_t address, uint64_t bytes, uint64_t now_ns);
+
+/**
+ * @brief Prints the counters since the previous report, if anything happened, and resets them.
+ * @param[in,out] limiter The limiter.
+ */
+void ratelimit_report(RateLimiter *limiter);
+
+/* - - - - - - - - - - - - - - - - - - - END RATE LIMIT - - - - - - - - - - - - - - - - - - - */
+
+#endif /* RATELIMIT_H_ */
@@ -0,0 +1,298 @@
+/**
+ * @file scheduler.c
+ * @brief Implementation of the request classes and of the deficit round robin.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "scheduler.h"
+#include "libs/codec/codec.h"
+#include "libs/clock/clock.h"
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+static void queue_push(RequestQueue *queue, PendingRequest *request) {
+    request->next = NULL;
+    if (queue->tail == NULL) {
+        queue->head = request;
+    } else {
+        queue->tail->next = request;
+    }
+    queue->tail = request;
+    queue->length++;
+}
+
+static PendingRequest *queue_pop(RequestQueue *queue) {
+    PendingRequest *request = queue->head;
+    if (request != NULL) {
+        queue->head = request->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+        queue->length--;
+    }
+    return request;
+}
+
+static void release_slot(Scheduler *scheduler, PendingRequest *request) {
+    request->next = scheduler->free_list;
+    scheduler->free_list = request;
+}
+
+/**
+ * @brief Bulk queue of a client.
+ * @details A multiplicative hash of the address and port: clients that collide share
+ * a queue, and therefore a share, as in stochastic fair queuing.
+ */
+static unsigned int flow_of(const struct sockaddr_in *client) {
+    uint32_t key = (uint32_t)client->sin_addr.s_addr * 0x9E3779B1u ^ (uint32_t)client->sin_port * 0x85EBCA6Bu;
+    return (key * 0xC2B2AE35u) >> 26;	/**< The 6 high bits: `SCHEDULER_FLOWS` queues */
+}
+
+static bool is_interactive_source(const Scheduler *scheduler, const struct sockaddr_in *client) {
+    for (unsigned int i = 0; i < scheduler->rule_count; i++) {
+        if ((client->sin_addr.s_addr & scheduler->rules[i].mask) == scheduler->rules[i].network) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Chooses the class of a request and the response bytes it will cost, and sets its deadline.
+ * @details Malformed requests and stream control messages are answered with a header at
+ * most and are cheap to serve early; credits in particular keep the streams flowing.
+ */
+static TrafficClass classify(const Scheduler *scheduler, PendingRequest *request, uint32_t *cost) {
+    RequestView view;
+
+    *cost = RESPONSE_HEADER_SIZE;
+    if (codec_decode_request(request->data, request->size, &view) != CODEC_OK) {
+        return CLASS_INTERACTIVE;
+    }
+    if (view.deadline_us != 0) {
+        request->deadline_ns = request->received_ns + view.deadline_us * NANOSECONDS_PER_MICROSECOND;
+    }
+    if (view.operation == OP_GENERATE) {
+        uint32_t bytes = (uint32_t)view.count * view.length;
+        *cost = bytes < MAX_DATAGRAM_SIZE - RESPONSE_HEADER_SIZE ? bytes + RESPONSE_HEADER_SIZE : MAX_DATAGRAM_SIZE;
+    }
+
+    switch (view.flags & REQUEST_FLAG_PRIORITY) {
+        case PRIORITY_INTERACTIVE:
+            return CLASS_INTERACTIVE;
+        case PRIORITY_BULK:
+            return CLASS_BULK;
+        default:
+            break;
+    }
+    if (is_interactive_source(scheduler, &request->client)) {
+        return CLASS_INTERACTIVE;
+    }
+    return *cost <= SCHEDULER_INTERACTIVE_BYTES + RESPONSE_HEADER_SIZE ? CLASS_INTERACTIVE : CLASS_BULK;
+}
+
+/**
+ * @brief Histogram bucket of a latency: exact below 4 µs, then 4 buckets per power of two.
+ */
+static unsigned int latency_bucket(uint64_t microseconds) {
+    if (microseconds < 4) {
+        return (unsigned int)microseconds;
+    }
+    unsigned int exponent = 63 - (unsigned int)__builtin_clzll(microseconds);
+    unsigned int bucket = 4 * (exponent - 1) + (unsigned int)((microseconds >> (exponent - 2)) & 3);
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/**
+ * @brief Largest latency, in microseconds, that falls in a bucket.
+ */
+static uint64_t latency_bucket_limit(unsigned int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    unsigned int exponent = bucket / 4 + 1;
+    return ((uint64_t)(4 + bucket % 4 + 1) << (exponent - 2)) - 1;
+}
+
+static uint64_t latency_percentile(const LatencyHistogram *histogram, uint64_t rank) {
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += histogram->buckets[i];
+        if (seen >= rank) {
+            return latency_bucket_limit(i);
+        }
+    }
+    return histogram->max_ns / NANOSECONDS_PER_MICROSECOND;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - SCHEDULER - - - - - - - - - - - - - - - - - - - - */
+
+bool scheduler_init(Scheduler *scheduler) {
+    memset(scheduler, 0, sizeof(*scheduler));
+    scheduler->slots = malloc(SCHEDULER_SLOTS * sizeof(*scheduler->slots));
+    if (scheduler->slots == NULL) {
+        return false;
+    }
+    for (unsigned int i = 0; i < SCHEDULER_SLOTS; i++) {
+        release_slot(scheduler, &scheduler->slots[SCHEDULER_SLOTS - 1 - i]);
+    }
+    return true;
+}
+
+void scheduler_destroy(Scheduler *scheduler) {
+    free(scheduler->slots);
+    scheduler->slots = scheduler->free_list = NULL;
+}
+
+bool scheduler_add_source_rule(Scheduler *scheduler, const char *source) {
+    char address[16];
+    const char *slash = strchr(source, '/');
+    size_t address_length = slash != NULL ? (size_t)(slash - source) : strlen(source);
+    int bits = 32;
+
+    if (scheduler->rule_count == SCHEDULER_MAX_SOURCE_RULES || address_length == 0 || address_length >= sizeof(address)) {
+        return false;
+    }
+    if (slash != NULL) {
+        char *end;
+        long parsed = strtol(slash + 1, &end, 10);
+        if (end == slash + 1 || *end != '\0' || parsed < 0 || parsed > 32) {
+            return false;
+        }
+        bits = (int)parsed;
+    }
+    memcpy(address, source, address_length);
+    address[address_length] = '\0';
+
+    uint32_t network = inet_addr(address);
+    if (network == INADDR_NONE && strcmp(address, "255.255.255.255") != 0) {
+        return false;
+    }
+    uint32_t mask = bits == 0 ? 0 : htonl(UINT32_MAX << (32 - bits));
+    scheduler->rules[scheduler->rule_count++] = (SourceRule){ .network = network & mask, .mask = mask };
+    return true;
+}
+
+PendingRequest *scheduler_acquire(Scheduler *scheduler) {
+    PendingRequest *request = scheduler->free_list;
+    if (request != NULL) {
+        scheduler->free_list = request->next;
+    }
+    return request;
+}
+
+void scheduler_release(Scheduler *scheduler, PendingRequest *request) {
+    release_slot(scheduler, request);
+}
+
+bool scheduler_enqueue(Scheduler *scheduler, PendingRequest *request, size_t size, uint64_t now_ns) {
+    request->size = size;
+    request->received_ns = now_ns;
+    request->deadline_ns = 0;
+    request->traffic_class = classify(scheduler, request, &request->cost);
+
+    if (request->traffic_class == CLASS_INTERACTIVE) {
+        queue_push(&scheduler->interactive, request);
+        scheduler->pending++;
+        return true;
+    }
+
+    request->flow = flow_of(&request->client);
+    BulkFlow *flow = &scheduler->flows[request->flow];
+    if (scheduler->bulk_pending == SCHEDULER_BULK_SLOTS || flow->queue.length == SCHEDULER_FLOW_SLOTS) {
+        scheduler->latency[CLASS_BULK].rejected++;
+        release_slot(scheduler, request);
+        return false;
+    }
+
+    if (flow->queue.length == 0) {
+        /* A queue becoming active joins the end of the round with no credit left over */
+        flow->deficit = 0;
+        scheduler->active[(scheduler->active_head + scheduler->active_count) % SCHEDULER_FLOWS] = request->flow;
+        scheduler->active_count++;
+    }
+    queue_push(&flow->queue, request);
+    scheduler->bulk_pending++;
+    scheduler->pending++;
+    return true;
+}
+
+void scheduler_reject(Scheduler *scheduler) {
+    scheduler->latency[CLASS_INTERACTIVE].rejected++;	/**< Bulk requests can never exhaust the slots */
+}
+
+PendingRequest *scheduler_next(Scheduler *scheduler) {
+    PendingRequest *request = queue_pop(&scheduler->interactive);
+    if (request != NULL) {
+        scheduler->pending--;
+        return request;
+    }
+
+    /* The quantum covers the largest response, so at most one extra turn of the ring is needed */
+    while (scheduler->active_count > 0) {
+        unsigned int index = scheduler->active[scheduler->active_head];
+        BulkFlow *flow = &scheduler->flows[index];
+
+        if (flow->deficit >= flow->queue.head->cost) {
+            request = queue_pop(&flow->queue);
+            flow->deficit -= request->cost;
+            if (flow->queue.length == 0) {
+                scheduler->active_head = (scheduler->active_head + 1) % SCHEDULER_FLOWS;
+                scheduler->active_count--;
+            }
+            scheduler->bulk_pending--;
+            scheduler->pending--;
+            return request;
+        }
+
+        /* Out of credit: next round, the queue moves to the end of the ring */
+        flow->deficit += SCHEDULER_QUANTUM;
+        scheduler->active[(scheduler->active_head + scheduler->active_count) % SCHEDULER_FLOWS] = index;
+        scheduler->active_head = (scheduler->active_head + 1) % SCHEDULER_FLOWS;
+    }
+    return NULL;
+}
+
+void scheduler_complete(Scheduler *scheduler, PendingRequest *request, uint64_t now_ns) {
+    LatencyHistogram *histogram = &scheduler->latency[request->traffic_class];
+    uint64_t latency_ns = now_ns - request->received_ns;
+
+    histogram->buckets[latency_bucket(latency_ns / NANOSECONDS_PER_MICROSECOND)]++;
+    histogram->count++;
+    if (latency_ns > histogram->max_ns) {
+        histogram->max_ns = latency_ns;
+    }
+    release_slot(scheduler, request);
+}
+
+void scheduler_expire(Scheduler *scheduler, PendingRequest *request) {
+    scheduler->latency[request->traffic_class].expired++;
+    release_slot(scheduler, request);
+}
+
+void scheduler_take_summary(Scheduler *scheduler, TrafficClass traffic_class, LatencySummary *summary) {
+    LatencyHistogram *histogram = &scheduler->latency[traffic_class];
+
+    summary->count = histogram->count;
+    summary->rejected = histogram->rejected;
+    summary->expired = histogram->expired;
+    summary->p50_us = histogram->count > 0 ? latency_percentile(histogram, (histogram->count + 1) / 2) : 0;
+    summary->p99_us = histogram->count > 0 ? latency_percentile(histogram, (histogram->count * 99 + 99) / 100) : 0;
+    summary->max_us = histogram->max_ns / NANOSECONDS_PER_MICROSECOND;
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+/* - - - - - - - - - - - - - - - - - - - END SCHEDULER - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,253 @@
+/**
+ * @file scheduler.h
+ * @brief Priority classes and fair queuing of the datagram requests.
+ *
+ * A bulk job can send requests faster than the server answers them; served in
+ * arrival order, a single-password request from a user would then wait behind
+ * the whole backlog. Requests are therefore received into a pool of slots and
+ * queued by class before being served:
+ *
+ * - the class is the one asked for in the request flags (`REQUEST_FLAG_PRIORITY`);
+ *   with `PRIORITY_AUTO` a request from an interactive source (`-i`) is
+ *   interactive, otherwise the class follows the size of the response;
+ * - interactive requests have strict priority and are served in arrival order;
+ * - bulk requests are queued per client (address and port) and the clients are
+ *   served by deficit round robin, so each one gets the same share of response
+ *   bytes whatever the rate and the size of its requests.
+ *
+ * Bulk requests may only take part of the slots: when they are used up, or when
+ * a single client already has `SCHEDULER_FLOW_SLOTS` requests waiting, the new
+ * request is rejected at once instead of growing the queue. A request that
+ * carries a deadline is given up, rather than served late, once the deadline
+ * has passed. The time from reception to answer is recorded per class in a
+ * log-bucketed histogram.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/protocol/protocol.h"
+
+/* - - - - - - - - - - - - - - - - - - - - SCHEDULER - - - - - - - - - - - - - - - - - - - - */
+
+#define SCHEDULER_SLOTS 1024							/**< Requests waiting at the same time */
+#define SCHEDULER_BULK_SLOTS (SCHEDULER_SLOTS * 3 / 4)	/**< Slots bulk requests may take, the rest is kept for interactive ones */
+#define SCHEDULER_FLOWS 64								/**< Bulk queues; clients hashing to the same queue share it */
+#define SCHEDULER_FLOW_SLOTS 128						/**< Requests one bulk queue may hold */
+#define SCHEDULER_QUANTUM MAX_DATAGRAM_SIZE				/**< Response bytes a bulk queue may send per round */
+#define SCHEDULER_INTERACTIVE_BYTES (4 * MAX_PASSWORD_LENGTH)	/**< Unclassified requests up to this many password bytes are interactive */
+#define SCHEDULER_MAX_SOURCE_RULES 8					/**< Interactive source networks (-i) */
+#define LATENCY_BUCKETS 96								/**< Histogram buckets: 4 per power of two, up to 16 s */
+
+/**
+ * @enum TrafficClass
+ * @brief Scheduling class of a request.
+ */
+typedef enum {
+    CLASS_INTERACTIVE,		/**< Strict priority, arrival order */
+    CLASS_BULK,				/**< Deficit round robin between clients */
+    CLASS_COUNT
+} TrafficClass;
+
+/**
+ * @struct PendingRequest
+ * @brief A received datagram waiting to be served.
+ */
+typedef struct PendingRequest {
+    unsigned char data[MAX_DATAGRAM_SIZE];	/**< The datagram, decoded in place when it is served */
+    size_t size;							/**< Bytes received */
+    struct sockaddr_in client;				/**< Sender */
+    uint64_t received_ns;					/**< Reception time */
+    uint64_t deadline_ns;					/**< Time the client stops waiting, 0 for none */
+    uint32_t cost;							/**< Response bytes, charged to the deficit of its queue */
+    TrafficClass traffic_class;				/**< Queue it waits in */
+    unsigned int flow;						/**< Bulk queue index */
+    struct PendingRequest *next;			/**< Next request of the same queue, or of the free list */
+} PendingRequest;
+
+/**
+ * @struct RequestQueue
+ * @brief FIFO of pending requests.
+ */
+typedef struct {
+    PendingRequest *head;		/**< Next request to serve */
+    PendingRequest *tail;		/**< Last request received */
+    unsigned int length;		/**< Requests queued */
+} RequestQueue;
+
+/**
+ * @struct BulkFlow
+ * @brief Bulk queue of one client (or of the few clients hashing to it).
+ */
+typedef struct {
+    RequestQueue queue;			/**< Waiting requests */
+    uint32_t deficit;			/**< Response bytes the queue may still send this round */
+} BulkFlow;
+
+/**
+ * @struct LatencyHistogram
+ * @brief Reception-to-answer times of one class.
+ */
+typedef struct {
+    uint64_t buckets[LATENCY_BUCKETS];	/**< Requests per latency bucket */
+    uint64_t count;						/**< Requests answered */
+    uint64_t rejected;					/**< Requests refused because the class was full */
+    uint64_t expired;					/**< Requests given up because their deadline passed */
+    uint64_t max_ns;					/**< Longest latency */
+} LatencyHistogram;
+
+/**
+ * @struct LatencySummary
+ * @brief Percentiles of a histogram, in microseconds.
+ */
+typedef struct {
+    uint64_t count;			/**< Requests answered */
+    uint64_t rejected;		/**< Requests refused */
+    uint64_t expired;		/**< Requests given up after their deadline */
+    uint64_t p50_us;		/**< Median */
+    uint64_t p99_us;		/**< 99th percentile */
+    uint64_t max_us;		/**< Maximum */
+} LatencySummary;
+
+/**
+ * @struct SourceRule
+ * @brief A network whose requests are interactive (network byte order).
+ */
+typedef struct {
+    uint32_t network;		/**< Network address */
+    uint32_t mask;			/**< Network mask */
+} SourceRule;
+
+/**
+ * @struct Scheduler
+ * @brief The request slots, the queues and their metrics.
+ */
+typedef struct {
+    PendingRequest *slots;					/**< `SCHEDULER_SLOTS` request slots */
+    PendingRequest *free_list;				/**< Unused slots */
+    unsigned int pending;					/**< Requests queued in every class */
+    RequestQueue interactive;				/**< Interactive requests */
+    BulkFlow flows[SCHEDULER_FLOWS];		/**< Bulk queues */
+    unsigned int active[SCHEDULER_FLOWS];	/**< Ring of the non-empty bulk queues, in service order */
+    unsigned int active_head;				/**< First queue of the ring */
+    unsigned int active_count;				/**< Queues in the ring */
+    unsigned int bulk_pending;				/**< Requests in the bulk queues */
+    SourceRule rules[SCHEDULER_MAX_SOURCE_RULES];	/**< Interactive sources */
+    unsigned int rule_count;				/**< Rules in use */
+    LatencyHistogram latency[CLASS_COUNT];	/**< Metrics since the last summary */
+} Scheduler;
+
+/**
+ * @brief Allocates the request slots of an empty scheduler.
+ * @param[out] scheduler The scheduler to initialise.
+ * @return `true` on success, `false` if the memory could not be allocated.
+ */
+bool scheduler_init(Scheduler *scheduler);
+
+/**
+ * @brief Releases the request slots.
+ * @param[in,out] scheduler The scheduler.
+ */
+void scheduler_destroy(Scheduler *scheduler);
+
+/**
+ * @brief Makes the requests of a network interactive.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in] source `a.b.c.d` or `a.b.c.d/bits`.
+ * @return `false` if the network is malformed or the rule table is full.
+ */
+bool scheduler_add_source_rule(Scheduler *scheduler, const char *source);
+
+/**
+ * @brief Takes a free slot to receive a datagram into.
+ * @param[in,out] scheduler The scheduler.
+ * @return The slot, or `NULL` if every slot is in use.
+ */
+PendingRequest *scheduler_acquire(Scheduler *scheduler);
+
+/**
+ * @brief Returns a slot that received nothing to the free list.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in] request A slot returned by `scheduler_acquire`.
+ */
+void scheduler_release(Scheduler *scheduler, PendingRequest *request);
+
+/**
+ * @brief Classifies a received request and queues it.
+ * @details `data` and `client` must have been filled in; on failure the slot is
+ * returned to the free list and the caller should refuse the request.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in,out] request A slot returned by `scheduler_acquire`.
+ * @param[in] size Bytes received.
+ * @param[in] now_ns Reception time.
+ * @return `false` if the class of the request has no room left.
+ */
+bool scheduler_enqueue(Scheduler *scheduler, PendingRequest *request, size_t size, uint64_t now_ns);
+
+/**
+ * @brief Counts a request refused before it could be queued (no free slot).
+ * @param[in,out] scheduler The scheduler.
+ */
+void scheduler_reject(Scheduler *scheduler);
+
+/**
+ * @brief Dequeues the next request to serve.
+ * @param[in,out] scheduler The scheduler.
+ * @return The request, or `NULL` if nothing is waiting.
+ */
+PendingRequest *scheduler_next(Scheduler *scheduler);
+
+/**
+ * @brief Records the latency of a served request and frees its slot.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in] request A request returned by `scheduler_next`.
+ * @param[in] now_ns Time the answer was sent.
+ */
+void scheduler_complete(Scheduler *scheduler, PendingRequest *request, uint64_t now_ns);
+
+/**
+ * @brief Counts a request given up because its deadline passed and frees its slot.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in] request A request returned by `scheduler_next`.
+ */
+void scheduler_expire(Scheduler *scheduler, PendingRequest *request);
+
+/**
+ * @brief Tells whether the deadline of a request has passed.
+ */
+static inline bool scheduler_is_expired(const PendingRequest *request, uint64_t now_ns) {
+    return request->deadline_ns != 0 && now_ns >= request->deadline_ns;
+}
+
+/**
+ * @brief Tells whether requests are waiting to be served.
+ */
+static inline bool scheduler_has_pending(const Scheduler *scheduler) {
+    return scheduler->pending > 0;
+}
+
+/**
+ * @brief Summarises the latency of a class and starts a new measurement period.
+ * @param[in,out] scheduler The scheduler.
+ * @param[in] traffic_class The class.
+ * @param[out] summary Counts and percentiles since the previous call.
+ */
+void scheduler_take_summary(Scheduler *scheduler, TrafficClass traffic_class, LatencySummary *summary);
+
+/* - - - - - - - - - - - - - - - - - - - END SCHEDULER - - - - - - - - - - - - - - - - - - - */
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,289 @@
+/**
+ * @file stream.c
+ * @brief Implementation of the server-push password streams.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#include <errno.h>
+#endif
+
+#include <string.h>
+
+#include "stream.h"
+#include "libs/clock/clock.h"
+
+#define STREAM_IDLE_TIMEOUT_NS (STREAM_IDLE_TIMEOUT_MS * NANOSECONDS_PER_MILLISECOND)
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Checks whether a stream belongs to `client` and `tenant_id` and has id `stream_id`.
+ */
+static bool stream_matches(const Stream *stream, const struct sockaddr_in *client, uint32_t tenant_id,
+                           uint32_t stream_id) {
+    return stream->active
+        && stream->subscription.request_id == stream_id
+        && stream->subscription.tenant_id == tenant_id
+        && stream->client.sin_addr.s_addr == client->sin_addr.s_addr
+        && stream->client.sin_port == client->sin_port;
+}
+
+/**
+ * @brief Finds the open stream `stream_id` of `client` and `tenant_id`.
+ * @return The stream, or `NULL` if it is not open.
+ */
+static Stream *find_stream(StreamTable *table, const struct sockaddr_in *client, uint32_t tenant_id,
+                           uint32_t stream_id) {
+    for (unsigned int i = 0; i < MAX_STREAMS; i++) {
+        if (stream_matches(&table->streams[i], client, tenant_id, stream_id)) {
+            return &table->streams[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Counts the open streams of a tenant.
+ */
+static unsigned int tenant_streams(const StreamTable *table, const Tenant *tenant) {
+    unsigned int count = 0;
+    for (unsigned int i = 0; i < MAX_STREAMS; i++) {
+        count += table->streams[i].active && table->streams[i].tenant == tenant;
+    }
+    return count;
+}
+
+/**
+ * @brief Tells the client that the stream is over and frees its slot.
+ */
+static void close_stream(StreamTable *table, Stream *stream, int server_socket) {
+    unsigned char buffer[STREAM_HEADER_SIZE];
+    size_t size = codec_encode_stream(buffer, sizeof(buffer), &stream->subscription, STATUS_STREAM_END, 0,
+                                      stream->sequence);
+    sendto(server_socket, (const char *)buffer, size, 0, (const struct sockaddr *)&stream->client,
+           sizeof(stream->client));	/**< Best effort: the stream is closed even if this is lost */
+    stream->active = false;
+    table->active_count--;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - STREAMS - - - - - - - - - - - - - - - - - - - - */
+
+void stream_table_init(StreamTable *table, PassgenEngine *engine) {
+    memset(table, 0, sizeof(*table));
+    table->engine = engine;
+}
+
+ResponseStatus stream_handle_request(StreamTable *table, int server_socket, const RequestView *request,
+                                     Tenant *tenant, const struct sockaddr_in *client, uint64_t now_ns) {
+    Stream *stream = find_stream(table, client, request->tenant_id, request->request_id);
+
+    switch (request->operation) {
+        case OP_SUBSCRIBE: {
+            SubscribeOptions options;
+            codec_subscribe_options(request, &options);
+            PassgenEngine *engine = tenant != NULL && tenant->engine != NULL ? tenant->engine : table->engine;
+            if (passgen_validate(passgen_engine_context(engine), request->type, request->length) != PASSGEN_OK) {
+                return STATUS_BAD_REQUEST;
+            }
+
+            if (stream == NULL) {
+                if (tenant != NULL && tenant_streams(table, tenant) >= tenant->max_streams) {
+                    tenant->metrics.throttled++;
+                    return STATUS_QUOTA_EXCEEDED;
+                }
+                for (unsigned int i = 0; i < MAX_STREAMS && stream == NULL; i++) {
+                    if (!table->streams[i].active) {
+                        stream = &table->streams[i];
+                    }
+                }
+                if (stream == NULL) {
+                    return STATUS_UNAVAILABLE;
+                }
+                memset(stream, 0, sizeof(*stream));
+                stream->active = true;
+                stream->client = *client;
+                stream->next_send_ns = now_ns;
+                table->active_count++;
+            }
+
+            uint16_t max_count = (uint16_t)MAX_STREAM_COUNT(request->length);
+            stream->tenant = tenant;
+            stream->engine = engine;
+            stream->subscription = *request;
+            stream->subscription.raw = stream->subscription.body = NULL;
+            stream->subscription.raw_size = stream->subscription.body_size = 0;
+            stream->subscription.count = request->count < max_count ? request->count : max_count;
+            stream->credits = options.credits;
+            stream->interval_ns = options.rate == 0 ? 0
+                : stream->subscription.count * NANOSECONDS_PER_SECOND / options.rate;
+            stream->last_activity_ns = now_ns;
+            return STATUS_OK;
+        }
+
+        case OP_CREDIT:
+            if (stream == NULL) {
+                return STATUS_BAD_REQUEST;
+            }
+            uint32_t credits = codec_credit_amount(request);
+            stream->credits = (stream->credits > UINT32_MAX - credits) ? UINT32_MAX : stream->credits + credits;
+            stream->last_activity_ns = now_ns;
+            return STATUS_OK;
+
+        case OP_UNSUBSCRIBE:
+            if (stream == NULL) {
+                return STATUS_BAD_REQUEST;
+            }
+            close_stream(table, stream, server_socket);
+            return STATUS_OK;
+
+        default:
+            return STATUS_BAD_REQUEST;
+    }
+}
+
+/**
+ * @brief Charges, generates and records the next datagram of a stream into `stream->pending`.
+ * @details The datagram is kept until the socket accepts it, so that a full send buffer
+ * never charges the budgets, nor writes the audit log, twice for the same passwords.
+ * @return `false` if the stream is held back by a budget or was closed.
+ */
+static bool prepare_datagram(StreamTable *table, Stream *stream, int server_socket, uint64_t now_ns) {
+    const RequestView *subscription = &stream->subscription;
+
+    if (table->limiter != NULL && codec_is_random_bytes(subscription->type)) {
+        uint64_t wait_ns = ratelimit_take(table->limiter, stream->client.sin_addr.s_addr,
+                                          (uint64_t)subscription->count * subscription->length, now_ns);
+        if (wait_ns != 0) {
+            stream->next_send_ns = now_ns + wait_ns;
+            return false;
+        }
+    }
+    if (stream->tenant != NULL) {
+        uint64_t wait_ns = tenant_take(stream->tenant, subscription->count, now_ns);
+        if (wait_ns != 0) {
+            stream->next_send_ns = now_ns + wait_ns;
+            return false;
+        }
+    }
+    size_t size = codec_encode_stream(stream->pending, sizeof(stream->pending), subscription, STATUS_STREAM_DATA,
+                                      subscription->count, stream->sequence);
+    char *passwords = codec_stream_password(stream->pending, subscription->length, 0);
+    if (passgen_generate_batch(stream->engine, subscription->type, subscription->length, subscription->count,
+                               passwords) != PASSGEN_OK) {
+        close_stream(table, stream, server_socket);	/**< The policy cannot be met any more */
+        return false;
+    }
+#if defined PASSGEN_AUDIT
+    if (table->audit != NULL
+        && !audit_issue(table->audit, &stream->client, subscription->tenant_id, subscription->request_id,
+                        subscription->type, subscription->length, passwords, subscription->length,
+                        subscription->count)) {
+        close_stream(table, stream, server_socket);	/**< Nothing is handed out unrecorded */
+        return false;
+    }
+#endif
+    stream->pending_size = size;
+    return true;
+}
+
+bool stream_service(StreamTable *table, int server_socket, uint64_t now_ns) {
+    for (unsigned int i = 0; i < MAX_STREAMS && table->active_count > 0; i++) {
+        Stream *stream = &table->streams[i];
+        if (!stream->active) {
+            continue;
+        }
+        if (now_ns - stream->last_activity_ns > STREAM_IDLE_TIMEOUT_NS) {
+            close_stream(table, stream, server_socket);
+            table->streams_expired++;
+            continue;
+        }
+
+        /* Without a rate `next_send_ns` stays in the past, unless a budget holds the stream back */
+        for (int burst = 0; burst < STREAM_MAX_BURST && stream->credits > 0 && stream->next_send_ns <= now_ns; burst++) {
+            if (stream->pending_size == 0 && !prepare_datagram(table, stream, server_socket, now_ns)) {
+                break;
+            }
+            if (sendto(server_socket, (const char *)stream->pending, stream->pending_size, 0,
+                       (const struct sockaddr *)&stream->client, sizeof(stream->client)) < 0) {
+#if defined WIN32
+                if (WSAGetLastError() == WSAEWOULDBLOCK) {
+#else
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+#endif
+                    return true;	/**< The pending datagram is sent when the socket is writable again */
+                }
+                /* Unreachable client: drop the stream without notification */
+                stream->active = false;
+                table->active_count--;
+                break;
+            }
+
+            stream->pending_size = 0;
+            stream->credits--;
+            stream->sequence++;
+            stream->next_send_ns += stream->interval_ns;
+            table->datagrams_sent++;
+            if (stream->tenant != NULL) {
+                stream->tenant->metrics.passwords += stream->subscription.count;
+            }
+        }
+
+        /* A stream that fell far behind its schedule must not send a huge catch-up burst */
+        if (stream->next_send_ns + stream->interval_ns * STREAM_MAX_BURST < now_ns) {
+            stream->next_send_ns = now_ns;
+        }
+    }
+    return false;
+}
+
+int stream_poll_timeout(const StreamTable *table, uint64_t now_ns) {
+    if (table->active_count == 0) {
+        return -1;
+    }
+
+    uint64_t next_ns = UINT64_MAX;
+    for (unsigned int i = 0; i < MAX_STREAMS; i++) {
+        const Stream *stream = &table->streams[i];
+        if (!stream->active) {
+            continue;
+        }
+        uint64_t expiry_ns = stream->last_activity_ns + STREAM_IDLE_TIMEOUT_NS + 1;
+        if (expiry_ns < next_ns) {
+            next_ns = expiry_ns;
+        }
+        if (stream->credits > 0 && stream->next_send_ns < next_ns) {
+            next_ns = stream->next_send_ns;
+        }
+    }
+
+    if (next_ns <= now_ns) {
+        return 0;
+    }
+    /* Round up so that the loop does not wake up just before the deadline */
+    return (int)((next_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+}
+
+void stream_rebind_tenants(StreamTable *table, int server_socket) {
+    for (unsigned int i = 0; i < MAX_STREAMS && table->active_count > 0; i++) {
+        Stream *stream = &table->streams[i];
+        if (!stream->active || stream->tenant == NULL) {
+            continue;
+        }
+        stream->tenant = tenant_find(table->tenants, stream->subscription.tenant_id);
+        if (stream->tenant == NULL || stream->tenant->max_streams == 0) {
+            close_stream(table, stream, server_socket);
+            continue;
+        }
+        stream->engine = stream->tenant->engine != NULL ? stream->tenant->engine : table->engine;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END STREAMS - - - - - - - - - - - - - - - - - - - */
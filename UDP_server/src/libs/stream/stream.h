@@ -0,0 +1,136 @@
+/**
+ * @file stream.h
+ * @brief Server-push password streams with credit-based flow control.
+ *
+ * A client opens a stream with an `OP_SUBSCRIBE` request. From then on the
+ * server pushes datagrams packed with passwords of the requested type and
+ * length, each one consuming one credit, at the rate chosen by the client.
+ * The client keeps the stream alive by granting more credits (`OP_CREDIT`);
+ * a stream without credit activity for `STREAM_IDLE_TIMEOUT_MS` is closed.
+ * Every datagram carries a sequence number so that losses can be detected
+ * (the client side, `libs/subscription`, counts them).
+ * A stream of random bytes is also held back whenever its client has used up
+ * its budget of bytes (see `libs/ratelimit`). The stream of a tenant is
+ * generated by the tenant's engine, held back whenever the tenant has used up
+ * its quota, and counted against the tenant's streams (see `libs/tenant`).
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef STREAM_H_
+#define STREAM_H_
+
+#if defined WIN32
+#include <winsock2.h>
+#else
+#include <netinet/in.h>
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/codec/codec.h"
+#include "libs/engine/engine.h"
+#include "libs/ratelimit/ratelimit.h"
+#include "libs/tenant/tenant.h"
+#if defined PASSGEN_AUDIT
+#include "libs/audit/audit.h"
+#endif
+
+/* - - - - - - - - - - - - - - - - - - - - STREAMS - - - - - - - - - - - - - - - - - - - - */
+
+#define MAX_STREAMS 64				/**< Maximum number of streams open at the same time */
+#define STREAM_MAX_BURST 32			/**< Datagrams sent to one stream before serving the others */
+
+/**
+ * @struct Stream
+ * @brief State of one open stream.
+ */
+typedef struct {
+    bool active;						/**< `true` while the stream is open */
+    struct sockaddr_in client;			/**< Address the datagrams are pushed to */
+    RequestView subscription;			/**< Subscribe request (type, length, count, stream id, tenant id) */
+    Tenant *tenant;						/**< Tenant charged for the datagrams, `NULL` without tenants */
+    PassgenEngine *engine;				/**< Engine generating the passwords: the table's, or the tenant's */
+    uint32_t credits;					/**< Datagrams that can still be sent */
+    uint32_t sequence;					/**< Sequence number of the next datagram */
+    uint64_t interval_ns;				/**< Time between two datagrams (0: as fast as possible) */
+    uint64_t next_send_ns;				/**< Earliest time the next datagram may be sent */
+    uint64_t last_activity_ns;			/**< Last subscribe or credit message */
+    size_t pending_size;				/**< Size of `pending`, 0 when no datagram waits for the socket */
+    unsigned char pending[MAX_DATAGRAM_SIZE];	/**< Datagram charged and recorded but not sent yet (full send buffer) */
+} Stream;
+
+/**
+ * @struct StreamTable
+ * @brief All the streams served by one server socket.
+ */
+typedef struct {
+    Stream streams[MAX_STREAMS];		/**< Stream slots */
+    PassgenEngine *engine;				/**< Engine generating the passwords of every stream */
+    RateLimiter *limiter;				/**< Budget of the random bytes of each client, `NULL` for none */
+    TenantTable *tenants;				/**< Tenants of the streams, `NULL` without tenants */
+#if defined PASSGEN_AUDIT
+    AuditLog *audit;					/**< Log of the issued passwords, `NULL` for none */
+#endif
+    unsigned int active_count;			/**< Number of open streams */
+    uint64_t datagrams_sent;			/**< Stream datagrams sent since start */
+    uint64_t streams_expired;			/**< Streams closed by the idle timeout */
+} StreamTable;
+
+/**
+ * @brief Initialises an empty stream table.
+ * @param[out] table The table to initialise.
+ * @param[in] engine Engine generating the passwords, used by the calling thread only.
+ */
+void stream_table_init(StreamTable *table, PassgenEngine *engine);
+
+/**
+ * @brief Handles a stream operation (`OP_SUBSCRIBE`, `OP_CREDIT` or `OP_UNSUBSCRIBE`).
+ *
+ * Re-subscribing with the id of an open stream updates its parameters and credits.
+ * A tenant cannot open more than `max_streams` streams at the same time.
+ *
+ * @param[in,out] table The stream table.
+ * @param[in] server_socket Socket used to notify the client when a stream is closed.
+ * @param[in] request The decoded stream request.
+ * @param[in,out] tenant The tenant of the request, admitted by `tenant_admit`, `NULL` without tenants.
+ * @param[in] client Address of the client that sent the request.
+ * @param[in] now_ns Current monotonic time.
+ * @return `STATUS_OK`, or the error to report to the client.
+ */
+ResponseStatus stream_handle_request(StreamTable *table, int server_socket, const RequestView *request,
+                                     Tenant *tenant, const struct sockaddr_in *client, uint64_t now_ns);
+
+/**
+ * @brief Binds the streams again to the tenants after the tenant file was reloaded.
+ *
+ * The streams of a tenant that is gone, or may no longer open streams, are closed.
+ *
+ * @param[in,out] table The stream table, whose `tenants` were just reloaded.
+ * @param[in] server_socket Socket used to notify the clients of the closed streams.
+ */
+void stream_rebind_tenants(StreamTable *table, int server_socket);
+
+/**
+ * @brief Sends the datagrams that are due and closes idle streams.
+ * @param[in,out] table The stream table.
+ * @param[in] server_socket The server socket.
+ * @param[in] now_ns Current monotonic time.
+ * @return `true` if the socket send buffer is full and the loop should wait for it to drain.
+ */
+bool stream_service(StreamTable *table, int server_socket, uint64_t now_ns);
+
+/**
+ * @brief Computes how long the event loop may sleep before `stream_service` has work to do.
+ * @param[in] table The stream table.
+ * @param[in] now_ns Current monotonic time.
+ * @return Milliseconds to wait, or -1 if no stream is open.
+ */
+int stream_poll_timeout(const StreamTable *table, uint64_t now_ns);
+
+/* - - - - - - - - - - - - - - - - - - - END STREAMS - - - - - - - - - - - - - - - - - - - */
+
+#endif /* STREAM_H_ */
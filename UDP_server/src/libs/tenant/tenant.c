@@ -0,0 +1,475 @@
+/**
+ * @file tenant.c
+ * @brief Implementation of the tenant table.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "tenant.h"
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Slot where the search for a tenant starts: the high bits of a multiplicative hash.
+ */
+static inline unsigned int tenant_slot(uint32_t id) {
+    return (unsigned int)((id * 2654435761u) >> 16) & (TENANT_SLOTS - 1);
+}
+
+/**
+ * @brief Finds a tenant of `tenants` by id through the hash table `slots`.
+ */
+static Tenant *find_tenant(Tenant *tenants, const uint16_t *slots, uint32_t id) {
+    for (unsigned int slot = tenant_slot(id); slots[slot] != 0; slot = (slot + 1) & (TENANT_SLOTS - 1)) {
+        Tenant *tenant = &tenants[slots[slot] - 1];
+        if (tenant->id == id) {
+            return tenant;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Bit of a password type in `Tenant.charsets`: the type letters are case-insensitive.
+ */
+static inline uint32_t charset_bit(char type) {
+    unsigned int letter = (unsigned int)((type | 0x20) - 'a');
+    return letter < 26 ? 1u << letter : 0;
+}
+
+/**
+ * @brief Reads the value of a `name=value` option as an unsigned number no larger than `max`.
+ */
+static bool parse_number(const char *value, size_t size, unsigned long max, unsigned long *number) {
+    char *end;
+    if (size == 0 || value[0] < '0' || value[0] > '9') {
+        return false;
+    }
+    *number = strtoul(value, &end, 10);
+    return (size_t)(end - value) == size && *number <= max;
+}
+
+/**
+ * @brief Applies one option of a tenant line.
+ * @return `false` if the option is unknown or its value invalid.
+ */
+static bool parse_option(const char *option, size_t size, Tenant *tenant, bool *burst_given) {
+    const char *equals = memchr(option, '=', size);
+    size_t name_size = equals != NULL ? (size_t)(equals - option) : size;
+    const char *value = equals != NULL ? equals + 1 : NULL;
+    size_t value_size = equals != NULL ? size - name_size - 1 : 0;
+    unsigned long number;
+
+#define OPTION_IS(name) (name_size == sizeof(name) - 1 && memcmp(option, name, name_size) == 0)
+    if (value == NULL) {
+        if (OPTION_IS("streams")) {
+            tenant->max_streams = TENANT_DEFAULT_STREAMS;
+        } else if (OPTION_IS("classes")) {
+            tenant->policy.require_every_class = true;
+            tenant->own_policy = true;
+        } else if (OPTION_IS("unique")) {
+            tenant->policy.unique = true;
+            tenant->own_policy = true;
+        } else {
+            return false;
+        }
+        return true;
+    }
+    if (OPTION_IS("types")) {
+        tenant->charsets = 0;
+        for (size_t i = 0; i < value_size; i++) {
+            uint32_t bit = charset_bit(value[i]);
+            if (bit == 0) {
+                return false;
+            }
+            tenant->charsets |= bit;
+        }
+        return tenant->charsets != 0;
+    }
+    if (OPTION_IS("entropy")) {
+        if (!parse_number(value, value_size, 1024, &number) || number == 0) {
+            return false;
+        }
+        tenant->policy.min_entropy_bits = (double)number;
+        tenant->own_policy = true;
+        return true;
+    }
+    if (OPTION_IS("rate")) {
+        if (!parse_number(value, value_size, UINT32_MAX, &number)) {
+            return false;
+        }
+        tenant->rate = (uint32_t)number;
+    } else if (OPTION_IS("burst")) {
+        if (!parse_number(value, value_size, UINT32_MAX, &number) || number == 0) {
+            return false;
+        }
+        tenant->burst = (uint32_t)number;
+        *burst_given = true;
+    } else if (OPTION_IS("min")) {
+        if (!parse_number(value, value_size, MAX_PASSWORD_LENGTH, &number) || number < MIN_PASSWORD_LENGTH) {
+            return false;
+        }
+        tenant->min_length = (uint8_t)number;
+    } else if (OPTION_IS("max")) {
+        if (!parse_number(value, value_size, MAX_PASSWORD_LENGTH, &number) || number < MIN_PASSWORD_LENGTH) {
+            return false;
+        }
+        tenant->max_length = (uint8_t)number;
+    } else if (OPTION_IS("streams")) {
+        if (!parse_number(value, value_size, UINT8_MAX, &number)) {
+            return false;
+        }
+        tenant->max_streams = (uint8_t)number;
+    } else if (OPTION_IS("count")) {
+        if (!parse_number(value, value_size, UINT16_MAX, &number) || number == 0) {
+            return false;
+        }
+        tenant->max_count = (uint16_t)number;
+    } else {
+        return false;
+    }
+#undef OPTION_IS
+    return true;
+}
+
+/**
+ * @brief Parses one line of a tenant file into `tenant`.
+ * @return 1 for a tenant, 0 for a blank or comment line, -1 for a malformed line.
+ */
+static int parse_line(const char *line, const PassgenPolicy *base_policy, Tenant *tenant) {
+    line += strspn(line, " \t");
+    if (*line == '\0' || *line == '\r' || *line == '\n' || *line == '#') {
+        return 0;
+    }
+
+    char *end;
+    unsigned long long id = strtoull(line, &end, 10);
+    if (end == line || id == 0 || id > UINT32_MAX || (*end != ' ' && *end != '\t')) {
+        return -1;
+    }
+    line = end + strspn(end, " \t");
+    if (!siphash_parse_key(line, tenant->key)) {
+        return -1;
+    }
+    line += 2 * SIPHASH_KEY_SIZE;
+
+    tenant->id = (uint32_t)id;
+    tenant->rate = 0;
+    tenant->charsets = UINT32_MAX;
+    tenant->min_length = MIN_PASSWORD_LENGTH;
+    tenant->max_length = MAX_PASSWORD_LENGTH;
+    tenant->max_count = UINT16_MAX;
+    tenant->max_streams = 0;
+    tenant->own_policy = false;
+    tenant->policy = *base_policy;
+
+    bool burst_given = false;
+    while (true) {
+        line += strspn(line, " \t\r\n");
+        size_t size = strcspn(line, " \t\r\n");
+        if (size == 0) {
+            break;
+        }
+        if (!parse_option(line, size, tenant, &burst_given)) {
+            return -1;
+        }
+        line += size;
+    }
+    if (!burst_given) {
+        tenant->burst = tenant->rate;	/**< One second of passwords */
+    }
+    return tenant->min_length <= tenant->max_length ? 1 : -1;
+}
+
+/**
+ * @brief Tells whether two tenants can share an engine across a reload.
+ */
+static bool same_policy(const Tenant *a, const Tenant *b) {
+    return a->own_policy && b->own_policy && a->policy.min_entropy_bits == b->policy.min_entropy_bits
+        && a->policy.require_every_class == b->policy.require_every_class && a->policy.unique == b->policy.unique
+        && a->policy.unique_capacity == b->policy.unique_capacity;
+}
+
+/**
+ * @brief Creates the context and the engine of a tenant with its own policy.
+ */
+static bool create_engine(Tenant *tenant, const char *breached) {
+    PassgenStatus status = passgen_context_create(&tenant->policy, &tenant->context);
+    if (status == PASSGEN_OK && breached != NULL) {
+        status = passgen_context_load_breached(tenant->context, breached);
+    }
+    if (status == PASSGEN_OK) {
+        status = passgen_engine_create(tenant->context, &tenant->engine);
+    }
+    if (status != PASSGEN_OK) {
+        passgen_context_destroy(tenant->context);
+        tenant->context = NULL;
+        tenant->engine = NULL;
+        return false;
+    }
+    return true;
+}
+
+static void destroy_engines(Tenant *tenants, unsigned int count) {
+    for (unsigned int i = 0; i < count; i++) {
+        if (tenants[i].engine != NULL) {
+            passgen_engine_destroy(tenants[i].engine);
+            passgen_context_destroy(tenants[i].context);
+        }
+    }
+}
+
+/**
+ * @brief Reads the tenant file into a new array and hash table.
+ * @details The tenants already in `table` keep their quota, their metrics and, when
+ * their policy did not change, their engine, which is moved to the new array.
+ * @return `false` if the file is invalid; `table` is then unchanged.
+ */
+static bool read_tenants(TenantTable *table, Tenant **tenants, unsigned int *count, uint16_t *slots) {
+    FILE *file = fopen(table->path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    Tenant *loaded = calloc(TENANT_MAX, sizeof(*loaded));
+    if (loaded == NULL) {
+        fclose(file);
+        return false;
+    }
+
+    char line[TENANT_LINE_SIZE];
+    unsigned int loaded_count = 0;
+    bool valid = true;
+    memset(slots, 0, TENANT_SLOTS * sizeof(*slots));
+    while (valid && fgets(line, sizeof(line), file) != NULL) {
+        Tenant tenant = { 0 };
+        int parsed = parse_line(line, &table->base_policy, &tenant);
+        if (parsed == 0) {
+            continue;
+        }
+        valid = parsed > 0 && loaded_count < TENANT_MAX && find_tenant(loaded, slots, tenant.id) == NULL;
+        if (valid) {
+            unsigned int slot = tenant_slot(tenant.id);
+            while (slots[slot] != 0) {
+                slot = (slot + 1) & (TENANT_SLOTS - 1);
+            }
+            loaded[loaded_count++] = tenant;
+            slots[slot] = (uint16_t)loaded_count;
+        }
+    }
+    valid = valid && ferror(file) == 0;
+    fclose(file);
+
+    /* Engines are only created once the whole file is known to be valid */
+    for (unsigned int i = 0; valid && i < loaded_count; i++) {
+        Tenant *tenant = &loaded[i];
+        Tenant *previous = table->tenants != NULL ? find_tenant(table->tenants, table->slots, tenant->id) : NULL;
+        tenant->tokens = tenant->burst;
+        if (previous != NULL) {
+            tenant->tokens = previous->tokens < tenant->burst ? previous->tokens : tenant->burst;
+            tenant->refilled_ns = previous->refilled_ns;
+            tenant->metrics = previous->metrics;
+        }
+        if (tenant->own_policy && (previous == NULL || !same_policy(tenant, previous))) {
+            valid = create_engine(tenant, table->breached);
+        }
+    }
+    if (!valid) {
+        destroy_engines(loaded, loaded_count);
+        free(loaded);
+        return false;
+    }
+
+    /* Hand over the engines that survive the reload */
+    for (unsigned int i = 0; i < loaded_count; i++) {
+        Tenant *tenant = &loaded[i];
+        Tenant *previous = table->tenants != NULL ? find_tenant(table->tenants, table->slots, tenant->id) : NULL;
+        if (tenant->own_policy && tenant->engine == NULL) {
+            tenant->context = previous->context;
+            tenant->engine = previous->engine;
+            previous->context = NULL;
+            previous->engine = NULL;
+        }
+    }
+    *tenants = loaded;
+    *count = loaded_count;
+    return true;
+}
+
+/**
+ * @brief Reads the identity of the tenant file, to notice when it is replaced or edited.
+ */
+static bool file_identity(const char *path, time_t *modified, long long *size) {
+    struct stat status;
+    if (stat(path, &status) != 0) {
+        return false;
+    }
+    *modified = status.st_mtime;
+    *size = (long long)status.st_size;
+    return true;
+}
+
+/**
+ * @brief Replaces the tenants of `table` with those of its file.
+ */
+static bool reload(TenantTable *table) {
+    Tenant *tenants;
+    unsigned int count;
+    uint16_t slots[TENANT_SLOTS];
+
+    if (!read_tenants(table, &tenants, &count, slots)) {
+        return false;
+    }
+    tenant_table_destroy(table);
+    table->tenants = tenants;
+    table->count = count;
+    memcpy(table->slots, slots, sizeof(slots));
+    return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - TENANTS - - - - - - - - - - - - - - - - - - - - */
+
+bool tenant_table_load(TenantTable *table, const char *path, const PassgenPolicy *base_policy, const char *breached) {
+    memset(table, 0, sizeof(*table));
+    table->path = path;
+    table->base_policy = *base_policy;
+    table->breached = breached;
+    return file_identity(path, &table->modified, &table->size) && reload(table);
+}
+
+TenantReload tenant_table_refresh(TenantTable *table, uint64_t now_ns) {
+    time_t modified;
+    long long size;
+
+    if (now_ns < table->next_check_ns) {
+        return TENANT_UNCHANGED;
+    }
+    table->next_check_ns = now_ns + TENANT_RELOAD_CHECK_NS;
+    if (!file_identity(table->path, &modified, &size)) {
+        return TENANT_RELOAD_FAILED;	/**< Removed or being replaced: keep serving the tenants we have */
+    }
+    if (modified == table->modified && size == table->size) {
+        return TENANT_UNCHANGED;
+    }
+    table->modified = modified;		/**< Not retried until the file changes again */
+    table->size = size;
+    return reload(table) ? TENANT_RELOADED : TENANT_RELOAD_FAILED;
+}
+
+void tenant_table_destroy(TenantTable *table) {
+    if (table->tenants != NULL) {
+        destroy_engines(table->tenants, table->count);
+        free(table->tenants);
+    }
+    table->tenants = NULL;
+    table->count = 0;
+    memset(table->slots, 0, sizeof(table->slots));
+}
+
+Tenant *tenant_authenticate(TenantTable *table, const RequestView *request, time_t now) {
+    Tenant *tenant = (request->flags & REQUEST_FLAG_TENANT) && table->tenants != NULL
+        ? find_tenant(table->tenants, table->slots, request->tenant_id) : NULL;
+    if (tenant == NULL) {
+        table->unknown++;
+        return NULL;
+    }
+    if (!codec_verify_request(request, tenant->key)) {
+        tenant->metrics.forged++;
+        return NULL;
+    }
+    int32_t skew = (int32_t)(request->tenant_time - (uint32_t)now);	/**< Signed: the 32-bit time may wrap */
+    if (skew > TENANT_TIME_WINDOW_S || skew < -TENANT_TIME_WINDOW_S) {
+        tenant->metrics.stale++;
+        return NULL;
+    }
+    return tenant;
+}
+
+ResponseStatus tenant_admit(Tenant *tenant, const RequestView *request, uint64_t now_ns) {
+    tenant->metrics.requests++;
+    if (request->operation != OP_GENERATE && request->operation != OP_SUBSCRIBE) {
+        return STATUS_OK;	/**< Credits and unsubscriptions only act on streams the tenant was allowed */
+    }
+    bool lengths_apply = !codec_is_random_bytes(request->type);	/**< A unit of random bytes is not a password */
+    if ((tenant->charsets & charset_bit(request->type)) == 0
+        || (lengths_apply && (request->length < tenant->min_length || request->length > tenant->max_length))) {
+        tenant->metrics.refused++;
+        return STATUS_UNAUTHORIZED;
+    }
+
+    if (request->operation == OP_SUBSCRIBE) {
+        SubscribeOptions options;
+        codec_subscribe_options(request, &options);
+        uint32_t per_datagram = MAX_STREAM_COUNT(request->length);
+        if (request->count < per_datagram) {
+            per_datagram = request->count;
+        }
+        /* A datagram larger than the burst could never be charged */
+        if (tenant->max_streams == 0
+            || (tenant->rate != 0 && (options.rate == 0 || options.rate > tenant->rate || per_datagram > tenant->burst))) {
+            tenant->metrics.refused++;
+            return STATUS_UNAUTHORIZED;
+        }
+        return STATUS_OK;	/**< The streams open at the same time are counted by the stream table */
+    }
+
+    uint16_t count = codec_response_count(request);
+    if (count > tenant->max_count) {
+        tenant->metrics.refused++;
+        return STATUS_UNAUTHORIZED;
+    }
+    if (tenant_take(tenant, count, now_ns) != 0) {
+        tenant->metrics.throttled++;
+        return STATUS_QUOTA_EXCEEDED;
+    }
+    return STATUS_OK;
+}
+
+uint64_t tenant_take(Tenant *tenant, uint32_t count, uint64_t now_ns) {
+    if (tenant->rate == 0) {
+        return 0;
+    }
+    if (tenant->refilled_ns != 0) {
+        tenant->tokens += (double)tenant->rate * (double)(now_ns - tenant->refilled_ns) / NANOSECONDS_PER_SECOND;
+        if (tenant->tokens > tenant->burst) {
+            tenant->tokens = tenant->burst;
+        }
+    }
+    tenant->refilled_ns = now_ns;
+    if (tenant->tokens < count) {
+        return (uint64_t)(((double)count - tenant->tokens) * NANOSECONDS_PER_SECOND / tenant->rate) + 1;
+    }
+    tenant->tokens -= count;
+    return 0;
+}
+
+Tenant *tenant_find(TenantTable *table, uint32_t id) {
+    return table->tenants != NULL ? find_tenant(table->tenants, table->slots, id) : NULL;
+}
+
+void tenant_report(TenantTable *table) {
+    for (unsigned int i = 0; i < table->count; i++) {
+        TenantMetrics *metrics = &table->tenants[i].metrics;
+        if (metrics->requests == 0 && metrics->forged == 0 && metrics->stale == 0) {
+            continue;
+        }
+        printf("Tenant %u: %llu requests, %llu passwords, %llu throttled, %llu refused, %llu forged, %llu stale\n",
+               table->tenants[i].id, (unsigned long long)metrics->requests, (unsigned long long)metrics->passwords,
+               (unsigned long long)metrics->throttled, (unsigned long long)metrics->refused,
+               (unsigned long long)metrics->forged, (unsigned long long)metrics->stale);
+        memset(metrics, 0, sizeof(*metrics));
+    }
+    if (table->unknown > 0) {
+        printf("Tenants: %llu requests without a known tenant\n", (unsigned long long)table->unknown);
+        table->unknown = 0;
+    }
+}
+
+/* - - - - - - - - - - - - - - - - - - - END TENANTS - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,200 @@
+/**
+ * @file tenant.h
+ * @brief Tenants sharing one server: authentication, quotas, policies and metrics.
+ *
+ * With `-A file` every compact request must name its tenant and end with a MAC
+ * computed with the tenant's key (`REQUEST_FLAG_TENANT`), over a signature time
+ * within `TENANT_TIME_WINDOW_S` of the server's clock. The file holds one
+ * tenant per line, its id, its SipHash key and its options:
+ *
+ *     # id  key (32 hexadecimal digits)            options
+ *     7     00112233445566778899aabbccddeeff       rate=1000 burst=5000 types=nas min=12 count=64 entropy=60 classes
+ *
+ * | Option      | Meaning                                                             |
+ * |-------------|---------------------------------------------------------------------|
+ * | `rate=N`    | Passwords per second, refilled continuously (default: no quota)     |
+ * | `burst=N`   | Passwords that can be taken at once (default: one second of `rate`) |
+ * | `types=...` | Password types (charsets) the tenant may ask for (default: all)     |
+ * | `min=N`     | Shortest password length allowed (random bytes excepted)            |
+ * | `max=N`     | Longest password length allowed (random bytes excepted)             |
+ * | `count=N`   | Most passwords in one request                                       |
+ * | `streams`   | The tenant may open `TENANT_DEFAULT_STREAMS` streams                |
+ * | `streams=N` | The tenant may open N streams at the same time                      |
+ * | `entropy=N` | Minimum entropy of a password, in bits                              |
+ * | `classes`   | Every character class in every password                             |
+ * | `unique`    | No password handed out twice to the tenant                          |
+ *
+ * A tenant with `entropy`, `classes` or `unique` gets an engine of its own, whose
+ * policy adds these options to the server's, so that its policy and its
+ * uniqueness filter are kept apart from the others'.
+ *
+ * The streams of a tenant are generated by its engine, ask for no more than
+ * `rate` passwords per second, and every datagram they send is charged to its
+ * quota like an answer.
+ *
+ * The tenants are found by id in an open-addressing hash table, in a constant
+ * number of probes; the MAC is a single SipHash over a request of a few dozen
+ * bytes. The file is checked for changes once a second and reloaded in place:
+ * the tenants that remain keep their engine, their quota and their metrics. A
+ * file that no longer reads correctly leaves the previous tenants in force.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef TENANT_H_
+#define TENANT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "libs/clock/clock.h"
+#include "libs/codec/codec.h"
+#include "libs/engine/engine.h"
+#include "libs/siphash/siphash.h"
+
+/* - - - - - - - - - - - - - - - - - - - - TENANTS - - - - - - - - - - - - - - - - - - - - */
+
+#define TENANT_MAX 256							/**< Tenants a server can hold */
+#define TENANT_SLOTS (2 * TENANT_MAX)			/**< Entries of the hash table, a power of two */
+#define TENANT_LINE_SIZE 512					/**< Longest line of a tenant file */
+#define TENANT_RELOAD_CHECK_NS NANOSECONDS_PER_SECOND	/**< Period of the look at the tenant file */
+#define TENANT_DEFAULT_STREAMS 4				/**< Streams open at the same time with a bare `streams` */
+
+/**
+ * @struct TenantMetrics
+ * @brief What a tenant did since the last report.
+ */
+typedef struct {
+    uint64_t requests;		/**< Authenticated requests */
+    uint64_t passwords;		/**< Passwords handed out */
+    uint64_t throttled;		/**< Requests refused by the quota */
+    uint64_t refused;		/**< Requests outside the tenant's policy */
+    uint64_t forged;		/**< Requests with a wrong MAC */
+    uint64_t stale;			/**< Requests signed outside the time window (replayed, or a wrong clock) */
+} TenantMetrics;
+
+/**
+ * @struct Tenant
+ * @brief One tenant: its key, its limits and its state.
+ */
+typedef struct {
+    uint32_t id;							/**< Id sent in the tenant extension, never 0 */
+    unsigned char key[SIPHASH_KEY_SIZE];	/**< Key of the MACs */
+    uint32_t rate;							/**< Passwords per second, 0 for no quota */
+    uint32_t burst;							/**< Capacity of the token bucket */
+    uint32_t charsets;						/**< Allowed password types, one bit per letter */
+    uint8_t min_length;						/**< Shortest length allowed */
+    uint8_t max_length;						/**< Longest length allowed */
+    uint16_t max_count;						/**< Most passwords per request */
+    uint8_t max_streams;					/**< Streams open at the same time, 0 for none */
+    bool own_policy;						/**< `policy` differs from the server's */
+    PassgenPolicy policy;					/**< Policy of the tenant's engine */
+    PassgenContext *context;				/**< Context of the tenant, `NULL` without `own_policy` */
+    PassgenEngine *engine;					/**< Engine of the tenant, `NULL` without `own_policy` */
+    double tokens;							/**< Passwords that can still be taken */
+    uint64_t refilled_ns;					/**< Last refill of `tokens` */
+    TenantMetrics metrics;					/**< Counters since the last report */
+} Tenant;
+
+/**
+ * @struct TenantTable
+ * @brief The tenants of the server and the file they come from.
+ */
+typedef struct {
+    Tenant *tenants;						/**< The tenants, `count` of them */
+    unsigned int count;						/**< Entries of `tenants` */
+    uint16_t slots[TENANT_SLOTS];			/**< Hash table: index in `tenants` plus one, 0 for an empty slot */
+    uint64_t unknown;						/**< Requests naming no known tenant since the last report */
+    const char *path;						/**< The tenant file */
+    PassgenPolicy base_policy;				/**< Policy of the server, extended by the tenants' options */
+    const char *breached;					/**< Breached password list of the tenants' own engines, `NULL` for none */
+    time_t modified;						/**< Modification time of the file when it was read */
+    long long size;							/**< Size of the file when it was read */
+    uint64_t next_check_ns;					/**< Next look at the file */
+} TenantTable;
+
+/**
+ * @enum TenantReload
+ * @brief Outcome of `tenant_table_refresh`.
+ */
+typedef enum {
+    TENANT_UNCHANGED,		/**< The file did not change, or was not looked at */
+    TENANT_RELOADED,		/**< The tenants of the new file are in force */
+    TENANT_RELOAD_FAILED	/**< The file changed but could not be loaded: the previous tenants stay */
+} TenantReload;
+
+/**
+ * @brief Reads the tenant file for the first time.
+ * @param[out] table The table.
+ * @param[in] path The tenant file.
+ * @param[in] base_policy Policy of the server, the starting point of the tenants' own policies.
+ * @param[in] breached Breached password list for the tenants with their own engine, `NULL` for none.
+ * @return `false` if the file cannot be read or holds a malformed line, a repeated id,
+ *         more than `TENANT_MAX` tenants, or a policy no engine can be created for.
+ */
+bool tenant_table_load(TenantTable *table, const char *path, const PassgenPolicy *base_policy, const char *breached);
+
+/**
+ * @brief Reloads the tenant file if it changed, at most once per `TENANT_RELOAD_CHECK_NS`.
+ * @param[in,out] table The table.
+ * @param[in] now_ns Current monotonic time.
+ * @return What happened to the tenants.
+ */
+TenantReload tenant_table_refresh(TenantTable *table, uint64_t now_ns);
+
+/**
+ * @brief Releases the tenants and their engines.
+ * @param[in,out] table The table.
+ */
+void tenant_table_destroy(TenantTable *table);
+
+/**
+ * @brief Finds the tenant of a request and checks its MAC and the time it was signed at.
+ * @param[in,out] table The table (the failures are counted).
+ * @param[in] request A successfully decoded request.
+ * @param[in] now Current Unix time.
+ * @return The tenant, or `NULL` if the request names no known tenant, its MAC is wrong, or it
+ *         was signed more than `TENANT_TIME_WINDOW_S` away from `now`.
+ */
+Tenant *tenant_authenticate(TenantTable *table, const RequestView *request, time_t now);
+
+/**
+ * @brief Checks a request against the policy and the quota of its tenant, and charges it.
+ * @param[in,out] tenant The tenant of the request.
+ * @param[in] request The authenticated request.
+ * @param[in] now_ns Current monotonic time.
+ * @return `STATUS_OK`, `STATUS_UNAUTHORIZED` if the policy forbids the request, or
+ *         `STATUS_QUOTA_EXCEEDED`.
+ */
+ResponseStatus tenant_admit(Tenant *tenant, const RequestView *request, uint64_t now_ns);
+
+/**
+ * @brief Takes passwords from the quota of a tenant.
+ * @param[in,out] tenant The tenant.
+ * @param[in] count Passwords to take.
+ * @param[in] now_ns Current monotonic time.
+ * @return 0 if the passwords were taken, otherwise the nanoseconds after which the quota will hold them.
+ */
+uint64_t tenant_take(Tenant *tenant, uint32_t count, uint64_t now_ns);
+
+/**
+ * @brief Finds a tenant by id.
+ * @param[in] table The table.
+ * @param[in] id Id of the tenant.
+ * @return The tenant, or `NULL` if there is none with this id. The pointer is only
+ *         valid until the next `tenant_table_refresh`.
+ */
+Tenant *tenant_find(TenantTable *table, uint32_t id);
+
+/**
+ * @brief Prints the metrics of the tenants that were active since the last report, and resets them.
+ * @param[in,out] table The table.
+ */
+void tenant_report(TenantTable *table);
+
+/* - - - - - - - - - - - - - - - - - - - END TENANTS - - - - - - - - - - - - - - - - - - - */
+
+#endif /* TENANT_H_ */
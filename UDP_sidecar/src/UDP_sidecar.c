@@ -0,0 +1,438 @@
+/**
+ * @file UDP_sidecar.c
+ * @brief Local aggregating proxy between many small clients and the password servers.
+ * @details The sidecar listens on the loopback interface (and optionally on a Unix
+ * datagram socket) for requests in any format the server accepts, the legacy
+ * `PasswordRequest` included, so existing clients only change the address they
+ * send to. Single-password requests are served from a prefetch pool; the others,
+ * and the pool misses, are queued by (type, length) and forwarded upstream as
+ * batch requests whose answers are fanned back out to the local clients.
+ * Identifiers and random bytes are batched the same way; templates are not
+ * proxied, and are answered `STATUS_BAD_REQUEST`.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <unistd.h>  		/**< Include UNIX standard header for close() and unlink() */
+#include <fcntl.h>  		/**< Include for fcntl() to make the sockets non-blocking */
+#include <poll.h>  			/**< Include for poll() used by the event loop */
+#include <errno.h>  		/**< Include for errno */
+#include <sys/socket.h>  	/**< Include socket library for UNIX */
+#include <sys/un.h>  		/**< Include for Unix domain socket addresses */
+#include <arpa/inet.h>  	/**< Include ARP and Internet address family libraries */
+#include <netinet/in.h>  	/**< Include for internet address family structures */
+
+#include <stdio.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libs/protocol/protocol.h"      /**< Include protocol definitions for communication */
+#include "libs/codec/codec.h"            /**< Include the in-place message codec */
+#include "libs/clock/clock.h"            /**< Include the monotonic clock */
+#include "libs/client/client.h"          /**< Include the pipelined client library (upstream) */
+#include "libs/prefetch/prefetch.h"      /**< Include the prefetch pools */
+#include "libs/resolver/resolver.h"      /**< Include the asynchronous resolver */
+#include "libs/aggregator/aggregator.h"  /**< Include the request aggregator */
+
+#define DEFAULT_SERVER_NAME "passwdgen.uniba.it"	/**< Upstream servers when `-s` is not given */
+#define RESOLVE_TIMEOUT_MS 5000						/**< Time allowed for the first resolution of the servers */
+#define RECEIVE_BATCH 64							/**< Datagrams read per socket and wake-up */
+#define LOCAL_RECEIVE_BUFFER (4 * 1024 * 1024)	/**< Requested receive buffer of the local sockets: bursts from many processes */
+#define UPSTREAM_TIMER_MS 5							/**< Longest sleep while upstream requests are in flight */
+#define REPORT_INTERVAL_NS (10 * NANOSECONDS_PER_SECOND)	/**< Time between two statistics lines */
+
+
+/**
+ * @struct SidecarOptions
+ * @brief Command-line options.
+ */
+typedef struct {
+    unsigned short local_port;	/**< Loopback port the local clients send to (-l) */
+    const char *unix_path;		/**< Unix datagram socket to listen on as well, `NULL` for none (-U) */
+    const char *server_name;	/**< Upstream servers as "host[:port]", comma separated (-s) */
+    unsigned short port;		/**< Default port of the upstream servers (-p) */
+    unsigned int window_us;		/**< Upper bound of the batching window (-W) */
+    size_t pool_capacity;		/**< Passwords kept per prefetch pool, 0 disables the pools (-P) */
+    unsigned int upstream_window;	/**< Batch requests in flight upstream (-w) */
+} SidecarOptions;
+
+/**
+ * @struct Sidecar
+ * @brief State of the proxy.
+ */
+typedef struct {
+    int udp_socket;					/**< Loopback UDP socket */
+    int unix_socket;				/**< Unix datagram socket, -1 if not enabled */
+    PassgenClient upstream;			/**< Client carrying the aggregated batches */
+    PassgenClient refill;			/**< Client carrying the prefetch refills */
+    Prefetcher prefetcher;			/**< Pools of single passwords */
+    bool prefetch_enabled;			/**< The pools are in use */
+    Aggregator aggregator;			/**< Queued and forwarded requests */
+} Sidecar;
+
+
+/**
+ * @brief Prints an error message on the standard error.
+ * @param[in] error_message The error message to be displayed.
+ */
+void error_handler(const char *error_message) {
+    fputs(error_message, stderr);
+}
+
+/**
+ * @brief Prints the command-line usage.
+ */
+void show_usage() {
+    fprintf(stderr,
+            "Usage: UDP_sidecar [-l port] [-U path] [-s servers] [-p port] [-W window_us] [-P pool] [-w window]\n"
+            "Listens on 127.0.0.1:port (and on the Unix datagram socket path) and forwards the requests\n"
+            "to the servers as batches. -W bounds the batching window, -P sizes the prefetch pool of each\n"
+            "type and length (0 disables it), -w limits the batch requests in flight.\n");
+}
+
+/**
+ * @brief Parses the command line.
+ * @param[in] argc Number of arguments.
+ * @param[in] argv The arguments.
+ * @param[out] options The options.
+ * @return `true` if the command line is valid.
+ */
+bool parse_options(int argc, char *argv[], SidecarOptions *options) {
+    *options = (SidecarOptions){
+        .local_port = DEFAULT_PORT,
+        .server_name = DEFAULT_SERVER_NAME,
+        .port = DEFAULT_PORT,
+        .window_us = AGGREGATOR_DEFAULT_WINDOW_US,
+        .pool_capacity = PREFETCH_DEFAULT_CAPACITY,
+        .upstream_window = CLIENT_DEFAULT_WINDOW,
+    };
+    for (int i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0' || argv[i][2] != '\0' || i + 1 == argc) {
+            return false;
+        }
+        const char *value = argv[++i];
+        switch (argv[i - 1][1]) {
+        case 'l': options->local_port = (unsigned short)atoi(value); break;
+        case 'U': options->unix_path = value; break;
+        case 's': options->server_name = value; break;
+        case 'p': options->port = (unsigned short)atoi(value); break;
+        case 'W': options->window_us = (unsigned int)atoi(value); break;
+        case 'P': options->pool_capacity = (size_t)atol(value); break;
+        case 'w': options->upstream_window = (unsigned int)atoi(value); break;
+        default: return false;
+        }
+    }
+    return options->local_port != 0 && options->port != 0
+        && options->upstream_window > 0 && options->upstream_window <= CLIENT_MAX_WINDOW;
+}
+
+/**
+ * @brief Switches a socket to non-blocking mode.
+ * @param[in] socket_descriptor The socket.
+ * @return `true` on success.
+ */
+bool set_nonblocking(int socket_descriptor) {
+    int flags = fcntl(socket_descriptor, F_GETFL, 0);
+    return flags >= 0 && fcntl(socket_descriptor, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+/**
+ * @brief Makes a local socket non-blocking and enlarges its receive buffer (best effort, capped by the system).
+ * @param[in] socket_descriptor The socket.
+ * @return `true` on success.
+ */
+bool prepare_local_socket(int socket_descriptor) {
+    int size = LOCAL_RECEIVE_BUFFER;
+    setsockopt(socket_descriptor, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    return set_nonblocking(socket_descriptor);
+}
+
+/**
+ * @brief Opens the loopback UDP socket the local clients send to.
+ * @param[in] port Port to listen on.
+ * @return The socket, -1 on error.
+ */
+int open_udp_socket(unsigned short port) {
+    struct sockaddr_in address = { .sin_family = AF_INET, .sin_port = htons(port) };
+    address.sin_addr.s_addr = inet_addr(DEFAULT_IP);
+
+    int created_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (created_socket >= 0 && (bind(created_socket, (struct sockaddr *)&address, sizeof(address)) < 0
+                                || !prepare_local_socket(created_socket))) {
+        close(created_socket);
+        created_socket = -1;
+    }
+    return created_socket;
+}
+
+/**
+ * @brief Opens the Unix datagram socket, replacing a stale socket file.
+ * @param[in] path Path of the socket.
+ * @return The socket, -1 on error.
+ */
+int open_unix_socket(const char *path) {
+    struct sockaddr_un address = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+    unlink(path);
+
+    int created_socket = socket(AF_UNIX, SOCK_DGRAM, 0);
+    if (created_socket >= 0 && (bind(created_socket, (struct sockaddr *)&address, sizeof(address)) < 0
+                                || !prepare_local_socket(created_socket))) {
+        close(created_socket);
+        created_socket = -1;
+    }
+    return created_socket;
+}
+
+/**
+ * @brief Registers every server of the `-s` list with the resolver.
+ * @param[in,out] resolver The resolver.
+ * @param[in] options The command-line options.
+ * @return `false` if an entry is invalid or there are too many servers.
+ */
+bool add_servers(Resolver *resolver, const SidecarOptions *options) {
+    char list[BUFFER_SIZE];
+
+    snprintf(list, sizeof(list), "%s", options->server_name);
+    for (char *entry = strtok(list, ","); entry != NULL; entry = strtok(NULL, ",")) {
+        unsigned short port = options->port;
+        char *separator = strchr(entry, ':');
+
+        if (separator != NULL) {
+            *separator = '\0';
+            port = (unsigned short)atoi(separator + 1);
+        }
+        if (port == 0 || !resolver_add(resolver, entry, port)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Opens an upstream client balancing over the resolved servers.
+ * @param[out] client The client.
+ * @param[in,out] resolver The resolver, started.
+ * @param[in] window Requests in flight.
+ * @return `true` if the socket was created.
+ */
+bool open_upstream(PassgenClient *client, Resolver *resolver, unsigned int window) {
+    struct sockaddr_in server_addresses[CLIENT_MAX_SERVERS];	/**< Addresses of the servers */
+
+    size_t count = resolver_addresses(resolver, server_addresses, CLIENT_MAX_SERVERS);
+    if (count == 0 || !client_open(client, &server_addresses[0])) {
+        return false;
+    }
+    client_set_servers(client, server_addresses, count);
+    client_set_server_source(client, resolver_update_client, resolver);
+    client_set_packed(client, true);	/**< Fewer batches upstream, and room for the counts of packed requests */
+    client->window = window;
+    return true;
+}
+
+/**
+ * @brief Aggregator reply function: sends an answer to a local client.
+ */
+void send_reply(void *context, const AggregatorPeer *peer, const unsigned char *message, size_t size) {
+    (void)context;
+    if (peer->address.ss_family == AF_UNIX && peer->address_size <= offsetof(struct sockaddr_un, sun_path)) {
+        return;	/**< Unbound Unix client: it cannot receive answers */
+    }
+    sendto(peer->socket, message, size, 0, (const struct sockaddr *)&peer->address, peer->address_size);	/**< Best effort, as UDP */
+}
+
+/**
+ * @brief Serves one local datagram: from the pool, or through the aggregator.
+ * @param[in,out] sidecar The proxy.
+ * @param[in] peer The local client.
+ * @param[in] buffer The datagram.
+ * @param[in] size Its size.
+ * @param[in] now_ns Current monotonic time.
+ */
+void handle_datagram(Sidecar *sidecar, const AggregatorPeer *peer, const unsigned char *buffer, size_t size,
+                     uint64_t now_ns) {
+    RequestView request;
+    char password[MAX_PASSWORD_LENGTH];
+
+    if (codec_decode_request(buffer, size, &request) != CODEC_OK || request.operation != OP_GENERATE) {
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_BAD_REQUEST, NULL, 0);	/**< Streams are not proxied */
+        return;
+    }
+    if (codec_is_template(request.type)) {
+        /* A queue keeps no body, and the upstream client sends every batch with a single template */
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_BAD_REQUEST, NULL, 0);
+        return;
+    }
+    if (!aggregator_accepts(request.type)) {
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_BAD_REQUEST, NULL, 0);	/**< No queue for it */
+        return;
+    }
+    if (request.flags & (REQUEST_FLAG_ENCRYPTED | REQUEST_FLAG_TENANT)) {
+        /* The proxy holds no key, and the MAC of a tenant does not survive the aggregation */
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_UNAUTHORIZED, NULL, 0);
+        return;
+    }
+    /* Only passwords are prefetched: an identifier taken from a pool would carry the time it was made */
+    if (sidecar->prefetch_enabled && codec_response_count(&request) == 1 && generator_lookup(request.type) != NULL
+        && prefetch_try_take(&sidecar->prefetcher, request.type, request.length, password) == STATUS_OK) {
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_OK, password, 1);
+        return;
+    }
+    if (!aggregator_submit(&sidecar->aggregator, peer, &request, now_ns)) {
+        aggregator_answer(&sidecar->aggregator, peer, &request, STATUS_UNAVAILABLE, NULL, 0);
+    }
+}
+
+/**
+ * @brief Reads and serves the pending datagrams of a local socket.
+ * @param[in,out] sidecar The proxy.
+ * @param[in] local_socket The socket.
+ * @return `false` on a socket error.
+ */
+bool receive_local(Sidecar *sidecar, int local_socket) {
+    for (int i = 0; i < RECEIVE_BATCH; i++) {
+        unsigned char buffer[MAX_DATAGRAM_SIZE];
+        AggregatorPeer peer = { .socket = local_socket, .address_size = sizeof(peer.address) };
+
+        ssize_t received = recvfrom(local_socket, buffer, sizeof(buffer), 0, (struct sockaddr *)&peer.address,
+                                    &peer.address_size);
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        handle_datagram(sidecar, &peer, buffer, (size_t)received, clock_now_ns());
+    }
+    return true;
+}
+
+/**
+ * @brief Prints how many upstream requests the local requests turned into.
+ * @param[in] sidecar The proxy.
+ */
+void print_report(const Sidecar *sidecar) {
+    const AggregatorStats *stats = &sidecar->aggregator.stats;
+    const PrefetchStats *pool = &sidecar->prefetcher.stats;
+    uint64_t local = stats->requests + pool->hits;
+    uint64_t upstream = stats->batches + pool->refills;
+
+    printf("local requests %llu (pool hits %llu), upstream requests %llu (%.1f local per upstream), failures %llu\n",
+           (unsigned long long)local, (unsigned long long)pool->hits, (unsigned long long)upstream,
+           upstream > 0 ? (double)local / (double)upstream : 0.0, (unsigned long long)stats->failures);
+    fflush(stdout);
+}
+
+/**
+ * @brief Entry point of the sidecar.
+ * @return EXIT_FAILURE if the sockets or the upstream clients cannot be opened; the event loop never returns.
+ */
+int main(int argc, char *argv[]) {
+    static Sidecar sidecar;		/**< Large (waiter storage): kept out of the stack */
+    SidecarOptions options;
+    Resolver resolver;
+
+    if (!parse_options(argc, argv, &options)) {
+        show_usage();
+        return EXIT_FAILURE;
+    }
+
+    sidecar.udp_socket = open_udp_socket(options.local_port);
+    sidecar.unix_socket = options.unix_path != NULL ? open_unix_socket(options.unix_path) : -1;
+    if (sidecar.udp_socket < 0 || (options.unix_path != NULL && sidecar.unix_socket < 0)) {
+        error_handler("Cannot open the local sockets.\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!resolver_init(&resolver, 0)) {
+        return EXIT_FAILURE;
+    }
+    if (!add_servers(&resolver, &options) || !resolver_start(&resolver) || !resolver_wait(&resolver, RESOLVE_TIMEOUT_MS)
+        || !open_upstream(&sidecar.upstream, &resolver, options.upstream_window)
+        || !open_upstream(&sidecar.refill, &resolver, CLIENT_DEFAULT_WINDOW)) {
+        error_handler("Cannot reach the upstream servers.\n");
+        resolver_stop(&resolver);
+        return EXIT_FAILURE;
+    }
+
+    aggregator_init(&sidecar.aggregator, &sidecar.upstream, options.window_us, send_reply, &sidecar);
+    if (options.pool_capacity > 0) {
+        PrefetchConfig config = prefetch_default_config();
+        config.capacity = options.pool_capacity;
+        config.low_water = options.pool_capacity / 4;
+        prefetch_init(&sidecar.prefetcher, &sidecar.refill, &config);
+        sidecar.prefetch_enabled = true;
+    }
+
+    printf("Sidecar listening on %s:%u\n", DEFAULT_IP, options.local_port);
+    fflush(stdout);
+
+    uint64_t next_report_ns = clock_now_ns() + REPORT_INTERVAL_NS;
+    uint64_t reported_requests = 0;
+    while (true) {
+        struct pollfd descriptors[4];
+        nfds_t count = 0;
+        uint64_t now_ns = clock_now_ns();
+        int timeout_ms = aggregator_poll_timeout(&sidecar.aggregator, now_ns);
+
+        /* The clients retransmit on timers of their own: never sleep long while they wait */
+        if ((sidecar.upstream.outstanding > 0 || sidecar.refill.outstanding > 0)
+            && (timeout_ms < 0 || timeout_ms > UPSTREAM_TIMER_MS)) {
+            timeout_ms = UPSTREAM_TIMER_MS;
+        }
+        /* Wake up for the report if there is something new to report */
+        if (sidecar.aggregator.stats.requests + sidecar.prefetcher.stats.hits != reported_requests) {
+            int report_ms = now_ns >= next_report_ns ? 0 : (int)((next_report_ns - now_ns) / NANOSECONDS_PER_MILLISECOND);
+            if (timeout_ms < 0 || report_ms < timeout_ms) {
+                timeout_ms = report_ms;
+            }
+        }
+        descriptors[count++] = (struct pollfd){ .fd = sidecar.udp_socket, .events = POLLIN };
+        if (sidecar.unix_socket >= 0) {
+            descriptors[count++] = (struct pollfd){ .fd = sidecar.unix_socket, .events = POLLIN };
+        }
+        descriptors[count++] = (struct pollfd){ .fd = sidecar.upstream.socket, .events = POLLIN };
+        descriptors[count++] = (struct pollfd){ .fd = sidecar.refill.socket, .events = POLLIN };
+
+        if (poll(descriptors, count, timeout_ms) < 0 && errno != EINTR) {
+            error_handler("Error waiting for socket events.\n");
+            break;
+        }
+
+        bool healthy = receive_local(&sidecar, sidecar.udp_socket)
+            && (sidecar.unix_socket < 0 || receive_local(&sidecar, sidecar.unix_socket))
+            && (!sidecar.prefetch_enabled || prefetch_poll(&sidecar.prefetcher, 0))
+            && aggregator_service(&sidecar.aggregator, clock_now_ns());
+        if (!healthy) {
+            error_handler("Socket error.\n");
+            break;
+        }
+
+        now_ns = clock_now_ns();
+        uint64_t requests = sidecar.aggregator.stats.requests + sidecar.prefetcher.stats.hits;
+        if (now_ns >= next_report_ns) {
+            if (requests != reported_requests) {
+                print_report(&sidecar);
+                reported_requests = requests;
+            }
+            next_report_ns = now_ns + REPORT_INTERVAL_NS;
+        }
+    }
+
+    if (sidecar.prefetch_enabled) {
+        prefetch_close(&sidecar.prefetcher);
+    }
+    client_close(&sidecar.upstream);
+    client_close(&sidecar.refill);
+    resolver_stop(&resolver);
+    close(sidecar.udp_socket);
+    if (sidecar.unix_socket >= 0) {
+        close(sidecar.unix_socket);
+        unlink(options.unix_path);
+    }
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,218 @@
+/**
+ * @file aggregator.c
+ * @brief Implementation of the request aggregator of the sidecar.
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#include <string.h>
+
+#include "aggregator.h"
+#include "libs/clock/clock.h"
+
+#define BATCH_TAG(head, count) ((uint64_t)(head) | (uint64_t)(count) << 16)	/**< Waiter list and passwords of a batch */
+#define BATCH_HEAD(tag) ((uint16_t)((tag) & 0xFFFF))
+
+/* - - - - - - - - - - - - - - - - - - - - HELPERS - - - - - - - - - - - - - - - - - - - - */
+
+static AggregatorQueue *queue_for(Aggregator *aggregator, const RequestView *request) {
+    const Generator *generator = generator_lookup(request->type);
+    if (codec_is_random_bytes(request->type)) {
+        return &aggregator->queues[AGGREGATOR_PASSWORD_QUEUES + AGGREGATOR_IDENTIFIER_QUEUES + request->length];
+    }
+    if (generator == NULL) {
+        return &aggregator->queues[AGGREGATOR_PASSWORD_QUEUES + identifier_lookup(request->type)->kind];
+    }
+    return &aggregator->queues[generator->type * (MAX_PASSWORD_LENGTH + 1) + request->length];
+}
+
+static void release_waiter(Aggregator *aggregator, uint16_t index) {
+    aggregator->waiters[index].next = aggregator->free_head;
+    aggregator->free_head = index;
+}
+
+/**
+ * @brief Batching window of a queue receiving its first request.
+ */
+static uint64_t window_ns(const Aggregator *aggregator, const AggregatorQueue *queue, uint8_t length) {
+    if (queue->gap_ns * 2 > aggregator->max_window_ns) {
+        return 0;	/**< Fewer than two requests expected: waiting only adds latency */
+    }
+    uint64_t fill_ns = queue->gap_ns * MAX_BATCH_COUNT(length);
+    return fill_ns < aggregator->max_window_ns ? fill_ns : aggregator->max_window_ns;
+}
+
+/**
+ * @brief Client callback: splits the answer of a batch among its waiters.
+ */
+static void deliver_batch(void *context, uint64_t tag, const ResponseView *response) {
+    Aggregator *aggregator = context;
+    bool ok = response != NULL && response->status == STATUS_OK;
+    uint16_t offset = 0;
+
+    for (uint16_t index = BATCH_HEAD(tag); index != AGGREGATOR_NONE; ) {
+        AggregatorWaiter *waiter = &aggregator->waiters[index];
+        uint16_t next = waiter->next;
+
+        if (ok && offset + waiter->count <= response->count) {
+            aggregator_answer(aggregator, &waiter->peer, &waiter->request, STATUS_OK,
+                              response->passwords + (size_t)offset * response->length, waiter->count);
+            offset += waiter->count;
+        } else {
+            aggregator_answer(aggregator, &waiter->peer, &waiter->request, STATUS_UNAVAILABLE, NULL, 0);
+            aggregator->stats.failures++;
+        }
+        release_waiter(aggregator, index);
+        index = next;
+    }
+}
+
+/**
+ * @brief Sends the first datagram's worth of waiters of a queue upstream.
+ * @return `false` if the client window is full.
+ */
+static bool forward_queue(Aggregator *aggregator, AggregatorQueue *queue) {
+    if (!client_can_submit(aggregator->client)) {
+        return false;
+    }
+
+    const AggregatorWaiter *first = &aggregator->waiters[queue->head];
+    const uint16_t max_count = client_max_count(aggregator->client, first->request.type, first->request.length);
+    uint16_t head = queue->head, last = queue->head, count = first->count;
+    while (aggregator->waiters[last].next != AGGREGATOR_NONE
+           && count + aggregator->waiters[aggregator->waiters[last].next].count <= max_count) {
+        last = aggregator->waiters[last].next;
+        count += aggregator->waiters[last].count;
+    }
+
+    queue->head = aggregator->waiters[last].next;
+    if (queue->head == AGGREGATOR_NONE) {
+        queue->tail = AGGREGATOR_NONE;
+    }
+    queue->passwords -= count;
+    aggregator->waiters[last].next = AGGREGATOR_NONE;
+
+    client_submit(aggregator->client, first->request.type, first->request.length, count, BATCH_TAG(head, count));
+    aggregator->stats.batches++;
+    return true;
+}
+
+/* - - - - - - - - - - - - - - - - - - - END HELPERS - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - AGGREGATOR - - - - - - - - - - - - - - - - - - - - */
+
+void aggregator_init(Aggregator *aggregator, PassgenClient *client, unsigned int max_window_us,
+                     AggregatorReply reply, void *context) {
+    memset(aggregator, 0, sizeof(*aggregator));
+    aggregator->client = client;
+    aggregator->max_window_ns = (uint64_t)max_window_us * 1000;
+    aggregator->reply = reply;
+    aggregator->reply_context = context;
+
+    for (size_t i = 0; i < AGGREGATOR_QUEUE_COUNT; i++) {
+        aggregator->queues[i] = (AggregatorQueue){
+            .head = AGGREGATOR_NONE,
+            .tail = AGGREGATOR_NONE,
+            .gap_ns = aggregator->max_window_ns,	/**< Assume a light load until requests arrive */
+        };
+    }
+    for (uint16_t i = 0; i < AGGREGATOR_MAX_WAITERS; i++) {
+        aggregator->waiters[i].next = (uint16_t)(i + 1 < AGGREGATOR_MAX_WAITERS ? i + 1 : AGGREGATOR_NONE);
+    }
+    aggregator->free_head = 0;
+}
+
+bool aggregator_submit(Aggregator *aggregator, const AggregatorPeer *peer, const RequestView *request, uint64_t now_ns) {
+    if (aggregator->free_head == AGGREGATOR_NONE) {
+        aggregator->stats.overflows++;
+        return false;
+    }
+    uint16_t index = aggregator->free_head;
+    AggregatorWaiter *waiter = &aggregator->waiters[index];
+    aggregator->free_head = waiter->next;
+
+    waiter->peer = *peer;
+    waiter->request = *request;
+    waiter->request.raw = waiter->request.body = NULL;
+    waiter->request.raw_size = waiter->request.body_size = 0;
+    waiter->count = codec_response_count(request);
+    waiter->next = AGGREGATOR_NONE;
+
+    AggregatorQueue *queue = queue_for(aggregator, request);
+    if (queue->last_arrival_ns != 0) {
+        int64_t sample = (int64_t)(now_ns - queue->last_arrival_ns);
+        int64_t gap = (int64_t)queue->gap_ns;
+        queue->gap_ns = (uint64_t)(gap + ((sample - gap) >> AGGREGATOR_GAP_SHIFT));
+    }
+    queue->last_arrival_ns = now_ns;
+
+    if (queue->head == AGGREGATOR_NONE) {
+        queue->head = index;
+        queue->deadline_ns = now_ns + window_ns(aggregator, queue, request->length);
+    } else {
+        aggregator->waiters[queue->tail].next = index;
+    }
+    queue->tail = index;
+    queue->passwords += waiter->count;
+
+    aggregator->stats.requests++;
+    aggregator->stats.passwords += waiter->count;
+    return true;
+}
+
+bool aggregator_service(Aggregator *aggregator, uint64_t now_ns) {
+    if (aggregator->client->outstanding > 0 && client_poll(aggregator->client, 0, deliver_batch, aggregator) < 0) {
+        return false;
+    }
+
+    for (size_t i = 0; i < AGGREGATOR_QUEUE_COUNT; i++) {
+        AggregatorQueue *queue = &aggregator->queues[i];
+        while (queue->head != AGGREGATOR_NONE
+               && (queue->deadline_ns <= now_ns
+                   || queue->passwords >= MAX_BATCH_COUNT(aggregator->waiters[queue->head].request.length))) {
+            if (!forward_queue(aggregator, queue)) {
+                return true;	/**< Window full: the queues wait for the next answers */
+            }
+        }
+    }
+    return true;
+}
+
+int aggregator_poll_timeout(const Aggregator *aggregator, uint64_t now_ns) {
+    int timeout_ms = -1;
+
+    for (size_t i = 0; i < AGGREGATOR_QUEUE_COUNT; i++) {
+        const AggregatorQueue *queue = &aggregator->queues[i];
+        if (queue->head == AGGREGATOR_NONE) {
+            continue;
+        }
+        int queue_timeout_ms = queue->deadline_ns <= now_ns ? 0
+            : (int)((queue->deadline_ns - now_ns + NANOSECONDS_PER_MILLISECOND - 1) / NANOSECONDS_PER_MILLISECOND);
+        if (timeout_ms < 0 || queue_timeout_ms < timeout_ms) {
+            timeout_ms = queue_timeout_ms;
+        }
+    }
+    return timeout_ms;
+}
+
+bool aggregator_accepts(char type) {
+    return generator_lookup(type) != NULL || identifier_lookup(type) != NULL || codec_is_random_bytes(type);
+}
+
+void aggregator_answer(const Aggregator *aggregator, const AggregatorPeer *peer, const RequestView *request,
+                       ResponseStatus status, const char *passwords, uint16_t count) {
+    unsigned char buffer[MAX_UNPACKED_RESPONSE_SIZE];
+    size_t size = codec_encode_response(buffer, sizeof(buffer), request, status, count);
+
+    if (size == 0) {
+        return;
+    }
+    if (status == STATUS_OK) {
+        memcpy(codec_response_password(buffer, request, 0), passwords, (size_t)count * request->length);
+    }
+    size = codec_pack_response(buffer, size, request);	/**< As the request asked, whatever the batch was */
+    aggregator->reply(aggregator->reply_context, peer, buffer, size);
+}
+
+/* - - - - - - - - - - - - - - - - - - - END AGGREGATOR - - - - - - - - - - - - - - - - - - - */
@@ -0,0 +1,173 @@
+/**
+ * @file aggregator.h
+ * @brief Collects the small requests of local clients into upstream batch requests.
+ *
+ * Every request received by the sidecar is queued with the requests of the
+ * same (type, length); an identifier type has a single length, and a queue.
+ * Random bytes are batched too: the server then charges the budget of the
+ * sidecar for the bytes of all its local clients. A queue is forwarded as one batch request when it holds
+ * a full datagram of passwords or when its batching window expires; the
+ * answer is then split among the queued requests, in arrival order.
+ *
+ * The window adapts to the load of each queue: it is the time the current
+ * arrival rate needs to fill a datagram, bounded by `max_window_us`, and it
+ * drops to zero when fewer than two requests are expected within the bound,
+ * so that a lightly loaded sidecar adds no latency.
+ *
+ * @version 1.0.0
+ * @date 2024-12-15
+ * @author Cristian Biallo
+ */
+
+#ifndef AGGREGATOR_H_
+#define AGGREGATOR_H_
+
+#include <sys/socket.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libs/client/client.h"
+#include "libs/generator/generator.h"
+#include "libs/identifier/identifier.h"
+
+/* - - - - - - - - - - - - - - - - - - - - TYPES - - - - - - - - - - - - - - - - - - - - */
+
+#define AGGREGATOR_MAX_WAITERS 4096			/**< Local requests queued or in flight upstream */
+#define AGGREGATOR_DEFAULT_WINDOW_US 2000	/**< Upper bound of the batching window */
+#define AGGREGATOR_GAP_SHIFT 3				/**< Weight of a new inter-arrival sample: 1/8 */
+#define AGGREGATOR_PASSWORD_QUEUES ((UNAMBIGUOUS + 1) * (MAX_PASSWORD_LENGTH + 1))	/**< One queue per password (type, length) */
+#define AGGREGATOR_IDENTIFIER_QUEUES IDENTIFIER_KIND_COUNT							/**< One per identifier type */
+#define AGGREGATOR_QUEUE_COUNT (AGGREGATOR_PASSWORD_QUEUES + AGGREGATOR_IDENTIFIER_QUEUES + MAX_PASSWORD_LENGTH + 1)	/**< And one per length of random bytes */
+#define AGGREGATOR_NONE UINT16_MAX			/**< End of a waiter list */
+
+/**
+ * @struct AggregatorPeer
+ * @brief Where the answer of a local request goes.
+ */
+typedef struct {
+    int socket;							/**< Local socket the request arrived on */
+    socklen_t address_size;				/**< Size of `address` */
+    struct sockaddr_storage address;	/**< Address of the local client (UDP or Unix) */
+} AggregatorPeer;
+
+/**
+ * @struct AggregatorWaiter
+ * @brief A local request waiting for its passwords.
+ */
+typedef struct {
+    AggregatorPeer peer;	/**< Client to answer */
+    RequestView request;	/**< Decoded request, without its buffer pointers */
+    uint16_t count;			/**< Passwords to hand out */
+    uint16_t next;			/**< Next waiter of the same list, `AGGREGATOR_NONE` at the end */
+} AggregatorWaiter;
+
+/**
+ * @struct AggregatorQueue
+ * @brief Requests of one (type, length) not forwarded yet.
+ */
+typedef struct {
+    uint16_t head;			/**< First waiter */
+    uint16_t tail;			/**< Last waiter */
+    uint32_t passwords;		/**< Passwords requested by the queued waiters */
+    uint64_t deadline_ns;	/**< When the queue is forwarded even if not full */
+    uint64_t last_arrival_ns;	/**< Arrival of the latest request */
+    uint64_t gap_ns;		/**< Smoothed time between two requests */
+} AggregatorQueue;
+
+/**
+ * @struct AggregatorStats
+ * @brief Counters of the aggregator.
+ */
+typedef struct {
+    uint64_t requests;			/**< Local requests queued */
+    uint64_t passwords;			/**< Passwords requested by them */
+    uint64_t batches;			/**< Batch requests sent upstream */
+    uint64_t failures;			/**< Local requests answered with an error */
+    uint64_t overflows;			/**< Local requests refused because every waiter was in use */
+} AggregatorStats;
+
+/**
+ * @typedef AggregatorReply
+ * @brief Sends an encoded answer to a local client.
+ */
+typedef void (*AggregatorReply)(void *context, const AggregatorPeer *peer, const unsigned char *message, size_t size);
+
+/**
+ * @struct Aggregator
+ * @brief The queues and the requests in flight upstream.
+ */
+typedef struct {
+    PassgenClient *client;				/**< Upstream client, dedicated to the aggregator */
+    uint64_t max_window_ns;				/**< Upper bound of the batching window */
+    AggregatorReply reply;				/**< Answer sender */
+    void *reply_context;				/**< Context of `reply` */
+    uint16_t free_head;					/**< First unused waiter */
+    AggregatorQueue queues[AGGREGATOR_QUEUE_COUNT];	/**< Pending requests by (type, length) */
+    AggregatorWaiter waiters[AGGREGATOR_MAX_WAITERS];	/**< Waiter storage */
+    AggregatorStats stats;				/**< Counters */
+} Aggregator;
+
+/* - - - - - - - - - - - - - - - - - - - END TYPES - - - - - - - - - - - - - - - - - - - */
+
+/* - - - - - - - - - - - - - - - - - - - - AGGREGATOR - - - - - - - - - - - - - - - - - - - - */
+
+/**
+ * @brief Initialises an aggregator with empty queues.
+ * @param[out] aggregator The aggregator.
+ * @param[in] client An open client, only used by this aggregator from now on.
+ * @param[in] max_window_us Upper bound of the batching window.
+ * @param[in] reply Answer sender.
+ * @param[in] context Context of `reply`.
+ */
+void aggregator_init(Aggregator *aggregator, PassgenClient *client, unsigned int max_window_us,
+                     AggregatorReply reply, void *context);
+
+/**
+ * @brief Queues a decoded `OP_GENERATE` request.
+ * @param[in,out] aggregator The aggregator.
+ * @param[in] peer Client to answer.
+ * @param[in] request The request.
+ * @param[in] now_ns Current monotonic time.
+ * @return `false` if every waiter is in use (the caller answers `STATUS_UNAVAILABLE`).
+ */
+bool aggregator_submit(Aggregator *aggregator, const AggregatorPeer *peer, const RequestView *request, uint64_t now_ns);
+
+/**
+ * @brief Forwards the queues that are full or whose window expired, and collects the upstream answers.
+ * @param[in,out] aggregator The aggregator.
+ * @param[in] now_ns Current monotonic time.
+ * @return `false` on a socket error of the upstream client.
+ */
+bool aggregator_service(Aggregator *aggregator, uint64_t now_ns);
+
+/**
+ * @brief Computes how long the event loop may sleep before a window expires.
+ * @param[in] aggregator The aggregator.
+ * @param[in] now_ns Current monotonic time.
+ * @return Milliseconds to wait, or -1 if no request is queued.
+ */
+int aggregator_poll_timeout(const Aggregator *aggregator, uint64_t now_ns);
+
+/**
+ * @brief Tells whether the requests of a type can be queued: passwords, identifiers and random bytes.
+ * @details Templates cannot: a queued request keeps no body.
+ * @param[in] type Type of a decoded request.
+ */
+bool aggregator_accepts(char type);
+
+/**
+ * @brief Encodes and sends the answer of a local request, bit-packed if it asked for it.
+ * @param[in] aggregator The aggregator (for its reply function).
+ * @param[in] peer Client to answer.
+ * @param[in] request The request being answered.
+ * @param[in] status `STATUS_OK` if `passwords` holds the passwords, an error otherwise.
+ * @param[in] passwords `count` passwords of `request->length` characters, back to back.
+ * @param[in] count Number of passwords.
+ */
+void aggregator_answer(const Aggregator *aggregator, const AggregatorPeer *peer, const RequestView *request,
+                       ResponseStatus status, const char *passwords, uint16_t count);
+
+/* - - - - - - - - - - - - - - - - - - - END AGGREGATOR - - - - - - - - - - - - - - - - - - - */
+
+#endif /* AGGREGATOR_H_ */